@@ -21,6 +21,30 @@
 #include <QDialog>
 #include <QHBoxLayout>
 #include <QFileInfo>
+#include <QDir>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <QProgressDialog>
+#include <QStatusBar>
+#include <QLineEdit>
+#include <QRegExp>
+#include <limits>
+#include <cmath>
+
+namespace {
+
+// Модальный индикатор хода долгой операции sgylib; появляется, если она идет дольше 0.5 с
+ProgressCallback dialogProgress(QProgressDialog& dialog) {
+    dialog.setWindowModality(Qt::WindowModal);
+    dialog.setMinimumDuration(500);
+    return [&dialog](const std::string& stage, int64_t current, int64_t total) {
+        dialog.setLabelText(QString::fromStdString(stage));
+        dialog.setValue(total > 0 ? static_cast<int>(current * 100 / total) : 0);
+        QCoreApplication::processEvents();
+    };
+}
+
+} // namespace
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent),
@@ -38,6 +62,10 @@ MainWindow::MainWindow(QWidget *parent)
     currentBrightness(0.0f),
     currentPerceptualCorrection(false),
     perceptualAction(nullptr),
+    followAction(nullptr),
+    followTimer(new QTimer(this)),
+    sampleMajorTimer(new QTimer(this)),
+    brickStoreTimer(new QTimer(this)),
     contrastSlider(nullptr),
     brightnessSlider(nullptr),
     currentFileName(""),
@@ -98,6 +126,15 @@ MainWindow::MainWindow(QWidget *parent)
     connect(viewer, &SegyViewer::traceInfoUnderCursor,
             this, &MainWindow::traceUnderCursor);
     connect(viewer, &SegyViewer::zoomChanged, this, &MainWindow::onZoomChanged);
+
+    followTimer->setInterval(1000); // Опрос размера файла раз в секунду
+    connect(followTimer, &QTimer::timeout, this, &MainWindow::onFollowTimer);
+
+    sampleMajorTimer->setInterval(500);
+    connect(sampleMajorTimer, &QTimer::timeout, this, &MainWindow::onSampleMajorTimer);
+
+    brickStoreTimer->setInterval(500);
+    connect(brickStoreTimer, &QTimer::timeout, this, &MainWindow::onBrickStoreTimer);
 }
 
 void MainWindow::createMenus() {
@@ -107,6 +144,16 @@ void MainWindow::createMenus() {
     connect(openTracesAct, &QAction::triggered, this, &MainWindow::openAsTraces);
     fileMenu->addAction(openTracesAct);
 
+    QAction* openGathersAct = new QAction("Open as Gathers...", this);
+    connect(openGathersAct, &QAction::triggered, this, &MainWindow::openAsGathers);
+    fileMenu->addAction(openGathersAct);
+
+    followAction = new QAction("Follow Growing File", this);
+    followAction->setCheckable(true);
+    followAction->setChecked(false);
+    connect(followAction, &QAction::toggled, this, &MainWindow::toggleFollowMode);
+    fileMenu->addAction(followAction);
+
     fileMenu->addSeparator();
     fileMenu->addAction("Exit", qApp, &QCoreApplication::quit);
 
@@ -144,6 +191,77 @@ void MainWindow::createMenus() {
     QAction* resetZoomAction = new QAction("Reset Zoom", this);
     connect(resetZoomAction, &QAction::triggered, this, &MainWindow::resetZoom);
     viewMenu->addAction(resetZoomAction);
+
+    QAction* sortTracesAction = new QAction("Sort Traces by Headers...", this);
+    connect(sortTracesAction, &QAction::triggered, this, &MainWindow::sortTracesByHeaders);
+    viewMenu->addAction(sortTracesAction);
+
+    // Навигация по сборкам (режим Open as Gathers)
+    QMenu* gatherMenu = menuBar()->addMenu("&Gathers");
+    QAction* prevGatherAction = new QAction("Previous Gather", this);
+    prevGatherAction->setShortcut(QKeySequence(Qt::Key_BracketLeft));
+    connect(prevGatherAction, &QAction::triggered, this, &MainWindow::previousGather);
+    gatherMenu->addAction(prevGatherAction);
+
+    QAction* nextGatherAction = new QAction("Next Gather", this);
+    nextGatherAction->setShortcut(QKeySequence(Qt::Key_BracketRight));
+    connect(nextGatherAction, &QAction::triggered, this, &MainWindow::nextGather);
+    gatherMenu->addAction(nextGatherAction);
+
+    QAction* goToGatherAction = new QAction("Go to Gather...", this);
+    connect(goToGatherAction, &QAction::triggered, this, &MainWindow::goToGather);
+    gatherMenu->addAction(goToGatherAction);
+
+    // Сечения 3D-куба по регулярной сетке инлайнов/кросслайнов
+    QMenu* geometryMenu = menuBar()->addMenu("&3D");
+    QAction* detectGeometryAction = new QAction("Detect Geometry...", this);
+    connect(detectGeometryAction, &QAction::triggered, this, &MainWindow::detectGeometry);
+    geometryMenu->addAction(detectGeometryAction);
+    geometryMenu->addSeparator();
+
+    QAction* inlineAction = new QAction("Inline...", this);
+    connect(inlineAction, &QAction::triggered, this, &MainWindow::showInlineSection);
+    geometryMenu->addAction(inlineAction);
+
+    QAction* crosslineAction = new QAction("Crossline...", this);
+    connect(crosslineAction, &QAction::triggered, this, &MainWindow::showCrosslineSection);
+    geometryMenu->addAction(crosslineAction);
+
+    QAction* timeSliceAction = new QAction("Time Slice...", this);
+    connect(timeSliceAction, &QAction::triggered, this, &MainWindow::showTimeSliceSection);
+    geometryMenu->addAction(timeSliceAction);
+
+    QAction* fenceAction = new QAction("Fence...", this);
+    connect(fenceAction, &QAction::triggered, this, &MainWindow::showFenceSection);
+    geometryMenu->addAction(fenceAction);
+
+    QAction* attributeMapAction = new QAction("Attribute Map...", this);
+    connect(attributeMapAction, &QAction::triggered, this, &MainWindow::showAttributeMapSection);
+    geometryMenu->addAction(attributeMapAction);
+    geometryMenu->addSeparator();
+
+    QAction* prevSectionAction = new QAction("Previous Section", this);
+    prevSectionAction->setShortcut(QKeySequence(Qt::CTRL + Qt::Key_BracketLeft));
+    connect(prevSectionAction, &QAction::triggered, this, &MainWindow::previousSection);
+    geometryMenu->addAction(prevSectionAction);
+
+    QAction* nextSectionAction = new QAction("Next Section", this);
+    nextSectionAction->setShortcut(QKeySequence(Qt::CTRL + Qt::Key_BracketRight));
+    connect(nextSectionAction, &QAction::triggered, this, &MainWindow::nextSection);
+    geometryMenu->addAction(nextSectionAction);
+
+    QAction* closeSectionAction = new QAction("Back to Traces", this);
+    connect(closeSectionAction, &QAction::triggered, this, &MainWindow::closeSection);
+    geometryMenu->addAction(closeSectionAction);
+    geometryMenu->addSeparator();
+
+    QAction* sampleMajorAction = new QAction("Build Time Slice Cache...", this);
+    connect(sampleMajorAction, &QAction::triggered, this, &MainWindow::buildSampleMajorCache);
+    geometryMenu->addAction(sampleMajorAction);
+
+    QAction* brickStoreAction = new QAction("Convert to Brick Store", this);
+    connect(brickStoreAction, &QAction::triggered, this, &MainWindow::buildBrickStore);
+    geometryMenu->addAction(brickStoreAction);
 }
 
 void MainWindow::setupScrollBar() {
@@ -172,12 +290,51 @@ void MainWindow::openSettings() {
     // Этот метод оставлен для совместимости, но не используется
 }
 
+QString MainWindow::cacheDirForFile(const QString& fileName) const {
+    // Каталог кэша определяется путем к файлу; актуальность содержимого проверяет SegyCache по отпечатку
+    QString root = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (root.isEmpty()) return QString();
+    QByteArray key = QCryptographicHash::hash(QFileInfo(fileName).absoluteFilePath().toUtf8(),
+                                              QCryptographicHash::Sha1).toHex();
+    QString dir = root + "/segy/" + QString::fromLatin1(key);
+    if (!QDir().mkpath(dir)) return QString();
+    return dir;
+}
+
+void MainWindow::showCacheWarnings() {
+    // Файл открыт и без кэша, но следующие открытия будут медленнее - сообщаем причину
+    std::vector<std::string> warnings = dataManager->takeCacheWarnings();
+    if (warnings.empty()) return;
+    QStringList lines;
+    for (const std::string& warning : warnings) lines << QString::fromStdString(warning);
+    QMessageBox::warning(this, "Cache", "The file cache could not be used:\n\n" + lines.join("\n"));
+}
+
+QStringList MainWindow::takeWarnings() {
+    QStringList lines;
+    for (const std::string& warning : dataManager->takeWarnings()) lines << QString::fromStdString(warning);
+    return lines;
+}
+
+void MainWindow::showFailure(const QString& title, const QString& message) {
+    // Причина - из списка ошибок SegyDataManager, сам метод вернул только false
+    QStringList reasons = takeWarnings();
+    QMessageBox::warning(this, title, reasons.isEmpty() ? message : message + ":\n\n" + reasons.join("\n"));
+}
+
 void MainWindow::openAsTraces() {
     QString fileName = QFileDialog::getOpenFileName(this, "Open SEG-Y File", "", "SEG-Y Files (*.sgy *.segy)");
     if (fileName.isEmpty())
         return;
 
-    if (!dataManager->loadFile(fileName.toStdString())) {
+    loadFile(fileName);
+}
+
+bool MainWindow::loadFile(const QString& fileName) {
+    // Построение копии прежнего файла отменяется при загрузке нового
+    sampleMajorTimer->stop();
+    brickStoreTimer->stop();
+    if (!dataManager->loadFile(fileName.toStdString(), cacheDirForFile(fileName).toStdString())) {
         QMessageBox::warning(this, "Error", "Failed to load SEG-Y file");
         // Сбрасываем информацию о файле в SettingsPanel
         settingsPanel->setFileInfo(0, 0.0f, 0);
@@ -189,13 +346,17 @@ void MainWindow::openAsTraces() {
         currentGain = 1.0f;
         settingsPanel->setGain(currentGain);
         viewer->setGain(currentGain);
-        return;
+        return false;
     }
     
     // Сохраняем имя файла и обновляем заголовок окна
     currentFileName = fileName;
     updateWindowTitle();
 
+    // Статистика амплитуд берется из кэша файла; пересчет только при смене отпечатка
+    dataManager->computeGlobalStats();
+    showCacheWarnings();
+
     viewer->setDataManager(dataManager);
     viewer->setCurrentPage(0);
     
@@ -292,6 +453,7 @@ void MainWindow::openAsTraces() {
     }
     
     viewer->update();
+    return true;
 }
 
 void MainWindow::onScrollBarChanged(int value) {
@@ -313,17 +475,478 @@ void MainWindow::traceUnderCursor(int traceIndex, int sampleIndex, float amplitu
     // Обновляем информацию о заголовке трассы
     if (dataManager) {
         std::vector<uint8_t> traceHeader = dataManager->getTraceHeader(traceIndex);
-        traceInfoPanel->updateTraceInfo(traceIndex, traceHeader);
+        traceInfoPanel->updateTraceInfo(dataManager->fileTraceIndex(traceIndex), traceHeader);
     }
 }
 
 void MainWindow::openAsGathers() {
-    // Заглушка для метода открытия как gathers
-    QMessageBox::information(this, "Info", "Gathers functionality not implemented yet");
-    
-    // TODO: При реализации gathers добавить обновление заголовка окна
-    // currentFileName = fileName;
-    // updateWindowTitle();
+    QString fileName = QFileDialog::getOpenFileName(this, "Open SEG-Y File as Gathers", "", "SEG-Y Files (*.sgy *.segy)");
+    if (fileName.isEmpty())
+        return;
+
+    // Ключ сборки выбирается из полей заголовка трассы
+    QStringList keys;
+    keys << "FieldRecord" << "CDP" << "EnergySourcePoint" << "offset" << "INLINE_3D" << "CROSSLINE_3D" << "TraceNumber";
+    bool ok;
+    QString key = QInputDialog::getItem(this, "Open as Gathers", "Gather key:", keys, 0, true, &ok);
+    if (!ok || key.isEmpty())
+        return;
+
+    if (!loadFile(fileName))
+        return;
+
+    // Индекс строится один раз и сохраняется в кэше файла
+    QProgressDialog progressDialog("Indexing trace headers...", QString(), 0, 100, this);
+    ProgressCallback progress = dialogProgress(progressDialog);
+    bool indexed = dataManager->setGatherKey(key.toStdString(), progress);
+    progressDialog.close();
+    if (!indexed) {
+        showFailure("Error", QString("Failed to index gathers by %1").arg(key));
+        return;
+    }
+    showGather(0);
+}
+
+void MainWindow::showGather(int gather) {
+    if (!dataManager->gatherMode()) return;
+
+    dataManager->setCurrentGather(gather);
+    int gatherSize = dataManager->traceCount();
+
+    // Страница - ровно одна сборка
+    settingsPanel->blockSignals(true);
+    settingsPanel->setTracesPerPage(gatherSize);
+    settingsPanel->blockSignals(false);
+    viewer->resetZoom();
+    viewer->setTracesPerPage(gatherSize);
+    viewer->setStartTrace(0);
+
+    scrollBar->blockSignals(true);
+    scrollBar->setMaximum(0);
+    scrollBar->setValue(0);
+    scrollBar->setPageStep(std::max(1, gatherSize));
+    scrollBar->blockSignals(false);
+
+    updateWindowTitle();
+    viewer->update();
+}
+
+void MainWindow::sortTracesByHeaders() {
+    if (currentFileName.isEmpty()) return;
+
+    std::vector<std::string> current = dataManager->getOrderingKeys();
+    QStringList currentKeys;
+    for (const auto& key : current) currentKeys << QString::fromStdString(key);
+
+    bool ok;
+    QString text = QInputDialog::getText(this, "Sort Traces by Headers",
+                                         "Header keys, comma separated (empty - file order):",
+                                         QLineEdit::Normal, currentKeys.join(", "), &ok);
+    if (!ok) return;
+
+    std::vector<std::string> keys;
+    for (const QString& key : text.split(QRegExp("[,\\s]+"), QString::SkipEmptyParts)) {
+        keys.push_back(key.toStdString());
+    }
+
+    // Перестановка строится по заголовкам один раз и сохраняется в кэше файла
+    QProgressDialog progressDialog("Sorting traces...", QString(), 0, 100, this);
+    ProgressCallback progress = dialogProgress(progressDialog);
+    bool sorted = dataManager->setTraceOrdering(keys, progress);
+    progressDialog.close();
+    if (!sorted) {
+        showFailure("Error", QString("Failed to sort traces by %1").arg(text));
+    } else {
+        // Перестановка построена, но не сохранилась в кэше
+        QStringList warnings = takeWarnings();
+        if (!warnings.isEmpty()) statusBar()->showMessage(warnings.join("; "), 10000);
+    }
+
+    // Переход из режима сборок возвращает страницы фиксированного размера
+    int tracesPerPage = settingsPanel->getTracesPerPage();
+    if (tracesPerPage <= 0) tracesPerPage = std::min(dataManager->traceCount(), 5000);
+    viewer->resetZoom();
+    viewer->setTracesPerPage(tracesPerPage);
+    scrollBar->setMaximum(std::max(0, dataManager->traceCount() - tracesPerPage));
+    scrollBar->setPageStep(tracesPerPage);
+    viewer->setStartTrace(scrollBar->value());
+    updateWindowTitle();
+    viewer->update();
+}
+
+void MainWindow::nextGather() {
+    if (dataManager->gatherMode() && dataManager->currentGather() + 1 < dataManager->gatherCount()) {
+        showGather(dataManager->currentGather() + 1);
+    }
+}
+
+void MainWindow::previousGather() {
+    if (dataManager->gatherMode() && dataManager->currentGather() > 0) {
+        showGather(dataManager->currentGather() - 1);
+    }
+}
+
+void MainWindow::goToGather() {
+    if (!dataManager->gatherMode()) return;
+
+    bool ok;
+    int value = QInputDialog::getInt(this, "Go to Gather",
+                                     QString("%1 value:").arg(QString::fromStdString(dataManager->getGatherKey())),
+                                     dataManager->gatherValue(dataManager->currentGather()),
+                                     std::numeric_limits<int>::min(), std::numeric_limits<int>::max(), 1, &ok);
+    if (!ok) return;
+
+    // Ближайшая сборка с значением не меньше заданного
+    int gather = 0;
+    while (gather + 1 < dataManager->gatherCount() && dataManager->gatherValue(gather) < value) ++gather;
+    showGather(gather);
+}
+
+void MainWindow::detectGeometry() {
+    if (currentFileName.isEmpty()) return;
+
+    // Номера линий берутся из байтов заголовка: по умолчанию 189/193 (SEG-Y rev1)
+    GeometryFields fields;
+    bool ok;
+    fields.inline_field.offset = QInputDialog::getInt(this, "Detect Geometry", "Inline header byte (1-based, 4-byte field):",
+                                                      fields.inline_field.offset, 1, 237, 1, &ok);
+    if (!ok) return;
+    fields.crossline_field.offset = QInputDialog::getInt(this, "Detect Geometry", "Crossline header byte (1-based, 4-byte field):",
+                                                         fields.crossline_field.offset, 1, 237, 1, &ok);
+    if (!ok) return;
+
+    QProgressDialog progressDialog("Reading trace headers...", QString(), 0, 100, this);
+    ProgressCallback progress = dialogProgress(progressDialog);
+    bool detected = dataManager->detectGeometry(fields, progress);
+    progressDialog.close();
+
+    const SurveyGeometry& geometry = dataManager->getGeometry();
+    if (!detected) {
+        QString reason = QString::fromStdString(geometry.reason());
+        if (reason.isEmpty()) {
+            // Заголовки не прочитались - причина в списке ошибок
+            showFailure("Detect Geometry", "Failed to read inline/crossline headers");
+            return;
+        }
+        QMessageBox::warning(this, "Detect Geometry", QString("Traces do not form a regular 3D grid: %1").arg(reason));
+        return;
+    }
+    statusBar()->showMessage(QString("Inlines %1-%2 step %3, crosslines %4-%5 step %6")
+                                 .arg(geometry.inline_min()).arg(geometry.inline_max()).arg(geometry.inline_step())
+                                 .arg(geometry.crossline_min()).arg(geometry.crossline_max()).arg(geometry.crossline_step()),
+                             10000);
+    showSection(SegyDataManager::GeometryView::Inline, geometry.inline_min());
+}
+
+void MainWindow::showSection(SegyDataManager::GeometryView view, int value) {
+    bool shown = false;
+    switch (view) {
+    case SegyDataManager::GeometryView::Inline: shown = dataManager->showInline(value); break;
+    case SegyDataManager::GeometryView::Crossline: shown = dataManager->showCrossline(value); break;
+    case SegyDataManager::GeometryView::TimeSlice: shown = dataManager->showTimeSlice(value); break;
+    // Разрез задается вершинами, а не номером: перечитывается по текущим
+    case SegyDataManager::GeometryView::Fence: shown = dataManager->showFence(dataManager->getFenceVertices()); break;
+    case SegyDataManager::GeometryView::AttributeMap: {
+        AttributeMap map = dataManager->getAttributeMap();
+        shown = dataManager->showAttributeMap(map.attribute, map.first_sample, map.n_samples);
+        break;
+    }
+    case SegyDataManager::GeometryView::None: break;
+    }
+    if (!shown) {
+        QStringList warnings = takeWarnings();
+        if (!warnings.isEmpty()) QMessageBox::warning(this, "Section", warnings.join("\n"));
+        return;
+    }
+    resetSectionPage();
+    // Сечение показано, но с оговорками (например, прочитано из файла вместо копии)
+    QStringList warnings = takeWarnings();
+    if (!warnings.isEmpty()) statusBar()->showMessage(warnings.join("; "), 10000);
+}
+
+void MainWindow::resetSectionPage() {
+    // Страница - сечение целиком, как и в режиме сборок
+    int columns = dataManager->traceCount();
+    settingsPanel->blockSignals(true);
+    settingsPanel->setTracesPerPage(columns);
+    settingsPanel->blockSignals(false);
+    viewer->resetZoom();
+    viewer->setTracesPerPage(columns);
+    viewer->setStartTrace(0);
+
+    scrollBar->blockSignals(true);
+    scrollBar->setMaximum(0);
+    scrollBar->setValue(0);
+    scrollBar->setPageStep(std::max(1, columns));
+    scrollBar->blockSignals(false);
+
+    updateWindowTitle();
+    viewer->update();
+}
+
+void MainWindow::showInlineSection() {
+    const SurveyGeometry& geometry = dataManager->getGeometry();
+    if (!geometry.regular()) return;
+    bool ok;
+    int value = QInputDialog::getInt(this, "Inline", "Inline number:", geometry.inline_min(),
+                                     geometry.inline_min(), geometry.inline_max(), geometry.inline_step(), &ok);
+    if (ok) showSection(SegyDataManager::GeometryView::Inline, value);
+}
+
+void MainWindow::showCrosslineSection() {
+    const SurveyGeometry& geometry = dataManager->getGeometry();
+    if (!geometry.regular()) return;
+    bool ok;
+    int value = QInputDialog::getInt(this, "Crossline", "Crossline number:", geometry.crossline_min(),
+                                     geometry.crossline_min(), geometry.crossline_max(), geometry.crossline_step(), &ok);
+    if (ok) showSection(SegyDataManager::GeometryView::Crossline, value);
+}
+
+void MainWindow::showTimeSliceSection() {
+    if (!dataManager->getGeometry().regular()) return;
+    float dt = dataManager->getSampleInterval();
+    int maxTime = static_cast<int>((dataManager->sampleCount() - 1) * dt);
+    bool ok;
+    int timeMs = QInputDialog::getInt(this, "Time Slice", "Time (ms):", 0, 0, maxTime, 1, &ok);
+    if (ok && dt > 0) showSection(SegyDataManager::GeometryView::TimeSlice, static_cast<int>(std::lround(timeMs / dt)));
+}
+
+void MainWindow::showFenceSection() {
+    const SurveyGeometry& geometry = dataManager->getGeometry();
+    if (!geometry.regular()) return;
+    QString example = QString("%1,%2; %3,%4").arg(geometry.inline_min()).arg(geometry.crossline_min())
+                          .arg(geometry.inline_max()).arg(geometry.crossline_max());
+    bool ok;
+    QString text = QInputDialog::getText(this, "Fence", "Vertices (inline,crossline; ...):", QLineEdit::Normal, example, &ok);
+    if (!ok) return;
+
+    std::vector<FenceVertex> vertices;
+    for (const QString& point : text.split(';', QString::SkipEmptyParts)) {
+        QStringList coords = point.split(',');
+        bool ilOk = false, xlOk = false;
+        FenceVertex vertex;
+        if (coords.size() == 2) {
+            vertex.inline_no = coords[0].trimmed().toDouble(&ilOk);
+            vertex.crossline_no = coords[1].trimmed().toDouble(&xlOk);
+        }
+        if (!ilOk || !xlOk) {
+            QMessageBox::warning(this, "Fence", QString("Invalid vertex: %1").arg(point.trimmed()));
+            return;
+        }
+        vertices.push_back(vertex);
+    }
+    if (vertices.size() < 2) {
+        QMessageBox::warning(this, "Fence", "A fence needs at least two vertices.");
+        return;
+    }
+    if (!dataManager->showFence(vertices)) {
+        showFailure("Fence", "Failed to show the fence");
+        return;
+    }
+    resetSectionPage();
+}
+
+void MainWindow::showAttributeMapSection() {
+    if (!dataManager->getGeometry().regular()) return;
+    float dt = dataManager->getSampleInterval();
+    if (dt <= 0) return;
+    int maxTime = static_cast<int>((dataManager->sampleCount() - 1) * dt);
+
+    QStringList attributes;
+    const WindowAttribute kinds[] = { WindowAttribute::Rms, WindowAttribute::MeanAbs, WindowAttribute::Max, WindowAttribute::Min };
+    for (WindowAttribute kind : kinds) attributes << window_attribute_name(kind);
+    bool ok;
+    QString name = QInputDialog::getItem(this, "Attribute Map", "Attribute:", attributes, 0, false, &ok);
+    if (!ok) return;
+    int fromMs = QInputDialog::getInt(this, "Attribute Map", "Window start (ms):", 0, 0, maxTime, 1, &ok);
+    if (!ok) return;
+    int toMs = QInputDialog::getInt(this, "Attribute Map", "Window end (ms):", maxTime, fromMs, maxTime, 1, &ok);
+    if (!ok) return;
+
+    int firstSample = static_cast<int>(std::lround(fromMs / dt));
+    int lastSample = std::min(dataManager->sampleCount() - 1, static_cast<int>(std::lround(toMs / dt)));
+    QProgressDialog progressDialog("Extracting attribute map...", QString(), 0, 100, this);
+    ProgressCallback progress = dialogProgress(progressDialog);
+    bool shown = dataManager->showAttributeMap(kinds[attributes.indexOf(name)], firstSample,
+                                               lastSample - firstSample + 1, progress);
+    progressDialog.close();
+    if (!shown) {
+        showFailure("Attribute Map", "Failed to extract the attribute map");
+        return;
+    }
+    resetSectionPage();
+}
+
+void MainWindow::nextSection() {
+    const SurveyGeometry& geometry = dataManager->getGeometry();
+    int value = dataManager->geometryViewValue();
+    switch (dataManager->geometryView()) {
+    case SegyDataManager::GeometryView::Inline:
+        if (value < geometry.inline_max()) showSection(SegyDataManager::GeometryView::Inline, value + geometry.inline_step());
+        break;
+    case SegyDataManager::GeometryView::Crossline:
+        if (value < geometry.crossline_max()) showSection(SegyDataManager::GeometryView::Crossline, value + geometry.crossline_step());
+        break;
+    case SegyDataManager::GeometryView::TimeSlice:
+        if (value + 1 < dataManager->sampleCount()) showSection(SegyDataManager::GeometryView::TimeSlice, value + 1);
+        break;
+    case SegyDataManager::GeometryView::Fence:
+    case SegyDataManager::GeometryView::AttributeMap:
+    case SegyDataManager::GeometryView::None:
+        break;
+    }
+}
+
+void MainWindow::previousSection() {
+    const SurveyGeometry& geometry = dataManager->getGeometry();
+    int value = dataManager->geometryViewValue();
+    switch (dataManager->geometryView()) {
+    case SegyDataManager::GeometryView::Inline:
+        if (value > geometry.inline_min()) showSection(SegyDataManager::GeometryView::Inline, value - geometry.inline_step());
+        break;
+    case SegyDataManager::GeometryView::Crossline:
+        if (value > geometry.crossline_min()) showSection(SegyDataManager::GeometryView::Crossline, value - geometry.crossline_step());
+        break;
+    case SegyDataManager::GeometryView::TimeSlice:
+        if (value > 0) showSection(SegyDataManager::GeometryView::TimeSlice, value - 1);
+        break;
+    case SegyDataManager::GeometryView::Fence:
+    case SegyDataManager::GeometryView::AttributeMap:
+    case SegyDataManager::GeometryView::None:
+        break;
+    }
+}
+
+void MainWindow::closeSection() {
+    if (dataManager->geometryView() == SegyDataManager::GeometryView::None) return;
+    dataManager->clearGeometryView();
+
+    int tracesPerPage = settingsPanel->getTracesPerPage();
+    if (tracesPerPage <= 0) tracesPerPage = std::min(dataManager->traceCount(), 5000);
+    viewer->resetZoom();
+    viewer->setTracesPerPage(tracesPerPage);
+    scrollBar->setMaximum(std::max(0, dataManager->traceCount() - tracesPerPage));
+    scrollBar->setPageStep(tracesPerPage);
+    viewer->setStartTrace(scrollBar->value());
+    updateWindowTitle();
+    viewer->update();
+}
+
+void MainWindow::buildSampleMajorCache() {
+    if (currentFileName.isEmpty() || dataManager->sampleMajorBuildRunning()) return;
+
+    QStringList encodings;
+    encodings << "float32" << "int16 (per-trace scale)";
+    bool ok;
+    QString encoding = QInputDialog::getItem(this, "Build Time Slice Cache",
+                                             "Sample encoding of the transposed copy:", encodings, 0, false, &ok);
+    if (!ok) return;
+
+    // Копия строится в фоне; до ее готовности срезы читаются из SEG-Y частичными чтениями
+    SampleEncoding sampleEncoding = encoding == encodings[1] ? SampleEncoding::Int16 : SampleEncoding::Float32;
+    if (!dataManager->startSampleMajorBuild(sampleEncoding)) {
+        QMessageBox::warning(this, "Build Time Slice Cache", "The cache directory for this file is not available.");
+        return;
+    }
+    sampleMajorTimer->start();
+    updateWindowTitle();
+}
+
+void MainWindow::onSampleMajorTimer() {
+    bool ready = dataManager->pollSampleMajorBuild();
+    if (dataManager->sampleMajorBuildRunning()) {
+        updateWindowTitle();
+        return;
+    }
+    sampleMajorTimer->stop();
+    updateWindowTitle();
+    if (!ready) {
+        showFailure("Build Time Slice Cache", "Failed to build the transposed copy of the data");
+        return;
+    }
+    // Текущий срез перечитывается уже из копии
+    if (dataManager->geometryView() == SegyDataManager::GeometryView::TimeSlice) {
+        showSection(SegyDataManager::GeometryView::TimeSlice, dataManager->geometryViewValue());
+    }
+    viewer->update();
+}
+
+void MainWindow::buildBrickStore() {
+    if (currentFileName.isEmpty() || dataManager->brickStoreBuildRunning()) return;
+    if (!dataManager->getGeometry().regular()) {
+        QMessageBox::information(this, "Convert to Brick Store", "Detect a regular 3D geometry first (3D > Detect Geometry).");
+        return;
+    }
+    if (!dataManager->startBrickStoreBuild()) {
+        QMessageBox::warning(this, "Convert to Brick Store", "The cache directory for this file is not available.");
+        return;
+    }
+    brickStoreTimer->start();
+    updateWindowTitle();
+}
+
+void MainWindow::onBrickStoreTimer() {
+    bool ready = dataManager->pollBrickStoreBuild();
+    if (dataManager->brickStoreBuildRunning()) {
+        updateWindowTitle();
+        return;
+    }
+    brickStoreTimer->stop();
+    updateWindowTitle();
+    if (!ready) {
+        showFailure("Convert to Brick Store", "Failed to convert the volume to bricks");
+        return;
+    }
+    // Текущее сечение перечитывается уже из блоков (карта атрибута читается из SEG-Y)
+    if (dataManager->geometryView() != SegyDataManager::GeometryView::None &&
+        dataManager->geometryView() != SegyDataManager::GeometryView::AttributeMap) {
+        showSection(dataManager->geometryView(), dataManager->geometryViewValue());
+    }
+    viewer->update();
+}
+
+void MainWindow::toggleFollowMode(bool enabled) {
+    if (enabled) {
+        followTimer->start();
+    } else {
+        followTimer->stop();
+    }
+}
+
+void MainWindow::onFollowTimer() {
+    if (currentFileName.isEmpty()) return;
+
+    // Дочитываются только новые трассы: статистика и индексы дополняются, а не строятся заново
+    bool atLastGather = dataManager->gatherMode() && dataManager->currentGather() + 1 >= dataManager->gatherCount();
+    int added = dataManager->refresh();
+    // Ошибки дочитывания не останавливают слежение - окно на каждый тик не выводим
+    QStringList warnings = takeWarnings();
+    if (!warnings.isEmpty()) statusBar()->showMessage(warnings.join("; "), 10000);
+    if (added <= 0) return;
+
+    if (dataManager->gatherMode()) {
+        settingsPanel->setFileInfo(dataManager->sampleCount(), dataManager->getSampleInterval(), dataManager->fileTraceCount());
+        showGather(atLastGather ? dataManager->gatherCount() - 1 : dataManager->currentGather());
+        return;
+    }
+    if (dataManager->geometryView() != SegyDataManager::GeometryView::None) {
+        // Сечение уже перечитано по обновленной геометрии
+        settingsPanel->setFileInfo(dataManager->sampleCount(), dataManager->getSampleInterval(), dataManager->fileTraceCount());
+        resetSectionPage();
+        return;
+    }
+
+    int totalTraces = dataManager->traceCount();
+    settingsPanel->setFileInfo(dataManager->sampleCount(), dataManager->getSampleInterval(), totalTraces);
+
+    // Если пользователь смотрел конец файла, переходим к новой последней странице
+    bool atEnd = scrollBar->value() >= scrollBar->maximum();
+    int maxValue = std::max(0, totalTraces - viewer->getTracesPerPage());
+    scrollBar->setMaximum(maxValue);
+    if (atEnd) {
+        scrollBar->setValue(maxValue);
+    }
+    viewer->update();
 }
 
 MainWindow::~MainWindow() {
@@ -685,7 +1308,44 @@ void MainWindow::updateWindowTitle() {
         // Извлекаем только имя файла без пути
         QFileInfo fileInfo(currentFileName);
         QString fileName = fileInfo.fileName();
-        setWindowTitle(QString("SEG-Y Viewer - %1").arg(fileName));
+        if (dataManager->gatherMode()) {
+            int gather = dataManager->currentGather();
+            setWindowTitle(QString("SEG-Y Viewer - %1 - %2 %3 (%4/%5)")
+                           .arg(fileName)
+                           .arg(QString::fromStdString(dataManager->getGatherKey()))
+                           .arg(dataManager->gatherValue(gather))
+                           .arg(gather + 1)
+                           .arg(dataManager->gatherCount()));
+        } else if (dataManager->geometryView() != SegyDataManager::GeometryView::None) {
+            int value = dataManager->geometryViewValue();
+            QString section;
+            switch (dataManager->geometryView()) {
+            case SegyDataManager::GeometryView::Inline: section = QString("inline %1").arg(value); break;
+            case SegyDataManager::GeometryView::Crossline: section = QString("crossline %1").arg(value); break;
+            case SegyDataManager::GeometryView::Fence: section = QString("fence (%1 vertices)").arg(value); break;
+            case SegyDataManager::GeometryView::AttributeMap: {
+                const AttributeMap& map = dataManager->getAttributeMap();
+                float dt = dataManager->getSampleInterval();
+                section = QString("%1 map %2-%3 ms").arg(window_attribute_name(map.attribute))
+                              .arg(map.first_sample * dt).arg((map.first_sample + map.n_samples - 1) * dt);
+                break;
+            }
+            default: section = QString("time slice %1 ms").arg(value * dataManager->getSampleInterval()); break;
+            }
+            setWindowTitle(QString("SEG-Y Viewer - %1 - %2").arg(fileName).arg(section));
+        } else if (dataManager->orderingMode()) {
+            QStringList keys;
+            for (const auto& key : dataManager->getOrderingKeys()) keys << QString::fromStdString(key);
+            setWindowTitle(QString("SEG-Y Viewer - %1 - sorted by %2").arg(fileName).arg(keys.join(", ")));
+        } else {
+            setWindowTitle(QString("SEG-Y Viewer - %1").arg(fileName));
+        }
+        if (dataManager->sampleMajorBuildRunning()) {
+            setWindowTitle(windowTitle() + QString(" [building slice cache %1%]").arg(dataManager->sampleMajorBuildProgress()));
+        }
+        if (dataManager->brickStoreBuildRunning()) {
+            setWindowTitle(windowTitle() + QString(" [converting to bricks %1%]").arg(dataManager->brickStoreBuildProgress()));
+        }
     }
 }
 
@@ -4,6 +4,8 @@
 #include <QScrollBar>
 #include <QDebug>
 #include <QWheelEvent>
+#include <QTimer>
+#include <QStringList>
 #include "SegyViewer.hpp"
 #include "SegyDataManager.hpp"
 #include "StatusPanel.hpp"
@@ -49,10 +51,49 @@ private slots:
     // Метод для обновления заголовка окна
     void updateWindowTitle();
 
+    // Режим слежения за дописываемым файлом
+    void toggleFollowMode(bool enabled);
+    void onFollowTimer();
+
+    // Виртуальная сортировка трасс по полям заголовка
+    void sortTracesByHeaders();
+
+    // Навигация по сборкам
+    void nextGather();
+    void previousGather();
+    void goToGather();
+
+    // Сечения 3D-куба: инлайн, кросслайн, временной срез
+    void detectGeometry();
+    void showInlineSection();
+    void showCrosslineSection();
+    void showTimeSliceSection();
+    void showFenceSection();
+    void showAttributeMapSection();
+    void nextSection();
+    void previousSection();
+    void closeSection();
+
+    // Транспонированная копия данных для быстрых срезов
+    void buildSampleMajorCache();
+    void onSampleMajorTimer();
+
+    // Блочное хранилище 3D-куба
+    void buildBrickStore();
+    void onBrickStoreTimer();
+
 private:
     void wheelEvent(QWheelEvent* event) override;
     void createMenus();
     void setupScrollBar();
+    bool loadFile(const QString& fileName);
+    void showCacheWarnings();
+    QStringList takeWarnings();
+    void showFailure(const QString& title, const QString& message);
+    void showGather(int gather);
+    void showSection(SegyDataManager::GeometryView view, int value);
+    void resetSectionPage();
+    QString cacheDirForFile(const QString& fileName) const; // пустая строка, если кэш недоступен
     
     SegyViewer* viewer;
     SegyDataManager* dataManager;
@@ -74,6 +115,14 @@ private:
     
     // Ссылки на действия меню для обновления состояния
     QAction* perceptualAction;
+    QAction* followAction;
+
+    // Опрос размера файла в режиме слежения
+    QTimer* followTimer;
+    // Опрос фонового построения транспонированной копии
+    QTimer* sampleMajorTimer;
+    // Опрос фоновой конвертации в блочное хранилище
+    QTimer* brickStoreTimer;
     
     // Ссылки на слайдеры для обновления настроек
     QSlider* contrastSlider;
@@ -4,14 +4,43 @@
 #include <algorithm>
 #include <limits>
 #include <cmath>
+#include <chrono>
+#include <fstream>
 
 SegyDataManager::SegyDataManager(int cacheSize)
     : cacheSize(cacheSize), totalTraces(0), 
-      globalMinAmplitude(0.0f), globalMaxAmplitude(1.0f), globalStatsValid(false) {
+      globalStatsValid(false), statsFromCache(false), currentGatherIdx(-1),
+      geomView(GeometryView::None), geomViewValue(0),
+      sampleStoreCancel(false), sampleStoreProgress(0),
+      brickStoreCancel(false), brickStoreProgress(0), brickCacheSize(256) {
 }
 
-bool SegyDataManager::loadFile(const std::string& filename) {
+SegyDataManager::~SegyDataManager() {
+    // Фоновые задачи обращаются к членам класса - дожидаемся их до разрушения
+    waitForPrefetch();
+    cancelSampleMajorBuild();
+    cancelBrickStoreBuild();
+}
+
+bool SegyDataManager::loadFile(const std::string& filename, const std::string& cacheDir) {
+    clearGatherMode();
+    clearTraceOrdering();
+    clearGeometryView();
+    geometry = SurveyGeometry();
+    cancelSampleMajorBuild();
+    sampleStore.reset();
+    cancelBrickStoreBuild();
+    brickStore.reset();
+    brickCache.clear();
+    brickLru.clear();
     this->filename = filename;
+    traceMaps.clear();
+    cache.reset();
+    amplitudeStats = AmplitudeStats();
+    globalStatsValid = false;
+    statsFromCache = false;
+    cacheWarnings.clear();
+    warnings.clear();
     try {
         reader = std::unique_ptr<SegyReader>(new SegyReader(filename));
         totalTraces = reader->num_traces();
@@ -19,6 +48,39 @@ bool SegyDataManager::loadFile(const std::string& filename) {
         // Очищаем кэш при загрузке нового файла
         clearCache();
         
+        // Кэш на диске не обязателен: при ошибке просто работаем без него
+        if (!cacheDir.empty()) {
+            try {
+                cache.reset(new SegyCache(cacheDir, filename));
+                if (cache->load_stats(amplitudeStats)) {
+                    globalStatsValid = true;
+                    statsFromCache = true;
+                }
+                // Транспонированная копия от прошлого открытия (если строилась)
+                std::string storePath = cache->sample_major_path();
+                if (std::ifstream(storePath).good()) {
+                    try {
+                        sampleStore.reset(new SampleMajorStore(storePath));
+                        if (sampleStore->num_samples() != reader->num_samples()) sampleStore.reset();
+                    } catch (const std::exception& e) {
+                        cacheWarnings.push_back(std::string("Sample-major store ignored: ") + e.what());
+                    }
+                }
+                // Блочное хранилище; используется после определения совпадающей геометрии
+                std::string bricksPath = cache->brick_store_path();
+                if (std::ifstream(bricksPath).good()) {
+                    try {
+                        brickStore.reset(new BrickStore(bricksPath));
+                        if (brickStore->num_samples() != reader->num_samples()) brickStore.reset();
+                    } catch (const std::exception& e) {
+                        cacheWarnings.push_back(std::string("Brick store ignored: ") + e.what());
+                    }
+                }
+            } catch (const std::exception& e) {
+                cacheWarnings.push_back(std::string("SEG-Y cache disabled: ") + e.what());
+                cache.reset();
+            }
+        }
 
         return true;
         
@@ -36,8 +98,20 @@ std::vector<std::vector<float>> SegyDataManager::getTracesPage(int page, int tra
 }
 
 std::vector<std::vector<float>> SegyDataManager::getTracesRange(int startTrace, int count) const {
+    if (virtualPageMode()) {
+        // Виртуальная страница уже загружена целиком при переходе на нее
+        int pageSize = static_cast<int>(pageTraces.size());
+        if (startTrace < 0 || startTrace >= pageSize) return {};
+        int end = std::min(startTrace + count, pageSize);
+        return std::vector<std::vector<float>>(pageTraces.begin() + startTrace, pageTraces.begin() + end);
+    }
+
     if (startTrace < 0 || startTrace >= totalTraces) return {};
     int end = std::min(startTrace + count, totalTraces);
+
+    if (ordering) {
+        return getTracesByIndices(ordering->physical_range(startTrace, end - startTrace));
+    }
     
     std::vector<std::vector<float>> result;
     result.reserve(end - startTrace);
@@ -94,7 +168,114 @@ void SegyDataManager::updateLRU(int traceIndex) const {
     lruList.push_back(traceIndex);
 }
 
+std::vector<std::vector<float>> SegyDataManager::getTracesByIndices(const std::vector<int>& indices) const {
+    std::vector<std::vector<float>> result(indices.size());
+    if (!reader) return result;
+
+    // Трассы из кэша берутся сразу, остальные читаются отсортированными объединенными сериями
+    std::unordered_map<int, std::vector<size_t>> missing;
+    std::vector<int> missingTraces;
+    for (size_t i = 0; i < indices.size(); ++i) {
+        int trace = indices[i];
+        if (trace < 0 || trace >= totalTraces) continue;
+        auto it = traceCache.find(trace);
+        if (it != traceCache.end()) {
+            updateLRU(trace);
+            result[i] = it->second;
+        } else {
+            std::vector<size_t>& positions = missing[trace];
+            if (positions.empty()) missingTraces.push_back(trace);
+            positions.push_back(i);
+        }
+    }
+
+    for (const TraceReadRun& run : coalesce_trace_reads(missingTraces, READ_GAP_TRACES)) {
+        std::vector<std::vector<float>> traces;
+        try {
+            traces = reader->get_traces(run.first_trace, run.count);
+        } catch (const std::exception& e) {
+            continue; // Оставляем пустые трассы, как и getTraceFromCache
+        }
+        for (int k = 0; k < run.count; ++k) {
+            auto it = missing.find(run.first_trace + k);
+            if (it == missing.end()) continue; // трасса из промежутка между нужными
+            for (size_t pos : it->second) result[pos] = traces[k];
+            addToCache(run.first_trace + k, traces[k]);
+        }
+    }
+    return result;
+}
+
+int SegyDataManager::pageSampleCount() const {
+    if (virtualPageMode()) return pageTraces.empty() ? 0 : static_cast<int>(pageTraces[0].size());
+    return sampleCount();
+}
+
+bool SegyDataManager::sampleStoreCovers(const std::vector<int>& traces) const {
+    if (!sampleStore) return false;
+    for (int trace : traces) {
+        if (trace < 0 || trace >= sampleStore->num_traces()) return false;
+    }
+    return true;
+}
+
+std::vector<std::vector<float>> SegyDataManager::getTracesWindow(int startTrace, int count, int firstSample, int nSamples) const {
+    const int pageSamples = pageSampleCount();
+    firstSample = std::max(0, firstSample);
+    nSamples = std::min(nSamples, pageSamples - firstSample);
+    if (nSamples <= 0) return {};
+
+    if (!virtualPageMode() && sampleStore && nSamples < pageSamples && startTrace >= 0 && startTrace < totalTraces) {
+        // Строка копии - один отсчет подряд идущих трасс: читаются только строки окна
+        int n = std::min(count, totalTraces - startTrace);
+        std::vector<int> physical;
+        if (ordering) {
+            physical = ordering->physical_range(startTrace, n);
+        } else {
+            physical.resize(n);
+            for (int i = 0; i < n; ++i) physical[i] = startTrace + i;
+        }
+        if (sampleStoreCovers(physical)) {
+            std::vector<std::vector<float>> result(n, std::vector<float>(nSamples));
+            std::vector<float> row(n);
+            for (int s = 0; s < nSamples; ++s) {
+                if (ordering) {
+                    sampleStore->gather_row(firstSample + s, physical, row.data());
+                } else {
+                    sampleStore->read_row(firstSample + s, startTrace, n, row.data());
+                }
+                for (int t = 0; t < n; ++t) result[t][s] = row[t];
+            }
+            return result;
+        }
+    }
+
+    std::vector<std::vector<float>> traces = getTracesRange(startTrace, count);
+    if (firstSample > 0 || nSamples < pageSamples) {
+        for (auto& trace : traces) {
+            int end = std::min(static_cast<int>(trace.size()), firstSample + nSamples);
+            if (firstSample >= end) {
+                trace.clear();
+                continue;
+            }
+            trace.erase(trace.begin() + end, trace.end());
+            trace.erase(trace.begin(), trace.begin() + firstSample);
+        }
+    }
+    return traces;
+}
+
+int SegyDataManager::fileTraceIndex(int traceIndex) const {
+    if (ordering) {
+        return (traceIndex >= 0 && traceIndex < ordering->size()) ? ordering->physical(traceIndex) : -1;
+    }
+    if (!virtualPageMode()) return traceIndex;
+    if (traceIndex < 0 || traceIndex >= static_cast<int>(pageIndices.size())) return -1;
+    return pageIndices[traceIndex];
+}
+
 std::vector<uint8_t> SegyDataManager::getTraceHeader(int traceIndex) const {
+    traceIndex = fileTraceIndex(traceIndex);
     if (traceIndex < 0 || traceIndex >= totalTraces || !reader) {
         return {};
     }
@@ -121,35 +302,806 @@ void SegyDataManager::clearCache() {
     lruList.clear();
 }
 
+std::vector<std::string> SegyDataManager::takeCacheWarnings() {
+    std::vector<std::string> taken;
+    taken.swap(cacheWarnings);
+    return taken;
+}
+
+std::vector<std::string> SegyDataManager::takeWarnings() {
+    std::vector<std::string> taken;
+    taken.swap(warnings);
+    return taken;
+}
+
+void SegyDataManager::warn(const std::string& message) {
+    warnings.push_back(message);
+}
+
 void SegyDataManager::computeGlobalStats(int numTraces) {
     if (!reader || totalTraces == 0) return;
-    
-    // Ограничиваем количество трасс для анализа
-    int tracesToAnalyze = std::min(numTraces, totalTraces);
-    
-    globalMinAmplitude = std::numeric_limits<float>::max();
-    globalMaxAmplitude = std::numeric_limits<float>::lowest();
-    
-    for (int i = 0; i < tracesToAnalyze; ++i) {
+    if (globalStatsValid && amplitudeStats.traces_analyzed >= std::min(numTraces, totalTraces)) return;
+
+    try {
+        amplitudeStats = compute_amplitude_stats(*reader, numTraces);
+    } catch (const std::exception& e) {
+        // Игнорируем ошибки при вычислении статистики
+        return;
+    }
+    globalStatsValid = amplitudeStats.valid();
+    statsFromCache = false;
+
+    if (cache && globalStatsValid) {
+        try {
+            cache->save_stats(amplitudeStats);
+        } catch (const std::exception& e) {
+            cacheWarnings.push_back(std::string("Failed to save amplitude stats: ") + e.what());
+        }
+    }
+}
+
+int SegyDataManager::refresh() {
+    if (!reader) return 0;
+
+    int firstNew = totalTraces;
+    int added = 0;
+    try {
+        added = reader->refresh();
+    } catch (const std::exception& e) {
+        warn("Failed to refresh " + filename + ": " + e.what());
+        return 0;
+    }
+    if (added <= 0) return 0;
+    totalTraces = reader->num_traces();
+
+    if (globalStatsValid) {
         try {
-            std::vector<float> trace = reader->get_trace(i);
-            for (float amplitude : trace) {
-                if (std::isfinite(amplitude)) {
-                    globalMinAmplitude = std::min(globalMinAmplitude, amplitude);
-                    globalMaxAmplitude = std::max(globalMaxAmplitude, amplitude);
+            accumulate_amplitude_stats(amplitudeStats, *reader, firstNew, added);
+        } catch (const std::exception& e) {
+            warn(std::string("Failed to update amplitude stats: ") + e.what());
+        }
+    }
+    for (auto& entry : traceMaps) {
+        try {
+            entry.second->append_traces(*reader);
+        } catch (const std::exception& e) {
+            warn(std::string("Failed to extend header index: ") + e.what());
+        }
+    }
+
+    if (ordering) {
+        // Встраиваем новые трассы слиянием: заголовки читаются только у них
+        bool extended = false;
+        try {
+            ordering->append_traces(*reader);
+            extended = true;
+        } catch (const std::exception& e) {
+            warn(std::string("Failed to extend trace ordering: ") + e.what());
+            // setTraceOrdering сбрасывает ordering - ключи копируем заранее
+            std::vector<std::string> keys = ordering->keys();
+            setTraceOrdering(keys);
+        }
+        if (extended && cache) {
+            try {
+                ordering->save(cache->ordering_path(ordering->keys()));
+            } catch (const std::exception& e) {
+                warn(std::string("Failed to save trace ordering: ") + e.what());
+            }
+        }
+    }
+
+    if (gatherMode()) {
+        // Новые трассы могли дополнить текущую сборку или образовать новые
+        waitForPrefetch();
+        prefetchedGathers.clear();
+        if (prefetchReader) prefetchReader->refresh();
+        int value = gatherValues[currentGatherIdx];
+        gatherValues = getTraceMap({gatherKey})->get_unique_values(gatherKey);
+        auto it = std::lower_bound(gatherValues.begin(), gatherValues.end(), value);
+        setCurrentGather(static_cast<int>(it - gatherValues.begin()));
+    }
+
+    if (geometry.regular()) {
+        GeometryView view = geomView;
+        int value = geomViewValue;
+        std::vector<FenceVertex> vertices = fenceVertices;
+        AttributeMap map = attributeMap;
+        // Заносим в сетку только новые трассы; определяем геометрию заново, лишь если
+        // они не ложатся на прежние шаги или попадают в занятые ячейки
+        bool extended = false;
+        try {
+            extended = geometry.append_traces(*reader, geometryFields);
+        } catch (const std::exception& e) {
+            warn(std::string("Failed to extend survey geometry: ") + e.what());
+        }
+        if (!extended) detectGeometry(geometryFields);
+        if (view == GeometryView::Inline) showInline(value);
+        else if (view == GeometryView::Crossline) showCrossline(value);
+        else if (view == GeometryView::TimeSlice) showTimeSlice(value);
+        else if (view == GeometryView::Fence) showFence(vertices);
+        else if (view == GeometryView::AttributeMap && geometry.regular()) {
+            // Карта дополняется окнами только дописанных трасс, а не пересчитывается по всему кубу
+            try {
+                update_attribute_map(*reader, geometry, firstNew, map);
+                setAttributeMapPage(map);
+            } catch (const std::exception& e) {
+                warn(std::string("Failed to update attribute map: ") + e.what());
+            }
+        }
+    }
+    return added;
+}
+
+TraceMap* SegyDataManager::getTraceMap(const std::vector<std::string>& keys, const ProgressCallback& progress) {
+    if (!reader || keys.empty()) return nullptr;
+
+    auto it = traceMaps.find(keys);
+    if (it != traceMaps.end()) return it->second.get();
+
+    // Без кэша индекс строится в памяти и живет до закрытия файла
+    std::string dbPath = cache ? cache->trace_map_path(keys) : ":memory:";
+    std::unique_ptr<TraceMap> map(new TraceMap(dbPath, keys));
+    if (!cache) {
+        // Базе в памяти некуда сбрасывать промежуточные серии - сортируем целиком в памяти
+        map->set_aggregation_memory_limit(std::numeric_limits<size_t>::max());
+    }
+    int indexed = map->indexed_trace_count();
+    if (indexed <= 0) {
+        map->build_map(*reader, "", progress);
+    } else if (indexed < totalTraces) {
+        map->append_traces(*reader, progress);
+    }
+    TraceMap* result = map.get();
+    traceMaps[keys] = std::move(map);
+    return result;
+}
+
+bool SegyDataManager::setGatherKey(const std::string& key, const ProgressCallback& progress) {
+    clearGatherMode();
+    clearTraceOrdering();
+    clearGeometryView();
+    if (!reader) return false;
+
+    std::vector<int> values;
+    try {
+        values = getTraceMap({key}, progress)->get_unique_values(key);
+        if (!prefetchReader) prefetchReader.reset(new SegyReader(filename));
+    } catch (const std::exception& e) {
+        warn("Failed to index gathers by " + key + ": " + e.what());
+        return false;
+    }
+    if (values.empty()) {
+        warn("No traces to group by " + key);
+        return false;
+    }
+
+    gatherKey = key;
+    gatherValues.swap(values);
+    setCurrentGather(0);
+    return true;
+}
+
+void SegyDataManager::clearGatherMode() {
+    waitForPrefetch();
+    prefetchedGathers.clear();
+    prefetchReader.reset();
+    gatherKey.clear();
+    gatherValues.clear();
+    pageIndices.clear();
+    pageTraces.clear();
+    currentGatherIdx = -1;
+}
+
+std::vector<int> SegyDataManager::gatherTraceIndices(int gather) {
+    TraceMap* map = getTraceMap({gatherKey});
+    return map->find_trace_indices({Optional<int>(gatherValues[gather])});
+}
+
+void SegyDataManager::setCurrentGather(int gather) {
+    if (!gatherMode()) return;
+    gather = std::max(0, std::min(gather, gatherCount() - 1));
+
+    pageIndices = gatherTraceIndices(gather);
+    bool prefetched = false;
+    {
+        std::lock_guard<std::mutex> lock(prefetchMutex);
+        auto it = prefetchedGathers.find(gather);
+        if (it != prefetchedGathers.end() && it->second.size() == pageIndices.size()) {
+            pageTraces.swap(it->second);
+            prefetched = true;
+        }
+    }
+    if (!prefetched) {
+        pageTraces = getTracesByIndices(pageIndices);
+    }
+    currentGatherIdx = gather;
+    prefetchNeighbours(gather);
+}
+
+void SegyDataManager::waitForPrefetch() {
+    if (prefetchTask.valid()) prefetchTask.wait();
+}
+
+void SegyDataManager::prefetchNeighbours(int gather) {
+    if (!prefetchReader) return;
+    waitForPrefetch();
+
+    // Соседние сборки; все остальные ранее подгруженные выбрасываются
+    std::vector<std::pair<int, std::vector<int>>> jobs;
+    {
+        std::lock_guard<std::mutex> lock(prefetchMutex);
+        for (auto it = prefetchedGathers.begin(); it != prefetchedGathers.end();) {
+            if (std::abs(it->first - gather) > 1) it = prefetchedGathers.erase(it);
+            else ++it;
+        }
+        for (int neighbour : {gather + 1, gather - 1}) {
+            if (neighbour >= 0 && neighbour < gatherCount() && !prefetchedGathers.count(neighbour)) {
+                jobs.push_back(std::make_pair(neighbour, std::vector<int>()));
+            }
+        }
+    }
+    if (jobs.empty()) return;
+    // Запросы к SQLite выполняются в этом потоке, фоновая задача только читает файл
+    for (auto& job : jobs) job.second = gatherTraceIndices(job.first);
+
+    SegyReader* bgReader = prefetchReader.get();
+    prefetchTask = std::async(std::launch::async, [this, bgReader, jobs]() {
+        for (const auto& job : jobs) {
+            std::vector<std::vector<float>> traces(job.second.size());
+            try {
+                size_t i = 0;
+                while (i < job.second.size()) {
+                    size_t runEnd = i + 1;
+                    while (runEnd < job.second.size() && job.second[runEnd] == job.second[runEnd - 1] + 1) ++runEnd;
+                    auto run = bgReader->get_traces(job.second[i], static_cast<int>(runEnd - i));
+                    for (size_t k = i; k < runEnd; ++k) traces[k].swap(run[k - i]);
+                    i = runEnd;
                 }
+            } catch (const std::exception& e) {
+                continue; // при ошибке сборка будет прочитана при переходе на нее
             }
+            std::lock_guard<std::mutex> lock(prefetchMutex);
+            prefetchedGathers[job.first].swap(traces);
+        }
+    });
+}
+
+bool SegyDataManager::setTraceOrdering(const std::vector<std::string>& keys, const ProgressCallback& progress) {
+    clearGatherMode();
+    clearGeometryView();
+    ordering.reset();
+    if (!reader) return false;
+    if (keys.empty()) return true;
+
+    std::unique_ptr<TraceOrdering> newOrdering(new TraceOrdering());
+    std::string cachePath = cache ? cache->ordering_path(keys) : std::string();
+    if (cachePath.empty() || !newOrdering->load(cachePath, totalTraces) || newOrdering->keys() != keys) {
+        try {
+            *newOrdering = TraceOrdering::from_header_keys(*reader, keys, progress);
         } catch (const std::exception& e) {
-            // Игнорируем ошибки при вычислении статистики
+            warn(std::string("Failed to build trace ordering: ") + e.what());
+            return false;
+        }
+        if (!cachePath.empty()) {
+            try {
+                newOrdering->save(cachePath);
+            } catch (const std::exception& e) {
+                warn(std::string("Failed to save trace ordering: ") + e.what());
+            }
         }
     }
-    
-    // Если все значения одинаковые, устанавливаем небольшой диапазон
-    if (std::abs(globalMaxAmplitude - globalMinAmplitude) < 1e-6) {
-        globalMaxAmplitude = globalMinAmplitude + 1.0f;
+    ordering = std::move(newOrdering);
+    return true;
+}
+
+bool SegyDataManager::detectGeometry(const GeometryFields& fields, const ProgressCallback& progress) {
+    clearGeometryView();
+    geometry = SurveyGeometry();
+    if (!reader) return false;
+    try {
+        geometry = SurveyGeometry::detect(*reader, fields, progress);
+    } catch (const std::exception& e) {
+        warn(std::string("Failed to detect survey geometry: ") + e.what());
+        return false;
     }
-    
-    globalStatsValid = true;
+    geometryFields = fields;
+    // Причина нерегулярности - в geometry.reason()
+    return geometry.regular();
+}
+
+bool SegyDataManager::showTraceList(const std::vector<int>& indices) {
+    clearGatherMode();
+    clearTraceOrdering();
+    clearGeometryView();
+    pageIndices = indices;
+    pageTraces = getTracesByIndices(pageIndices);
+    // Пустые ячейки сетки показываются как NaN на всю длину трассы
+    for (auto& trace : pageTraces) {
+        if (trace.empty()) trace.assign(sampleCount(), std::numeric_limits<float>::quiet_NaN());
+    }
+    return !pageTraces.empty();
+}
+
+bool SegyDataManager::showInline(int inlineNo) {
+    int offset = inlineNo - geometry.inline_min();
+    if (!geometry.regular() || offset < 0 || offset % geometry.inline_step() != 0 ||
+        offset / geometry.inline_step() >= geometry.inline_count()) {
+        return false;
+    }
+    int gridIndex = offset / geometry.inline_step();
+    if (!showSectionPage(GeometryView::Inline, gridIndex, geometry.inline_traces(inlineNo))) return false;
+    geomView = GeometryView::Inline;
+    geomViewValue = inlineNo;
+    return true;
+}
+
+bool SegyDataManager::showCrossline(int crosslineNo) {
+    int offset = crosslineNo - geometry.crossline_min();
+    if (!geometry.regular() || offset < 0 || offset % geometry.crossline_step() != 0 ||
+        offset / geometry.crossline_step() >= geometry.crossline_count()) {
+        return false;
+    }
+    int gridIndex = offset / geometry.crossline_step();
+    if (!showSectionPage(GeometryView::Crossline, gridIndex, geometry.crossline_traces(crosslineNo))) return false;
+    geomView = GeometryView::Crossline;
+    geomViewValue = crosslineNo;
+    return true;
+}
+
+bool SegyDataManager::showSectionPage(GeometryView view, int gridIndex, const std::vector<int>& indices) {
+    if (indices.empty()) return false;
+    if (!hasBrickStore()) return showTraceList(indices);
+
+    // Из блочного хранилища сечение любого направления стоит сопоставимого чтения
+    std::vector<std::vector<float>> traces;
+    try {
+        traces = readBrickSection(view, gridIndex);
+    } catch (const std::exception& e) {
+        warn(std::string("Failed to read section from bricks, reading SEG-Y instead: ") + e.what());
+        return showTraceList(indices);
+    }
+    clearGatherMode();
+    clearTraceOrdering();
+    clearGeometryView();
+    pageIndices = indices;
+    pageTraces.swap(traces);
+    return true;
+}
+
+std::vector<float> SegyDataManager::readTimeSlice(int sample) const {
+    const std::vector<int>& cells = geometry.cells();
+    std::vector<float> slice(cells.size());
+    if (!sampleStore && hasBrickStore()) {
+        std::vector<std::vector<float>> section = readBrickSection(GeometryView::TimeSlice, sample);
+        const size_t nXl = geometry.crossline_count();
+        for (size_t i = 0; i < section.size(); ++i) std::copy(section[i].begin(), section[i].end(), slice.begin() + i * nXl);
+        return slice;
+    }
+    if (!sampleStore) {
+        // Из каждой трассы читается только один отсчет, а не трасса целиком
+        reader->read_sample_window(cells, sample, 1, slice.data());
+        return slice;
+    }
+
+    // Срез - одна строка транспонированной копии; трассы, дописанные после
+    // ее построения, дочитываются из файла
+    std::vector<int> stored(cells);
+    std::vector<int> appended(cells.size(), -1);
+    bool hasAppended = false;
+    for (size_t i = 0; i < cells.size(); ++i) {
+        if (cells[i] >= sampleStore->num_traces()) {
+            stored[i] = -1;
+            appended[i] = cells[i];
+            hasAppended = true;
+        }
+    }
+    sampleStore->gather_row(sample, stored, slice.data());
+    if (hasAppended) {
+        std::vector<float> tail(cells.size());
+        reader->read_sample_window(appended, sample, 1, tail.data());
+        for (size_t i = 0; i < cells.size(); ++i) {
+            if (appended[i] >= 0) slice[i] = tail[i];
+        }
+    }
+    return slice;
+}
+
+bool SegyDataManager::showTimeSlice(int sample) {
+    if (!reader || !geometry.regular() || sample < 0 || sample >= sampleCount()) return false;
+    std::vector<float> slice;
+    try {
+        slice = readTimeSlice(sample);
+    } catch (const std::exception& e) {
+        warn(std::string("Failed to read time slice: ") + e.what());
+        return false;
+    }
+    clearGatherMode();
+    clearTraceOrdering();
+    clearGeometryView();
+    const int nXl = geometry.crossline_count();
+    pageIndices.clear();
+    pageTraces.resize(geometry.inline_count());
+    for (int i = 0; i < geometry.inline_count(); ++i) {
+        pageTraces[i].assign(slice.begin() + static_cast<size_t>(i) * nXl, slice.begin() + static_cast<size_t>(i + 1) * nXl);
+    }
+    geomView = GeometryView::TimeSlice;
+    geomViewValue = sample;
+    return true;
+}
+
+bool SegyDataManager::showFence(const std::vector<FenceVertex>& vertices) {
+    if (!reader || !geometry.regular() || vertices.size() < 2) return false;
+    // Копия: vertices может ссылаться на fenceVertices, которые очищаются ниже
+    std::vector<FenceVertex> path(vertices);
+    std::vector<FenceColumn> columns = plan_fence(geometry, path);
+    if (columns.empty()) {
+        warn("The fence does not cross the survey grid");
+        return false;
+    }
+
+    std::vector<std::vector<float>> traces;
+    try {
+        if (hasBrickStore()) {
+            std::vector<int> needed = fence_traces(columns);
+            traces = interpolate_fence(columns, needed, readBrickTraces(needed), sampleCount());
+        } else {
+            traces = extract_fence(*reader, columns);
+        }
+    } catch (const std::exception& e) {
+        warn(std::string("Failed to read fence: ") + e.what());
+        return false;
+    }
+    clearGatherMode();
+    clearTraceOrdering();
+    clearGeometryView();
+    // Колонке соответствует трасса с наибольшим весом (для заголовков)
+    pageIndices.resize(columns.size());
+    for (size_t c = 0; c < columns.size(); ++c) {
+        const FenceColumn& column = columns[c];
+        int best = 0;
+        for (int k = 1; k < 4; ++k) {
+            if (column.weights[k] > column.weights[best]) best = k;
+        }
+        pageIndices[c] = column.traces[best];
+    }
+    pageTraces.swap(traces);
+    fenceVertices = path;
+    geomView = GeometryView::Fence;
+    geomViewValue = static_cast<int>(path.size());
+    return true;
+}
+
+bool SegyDataManager::showAttributeMap(WindowAttribute attribute, int firstSample, int nSamples,
+                                       const ProgressCallback& progress) {
+    if (!reader || !geometry.regular()) return false;
+    AttributeMap map;
+    try {
+        if (!extract_attribute_map(*reader, geometry, attribute, firstSample, nSamples, map, progress)) return false;
+    } catch (const std::exception& e) {
+        warn(std::string("Failed to extract attribute map: ") + e.what());
+        return false;
+    }
+    setAttributeMapPage(map);
+    return true;
+}
+
+void SegyDataManager::setAttributeMapPage(AttributeMap& map) {
+    clearGatherMode();
+    clearTraceOrdering();
+    clearGeometryView();
+    const int nXl = geometry.crossline_count();
+    pageIndices.clear();
+    pageTraces.resize(geometry.inline_count());
+    for (int i = 0; i < geometry.inline_count(); ++i) {
+        pageTraces[i].assign(map.values.begin() + static_cast<size_t>(i) * nXl,
+                             map.values.begin() + static_cast<size_t>(i + 1) * nXl);
+    }
+    geomViewValue = static_cast<int>(map.attribute);
+    attributeMap = std::move(map);
+    geomView = GeometryView::AttributeMap;
+}
+
+const std::vector<float>& SegyDataManager::pagePercentiles() const {
+    static const std::vector<float> none;
+    return geomView == GeometryView::AttributeMap ? attributeMap.percentiles : none;
+}
+
+void SegyDataManager::clearGeometryView() {
+    if (geomView == GeometryView::None) return;
+    geomView = GeometryView::None;
+    geomViewValue = 0;
+    fenceVertices.clear();
+    attributeMap = AttributeMap();
+    pageIndices.clear();
+    pageTraces.clear();
+}
+
+PageAxes SegyDataManager::pageAxes() const {
+    PageAxes axes;
+    axes.verticalStep = getSampleInterval();
+    switch (geomView) {
+    case GeometryView::Inline:
+        axes.horizontalTitle = "Crossline";
+        axes.horizontalOrigin = geometry.crossline_min();
+        axes.horizontalStep = geometry.crossline_step();
+        break;
+    case GeometryView::Crossline:
+        axes.horizontalTitle = "Inline";
+        axes.horizontalOrigin = geometry.inline_min();
+        axes.horizontalStep = geometry.inline_step();
+        break;
+    case GeometryView::TimeSlice:
+    case GeometryView::AttributeMap:
+        axes.horizontalTitle = "Inline";
+        axes.horizontalOrigin = geometry.inline_min();
+        axes.horizontalStep = geometry.inline_step();
+        axes.verticalTitle = "Crossline";
+        axes.verticalUnit.clear();
+        axes.verticalOrigin = static_cast<float>(geometry.crossline_min());
+        axes.verticalStep = static_cast<float>(geometry.crossline_step());
+        break;
+    case GeometryView::Fence:
+        axes.horizontalTitle = "Fence Trace";
+        break;
+    case GeometryView::None:
+        break;
+    }
+    return axes;
+}
+
+bool SegyDataManager::startSampleMajorBuild(SampleEncoding encoding) {
+    if (!reader || !cache || sampleStoreTask.valid()) return false;
+
+    sampleStore.reset();
+    sampleStoreCancel = false;
+    sampleStoreProgress = 0;
+    std::string storePath = cache->sample_major_path();
+    std::string segyPath = filename;
+    sampleStoreTask = std::async(std::launch::async, [this, storePath, segyPath, encoding]() {
+        // Свой экземпляр SegyReader: построение не конкурирует за файл с отображением
+        SegyReader buildReader(segyPath);
+        auto progress = [this](const std::string&, int64_t current, int64_t total) {
+            sampleStoreProgress = total > 0 ? static_cast<int>(current * 100 / total) : 0;
+        };
+        return SampleMajorStore::build(buildReader, storePath, encoding, progress, &sampleStoreCancel);
+    });
+    return true;
+}
+
+bool SegyDataManager::pollSampleMajorBuild() {
+    if (sampleStoreTask.valid() &&
+        sampleStoreTask.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        try {
+            if (sampleStoreTask.get()) {
+                sampleStore.reset(new SampleMajorStore(cache->sample_major_path()));
+            }
+        } catch (const std::exception& e) {
+            warn(std::string("Failed to build sample-major store: ") + e.what());
+        }
+    }
+    return sampleStore != nullptr;
+}
+
+void SegyDataManager::cancelSampleMajorBuild() {
+    if (!sampleStoreTask.valid()) return;
+    sampleStoreCancel = true;
+    try {
+        sampleStoreTask.get();
+    } catch (const std::exception&) {
+        // Результат отмененного построения не нужен
+    }
+}
+
+bool SegyDataManager::startBrickStoreBuild() {
+    if (!reader || !cache || !geometry.regular() || brickStoreTask.valid()) return false;
+
+    brickStore.reset();
+    brickCache.clear();
+    brickLru.clear();
+    brickStoreCancel = false;
+    brickStoreProgress = 0;
+    std::string storePath = cache->brick_store_path();
+    std::string segyPath = filename;
+    SurveyGeometry buildGeometry = geometry;
+    brickStoreTask = std::async(std::launch::async, [this, storePath, segyPath, buildGeometry]() {
+        SegyReader buildReader(segyPath);
+        auto progress = [this](const std::string&, int64_t current, int64_t total) {
+            brickStoreProgress = total > 0 ? static_cast<int>(current * 100 / total) : 0;
+        };
+        return BrickStore::build(buildReader, buildGeometry, storePath, progress, &brickStoreCancel);
+    });
+    return true;
+}
+
+bool SegyDataManager::pollBrickStoreBuild() {
+    if (brickStoreTask.valid() &&
+        brickStoreTask.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        try {
+            if (brickStoreTask.get()) {
+                brickStore.reset(new BrickStore(cache->brick_store_path()));
+            }
+        } catch (const std::exception& e) {
+            warn(std::string("Failed to build brick store: ") + e.what());
+        }
+    }
+    return brickStore != nullptr;
+}
+
+void SegyDataManager::cancelBrickStoreBuild() {
+    if (!brickStoreTask.valid()) return;
+    brickStoreCancel = true;
+    try {
+        brickStoreTask.get();
+    } catch (const std::exception&) {
+        // Результат отмененного построения не нужен
+    }
+}
+
+bool SegyDataManager::hasBrickStore() const {
+    // Дописанные после построения трассы в блоках отсутствуют
+    return brickStore && brickStore->matches(geometry) && brickStore->source_traces() == totalTraces;
+}
+
+void SegyDataManager::setBrickCacheSize(int bricks) {
+    brickCacheSize = std::max(1, bricks);
+    while (static_cast<int>(brickCache.size()) > brickCacheSize) {
+        brickCache.erase(brickLru.front());
+        brickLru.pop_front();
+    }
+}
+
+std::vector<std::shared_ptr<const std::vector<float>>> SegyDataManager::getBricks(const std::vector<int>& ids) const {
+    std::vector<std::shared_ptr<const std::vector<float>>> result(ids.size());
+    std::vector<size_t> missing;
+    for (size_t i = 0; i < ids.size(); ++i) {
+        auto it = brickCache.find(ids[i]);
+        if (it != brickCache.end()) {
+            result[i] = it->second;
+            brickLru.remove(ids[i]);
+            brickLru.push_back(ids[i]);
+        } else {
+            missing.push_back(i);
+        }
+    }
+
+    // Недостающие блоки читаются и распаковываются параллельно
+    bool failed = false;
+    std::string error;
+    #pragma omp parallel for schedule(dynamic)
+    for (long m = 0; m < static_cast<long>(missing.size()); ++m) {
+        try {
+            std::shared_ptr<std::vector<float>> brick = std::make_shared<std::vector<float>>();
+            brickStore->read_brick(ids[missing[m]], *brick);
+            result[missing[m]] = brick;
+        } catch (const std::exception& e) {
+            #pragma omp critical
+            {
+                failed = true;
+                error = e.what();
+            }
+        }
+    }
+    if (failed) {
+        throw std::runtime_error("Failed to read bricks: " + error);
+    }
+
+    // Блоки текущего сечения остаются живыми через result, даже если вытеснены из кэша
+    for (size_t i : missing) {
+        if (brickCache.count(ids[i])) continue;
+        brickCache[ids[i]] = result[i];
+        brickLru.push_back(ids[i]);
+        if (static_cast<int>(brickCache.size()) > brickCacheSize) {
+            brickCache.erase(brickLru.front());
+            brickLru.pop_front();
+        }
+    }
+    return result;
+}
+
+std::vector<std::vector<float>> SegyDataManager::readBrickSection(GeometryView view, int gridIndex) const {
+    const int B = BrickStore::BRICK_SIZE;
+    const BrickStore& store = *brickStore;
+    const int nIl = store.inline_count(), nXl = store.crossline_count(), ns = store.num_samples();
+    const int local = gridIndex % B;
+
+    // Блоки, пересекающие сечение, и размеры страницы (колонки x отсчеты)
+    std::vector<int> ids;
+    int columns = 0, rows = 0;
+    switch (view) {
+    case GeometryView::Inline:
+        columns = nXl;
+        rows = ns;
+        for (int bj = 0; bj < store.bricks_xl(); ++bj)
+            for (int bk = 0; bk < store.bricks_t(); ++bk) ids.push_back(store.brick_id(gridIndex / B, bj, bk));
+        break;
+    case GeometryView::Crossline:
+        columns = nIl;
+        rows = ns;
+        for (int bi = 0; bi < store.bricks_il(); ++bi)
+            for (int bk = 0; bk < store.bricks_t(); ++bk) ids.push_back(store.brick_id(bi, gridIndex / B, bk));
+        break;
+    case GeometryView::TimeSlice:
+        columns = nIl;
+        rows = nXl;
+        for (int bi = 0; bi < store.bricks_il(); ++bi)
+            for (int bj = 0; bj < store.bricks_xl(); ++bj) ids.push_back(store.brick_id(bi, bj, gridIndex / B));
+        break;
+    case GeometryView::Fence:
+    case GeometryView::AttributeMap:
+    case GeometryView::None:
+        return {};
+    }
+    std::vector<std::shared_ptr<const std::vector<float>>> bricks = getBricks(ids);
+
+    std::vector<std::vector<float>> page(columns, std::vector<float>(rows));
+    size_t n = 0;
+    if (view == GeometryView::Inline) {
+        for (int bj = 0; bj < store.bricks_xl(); ++bj) {
+            for (int bk = 0; bk < store.bricks_t(); ++bk) {
+                const float* brick = bricks[n++]->data();
+                for (int lj = 0; lj < std::min(B, nXl - bj * B); ++lj)
+                    for (int lk = 0; lk < std::min(B, ns - bk * B); ++lk)
+                        page[bj * B + lj][bk * B + lk] = brick[(local * B + lj) * B + lk];
+            }
+        }
+    } else if (view == GeometryView::Crossline) {
+        for (int bi = 0; bi < store.bricks_il(); ++bi) {
+            for (int bk = 0; bk < store.bricks_t(); ++bk) {
+                const float* brick = bricks[n++]->data();
+                for (int li = 0; li < std::min(B, nIl - bi * B); ++li)
+                    for (int lk = 0; lk < std::min(B, ns - bk * B); ++lk)
+                        page[bi * B + li][bk * B + lk] = brick[(li * B + local) * B + lk];
+            }
+        }
+    } else {
+        for (int bi = 0; bi < store.bricks_il(); ++bi) {
+            for (int bj = 0; bj < store.bricks_xl(); ++bj) {
+                const float* brick = bricks[n++]->data();
+                for (int li = 0; li < std::min(B, nIl - bi * B); ++li)
+                    for (int lj = 0; lj < std::min(B, nXl - bj * B); ++lj)
+                        page[bi * B + li][bj * B + lj] = brick[(li * B + lj) * B + local];
+            }
+        }
+    }
+    return page;
 }
 
+std::vector<std::vector<float>> SegyDataManager::readBrickTraces(const std::vector<int>& traces) const {
+    const int B = BrickStore::BRICK_SIZE;
+    const BrickStore& store = *brickStore;
+    const int nXl = store.crossline_count(), ns = store.num_samples();
 
+    // Ячейка сетки каждой трассы
+    std::unordered_map<int, int> cellOf;
+    for (int t : traces) cellOf[t] = -1;
+    const std::vector<int>& cells = geometry.cells();
+    for (size_t c = 0; c < cells.size(); ++c) {
+        auto it = cellOf.find(cells[c]);
+        if (it != cellOf.end()) it->second = static_cast<int>(c);
+    }
+
+    // Все блоки по времени для колонок блоков, через которые проходит разрез
+    std::vector<int> ids;
+    for (const auto& entry : cellOf) {
+        if (entry.second < 0) continue;
+        int bi = entry.second / nXl / B, bj = entry.second % nXl / B;
+        for (int bk = 0; bk < store.bricks_t(); ++bk) ids.push_back(store.brick_id(bi, bj, bk));
+    }
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    std::vector<std::shared_ptr<const std::vector<float>>> bricks = getBricks(ids);
+
+    std::vector<std::vector<float>> result(traces.size());
+    for (size_t t = 0; t < traces.size(); ++t) {
+        int cell = cellOf[traces[t]];
+        if (cell < 0) continue;
+        int i = cell / nXl, j = cell % nXl;
+        result[t].resize(ns);
+        for (int bk = 0; bk < store.bricks_t(); ++bk) {
+            size_t pos = std::lower_bound(ids.begin(), ids.end(), store.brick_id(i / B, j / B, bk)) - ids.begin();
+            const float* src = bricks[pos]->data() + ((i % B) * B + j % B) * B;
+            std::copy(src, src + std::min(B, ns - bk * B), result[t].begin() + bk * B);
+        }
+    }
+    return result;
+}
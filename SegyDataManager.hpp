@@ -5,30 +5,150 @@
 #include <memory>
 #include <unordered_map>
 #include <list>
+#include <map>
+#include <mutex>
+#include <future>
+#include <atomic>
 #include "SegyReader.hpp"
+#include "AmplitudeStats.hpp"
+#include "SegyCache.hpp"
+#include "TraceMap.hpp"
+#include "TraceOrdering.hpp"
+#include "SurveyGeometry.hpp"
+#include "SampleMajorStore.hpp"
+#include "BrickStore.hpp"
+#include "FenceExtractor.hpp"
+#include "AttributeMap.hpp"
+
+// Подписи осей страницы: колонка i подписывается horizontalOrigin + i * horizontalStep,
+// отсчет j - verticalOrigin + j * verticalStep
+struct PageAxes {
+    std::string horizontalTitle = "Trace Number";
+    int horizontalOrigin = 0;
+    int horizontalStep = 1;
+    std::string verticalTitle = "Time (ms)";
+    std::string verticalUnit = "ms";
+    float verticalOrigin = 0.0f;
+    float verticalStep = 0.0f;
+};
 
 class SegyDataManager {
 public:
     SegyDataManager(int cacheSize = 1000);
-    ~SegyDataManager() = default;
+    ~SegyDataManager();
     
-    bool loadFile(const std::string& filename);
+    // cacheDir - каталог кэша этого файла (пустая строка - без кэша)
+    bool loadFile(const std::string& filename, const std::string& cacheDir = "");
     std::vector<std::vector<float>> getTracesPage(int page, int tracesPerPage) const;
     std::vector<std::vector<float>> getTracesRange(int startTrace, int count) const;
     std::vector<uint8_t> getTraceHeader(int traceIndex) const;
-    int traceCount() const { return totalTraces; }
+    // Трассы по индексам файла; подряд идущие индексы читаются одним блоком
+    std::vector<std::vector<float>> getTracesByIndices(const std::vector<int>& indices) const;
+    // Окно отсчетов [firstSample, firstSample + nSamples) колонок страницы. При готовой
+    // транспонированной копии неглубокое окно читается из нее только по показываемым байтам.
+    std::vector<std::vector<float>> getTracesWindow(int startTrace, int count, int firstSample, int nSamples) const;
+    // Число отсчетов в колонке текущей страницы (для временного среза - число кросслайнов)
+    int pageSampleCount() const;
+    // На виртуальной странице (сборка, инлайн, срез) - число ее колонок, иначе - трасс файла
+    int traceCount() const { return virtualPageMode() ? static_cast<int>(pageTraces.size()) : totalTraces; }
+    int fileTraceCount() const { return totalTraces; }
+    // Индекс трассы в файле для индекса на странице (-1, если колонка - не трасса файла)
+    int fileTraceIndex(int traceIndex) const;
+    int sampleCount() const { return reader ? reader->num_samples() : 0; }
+
+    // Режим слежения за дописываемым файлом: подхватывает новые трассы, дополняет
+    // статистику и открытые индексы только по ним. Возвращает число новых трасс.
+    int refresh();
     float getSampleInterval() const { return reader ? reader->sample_interval() : 0.0f; }
+    // Счетчики чтения и декодирования основного SegyReader (фоновая подгрузка сборок не входит)
+    SegyReaderStats readerStats() const { return reader ? reader->stats() : SegyReaderStats(); }
     
     // Настройки кэша
     void setCacheSize(int size);
     int getCacheSize() const { return cacheSize; }
     void clearCache();
     
-    // Глобальные статистики амплитуд (на основе первых N трасс)
+    // Глобальные статистики амплитуд (на основе первых N трасс).
+    // При наличии кэша берутся из него, пересчитываются только при смене отпечатка файла.
     void computeGlobalStats(int numTraces = 1000);
-    float getGlobalMinAmplitude() const { return globalMinAmplitude; }
-    float getGlobalMaxAmplitude() const { return globalMaxAmplitude; }
+    float getGlobalMinAmplitude() const { return amplitudeStats.min_amplitude; }
+    float getGlobalMaxAmplitude() const { return amplitudeStats.max_amplitude; }
     bool hasGlobalStats() const { return globalStatsValid; }
+    const AmplitudeStats& getAmplitudeStats() const { return amplitudeStats; }
+    bool statsLoadedFromCache() const { return statsFromCache; }
+    // Ошибки кэша файла (кэш не открылся, копия не подошла, статистика не сохранилась) с
+    // последнего вызова; работа продолжается без кэша, но пользователю стоит об этом знать
+    std::vector<std::string> takeCacheWarnings();
+    // Ошибки операций (дочитывание файла, построение индексов и копий, чтение сечений) с
+    // последнего вызова: методы возвращают false или пустой результат, а причина - здесь
+    std::vector<std::string> takeWarnings();
+
+    // Индекс заголовков по ключам; хранится в кэше и строится только при его отсутствии
+    TraceMap* getTraceMap(const std::vector<std::string>& keys, const ProgressCallback& progress = ProgressCallback());
+
+    // Режим сборок: страница - ровно одна сборка (ensemble) по значению ключа заголовка.
+    // Соседние сборки подгружаются в фоне отдельным экземпляром SegyReader.
+    bool setGatherKey(const std::string& key, const ProgressCallback& progress = ProgressCallback());
+    void clearGatherMode();
+    bool gatherMode() const { return !gatherKey.empty(); }
+    const std::string& getGatherKey() const { return gatherKey; }
+    int gatherCount() const { return static_cast<int>(gatherValues.size()); }
+    int currentGather() const { return currentGatherIdx; }
+    int gatherValue(int gather) const { return gatherValues.at(gather); }
+    void setCurrentGather(int gather);
+
+    // Виртуальный порядок трасс: файл показывается отсортированным по полям заголовка
+    // (например, CDP, offset) без записи копии. Пустой список ключей - исходный порядок.
+    bool setTraceOrdering(const std::vector<std::string>& keys, const ProgressCallback& progress = ProgressCallback());
+    void clearTraceOrdering() { ordering.reset(); }
+    bool orderingMode() const { return ordering != nullptr; }
+    std::vector<std::string> getOrderingKeys() const { return ordering ? ordering->keys() : std::vector<std::string>(); }
+
+    // 3D-геометрия по номерам инлайнов/кросслайнов из заданных байтов заголовка.
+    // Инлайн, кросслайн и временной срез показываются как виртуальные страницы.
+    enum class GeometryView { None, Inline, Crossline, TimeSlice, Fence, AttributeMap };
+    bool detectGeometry(const GeometryFields& fields = GeometryFields(), const ProgressCallback& progress = ProgressCallback());
+    const SurveyGeometry& getGeometry() const { return geometry; }
+    bool showInline(int inlineNo);
+    bool showCrossline(int crosslineNo);
+    // Срез на отсчете sample: колонки - инлайны, строки - кросслайны
+    bool showTimeSlice(int sample);
+    // Разрез по ломаной (вершины в номерах инлайнов/кросслайнов): колонки с шагом в одну
+    // ячейку сетки, каждая - билинейная интерполяция четырех соседних трасс
+    bool showFence(const std::vector<FenceVertex>& vertices);
+    const std::vector<FenceVertex>& getFenceVertices() const { return fenceVertices; }
+    // Карта атрибута в окне [firstSample, firstSample + nSamples): раскладка как у временного среза
+    bool showAttributeMap(WindowAttribute attribute, int firstSample, int nSamples,
+                          const ProgressCallback& progress = ProgressCallback());
+    const AttributeMap& getAttributeMap() const { return attributeMap; }
+    void clearGeometryView();
+    GeometryView geometryView() const { return geomView; }
+    int geometryViewValue() const { return geomViewValue; }
+
+    // Транспонированная копия данных (по отсчетам) в кэше файла для срезов и неглубоких окон.
+    // Строится в фоне отдельным экземпляром SegyReader; нужен каталог кэша.
+    bool startSampleMajorBuild(SampleEncoding encoding = SampleEncoding::Float32);
+    bool sampleMajorBuildRunning() const { return sampleStoreTask.valid(); }
+    int sampleMajorBuildProgress() const { return sampleStoreProgress; }
+    // Подхватывает завершившееся построение; true, если копия готова к чтению
+    bool pollSampleMajorBuild();
+    bool hasSampleMajorStore() const { return sampleStore != nullptr; }
+
+    // Блочное хранилище 3D-куба в кэше файла: инлайн, кросслайн и срез читаются
+    // из распакованных блоков через LRU. Строится в фоне по определенной геометрии.
+    bool startBrickStoreBuild();
+    bool brickStoreBuildRunning() const { return brickStoreTask.valid(); }
+    int brickStoreBuildProgress() const { return brickStoreProgress; }
+    bool pollBrickStoreBuild();
+    // true, если хранилище построено для текущей геометрии и всех трасс файла
+    bool hasBrickStore() const;
+    void setBrickCacheSize(int bricks);
+
+    bool virtualPageMode() const { return gatherMode() || geomView != GeometryView::None; }
+    PageAxes pageAxes() const;
+    // Перцентили значений страницы для цветовой шкалы, если они отличаются от амплитуд файла
+    // (карта атрибута); пустой вектор - использовать статистику амплитуд
+    const std::vector<float>& pagePercentiles() const;
 
 private:
     // LRU кэш для трасс
@@ -42,10 +162,71 @@ private:
     int totalTraces;
     
     // Глобальные статистики
-    float globalMinAmplitude;
-    float globalMaxAmplitude;
+    AmplitudeStats amplitudeStats;
     bool globalStatsValid;
+    bool statsFromCache;
+    std::vector<std::string> cacheWarnings;
+    std::vector<std::string> warnings;
+    void warn(const std::string& message);
+
+    // Кэш файла и открытые индексы заголовков
+    std::unique_ptr<SegyCache> cache;
+    std::map<std::vector<std::string>, std::unique_ptr<TraceMap>> traceMaps;
     
+    // Режим сборок
+    std::string gatherKey;
+    std::vector<int> gatherValues;
+    int currentGatherIdx;
+
+    // Виртуальная страница: колонки текущей сборки или 3D-сечения
+    std::vector<int> pageIndices;                  // индексы трасс в файле (-1 - пустая ячейка)
+    std::vector<std::vector<float>> pageTraces;    // данные колонок
+
+    // Виртуальный порядок трасс
+    std::unique_ptr<TraceOrdering> ordering;
+
+    // 3D-геометрия
+    GeometryFields geometryFields;
+    SurveyGeometry geometry;
+    GeometryView geomView;
+    int geomViewValue;
+    std::vector<FenceVertex> fenceVertices;
+    AttributeMap attributeMap;
+    bool showTraceList(const std::vector<int>& indices);
+    bool showSectionPage(GeometryView view, int gridIndex, const std::vector<int>& indices);
+    void setAttributeMapPage(AttributeMap& map);
+
+    // Транспонированная копия
+    std::unique_ptr<SampleMajorStore> sampleStore;
+    std::future<bool> sampleStoreTask;
+    std::atomic<bool> sampleStoreCancel;
+    std::atomic<int> sampleStoreProgress;
+    void cancelSampleMajorBuild();
+    bool sampleStoreCovers(const std::vector<int>& traces) const;
+
+    // Блочное хранилище и LRU распакованных блоков
+    std::unique_ptr<BrickStore> brickStore;
+    std::future<bool> brickStoreTask;
+    std::atomic<bool> brickStoreCancel;
+    std::atomic<int> brickStoreProgress;
+    mutable std::unordered_map<int, std::shared_ptr<const std::vector<float>>> brickCache;
+    mutable std::list<int> brickLru;
+    int brickCacheSize;
+    void cancelBrickStoreBuild();
+    std::vector<std::shared_ptr<const std::vector<float>>> getBricks(const std::vector<int>& ids) const;
+    std::vector<std::vector<float>> readBrickSection(GeometryView view, int gridIndex) const;
+    std::vector<std::vector<float>> readBrickTraces(const std::vector<int>& traces) const;
+    std::vector<float> readTimeSlice(int sample) const;
+
+    // Фоновая подгрузка соседних сборок
+    std::unique_ptr<SegyReader> prefetchReader;
+    std::future<void> prefetchTask;
+    mutable std::mutex prefetchMutex;
+    std::map<int, std::vector<std::vector<float>>> prefetchedGathers;
+    void prefetchNeighbours(int gather);
+    void waitForPrefetch();
+    std::vector<int> gatherTraceIndices(int gather);
+
     // Методы кэширования
     std::vector<float> getTraceFromCache(int traceIndex) const;
     void addToCache(int traceIndex, const std::vector<float>& trace) const;
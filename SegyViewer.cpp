@@ -3,6 +3,7 @@
 #include "ColorSchemes.hpp"
 #include <QPainter>
 #include <QMouseEvent>
+#include <QElapsedTimer>
 #include <algorithm>
 #include <limits>
 #include <cmath>
@@ -52,6 +53,10 @@ SegyViewer::SegyViewer(QWidget* parent)
 
 void SegyViewer::setDataManager(SegyDataManager* manager) {
     dataManager = manager;
+    // Статистики относятся к предыдущему файлу
+    globalStatsComputed = false;
+    percentilesComputed = false;
+    colorMapValid = false;
 }
 
 void SegyViewer::setColorScheme(const QString& scheme) {
@@ -109,6 +114,7 @@ void SegyViewer::setStartTrace(int traceIndex) {
 }
 
 void SegyViewer::paintEvent(QPaintEvent* /*event*/) {
+    frameTiming = FrameTiming();
     QPainter p(this);
     p.fillRect(rect(), Qt::white); // Белый фон вместо черного
 
@@ -118,28 +124,18 @@ void SegyViewer::paintEvent(QPaintEvent* /*event*/) {
         return;
     }
 
-    auto traces = dataManager->getTracesRange(startTraceIndex, tracesPerPage);
-    if (traces.empty()) {
+    int maxSamples = dataManager->pageSampleCount();
+    if (maxSamples == 0) {
         p.setPen(Qt::black); // Черный текст на белом фоне
         p.drawText(rect(), Qt::AlignCenter, "No traces to display");
         return;
     }
 
-    if (!colorMapValid) {
-        updateColorMap();
-    }
-
-    int traceCount = traces.size();
-    int maxSamples = 0;
-    for (const auto& tr : traces)
-        maxSamples = std::max(maxSamples, static_cast<int>(tr.size()));
-    if (maxSamples == 0) return;
-
     // samplesPerPage теперь интерпретируется как время в миллисекундах
     int samplesToShow;
     if (samplesPerPage > 0) {
         // Конвертируем время в количество сэмплов
-        float dt = dataManager->getSampleInterval(); // в микросекундах
+        float dt = dataManager->pageAxes().verticalStep; // шаг по вертикали (мс для трасс)
         int timeInSamples = static_cast<int>(samplesPerPage / dt);
         samplesToShow = std::min(timeInSamples, maxSamples);
     } else {
@@ -151,6 +147,28 @@ void SegyViewer::paintEvent(QPaintEvent* /*event*/) {
         samplesToShow = std::min(100, maxSamples);
     }
 
+    // Читается только окно отсчетов, попадающее на экран.
+    // Декодирование внутри SegyReader вычитается из времени получения окна.
+    QElapsedTimer stageTimer;
+    stageTimer.start();
+    const double decodeBefore = dataManager->readerStats().decode_seconds;
+    auto traces = dataManager->getTracesWindow(startTraceIndex, tracesPerPage, startSampleIndex, samplesToShow);
+    const double windowMs = stageTimer.nsecsElapsed() * 1e-6;
+    frameTiming.decodeMs = std::min(windowMs, (dataManager->readerStats().decode_seconds - decodeBefore) * 1e3);
+    frameTiming.fetchMs = windowMs - frameTiming.decodeMs;
+    if (traces.empty()) {
+        p.setPen(Qt::black); // Черный текст на белом фоне
+        p.drawText(rect(), Qt::AlignCenter, "No traces to display");
+        return;
+    }
+
+    stageTimer.restart();
+    if (!colorMapValid) {
+        updateColorMap();
+    }
+
+    int traceCount = traces.size();
+
     // Определяем размеры для осей - асимметричные отступы
     const int leftMargin = 80;   // Отступ слева для подписей времени
     const int bottomMargin = 80; // Отступ снизу для подписей трасс
@@ -179,12 +197,12 @@ void SegyViewer::paintEvent(QPaintEvent* /*event*/) {
     for (int y = 0; y < actualSamplesToRender; ++y) {
         // Заполняем строку с суперсэмплингом
         for (int x = 0; x < traceCount; ++x) {
-            // Вычисляем индекс сэмпла с учетом шага
-            int sampleIndex = startSampleIndex + static_cast<int>(y * sampleStep);
+            // Вычисляем индекс сэмпла внутри окна с учетом шага
+            int sampleIndex = static_cast<int>(y * sampleStep);
             if (sampleIndex >= static_cast<int>(traces[x].size())) {
-                sampleIndex = traces[x].size() - 1;
+                sampleIndex = static_cast<int>(traces[x].size()) - 1;
             }
-            float amp = traces[x][sampleIndex];
+            float amp = sampleIndex >= 0 ? traces[x][sampleIndex] : std::numeric_limits<float>::quiet_NaN();
             QRgb color = amplitudeToRgb(amp);
             
             // Заполняем пиксель напрямую без суперсэмплинга
@@ -192,14 +210,20 @@ void SegyViewer::paintEvent(QPaintEvent* /*event*/) {
         }
     }
 
+    frameTiming.rasterMs = stageTimer.nsecsElapsed() * 1e-6;
+    stageTimer.restart();
+
     // Рисуем изображение напрямую без суперсэмплинга
     p.drawImage(imageRect, img, QRect(0, 0, img.width(), img.height()));
     
     // Вычисляем шаги для подписей
     int traceStep = std::max(1, traceCount / (imageRect.width() / labelSpacing));
     
+    // Подписи осей зависят от страницы: трассы, сборка, инлайн или временной срез
+    PageAxes axes = dataManager->pageAxes();
+
     // Вычисляем оптимальный шаг времени кратный 250мс
-    float dt = dataManager->getSampleInterval(); // в микросекундах
+    float dt = axes.verticalStep;
     float totalTimeMs = (samplesToShow - 1) * dt; // общее время в миллисекундах (сэмплы от 0 до samplesToShow-1)
     
     // Вычисляем оптимальный шаг времени в миллисекундах
@@ -245,7 +269,7 @@ void SegyViewer::paintEvent(QPaintEvent* /*event*/) {
         p.drawLine(x, height() - bottomMargin, x, height() - bottomMargin + tickLength);
         
         // Подпись - под делением
-        QString label = QString::number(traceIndex);
+        QString label = QString::number(axes.horizontalOrigin + traceIndex * axes.horizontalStep);
         QRect textRect(x - 20, height() - bottomMargin + tickLength + 5, 40, 20);
         p.drawText(textRect, Qt::AlignCenter, label);
     }
@@ -259,8 +283,9 @@ void SegyViewer::paintEvent(QPaintEvent* /*event*/) {
         // Деление - от левого края картинки влево
         p.drawLine(leftMargin - tickLength, y, leftMargin, y);
         
-        // Подпись времени - слева от деления, всегда в миллисекундах
-        QString timeLabel = QString::number(timeMs) + " ms";
+        // Подпись времени - слева от деления, в единицах вертикальной оси страницы
+        QString timeLabel = QString::number(axes.verticalOrigin + timeMs);
+        if (!axes.verticalUnit.empty()) timeLabel += " " + QString::fromStdString(axes.verticalUnit);
         
         QRect textRect(0, y - 10, leftMargin - tickLength - 5, 20);
         p.drawText(textRect, Qt::AlignRight | Qt::AlignVCenter, timeLabel);
@@ -271,23 +296,30 @@ void SegyViewer::paintEvent(QPaintEvent* /*event*/) {
     
     // Подпись оси трасс - под картинкой, ниже оси
     QRect xAxisLabelRect(leftMargin, height() - bottomMargin + 40, imageRect.width(), 20);
-    p.drawText(xAxisLabelRect, Qt::AlignCenter, "Trace Number");
+    p.drawText(xAxisLabelRect, Qt::AlignCenter, QString::fromStdString(axes.horizontalTitle));
     
     // Подпись оси времени - слева от картинки, с большим отступом
     QRect yAxisLabelRect(0, topMargin, 20, imageRect.height());
     p.save();
     p.translate(15, topMargin + imageRect.height() / 2); // Увеличиваем отступ с 5 до 15
     p.rotate(-90);
-    p.drawText(QRect(-50, -10, 100, 20), Qt::AlignCenter, "Time (ms)"); // Добавляем единицы измерения
+    p.drawText(QRect(-50, -10, 100, 20), Qt::AlignCenter, QString::fromStdString(axes.verticalTitle));
     p.restore();
     
     // Рисуем прямоугольник выделения для зума
     drawSelectionRect(p);
+    frameTiming.blitMs = stageTimer.nsecsElapsed() * 1e-6;
 }
 
 void SegyViewer::updateColorMap() {
     if (!dataManager) return;
 
+    if (!globalStatsComputed && dataManager->hasGlobalStats()) {
+        // Статистика посчитана менеджером данных (или загружена из кэша файла)
+        minAmplitude = dataManager->getGlobalMinAmplitude();
+        maxAmplitude = dataManager->getGlobalMaxAmplitude();
+        globalStatsComputed = true;
+    }
     if (!globalStatsComputed) {
         auto traces = dataManager->getTracesRange(0, 1000);
         if (!traces.empty()) {
@@ -335,6 +367,13 @@ void SegyViewer::updateColorMap() {
 void SegyViewer::computePercentiles() {
     if (!dataManager || percentilesComputed) return;
     
+    const AmplitudeStats& stats = dataManager->getAmplitudeStats();
+    if (dataManager->hasGlobalStats() && stats.valid()) {
+        amplitudePercentiles = stats.percentiles;
+        percentilesComputed = true;
+        return;
+    }
+    
     // Получаем все амплитуды для вычисления перцентилей
     auto traces = dataManager->getTracesRange(0, 1000); // Используем первые 1000 трасс для статистики
     if (traces.empty()) return;
@@ -373,6 +412,10 @@ void SegyViewer::updateEffectiveAmplitudeRange() {
     }
     
     if (!percentilesComputed) return;
+
+    // Карта атрибута имеет собственный диапазон значений, не связанный с амплитудами файла
+    const std::vector<float>& pagePercentiles = dataManager->pagePercentiles();
+    const std::vector<float>& percentiles = pagePercentiles.empty() ? amplitudePercentiles : pagePercentiles;
     
     // Применяем формулу: gain = [gain - 1.0, 101 - gain]
     float lowerPercentile = std::max(0.0f, gain - 1.0f);
@@ -387,8 +430,8 @@ void SegyViewer::updateEffectiveAmplitudeRange() {
     upperIndex = std::max(lowerIndex, std::min(upperIndex, 1000));
     
     // Получаем эффективные границы амплитуд
-    effectiveMinAmplitude = amplitudePercentiles[lowerIndex];
-    effectiveMaxAmplitude = amplitudePercentiles[upperIndex];
+    effectiveMinAmplitude = percentiles[lowerIndex];
+    effectiveMaxAmplitude = percentiles[upperIndex];
     
     // Защита от одинаковых значений
     if (std::abs(effectiveMaxAmplitude - effectiveMinAmplitude) < 1e-6) {
@@ -451,7 +494,7 @@ void SegyViewer::mouseMoveEvent(QMouseEvent* event) {
     int samplesToShow;
     if (samplesPerPage > 0) {
         // Конвертируем время в количество сэмплов
-        float dt = dataManager->getSampleInterval(); // в микросекундах
+        float dt = dataManager->pageAxes().verticalStep; // шаг по вертикали (мс для трасс)
         int timeInSamples = static_cast<int>(samplesPerPage / dt);
         samplesToShow = std::min(timeInSamples, maxSamples);
     } else {
@@ -498,6 +541,8 @@ int SegyViewer::calculateOptimalTimeStep(float totalTimeMs, int height, int labe
     if (roundedStepMs > totalTimeMs / 4) {
         roundedStepMs = static_cast<int>(totalTimeMs / 4);
     }
+    // Короткая ось (например, кросслайны среза) не должна давать нулевой шаг
+    if (roundedStepMs < 1) roundedStepMs = 1;
     
     // Возвращаем шаг в миллисекундах, а не в сэмплах
     return roundedStepMs;
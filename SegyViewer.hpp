@@ -9,6 +9,15 @@
 
 class SegyDataManager;
 
+// Время последнего кадра по этапам, мс
+struct FrameTiming {
+    double fetchMs = 0.0;  // получение окна трасс: кэш, копии и чтение файла без декодирования
+    double decodeMs = 0.0; // декодирование отсчетов в SegyReader
+    double rasterMs = 0.0; // цветовая карта и заполнение QImage
+    double blitMs = 0.0;   // вывод изображения, осей и подписей
+    double totalMs() const { return fetchMs + decodeMs + rasterMs + blitMs; }
+};
+
 class SegyViewer : public QWidget {
     Q_OBJECT
 public:
@@ -50,6 +59,9 @@ public:
     void zoomToRegion(int startTrace, int endTrace, int startSample, int endSample);
     QString getZoomHelpText() const;
 
+    // Разбивка времени последнего paintEvent с данными (для измерения отзывчивости)
+    const FrameTiming& lastFrameTiming() const { return frameTiming; }
+
 signals:
     void traceInfoUnderCursor(int traceIndex, int sampleIndex, float amplitude);
     void zoomChanged(); // Сигнал при изменении зума
@@ -127,4 +139,6 @@ private:
     int lastRenderedSamplesPerPage;
     float lastRenderedGain;
     QString lastRenderedColorScheme;
+
+    FrameTiming frameTiming;
 };
@@ -0,0 +1,111 @@
+#include "AmplitudeStats.hpp"
+#include "SegyReader.hpp"
+#include "SegyUtil.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+const size_t READ_CHUNK_BYTES = size_t(16) << 20;
+
+// Корзина значения; сравнение в double до приведения: значение далеко за границами
+// (выброс в дописанных трассах) не помещается в int
+int histogram_bin(float amplitude, double hist_min, double scale, int bins) {
+    double bin = (amplitude - hist_min) * scale;
+    return static_cast<int>(std::max(0.0, std::min(bin, static_cast<double>(bins - 1))));
+}
+
+// Вызывает f для каждого конечного значения трасс [first_trace, first_trace + n_traces)
+template <typename F>
+void for_each_amplitude(const SegyReader& reader, int first_trace, int n_traces, F f) {
+    const int n_samples = reader.num_samples();
+    const size_t bsize = static_cast<size_t>(reader.trace_bsize());
+    const int chunk_traces = static_cast<int>(std::max<size_t>(1, READ_CHUNK_BYTES / bsize));
+    std::vector<char> chunk;
+    std::vector<float> trace(n_samples);
+    for (int done = 0; done < n_traces; done += chunk_traces) {
+        int count = std::min(chunk_traces, n_traces - done);
+        chunk.resize(count * bsize);
+        reader.read_raw_block(first_trace + done, chunk.size(), chunk.data());
+        for (int t = 0; t < count; ++t) {
+            reader.decode_trace_samples(reinterpret_cast<const uint8_t*>(chunk.data()) + t * bsize, trace.data());
+            for (int s = 0; s < n_samples; ++s) {
+                if (std::isfinite(trace[s])) f(trace[s]);
+            }
+        }
+    }
+}
+
+} // namespace
+
+AmplitudeStats compute_amplitude_stats(const SegyReader& reader, int max_traces) {
+    AmplitudeStats stats;
+    const int n_traces = std::min(max_traces, reader.num_traces());
+    const int n_samples = reader.num_samples();
+    if (n_traces <= 0 || n_samples <= 0) return stats;
+
+    std::vector<float> amplitudes;
+    amplitudes.reserve(static_cast<size_t>(n_traces) * n_samples);
+    double sum = 0.0, sum_sq = 0.0;
+    for_each_amplitude(reader, 0, n_traces, [&](float amplitude) {
+        amplitudes.push_back(amplitude);
+        sum += amplitude;
+        sum_sq += static_cast<double>(amplitude) * amplitude;
+    });
+    stats.traces_analyzed = n_traces;
+    if (amplitudes.empty()) return stats;
+
+    std::sort(amplitudes.begin(), amplitudes.end());
+    const size_t n = amplitudes.size();
+    stats.sample_count = static_cast<int64_t>(n);
+    stats.mean = sum / n;
+    stats.rms = std::sqrt(sum_sq / n);
+    stats.min_amplitude = amplitudes.front();
+    stats.max_amplitude = amplitudes.back();
+    // Если все значения одинаковые, устанавливаем небольшой диапазон
+    if (std::abs(stats.max_amplitude - stats.min_amplitude) < 1e-6) {
+        stats.max_amplitude = stats.min_amplitude + 1.0f;
+    }
+
+    stats.percentiles.resize(AmplitudeStats::PERCENTILE_STEPS);
+    for (int i = 0; i < AmplitudeStats::PERCENTILE_STEPS; ++i) {
+        float percentile = i / 10.0f;
+        size_t index = static_cast<size_t>((percentile / 100.0f) * (n - 1));
+        stats.percentiles[i] = amplitudes[std::min(index, n - 1)];
+    }
+
+    stats.hist_min = stats.min_amplitude;
+    stats.hist_max = stats.max_amplitude;
+    stats.histogram.assign(AmplitudeStats::HISTOGRAM_BINS, 0);
+    const double scale = AmplitudeStats::HISTOGRAM_BINS / (static_cast<double>(stats.hist_max) - stats.hist_min);
+    for (float amplitude : amplitudes) {
+        ++stats.histogram[histogram_bin(amplitude, stats.hist_min, scale, AmplitudeStats::HISTOGRAM_BINS)];
+    }
+    return stats;
+}
+
+void accumulate_amplitude_stats(AmplitudeStats& stats, const SegyReader& reader, int first_trace, int n_traces) {
+    if (n_traces <= 0) return;
+    if (!stats.valid()) {
+        throw std::logic_error("accumulate_amplitude_stats requires initialized statistics");
+    }
+    double n = static_cast<double>(stats.sample_count);
+    double sum = stats.mean * n;
+    double sum_sq = stats.rms * stats.rms * n;
+    const int bins = static_cast<int>(stats.histogram.size());
+    const double scale = bins / (static_cast<double>(stats.hist_max) - stats.hist_min);
+
+    for_each_amplitude(reader, first_trace, n_traces, [&](float amplitude) {
+        stats.min_amplitude = std::min(stats.min_amplitude, amplitude);
+        stats.max_amplitude = std::max(stats.max_amplitude, amplitude);
+        sum += amplitude;
+        sum_sq += static_cast<double>(amplitude) * amplitude;
+        ++stats.sample_count;
+        // Границы корзин не сдвигаются, значения вне диапазона попадают в крайние
+        ++stats.histogram[histogram_bin(amplitude, stats.hist_min, scale, bins)];
+    });
+    stats.mean = sum / stats.sample_count;
+    stats.rms = std::sqrt(sum_sq / stats.sample_count);
+    stats.traces_analyzed += n_traces;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+class SegyReader;
+
+/**
+ * @brief Статистика амплитуд, по которой настраивается цветовая шкала.
+ *
+ * Считается по первым N трассам файла (как и прежний расчет во вьювере):
+ * минимум/максимум, среднее, RMS, гистограмма и перцентили от 0 до 100% с шагом 0.1%.
+ */
+struct AmplitudeStats {
+    static const int HISTOGRAM_BINS = 256;
+    static const int PERCENTILE_STEPS = 1001; // 0.0, 0.1, ..., 100.0
+
+    float min_amplitude = 0.0f;
+    float max_amplitude = 1.0f;
+    double mean = 0.0;
+    double rms = 0.0;
+    int64_t sample_count = 0;  // учтено конечных значений
+    int traces_analyzed = 0;
+    // Границы гистограммы: совпадают с min/max исходной выборки и не сдвигаются при дополнении
+    float hist_min = 0.0f;
+    float hist_max = 1.0f;
+    std::vector<uint64_t> histogram;  // HISTOGRAM_BINS корзин по [hist_min, hist_max]
+    std::vector<float> percentiles;   // PERCENTILE_STEPS значений
+
+    bool valid() const { return sample_count > 0 && percentiles.size() == PERCENTILE_STEPS; }
+};
+
+/**
+ * @brief Считает статистику по первым max_traces трассам.
+ * Трассы читаются крупными блоками через read_raw_block.
+ */
+AmplitudeStats compute_amplitude_stats(const SegyReader& reader, int max_traces = 1000);
+
+/**
+ * @brief Дополняет статистику трассами [first_trace, first_trace + n_traces) без пересчета прежних.
+ *
+ * Обновляются min/max, среднее, RMS и гистограмма (границы hist_min/hist_max сохраняются,
+ * выходящие за них значения попадают в крайние корзины). Перцентили остаются
+ * посчитанными по исходной выборке.
+ * @throws std::logic_error, если stats еще не посчитана.
+ */
+void accumulate_amplitude_stats(AmplitudeStats& stats, const SegyReader& reader, int first_trace, int n_traces);
@@ -0,0 +1,254 @@
+#include "AttributeMap.hpp"
+#include "SegyReader.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define SGY_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+const size_t CHUNK_CELLS = 1 << 16;   // ячеек между отчетами о ходе и проверками отмены
+const size_t PIECE_CELLS = 256;       // ячеек на одно задание потока
+const int PERCENTILE_STEPS = 1001;
+
+int max_threads() {
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+int thread_num() {
+#ifdef _OPENMP
+    return omp_get_thread_num();
+#else
+    return 0;
+#endif
+}
+
+#ifdef SGY_HAVE_SSE2
+inline float horizontal_sum(__m128 v) {
+    __m128 t = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    t = _mm_add_ss(t, _mm_shuffle_ps(t, t, 1));
+    return _mm_cvtss_f32(t);
+}
+
+inline float horizontal_max(__m128 v) {
+    __m128 t = _mm_max_ps(v, _mm_movehl_ps(v, v));
+    t = _mm_max_ss(t, _mm_shuffle_ps(t, t, 1));
+    return _mm_cvtss_f32(t);
+}
+
+inline float horizontal_min(__m128 v) {
+    __m128 t = _mm_min_ps(v, _mm_movehl_ps(v, v));
+    t = _mm_min_ss(t, _mm_shuffle_ps(t, t, 1));
+    return _mm_cvtss_f32(t);
+}
+#endif
+
+std::vector<float> value_percentiles(const std::vector<float>& values) {
+    std::vector<float> finite;
+    finite.reserve(values.size());
+    for (float v : values) {
+        if (std::isfinite(v)) finite.push_back(v);
+    }
+    if (finite.empty()) return {};
+    std::sort(finite.begin(), finite.end());
+    std::vector<float> percentiles(PERCENTILE_STEPS);
+    for (int i = 0; i < PERCENTILE_STEPS; ++i) {
+        size_t index = static_cast<size_t>(static_cast<double>(i) / (PERCENTILE_STEPS - 1) * (finite.size() - 1));
+        percentiles[i] = finite[std::min(index, finite.size() - 1)];
+    }
+    return percentiles;
+}
+
+// Считает values[c] для непустых ячеек с индексом трассы не меньше min_trace
+bool fill_cells(const SegyReader& reader, const std::vector<int>& cells, int min_trace, WindowAttribute attribute,
+                int first_sample, int n_samples, std::vector<float>& values,
+                const ProgressCallback& progress, const std::atomic<bool>* cancel) {
+    // Экземпляры SegyReader по потокам живут до конца построения
+    std::vector<std::unique_ptr<SegyReader>> readers(max_threads());
+    bool failed = false;
+    std::string error;
+
+    for (size_t chunk = 0; chunk < cells.size(); chunk += CHUNK_CELLS) {
+        if (cancel && cancel->load()) return false;
+        const size_t chunk_end = std::min(cells.size(), chunk + CHUNK_CELLS);
+        const long n_pieces = static_cast<long>((chunk_end - chunk + PIECE_CELLS - 1) / PIECE_CELLS);
+
+        #pragma omp parallel
+        {
+            std::vector<int> traces;
+            std::vector<float> window;
+            #pragma omp for schedule(dynamic)
+            for (long p = 0; p < n_pieces; ++p) {
+                const size_t begin = chunk + p * PIECE_CELLS;
+                const size_t end = std::min(chunk_end, begin + PIECE_CELLS);
+                try {
+                    // Пустые и уже посчитанные ячейки не читаются
+                    traces.clear();
+                    for (size_t c = begin; c < end; ++c) {
+                        if (cells[c] >= 0 && cells[c] >= min_trace) traces.push_back(cells[c]);
+                    }
+                    if (traces.empty()) continue;
+                    std::unique_ptr<SegyReader>& local = readers[thread_num()];
+                    if (!local) local.reset(new SegyReader(reader.filename()));
+                    window.resize(traces.size() * n_samples);
+                    local->read_sample_window(traces, first_sample, n_samples, window.data());
+                    size_t k = 0;
+                    for (size_t c = begin; c < end; ++c) {
+                        if (cells[c] < 0 || cells[c] < min_trace) continue;
+                        values[c] = reduce_window(window.data() + k * n_samples, n_samples, attribute);
+                        ++k;
+                    }
+                } catch (const std::exception& e) {
+                    #pragma omp critical
+                    {
+                        failed = true;
+                        error = e.what();
+                    }
+                }
+            }
+        }
+        if (failed) {
+            throw std::runtime_error("Failed to read attribute window: " + error);
+        }
+        report_progress(progress, "Extracting attribute map", chunk_end, cells.size());
+    }
+    return true;
+}
+
+void set_map_grid(const SurveyGeometry& geometry, AttributeMap& map) {
+    map.inline_min = geometry.inline_min();
+    map.inline_step = geometry.inline_step();
+    map.inline_count = geometry.inline_count();
+    map.crossline_min = geometry.crossline_min();
+    map.crossline_step = geometry.crossline_step();
+    map.crossline_count = geometry.crossline_count();
+}
+
+} // namespace
+
+const char* window_attribute_name(WindowAttribute attribute) {
+    switch (attribute) {
+    case WindowAttribute::Rms: return "RMS";
+    case WindowAttribute::MeanAbs: return "Mean Abs";
+    case WindowAttribute::Max: return "Max";
+    case WindowAttribute::Min: return "Min";
+    }
+    return "";
+}
+
+float reduce_window(const float* samples, int n, WindowAttribute attribute) {
+    if (n <= 0) return std::numeric_limits<float>::quiet_NaN();
+    int i = 0;
+    switch (attribute) {
+    case WindowAttribute::Rms:
+    case WindowAttribute::MeanAbs: {
+        const bool squares = attribute == WindowAttribute::Rms;
+        float sum = 0.0f;
+#ifdef SGY_HAVE_SSE2
+        const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+        __m128 acc = _mm_setzero_ps();
+        for (; i + 4 <= n; i += 4) {
+            __m128 x = _mm_loadu_ps(samples + i);
+            acc = _mm_add_ps(acc, squares ? _mm_mul_ps(x, x) : _mm_and_ps(x, abs_mask));
+        }
+        sum = horizontal_sum(acc);
+#endif
+        for (; i < n; ++i) sum += squares ? samples[i] * samples[i] : std::fabs(samples[i]);
+        return squares ? std::sqrt(sum / n) : sum / n;
+    }
+    case WindowAttribute::Max: {
+        float best = samples[0];
+#ifdef SGY_HAVE_SSE2
+        if (n >= 4) {
+            __m128 acc = _mm_loadu_ps(samples);
+            for (i = 4; i + 4 <= n; i += 4) acc = _mm_max_ps(acc, _mm_loadu_ps(samples + i));
+            best = horizontal_max(acc);
+        }
+#endif
+        for (; i < n; ++i) best = std::max(best, samples[i]);
+        return best;
+    }
+    case WindowAttribute::Min: {
+        float best = samples[0];
+#ifdef SGY_HAVE_SSE2
+        if (n >= 4) {
+            __m128 acc = _mm_loadu_ps(samples);
+            for (i = 4; i + 4 <= n; i += 4) acc = _mm_min_ps(acc, _mm_loadu_ps(samples + i));
+            best = horizontal_min(acc);
+        }
+#endif
+        for (; i < n; ++i) best = std::min(best, samples[i]);
+        return best;
+    }
+    }
+    return std::numeric_limits<float>::quiet_NaN();
+}
+
+bool extract_attribute_map(const SegyReader& reader, const SurveyGeometry& geometry, WindowAttribute attribute,
+                           int first_sample, int n_samples, AttributeMap& result,
+                           const ProgressCallback& progress, const std::atomic<bool>* cancel) {
+    if (!geometry.regular()) {
+        throw std::invalid_argument("Attribute map needs a regular 3D geometry");
+    }
+    if (first_sample < 0 || n_samples <= 0 || first_sample + n_samples > reader.num_samples()) {
+        throw std::out_of_range("Attribute window is outside the trace");
+    }
+    const std::vector<int>& cells = geometry.cells();
+    std::vector<float> values(cells.size(), std::numeric_limits<float>::quiet_NaN());
+    if (!fill_cells(reader, cells, 0, attribute, first_sample, n_samples, values, progress, cancel)) return false;
+
+    result.attribute = attribute;
+    result.first_sample = first_sample;
+    result.n_samples = n_samples;
+    set_map_grid(geometry, result);
+    result.values.swap(values);
+    result.percentiles = value_percentiles(result.values);
+    return true;
+}
+
+void update_attribute_map(const SegyReader& reader, const SurveyGeometry& geometry, int first_trace, AttributeMap& map) {
+    if (!geometry.regular()) {
+        throw std::invalid_argument("Attribute map needs a regular 3D geometry");
+    }
+    // Прежние ячейки переносимы, только если шаги и привязка сетки не изменились
+    if (map.inline_step != geometry.inline_step() || map.crossline_step != geometry.crossline_step() ||
+        (map.inline_min - geometry.inline_min()) % geometry.inline_step() != 0 ||
+        (map.crossline_min - geometry.crossline_min()) % geometry.crossline_step() != 0 ||
+        map.values.size() != static_cast<size_t>(map.inline_count) * map.crossline_count) {
+        extract_attribute_map(reader, geometry, map.attribute, map.first_sample, map.n_samples, map);
+        return;
+    }
+
+    // Прежние значения переносятся в (возможно, расширенную) сетку со сдвигом
+    const std::vector<int>& cells = geometry.cells();
+    const int n_xl = geometry.crossline_count();
+    std::vector<float> values(cells.size(), std::numeric_limits<float>::quiet_NaN());
+    for (int i = 0; i < map.inline_count; ++i) {
+        const int gi = (map.inline_min + i * map.inline_step - geometry.inline_min()) / geometry.inline_step();
+        for (int j = 0; j < map.crossline_count; ++j) {
+            const int gj = (map.crossline_min + j * map.crossline_step - geometry.crossline_min()) / geometry.crossline_step();
+            if (gi < 0 || gi >= geometry.inline_count() || gj < 0 || gj >= n_xl) continue;
+            values[static_cast<size_t>(gi) * n_xl + gj] = map.values[static_cast<size_t>(i) * map.crossline_count + j];
+        }
+    }
+    fill_cells(reader, cells, first_trace, map.attribute, map.first_sample, map.n_samples, values,
+               ProgressCallback(), nullptr);
+
+    set_map_grid(geometry, map);
+    map.values.swap(values);
+    map.percentiles = value_percentiles(map.values);
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include "SegyUtil.hpp"
+#include "SurveyGeometry.hpp"
+
+class SegyReader;
+
+// Атрибут амплитуд в окне [t0, t1] трассы
+enum class WindowAttribute { Rms = 0, MeanAbs = 1, Max = 2, Min = 3 };
+
+const char* window_attribute_name(WindowAttribute attribute);
+
+/**
+ * @brief Значение атрибута по n отсчетам (SSE, по 4 отсчета за шаг).
+ * Для пустого окна возвращается NaN.
+ */
+float reduce_window(const float* samples, int n, WindowAttribute attribute);
+
+/**
+ * @brief Карта атрибута по сетке: values[i * crossline_count + j] (NaN для пустых ячеек)
+ * и перцентили значений от 0 до 100% с шагом 0.1% для цветовой шкалы.
+ */
+struct AttributeMap {
+    WindowAttribute attribute = WindowAttribute::Rms;
+    int first_sample = 0;
+    int n_samples = 0;
+    // Сетка, по которой посчитаны values (нужна, чтобы дополнить карту дописанными трассами)
+    int inline_min = 0, inline_step = 1, inline_count = 0;
+    int crossline_min = 0, crossline_step = 1, crossline_count = 0;
+    std::vector<float> values;
+    std::vector<float> percentiles;
+};
+
+/**
+ * @brief Считает карту атрибута в окне отсчетов [first_sample, first_sample + n_samples).
+ *
+ * Ячейки обрабатываются порциями: с диска читается только окно каждой трассы
+ * (read_sample_window), порции делятся между потоками, у каждого потока свой
+ * экземпляр SegyReader. В памяти одновременно только окна текущей порции.
+ * @return false, если построение отменено через cancel.
+ * @throws std::runtime_error при ошибке чтения.
+ */
+bool extract_attribute_map(const SegyReader& reader, const SurveyGeometry& geometry, WindowAttribute attribute,
+                           int first_sample, int n_samples, AttributeMap& result,
+                           const ProgressCallback& progress = ProgressCallback(),
+                           const std::atomic<bool>* cancel = nullptr);
+
+/**
+ * @brief Дополняет карту трассами с индексами от first_trace (дописанными в файл).
+ * Значения прежних ячеек переносятся, если сетка расширилась; с диска читаются окна
+ * только новых трасс. Если шаги сетки изменились, карта считается заново целиком.
+ * @throws std::runtime_error при ошибке чтения.
+ */
+void update_attribute_map(const SegyReader& reader, const SurveyGeometry& geometry, int first_trace, AttributeMap& map);
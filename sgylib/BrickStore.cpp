@@ -0,0 +1,251 @@
+#include "BrickStore.hpp"
+#include "SegyReader.hpp"
+#include "SurveyGeometry.hpp"
+#include "TraceOrdering.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+
+#ifdef SGY_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace {
+
+const char BRICK_MAGIC[8] = { 'S', 'G', 'Y', 'B', 'R', 'I', 'K', '1' };
+const uint32_t BYTE_ORDER_MARK = 0x01020304u;
+
+struct BrickHeader {
+    char magic[8];
+    uint32_t byte_order;
+    uint32_t brick_size;
+    int32_t n_il, n_xl, n_samples;
+    int32_t il_min, il_step, xl_min, xl_step;
+    int32_t source_traces;
+    int32_t reserved[4];
+};
+static_assert(sizeof(BrickHeader) == 64, "BrickHeader must be 64 bytes");
+
+struct PackedEntry {
+    uint64_t offset;
+    uint32_t size;
+    uint32_t compressed;
+};
+static_assert(sizeof(PackedEntry) == 16, "PackedEntry must be 16 bytes");
+
+// Сжимает блок; если сжатие недоступно или не дает выигрыша, блок хранится как есть
+bool compress_brick(const std::vector<float>& brick, std::vector<char>& out) {
+    const size_t raw_bytes = brick.size() * sizeof(float);
+#ifdef SGY_HAVE_ZLIB
+    uLongf packed = compressBound(static_cast<uLong>(raw_bytes));
+    out.resize(packed);
+    if (compress2(reinterpret_cast<Bytef*>(out.data()), &packed, reinterpret_cast<const Bytef*>(brick.data()),
+                  static_cast<uLong>(raw_bytes), Z_BEST_SPEED) == Z_OK && packed < raw_bytes) {
+        out.resize(packed);
+        return true;
+    }
+#endif
+    out.resize(raw_bytes);
+    std::memcpy(out.data(), brick.data(), raw_bytes);
+    return false;
+}
+
+} // namespace
+
+const int BrickStore::BRICK_SIZE;
+const size_t BrickStore::BRICK_VALUES;
+
+bool BrickStore::build(const SegyReader& reader, const SurveyGeometry& geometry, const std::string& path,
+                       const ProgressCallback& progress, const std::atomic<bool>* cancel) {
+    if (!geometry.regular()) {
+        throw std::runtime_error("Brick store needs a regular 3D geometry");
+    }
+    const int n_il = geometry.inline_count();
+    const int n_xl = geometry.crossline_count();
+    const int ns = reader.num_samples();
+    const int bricks_il = (n_il + BRICK_SIZE - 1) / BRICK_SIZE;
+    const int bricks_xl = (n_xl + BRICK_SIZE - 1) / BRICK_SIZE;
+    const int bricks_t = (ns + BRICK_SIZE - 1) / BRICK_SIZE;
+    const size_t n_bricks = static_cast<size_t>(bricks_il) * bricks_xl * bricks_t;
+
+    const std::string tmp_path = path + ".tmp";
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("Cannot create brick store: " + tmp_path);
+    }
+    BrickHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, BRICK_MAGIC, sizeof(BRICK_MAGIC));
+    header.byte_order = BYTE_ORDER_MARK;
+    header.brick_size = BRICK_SIZE;
+    header.n_il = n_il;
+    header.n_xl = n_xl;
+    header.n_samples = ns;
+    header.il_min = geometry.inline_min();
+    header.il_step = geometry.inline_step();
+    header.xl_min = geometry.crossline_min();
+    header.xl_step = geometry.crossline_step();
+    header.source_traces = reader.num_traces();
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    // Индекс записывается в конце, когда известны смещения; пока резервируем место
+    std::vector<PackedEntry> index(n_bricks);
+    out.write(reinterpret_cast<const char*>(index.data()), static_cast<std::streamsize>(index.size() * sizeof(PackedEntry)));
+    uint64_t offset = sizeof(header) + index.size() * sizeof(PackedEntry);
+
+    const std::vector<int>& cells = geometry.cells();
+    std::vector<std::vector<float>> bricks(bricks_t);
+    std::vector<std::vector<char>> packed(bricks_t);
+    std::vector<char> is_compressed(bricks_t);
+    const int columns = bricks_il * bricks_xl;
+
+    for (int column = 0; column < columns; ++column) {
+        if (cancel && cancel->load()) {
+            out.close();
+            std::remove(tmp_path.c_str());
+            return false;
+        }
+        const int bi = column / bricks_xl;
+        const int bj = column % bricks_xl;
+        const int il0 = bi * BRICK_SIZE, il1 = std::min(n_il, il0 + BRICK_SIZE);
+        const int xl0 = bj * BRICK_SIZE, xl1 = std::min(n_xl, xl0 + BRICK_SIZE);
+
+        // Трассы столбца блоков читаются объединенными сериями
+        std::vector<int> wanted;
+        for (int i = il0; i < il1; ++i) {
+            for (int j = xl0; j < xl1; ++j) {
+                int trace = cells[static_cast<size_t>(i) * n_xl + j];
+                if (trace >= 0) wanted.push_back(trace);
+            }
+        }
+        std::unordered_map<int, std::vector<float>> traces;
+        for (const TraceReadRun& run : coalesce_trace_reads(wanted, READ_GAP_TRACES)) {
+            std::vector<std::vector<float>> block = reader.get_traces(run.first_trace, run.count);
+            for (int k = 0; k < run.count; ++k) traces[run.first_trace + k].swap(block[k]);
+        }
+
+        #pragma omp parallel for schedule(dynamic)
+        for (int bk = 0; bk < bricks_t; ++bk) {
+            std::vector<float>& brick = bricks[bk];
+            brick.assign(BRICK_VALUES, 0.0f);
+            const int t0 = bk * BRICK_SIZE, t1 = std::min(ns, t0 + BRICK_SIZE);
+            for (int i = il0; i < il1; ++i) {
+                for (int j = xl0; j < xl1; ++j) {
+                    float* dst = brick.data() + (static_cast<size_t>(i - il0) * BRICK_SIZE + (j - xl0)) * BRICK_SIZE;
+                    int trace = cells[static_cast<size_t>(i) * n_xl + j];
+                    if (trace < 0) {
+                        std::fill(dst, dst + (t1 - t0), std::numeric_limits<float>::quiet_NaN());
+                        continue;
+                    }
+                    const std::vector<float>& data = traces.at(trace);
+                    std::copy(data.begin() + t0, data.begin() + t1, dst);
+                }
+            }
+            is_compressed[bk] = compress_brick(brick, packed[bk]);
+        }
+
+        for (int bk = 0; bk < bricks_t; ++bk) {
+            PackedEntry& entry = index[(static_cast<size_t>(bi) * bricks_xl + bj) * bricks_t + bk];
+            entry.offset = offset;
+            entry.size = static_cast<uint32_t>(packed[bk].size());
+            entry.compressed = is_compressed[bk] ? 1u : 0u;
+            out.write(packed[bk].data(), static_cast<std::streamsize>(packed[bk].size()));
+            offset += packed[bk].size();
+        }
+        if (!out) {
+            out.close();
+            std::remove(tmp_path.c_str());
+            throw std::runtime_error("Failed to write brick store: " + tmp_path);
+        }
+        report_progress(progress, "Converting to bricks", column + 1, columns);
+    }
+
+    out.seekp(sizeof(header));
+    out.write(reinterpret_cast<const char*>(index.data()), static_cast<std::streamsize>(index.size() * sizeof(PackedEntry)));
+    out.close();
+    if (!out) {
+        std::remove(tmp_path.c_str());
+        throw std::runtime_error("Failed to write brick store: " + tmp_path);
+    }
+    std::remove(path.c_str());
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::remove(tmp_path.c_str());
+        throw std::runtime_error("Cannot write brick store: " + path);
+    }
+    return true;
+}
+
+BrickStore::BrickStore(const std::string& path) : file_(path, std::ios::binary) {
+    if (!file_) {
+        throw std::runtime_error("Cannot open brick store: " + path);
+    }
+    BrickHeader header;
+    if (!file_.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, BRICK_MAGIC, sizeof(BRICK_MAGIC)) != 0 ||
+        header.byte_order != BYTE_ORDER_MARK || header.brick_size != static_cast<uint32_t>(BRICK_SIZE) ||
+        header.n_il <= 0 || header.n_xl <= 0 || header.n_samples <= 0) {
+        throw std::runtime_error("Corrupted brick store: " + path);
+    }
+    n_il_ = header.n_il;
+    n_xl_ = header.n_xl;
+    n_samples_ = header.n_samples;
+    il_min_ = header.il_min;
+    il_step_ = header.il_step;
+    xl_min_ = header.xl_min;
+    xl_step_ = header.xl_step;
+    source_traces_ = header.source_traces;
+
+    std::vector<PackedEntry> entries(static_cast<size_t>(bricks_il()) * bricks_xl() * bricks_t());
+    if (!file_.read(reinterpret_cast<char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(PackedEntry)))) {
+        throw std::runtime_error("Corrupted brick store index: " + path);
+    }
+    index_.reserve(entries.size());
+    for (const PackedEntry& e : entries) {
+        if (e.size == 0 || (!e.compressed && e.size != BRICK_VALUES * sizeof(float))) {
+            throw std::runtime_error("Corrupted brick store index: " + path);
+        }
+#ifndef SGY_HAVE_ZLIB
+        if (e.compressed) {
+            throw std::runtime_error("Brick store is compressed, but zlib support is not built in: " + path);
+        }
+#endif
+        index_.push_back(IndexEntry{ e.offset, e.size, e.compressed });
+    }
+}
+
+bool BrickStore::matches(const SurveyGeometry& geometry) const {
+    return geometry.regular() &&
+           geometry.inline_count() == n_il_ && geometry.crossline_count() == n_xl_ &&
+           geometry.inline_min() == il_min_ && geometry.inline_step() == il_step_ &&
+           geometry.crossline_min() == xl_min_ && geometry.crossline_step() == xl_step_;
+}
+
+void BrickStore::read_brick(int id, std::vector<float>& out) const {
+    const IndexEntry& entry = index_.at(id);
+    std::vector<char> stored(entry.size);
+    {
+        std::lock_guard<std::mutex> lock(io_mutex_);
+        file_.clear();
+        file_.seekg(static_cast<std::streamoff>(entry.offset));
+        file_.read(stored.data(), entry.size);
+        if (static_cast<size_t>(file_.gcount()) != entry.size) {
+            throw std::runtime_error("Failed to read brick " + std::to_string(id));
+        }
+    }
+
+    out.resize(BRICK_VALUES);
+    if (!entry.compressed) {
+        std::memcpy(out.data(), stored.data(), BRICK_VALUES * sizeof(float));
+        return;
+    }
+#ifdef SGY_HAVE_ZLIB
+    uLongf size = static_cast<uLongf>(BRICK_VALUES * sizeof(float));
+    if (uncompress(reinterpret_cast<Bytef*>(out.data()), &size, reinterpret_cast<const Bytef*>(stored.data()), entry.size) != Z_OK ||
+        size != BRICK_VALUES * sizeof(float)) {
+        throw std::runtime_error("Corrupted brick " + std::to_string(id));
+    }
+#endif
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <fstream>
+#include <cstdint>
+#include "SegyUtil.hpp"
+
+class SegyReader;
+class SurveyGeometry;
+
+/**
+ * @class BrickStore
+ * @brief Блочное хранилище 3D-куба: кубики BRICK_SIZE^3 отсчетов (инлайн x кросслайн x время).
+ *
+ * Каждый блок сжимается независимо (zlib, если доступен) и адресуется через индекс
+ * в начале файла, поэтому инлайн, кросслайн и временной срез читают сопоставимое
+ * число блоков вне зависимости от порядка трасс в исходном SEG-Y.
+ * Внутри блока отсчеты идут в порядке [инлайн][кросслайн][время]; пустые ячейки
+ * сетки - NaN, выход за границы куба на краевых блоках - нули.
+ */
+class BrickStore {
+public:
+    static const int BRICK_SIZE = 64;
+    static const size_t BRICK_VALUES = static_cast<size_t>(BRICK_SIZE) * BRICK_SIZE * BRICK_SIZE;
+
+    /**
+     * @brief Конвертирует SEG-Y с регулярной геометрией в блочное хранилище.
+     * Столбцы блоков (64x64 трассы на всю длину) читаются сериями подряд идущих трасс,
+     * блоки столбца сжимаются параллельно. Файл пишется во временный и переименовывается.
+     * @return false, если построение отменено флагом cancel.
+     * @throws std::runtime_error при ошибке чтения/записи или нерегулярной геометрии.
+     */
+    static bool build(const SegyReader& reader, const SurveyGeometry& geometry, const std::string& path,
+                      const ProgressCallback& progress = ProgressCallback(),
+                      const std::atomic<bool>* cancel = nullptr);
+
+    /**
+     * @brief Открывает хранилище и читает индекс блоков.
+     * @throws std::runtime_error, если файл отсутствует или поврежден.
+     */
+    explicit BrickStore(const std::string& path);
+
+    BrickStore(const BrickStore&) = delete;
+    BrickStore& operator=(const BrickStore&) = delete;
+
+    int inline_count() const { return n_il_; }
+    int crossline_count() const { return n_xl_; }
+    int num_samples() const { return n_samples_; }
+    int inline_min() const { return il_min_; }
+    int inline_step() const { return il_step_; }
+    int crossline_min() const { return xl_min_; }
+    int crossline_step() const { return xl_step_; }
+    // Число трасс файла на момент построения
+    int source_traces() const { return source_traces_; }
+
+    int bricks_il() const { return (n_il_ + BRICK_SIZE - 1) / BRICK_SIZE; }
+    int bricks_xl() const { return (n_xl_ + BRICK_SIZE - 1) / BRICK_SIZE; }
+    int bricks_t() const { return (n_samples_ + BRICK_SIZE - 1) / BRICK_SIZE; }
+    int brick_id(int bi, int bj, int bk) const { return (bi * bricks_xl() + bj) * bricks_t() + bk; }
+
+    // true, если хранилище построено для этой сетки
+    bool matches(const SurveyGeometry& geometry) const;
+
+    /**
+     * @brief Читает и распаковывает блок в out (BRICK_VALUES значений).
+     * Потокобезопасно: под блокировкой выполняется только чтение сжатых байтов.
+     */
+    void read_brick(int id, std::vector<float>& out) const;
+
+    // Сжатый размер блока в байтах (для оценки объема чтения)
+    uint32_t stored_size(int id) const { return index_.at(id).size; }
+
+private:
+    struct IndexEntry {
+        uint64_t offset;
+        uint32_t size;
+        uint32_t compressed; // 0 - блок хранится без сжатия
+    };
+
+    int n_il_ = 0, n_xl_ = 0, n_samples_ = 0;
+    int il_min_ = 0, il_step_ = 1, xl_min_ = 0, xl_step_ = 1;
+    int source_traces_ = 0;
+    std::vector<IndexEntry> index_;
+    mutable std::ifstream file_;
+    mutable std::mutex io_mutex_;
+};
@@ -0,0 +1,184 @@
+#include "FenceExtractor.hpp"
+#include "SegyReader.hpp"
+#include "TraceOrdering.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define SGY_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// Колонка в точке (gi, gj) сетки; false, если точка вне сетки
+bool make_column(const SurveyGeometry& geometry, double gi, double gj, FenceColumn& column) {
+    const int n_il = geometry.inline_count();
+    const int n_xl = geometry.crossline_count();
+    const double eps = 1e-9;
+    if (gi < -eps || gj < -eps || gi > n_il - 1 + eps || gj > n_xl - 1 + eps) return false;
+    gi = std::max(0.0, std::min(gi, n_il - 1.0));
+    gj = std::max(0.0, std::min(gj, n_xl - 1.0));
+
+    const int i0 = std::min(static_cast<int>(gi), n_il - 1), i1 = std::min(i0 + 1, n_il - 1);
+    const int j0 = std::min(static_cast<int>(gj), n_xl - 1), j1 = std::min(j0 + 1, n_xl - 1);
+    const float fi = static_cast<float>(gi - i0), fj = static_cast<float>(gj - j0);
+    const int ii[4] = { i0, i0, i1, i1 };
+    const int jj[4] = { j0, j1, j0, j1 };
+    const float w[4] = { (1 - fi) * (1 - fj), (1 - fi) * fj, fi * (1 - fj), fi * fj };
+
+    float total = 0.0f;
+    for (int k = 0; k < 4; ++k) {
+        column.traces[k] = geometry.cells()[static_cast<size_t>(ii[k]) * n_xl + jj[k]];
+        column.weights[k] = (column.traces[k] >= 0) ? w[k] : 0.0f;
+        if (column.weights[k] == 0.0f) column.traces[k] = -1;
+        total += column.weights[k];
+    }
+    for (int k = 0; k < 4; ++k) {
+        if (total > 0.0f) column.weights[k] /= total;
+    }
+    column.inline_no = geometry.inline_min() + gi * geometry.inline_step();
+    column.crossline_no = geometry.crossline_min() + gj * geometry.crossline_step();
+    return true;
+}
+
+} // namespace
+
+std::vector<FenceColumn> plan_fence(const SurveyGeometry& geometry, const std::vector<FenceVertex>& vertices, double step_cells) {
+    std::vector<FenceColumn> columns;
+    if (!geometry.regular() || vertices.empty()) return columns;
+    if (step_cells <= 0.0) {
+        throw std::invalid_argument("Fence step must be positive");
+    }
+
+    // Вершины в координатах сетки (индексы ячеек)
+    std::vector<double> gi(vertices.size()), gj(vertices.size());
+    for (size_t v = 0; v < vertices.size(); ++v) {
+        gi[v] = (vertices[v].inline_no - geometry.inline_min()) / geometry.inline_step();
+        gj[v] = (vertices[v].crossline_no - geometry.crossline_min()) / geometry.crossline_step();
+    }
+
+    FenceColumn column;
+    for (size_t v = 0; v + 1 < vertices.size(); ++v) {
+        double di = gi[v + 1] - gi[v], dj = gj[v + 1] - gj[v];
+        int steps = std::max(1, static_cast<int>(std::ceil(std::sqrt(di * di + dj * dj) / step_cells)));
+        for (int k = 0; k < steps; ++k) {
+            double t = static_cast<double>(k) / steps;
+            if (make_column(geometry, gi[v] + t * di, gj[v] + t * dj, column)) columns.push_back(column);
+        }
+    }
+    if (make_column(geometry, gi.back(), gj.back(), column)) columns.push_back(column);
+    return columns;
+}
+
+std::vector<int> fence_traces(const std::vector<FenceColumn>& columns) {
+    std::vector<int> traces;
+    traces.reserve(columns.size() * 4);
+    for (const FenceColumn& column : columns) {
+        for (int k = 0; k < 4; ++k) {
+            if (column.traces[k] >= 0) traces.push_back(column.traces[k]);
+        }
+    }
+    std::sort(traces.begin(), traces.end());
+    traces.erase(std::unique(traces.begin(), traces.end()), traces.end());
+    return traces;
+}
+
+void interpolate_fence_column(const float* const corners[4], const float weights[4], int n_samples, float* out) {
+    if (weights[0] + weights[1] + weights[2] + weights[3] <= 0.0f) {
+        std::fill(out, out + n_samples, std::numeric_limits<float>::quiet_NaN());
+        return;
+    }
+    // Трассы с нулевым весом заменяются любой присутствующей: вклад все равно нулевой
+    const float* c[4];
+    const float* any = nullptr;
+    for (int k = 0; k < 4; ++k) {
+        if (corners[k] && weights[k] != 0.0f) any = corners[k];
+    }
+    for (int k = 0; k < 4; ++k) c[k] = (corners[k] && weights[k] != 0.0f) ? corners[k] : any;
+
+    int i = 0;
+#ifdef SGY_HAVE_SSE2
+    const __m128 w0 = _mm_set1_ps(weights[0]), w1 = _mm_set1_ps(weights[1]);
+    const __m128 w2 = _mm_set1_ps(weights[2]), w3 = _mm_set1_ps(weights[3]);
+    for (; i + 4 <= n_samples; i += 4) {
+        __m128 acc = _mm_mul_ps(w0, _mm_loadu_ps(c[0] + i));
+        acc = _mm_add_ps(acc, _mm_mul_ps(w1, _mm_loadu_ps(c[1] + i)));
+        acc = _mm_add_ps(acc, _mm_mul_ps(w2, _mm_loadu_ps(c[2] + i)));
+        acc = _mm_add_ps(acc, _mm_mul_ps(w3, _mm_loadu_ps(c[3] + i)));
+        _mm_storeu_ps(out + i, acc);
+    }
+#endif
+    for (; i < n_samples; ++i) {
+        out[i] = weights[0] * c[0][i] + weights[1] * c[1][i] + weights[2] * c[2][i] + weights[3] * c[3][i];
+    }
+}
+
+std::vector<std::vector<float>> interpolate_fence(const std::vector<FenceColumn>& columns, const std::vector<int>& traces,
+                                                  const std::vector<std::vector<float>>& trace_data, int n_samples) {
+    std::vector<std::vector<float>> result(columns.size(), std::vector<float>(n_samples));
+    #pragma omp parallel for schedule(static)
+    for (long c = 0; c < static_cast<long>(columns.size()); ++c) {
+        const FenceColumn& column = columns[c];
+        const float* corners[4];
+        float weights[4];
+        for (int k = 0; k < 4; ++k) {
+            corners[k] = nullptr;
+            weights[k] = column.weights[k];
+            if (column.traces[k] < 0) continue;
+            size_t pos = std::lower_bound(traces.begin(), traces.end(), column.traces[k]) - traces.begin();
+            if (pos < traces.size() && traces[pos] == column.traces[k] &&
+                static_cast<int>(trace_data[pos].size()) >= n_samples) {
+                corners[k] = trace_data[pos].data();
+            } else {
+                weights[k] = 0.0f; // трасса не прочитана - как пустая ячейка
+            }
+        }
+        // После отбрасывания непрочитанных трасс веса нормируются заново
+        float total = weights[0] + weights[1] + weights[2] + weights[3];
+        if (total > 0.0f) {
+            for (int k = 0; k < 4; ++k) weights[k] /= total;
+        }
+        interpolate_fence_column(corners, weights, n_samples, result[c].data());
+    }
+    return result;
+}
+
+std::vector<std::vector<float>> extract_fence(const SegyReader& reader, const std::vector<FenceColumn>& columns) {
+    const std::vector<int> traces = fence_traces(columns);
+    const std::vector<TraceReadRun> runs = coalesce_trace_reads(traces, READ_GAP_TRACES);
+    std::vector<std::vector<float>> trace_data(traces.size());
+
+    bool failed = false;
+    std::string error;
+    #pragma omp parallel
+    {
+        // Собственный экземпляр на поток: чтения идут параллельно, без общей блокировки
+        std::unique_ptr<SegyReader> local;
+        #pragma omp for schedule(dynamic)
+        for (long r = 0; r < static_cast<long>(runs.size()); ++r) {
+            try {
+                if (!local) local.reset(new SegyReader(reader.filename()));
+                std::vector<std::vector<float>> block = local->get_traces(runs[r].first_trace, runs[r].count);
+                // Серия может захватывать лишние трассы из промежутков - берем только нужные
+                auto first = std::lower_bound(traces.begin(), traces.end(), runs[r].first_trace);
+                for (auto it = first; it != traces.end() && *it < runs[r].first_trace + runs[r].count; ++it) {
+                    trace_data[it - traces.begin()].swap(block[*it - runs[r].first_trace]);
+                }
+            } catch (const std::exception& e) {
+                #pragma omp critical
+                {
+                    failed = true;
+                    error = e.what();
+                }
+            }
+        }
+    }
+    if (failed) {
+        throw std::runtime_error("Failed to read fence traces: " + error);
+    }
+    return interpolate_fence(columns, traces, trace_data, reader.num_samples());
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vector>
+#include "SurveyGeometry.hpp"
+
+class SegyReader;
+
+// Вершина ломаной разреза в номерах инлайна/кросслайна (допускаются дробные)
+struct FenceVertex {
+    double inline_no;
+    double crossline_no;
+};
+
+/**
+ * @brief Колонка разреза: точка ломаной и билинейные веса четырех соседних трасс.
+ * Отсутствующие трассы (пустые ячейки) имеют индекс -1 и нулевой вес; веса
+ * оставшихся нормированы. Если все четыре ячейки пусты, колонка заполняется NaN.
+ */
+struct FenceColumn {
+    double inline_no;
+    double crossline_no;
+    int traces[4];
+    float weights[4];
+};
+
+/**
+ * @brief Разбивает ломаную на колонки с шагом step_cells ячеек сетки.
+ * Точки вне сетки пропускаются. Последняя вершина всегда дает колонку.
+ */
+std::vector<FenceColumn> plan_fence(const SurveyGeometry& geometry, const std::vector<FenceVertex>& vertices,
+                                    double step_cells = 1.0);
+
+// Трассы, нужные для колонок: без повторов, по возрастанию
+std::vector<int> fence_traces(const std::vector<FenceColumn>& columns);
+
+/**
+ * @brief Колонка как взвешенная сумма четырех трасс (SSE, по 4 отсчета за шаг).
+ * @param corners Четыре указателя на трассы длиной n_samples (для нулевого веса допустим nullptr).
+ */
+void interpolate_fence_column(const float* const corners[4], const float weights[4], int n_samples, float* out);
+
+/**
+ * @brief Извлекает разрез из файла. Нужные трассы объединяются в серии подряд
+ * идущих и читаются параллельно: у каждого потока свой экземпляр SegyReader,
+ * поэтому чтения не упираются в общую блокировку файла.
+ * @throws std::runtime_error при ошибке чтения.
+ */
+std::vector<std::vector<float>> extract_fence(const SegyReader& reader, const std::vector<FenceColumn>& columns);
+
+// Интерполяция колонок по уже прочитанным трассам (trace_data[k] - трасса traces[k] из fence_traces)
+std::vector<std::vector<float>> interpolate_fence(const std::vector<FenceColumn>& columns, const std::vector<int>& traces,
+                                                  const std::vector<std::vector<float>>& trace_data, int n_samples);
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <string>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Позиционное чтение/запись по файловым дескрипторам (POSIX и Windows CRT).
+// Функции возвращают -1 при ошибке (код - в errno), *_all бросают std::runtime_error.
+
+#ifdef _WIN32
+inline int file_open_read(const std::string& path) { return _open(path.c_str(), _O_RDONLY | _O_BINARY); }
+inline int file_open_rw(const std::string& path) { return _open(path.c_str(), _O_RDWR | _O_BINARY); }
+inline int file_create(const std::string& path) {
+    return _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+}
+inline int file_close(int fd) { return _close(fd); }
+inline bool file_seek(int fd, int64_t offset) { return _lseeki64(fd, offset, SEEK_SET) >= 0; }
+inline int64_t file_write(int fd, const char* src, size_t n) { return _write(fd, src, static_cast<unsigned>(n)); }
+inline int64_t file_pread(int fd, int64_t offset, char* dst, size_t n) {
+    if (!file_seek(fd, offset)) return -1;
+    return _read(fd, dst, static_cast<unsigned>(n));
+}
+inline int64_t file_pwrite(int fd, int64_t offset, const char* src, size_t n) {
+    if (!file_seek(fd, offset)) return -1;
+    return file_write(fd, src, n);
+}
+inline bool file_sync(int fd) { return _commit(fd) == 0; }
+#else
+inline int file_open_read(const std::string& path) { return ::open(path.c_str(), O_RDONLY); }
+inline int file_open_rw(const std::string& path) { return ::open(path.c_str(), O_RDWR); }
+inline int file_create(const std::string& path) { return ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644); }
+inline int file_close(int fd) { return ::close(fd); }
+inline bool file_seek(int fd, int64_t offset) { return ::lseek(fd, static_cast<off_t>(offset), SEEK_SET) >= 0; }
+inline int64_t file_write(int fd, const char* src, size_t n) { return ::write(fd, src, n); }
+inline int64_t file_pread(int fd, int64_t offset, char* dst, size_t n) { return ::pread(fd, dst, n, static_cast<off_t>(offset)); }
+inline int64_t file_pwrite(int fd, int64_t offset, const char* src, size_t n) {
+    return ::pwrite(fd, src, n, static_cast<off_t>(offset));
+}
+inline bool file_sync(int fd) { return ::fsync(fd) == 0; }
+#endif
+
+// Дескриптор, закрываемый в деструкторе
+struct FileHandle {
+    int fd;
+    explicit FileHandle(int fd) : fd(fd) {}
+    ~FileHandle() { if (fd >= 0) file_close(fd); }
+    FileHandle(const FileHandle&) = delete;
+    FileHandle& operator=(const FileHandle&) = delete;
+};
+
+// Пишет n байт в текущую позицию, повторяя неполные записи
+inline void file_write_all(int fd, const char* src, size_t n, const std::string& path) {
+    while (n > 0) {
+        int64_t written = file_write(fd, src, n);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) {
+            throw std::runtime_error("Failed to write " + path + ": " + std::strerror(errno));
+        }
+        src += written;
+        n -= static_cast<size_t>(written);
+    }
+}
+
+inline void file_pwrite_all(int fd, int64_t offset, const char* src, size_t n, const std::string& path) {
+    while (n > 0) {
+        int64_t written = file_pwrite(fd, offset, src, n);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) {
+            throw std::runtime_error("Failed to write " + path + ": " + std::strerror(errno));
+        }
+        src += written;
+        offset += written;
+        n -= static_cast<size_t>(written);
+    }
+}
+
+// Читает ровно n байт; конец файла раньше - ошибка
+inline void file_pread_all(int fd, int64_t offset, char* dst, size_t n, const std::string& path) {
+    while (n > 0) {
+        int64_t got = file_pread(fd, offset, dst, n);
+        if (got < 0 && errno == EINTR) continue;
+        if (got < 0) {
+            throw std::runtime_error("Failed to read " + path + ": " + std::strerror(errno));
+        }
+        if (got == 0) {
+            throw std::runtime_error("Unexpected end of file " + path + " at byte " + std::to_string(offset));
+        }
+        dst += got;
+        offset += got;
+        n -= static_cast<size_t>(got);
+    }
+}
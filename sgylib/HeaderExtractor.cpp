@@ -0,0 +1,189 @@
+#include "HeaderExtractor.hpp"
+#include "TraceFieldMap.hpp"
+#include "SegyReader.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <limits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SGY_X86_DISPATCH 1
+#include <immintrin.h>
+#endif
+
+const std::vector<int32_t>& HeaderColumns::column(const std::string& field) const {
+    for (size_t k = 0; k < fields.size(); ++k) {
+        if (fields[k] == field) return columns[k];
+    }
+    throw std::invalid_argument("Field is not extracted: " + field);
+}
+
+std::vector<FieldInfo> resolve_trace_fields(const std::vector<std::string>& field_names) {
+    std::vector<FieldInfo> fields;
+    fields.reserve(field_names.size());
+    for (const auto& name : field_names) {
+        auto it = TraceFieldOffsets.find(name);
+        if (it == TraceFieldOffsets.end()) {
+            throw std::invalid_argument("Unknown trace header field: " + name);
+        }
+        fields.push_back(it->second);
+    }
+    return fields;
+}
+
+static void check_fields(const std::vector<FieldInfo>& fields) {
+    for (const auto& f : fields) {
+        if ((f.size != 2 && f.size != 4) || f.offset < 1 || f.offset + f.size - 1 > 240) {
+            throw std::invalid_argument("Invalid trace header field: offset " + std::to_string(f.offset) +
+                                        ", size " + std::to_string(f.size));
+        }
+    }
+}
+
+static void extract_range_scalar(const uint8_t* block, int first, int last, size_t stride,
+                                 const std::vector<FieldInfo>& fields, int32_t* const* out) {
+    for (int i = first; i < last; ++i) {
+        const uint8_t* header = block + static_cast<size_t>(i) * stride;
+        for (size_t k = 0; k < fields.size(); ++k) {
+            const FieldInfo& f = fields[k];
+            out[k][i] = (f.size == 4) ? get_i32_be(header, f.offset)
+                                      : static_cast<int32_t>(get_i16_be(header, f.offset));
+        }
+    }
+}
+
+void extract_header_fields_scalar(const uint8_t* block, int n_traces, size_t stride,
+                                  const std::vector<FieldInfo>& fields, int32_t* const* out) {
+    check_fields(fields);
+    extract_range_scalar(block, 0, n_traces, stride, fields, out);
+}
+
+#ifdef SGY_X86_DISPATCH
+
+// Обрабатывает по 8 заголовков за итерацию: одна gather-загрузка 32-битных слов на поле,
+// затем перестановка байтов из big-endian. Все загрузки остаются внутри 240-байтового
+// заголовка: 2-байтовое поле читается вместе с двумя предшествующими байтами.
+__attribute__((target("avx2")))
+static int extract_avx2(const uint8_t* block, int n_traces, size_t stride,
+                        const std::vector<FieldInfo>& fields, int32_t* const* out) {
+    const int s = static_cast<int>(stride);
+    const __m256i vindex = _mm256_setr_epi32(0, s, 2 * s, 3 * s, 4 * s, 5 * s, 6 * s, 7 * s);
+    const __m256i bswap32 = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                             3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    // Старший байт поля в байт 3 слова, младший - в байт 2; затем арифметический сдвиг на 16
+    const __m256i tail16 = _mm256_setr_epi8(-1, -1, 3, 2, -1, -1, 7, 6, -1, -1, 11, 10, -1, -1, 15, 14,
+                                            -1, -1, 3, 2, -1, -1, 7, 6, -1, -1, 11, 10, -1, -1, 15, 14);
+    const __m256i head16 = _mm256_setr_epi8(-1, -1, 1, 0, -1, -1, 5, 4, -1, -1, 9, 8, -1, -1, 13, 12,
+                                            -1, -1, 1, 0, -1, -1, 5, 4, -1, -1, 9, 8, -1, -1, 13, 12);
+
+    int i = 0;
+    for (; i + 8 <= n_traces; i += 8) {
+        const uint8_t* base = block + static_cast<size_t>(i) * stride;
+        for (size_t k = 0; k < fields.size(); ++k) {
+            const FieldInfo& f = fields[k];
+            __m256i v;
+            if (f.size == 4) {
+                v = _mm256_i32gather_epi32(reinterpret_cast<const int*>(base + f.offset - 1), vindex, 1);
+                v = _mm256_shuffle_epi8(v, bswap32);
+            } else if (f.offset >= 3) {
+                v = _mm256_i32gather_epi32(reinterpret_cast<const int*>(base + f.offset - 3), vindex, 1);
+                v = _mm256_srai_epi32(_mm256_shuffle_epi8(v, tail16), 16);
+            } else {
+                v = _mm256_i32gather_epi32(reinterpret_cast<const int*>(base + f.offset - 1), vindex, 1);
+                v = _mm256_srai_epi32(_mm256_shuffle_epi8(v, head16), 16);
+            }
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out[k] + i), v);
+        }
+    }
+    return i;
+}
+
+static bool cpu_has_avx2() {
+    static const bool has = __builtin_cpu_supports("avx2");
+    return has;
+}
+
+#endif
+
+bool header_extractor_uses_simd() {
+#ifdef SGY_X86_DISPATCH
+    return cpu_has_avx2();
+#else
+    return false;
+#endif
+}
+
+void extract_header_fields(const uint8_t* block, int n_traces, size_t stride,
+                           const std::vector<FieldInfo>& fields, int32_t* const* out) {
+    check_fields(fields);
+    if (n_traces <= 0 || fields.empty()) return;
+
+    int done = 0;
+#ifdef SGY_X86_DISPATCH
+    // Индексы gather - 32-битные смещения относительно первой трассы группы
+    if (cpu_has_avx2() && stride <= static_cast<size_t>(std::numeric_limits<int>::max() / 8)) {
+        done = extract_avx2(block, n_traces, stride, fields, out);
+    }
+#endif
+    extract_range_scalar(block, done, n_traces, stride, fields, out);
+}
+
+HeaderColumns extract_header_columns(const uint8_t* block, int n_traces, size_t stride,
+                                     const std::vector<std::string>& field_names) {
+    HeaderColumns result;
+    result.fields = field_names;
+    result.columns.assign(field_names.size(), std::vector<int32_t>(n_traces > 0 ? n_traces : 0));
+
+    std::vector<int32_t*> out(field_names.size());
+    for (size_t k = 0; k < out.size(); ++k) {
+        out[k] = result.columns[k].data();
+    }
+    extract_header_fields(block, n_traces, stride, resolve_trace_fields(field_names), out.data());
+    return result;
+}
+
+std::vector<std::vector<int32_t>> read_header_columns(const SegyReader& reader, const std::vector<FieldInfo>& fields,
+                                                      const ProgressCallback& progress) {
+    return read_header_columns(reader, fields, 0, reader.num_traces(), progress);
+}
+
+std::vector<std::vector<int32_t>> read_header_columns(const SegyReader& reader, const std::vector<FieldInfo>& fields,
+                                                      int first_trace, int n_traces, const ProgressCallback& progress) {
+    check_fields(fields);
+    if (first_trace < 0 || n_traces < 0 || n_traces > reader.num_traces() - first_trace) {
+        throw std::out_of_range("Header range out of range: " + std::to_string(first_trace) + "+" + std::to_string(n_traces));
+    }
+    const size_t trace_size = reader.trace_bsize();
+    const size_t CHUNK_SIZE_BYTES = 64 * 1024 * 1024;
+    const int EXTRACT_BLOCK = 4096;
+    const int traces_per_chunk = static_cast<int>(std::max<size_t>(1, CHUNK_SIZE_BYTES / trace_size));
+
+    std::vector<std::vector<int32_t>> columns(fields.size(), std::vector<int32_t>(n_traces));
+    std::vector<char> chunk;
+    for (int first = 0; first < n_traces; first += traces_per_chunk) {
+        const int count = std::min(traces_per_chunk, n_traces - first);
+        chunk.resize(static_cast<size_t>(count) * trace_size);
+        reader.read_raw_block(first_trace + first, chunk.size(), chunk.data());
+        const uint8_t* block = reinterpret_cast<const uint8_t*>(chunk.data());
+
+        // Каждый подблок пишет прямо в свой участок колонок
+        const int n_blocks = (count + EXTRACT_BLOCK - 1) / EXTRACT_BLOCK;
+        #pragma omp parallel for schedule(static)
+        for (int b = 0; b < n_blocks; ++b) {
+            const int offset = b * EXTRACT_BLOCK;
+            std::vector<int32_t*> out(fields.size());
+            for (size_t k = 0; k < fields.size(); ++k) out[k] = columns[k].data() + first + offset;
+            extract_header_fields(block + offset * trace_size, std::min(EXTRACT_BLOCK, count - offset),
+                                  trace_size, fields, out.data());
+        }
+        report_progress(progress, "Reading trace headers", first + count, n_traces);
+    }
+    return columns;
+}
+
+HeaderColumns read_header_columns(const SegyReader& reader, const std::vector<std::string>& field_names,
+                                  const ProgressCallback& progress) {
+    HeaderColumns result;
+    result.fields = field_names;
+    result.columns = read_header_columns(reader, resolve_trace_fields(field_names), progress);
+    return result;
+}
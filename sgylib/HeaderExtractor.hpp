@@ -0,0 +1,71 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "SegyUtil.hpp"
+
+class SegyReader;
+
+/**
+ * @brief Набор колонок значений полей заголовков (structure-of-arrays).
+ *
+ * columns[k][i] - значение поля fields[k] для i-й трассы блока.
+ */
+struct HeaderColumns {
+    std::vector<std::string> fields;
+    std::vector<std::vector<int32_t>> columns;
+
+    const std::vector<int32_t>& column(const std::string& field) const;
+};
+
+/**
+ * @brief Преобразует имена полей заголовка трассы в смещения (см. TraceFieldMap.hpp).
+ * @throws std::invalid_argument для неизвестного поля.
+ */
+std::vector<FieldInfo> resolve_trace_fields(const std::vector<std::string>& field_names);
+
+/**
+ * @brief Извлекает K полей из M последовательных 240-байтовых заголовков.
+ *
+ * Заголовки лежат в block с шагом stride байт (обычно stride = размер трассы,
+ * для блока из одних заголовков stride = 240). Результат пишется в out[k][0..n_traces),
+ * 2-байтовые поля расширяются со знаком. На процессорах с AVX2 используются
+ * gather-загрузки и перестановка байтов, иначе - скалярный путь.
+ */
+void extract_header_fields(const uint8_t* block, int n_traces, size_t stride,
+                           const std::vector<FieldInfo>& fields, int32_t* const* out);
+
+/**
+ * @brief Удобная обертка: извлекает поля по именам в HeaderColumns.
+ */
+HeaderColumns extract_header_columns(const uint8_t* block, int n_traces, size_t stride,
+                                     const std::vector<std::string>& field_names);
+
+/**
+ * @brief Скалярная реализация (для проверки и сравнения производительности).
+ */
+void extract_header_fields_scalar(const uint8_t* block, int n_traces, size_t stride,
+                                  const std::vector<FieldInfo>& fields, int32_t* const* out);
+
+/**
+ * @brief Извлекает поля заголовков всех трасс файла в колонки (по одной на поле).
+ *
+ * Файл читается последовательно блоками, заголовки блока разбираются параллельно (OpenMP).
+ * Поля задаются смещениями, поэтому подходят и нестандартные байты заголовка.
+ */
+std::vector<std::vector<int32_t>> read_header_columns(const SegyReader& reader, const std::vector<FieldInfo>& fields,
+                                                      const ProgressCallback& progress = ProgressCallback());
+
+// То же для трасс [first_trace, first_trace + n_traces): например, только дописанных в файл
+std::vector<std::vector<int32_t>> read_header_columns(const SegyReader& reader, const std::vector<FieldInfo>& fields,
+                                                      int first_trace, int n_traces,
+                                                      const ProgressCallback& progress = ProgressCallback());
+
+// То же по именам полей (см. TraceFieldMap.hpp)
+HeaderColumns read_header_columns(const SegyReader& reader, const std::vector<std::string>& field_names,
+                                  const ProgressCallback& progress = ProgressCallback());
+
+// true, если extract_header_fields использует AVX2
+bool header_extractor_uses_simd();
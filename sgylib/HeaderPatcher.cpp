@@ -0,0 +1,292 @@
+#include "HeaderPatcher.hpp"
+#include "SegyReader.hpp"
+#include "TraceOrdering.hpp"
+#include "FileIo.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+
+namespace {
+
+const int TRACE_HEADER_SIZE = 240;
+const size_t BATCH_BYTES = 32u << 20; // прочитанных трасс на пакет
+// Во сколько раз чтение серий целиком должно превышать объем самих заголовков,
+// чтобы вместо серий читались только заголовки
+const size_t HEADERS_ONLY_RATIO = 4;
+
+const char JOURNAL_MAGIC[8] = { 'S', 'G', 'Y', 'U', 'N', 'D', 'O', '1' };
+const uint32_t BYTE_ORDER_MARK = 0x01020304u;
+const size_t JOURNAL_HEADER_SIZE = 16;
+const size_t JOURNAL_RECORD_SIZE = sizeof(int64_t) + TRACE_HEADER_SIZE; // индекс трассы + исходный заголовок
+
+struct JournalHeader {
+    char magic[8];
+    uint32_t byte_order;
+    int32_t trace_bsize;
+};
+static_assert(sizeof(JournalHeader) == JOURNAL_HEADER_SIZE, "JournalHeader must be packed into 16 bytes");
+
+// Серия подряд идущих трасс в буфере пакета (трассы целиком или только заголовки)
+struct Piece {
+    int first_trace;
+    int count;
+    size_t buffer_offset;
+    size_t entries_end; // конец заголовков этой серии в списке изменяемых
+};
+
+// Изменяемый заголовок: индекс в патче и смещение заголовка в буфере пакета
+struct Entry {
+    size_t patch_index;
+    size_t buffer_offset;
+};
+
+void validate_patch(const HeaderPatch& patch) {
+    if (patch.values.size() != patch.fields.size()) {
+        throw std::invalid_argument("Header patch must have one value column per field.");
+    }
+    for (size_t k = 0; k < patch.fields.size(); ++k) {
+        const FieldInfo& field = patch.fields[k];
+        if ((field.size != 2 && field.size != 4) || field.offset < 1 || field.offset + field.size - 1 > TRACE_HEADER_SIZE) {
+            throw std::invalid_argument("Invalid header field at byte " + std::to_string(field.offset));
+        }
+        if (patch.values[k].size() != patch.traces.size()) {
+            throw std::invalid_argument("Header patch column size mismatch for field at byte " + std::to_string(field.offset));
+        }
+        if (field.size == 2) {
+            for (int32_t value : patch.values[k]) {
+                if (value < std::numeric_limits<int16_t>::min() || value > std::numeric_limits<int16_t>::max()) {
+                    throw std::invalid_argument("Value " + std::to_string(value) + " does not fit 2-byte field at byte " +
+                                                std::to_string(field.offset));
+                }
+            }
+        }
+    }
+}
+
+class UndoJournal {
+public:
+    UndoJournal(const std::string& path, int trace_bsize) : path_(path), fd_(file_create(path)) {
+        if (fd_.fd < 0) {
+            throw std::runtime_error("Cannot create undo journal: " + path);
+        }
+        JournalHeader header;
+        std::memcpy(header.magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+        header.byte_order = BYTE_ORDER_MARK;
+        header.trace_bsize = trace_bsize;
+        file_write_all(fd_.fd, reinterpret_cast<const char*>(&header), sizeof(header), path_);
+    }
+
+    // Дописывает исходные заголовки и дожидается их записи на диск
+    void append(const HeaderPatch& patch, const std::vector<Entry>& entries, const std::vector<char>& buffer) {
+        records_.resize(entries.size() * JOURNAL_RECORD_SIZE);
+        for (size_t e = 0; e < entries.size(); ++e) {
+            char* record = records_.data() + e * JOURNAL_RECORD_SIZE;
+            int64_t trace = patch.traces[entries[e].patch_index];
+            std::memcpy(record, &trace, sizeof(trace));
+            std::memcpy(record + sizeof(trace), buffer.data() + entries[e].buffer_offset, TRACE_HEADER_SIZE);
+        }
+        file_write_all(fd_.fd, records_.data(), records_.size(), path_);
+        if (!file_sync(fd_.fd)) {
+            throw std::runtime_error("Failed to sync undo journal: " + path_);
+        }
+    }
+
+private:
+    std::string path_;
+    FileHandle fd_;
+    std::vector<char> records_;
+};
+
+} // namespace
+
+bool apply_header_patch(const std::string& segy_path, const HeaderPatch& patch, const HeaderPatchOptions& options,
+                        HeaderPatchStats* stats, const ProgressCallback& progress, const std::atomic<bool>* cancel) {
+    auto start = std::chrono::steady_clock::now();
+    validate_patch(patch);
+
+    SegyReader reader(segy_path);
+    const size_t n = patch.traces.size();
+    for (int trace : patch.traces) {
+        if (trace < 0 || trace >= reader.num_traces()) {
+            throw std::out_of_range("Trace index out of range: " + std::to_string(trace));
+        }
+    }
+
+    // Заголовки обходятся в порядке смещений в файле
+    std::vector<size_t> order(n);
+    std::iota(order.begin(), order.end(), static_cast<size_t>(0));
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return patch.traces[a] < patch.traces[b]; });
+    for (size_t i = 1; i < n; ++i) {
+        if (patch.traces[order[i]] == patch.traces[order[i - 1]]) {
+            throw std::invalid_argument("Duplicate trace in header patch: " + std::to_string(patch.traces[order[i]]));
+        }
+    }
+
+    std::vector<TraceReadRun> runs = coalesce_trace_reads(patch.traces, std::max(0, options.read_max_gap));
+    const size_t bsize = static_cast<size_t>(reader.trace_bsize());
+    // Редкие заголовки длинных трасс читаются по одному: серии были бы в основном из отсчетов
+    size_t run_bytes = 0;
+    for (const TraceReadRun& r : runs) run_bytes += static_cast<size_t>(r.count) * bsize;
+    const bool headers_only = run_bytes > HEADERS_ONLY_RATIO * n * TRACE_HEADER_SIZE;
+    if (headers_only) runs = coalesce_trace_reads(patch.traces, 0);
+    // Шаг трасс в буфере пакета
+    const size_t stride = headers_only ? static_cast<size_t>(TRACE_HEADER_SIZE) : bsize;
+    const int piece_traces = static_cast<int>(std::max<size_t>(1, BATCH_BYTES / stride));
+
+    FileHandle fd(file_open_rw(segy_path));
+    if (fd.fd < 0) {
+        throw std::runtime_error("Cannot open SEG-Y file for writing: " + segy_path);
+    }
+    std::unique_ptr<UndoJournal> journal;
+    if (!options.journal_path.empty()) {
+        journal.reset(new UndoJournal(options.journal_path, reader.trace_bsize()));
+    }
+
+    HeaderPatchStats local;
+    std::vector<Piece> pieces;
+    std::vector<Entry> entries;
+    std::vector<char> buffer;
+    size_t next = 0;  // следующий заголовок в order
+    size_t run = 0;
+    int run_pos = 0;  // трасс серии run, вошедших в предыдущие пакеты
+    bool cancelled = false;
+    while (run < runs.size()) {
+        if (cancel && cancel->load()) {
+            cancelled = true;
+            break;
+        }
+
+        // Пакет: серии (длинные - по частям) общим объемом около BATCH_BYTES
+        pieces.clear();
+        size_t batch_bytes = 0;
+        while (run < runs.size() && batch_bytes < BATCH_BYTES) {
+            int count = std::min(piece_traces, runs[run].count - run_pos);
+            pieces.push_back(Piece{ runs[run].first_trace + run_pos, count, batch_bytes, 0 });
+            batch_bytes += static_cast<size_t>(count) * stride;
+            run_pos += count;
+            if (run_pos == runs[run].count) {
+                ++run;
+                run_pos = 0;
+            }
+        }
+        buffer.resize(batch_bytes);
+        entries.clear();
+        for (Piece& piece : pieces) {
+            if (headers_only) {
+                for (int t = 0; t < piece.count; ++t) {
+                    file_pread_all(fd.fd, reader.trace_offset(piece.first_trace + t),
+                                   buffer.data() + piece.buffer_offset + static_cast<size_t>(t) * stride, TRACE_HEADER_SIZE, segy_path);
+                }
+            } else {
+                file_pread_all(fd.fd, reader.trace_offset(piece.first_trace), buffer.data() + piece.buffer_offset,
+                               static_cast<size_t>(piece.count) * bsize, segy_path);
+            }
+            local.bytes_read += static_cast<size_t>(piece.count) * stride;
+            while (next < n && patch.traces[order[next]] < piece.first_trace + piece.count) {
+                size_t offset = piece.buffer_offset + static_cast<size_t>(patch.traces[order[next]] - piece.first_trace) * stride;
+                entries.push_back(Entry{ order[next], offset });
+                ++next;
+            }
+            piece.entries_end = entries.size();
+        }
+
+        // Журнал - до изменения файла
+        if (journal) journal->append(patch, entries, buffer);
+
+        // Новые заголовки
+        const long n_entries = static_cast<long>(entries.size());
+        #pragma omp parallel for schedule(static)
+        for (long e = 0; e < n_entries; ++e) {
+            uint8_t* header = reinterpret_cast<uint8_t*>(buffer.data()) + entries[e].buffer_offset;
+            for (size_t k = 0; k < patch.fields.size(); ++k) {
+                int32_t value = patch.values[k][entries[e].patch_index];
+                if (patch.fields[k].size == 2) {
+                    set_i16_be(header, patch.fields[k].offset, static_cast<int16_t>(value));
+                } else {
+                    set_i32_be(header, patch.fields[k].offset, value);
+                }
+            }
+        }
+
+        // Запись: соседние заголовки серии объединяются вместе с промежутком
+        // (в буфере одних заголовков промежутков нет - каждый пишется отдельно)
+        size_t e = 0;
+        for (const Piece& piece : pieces) {
+            while (e < piece.entries_end) {
+                size_t begin = entries[e].buffer_offset;
+                size_t end = begin + TRACE_HEADER_SIZE;
+                for (++e; !headers_only && e < piece.entries_end && entries[e].buffer_offset - end <= options.write_max_gap; ++e) {
+                    end = entries[e].buffer_offset + TRACE_HEADER_SIZE;
+                }
+                int64_t file_offset = reader.trace_offset(piece.first_trace + static_cast<int>((begin - piece.buffer_offset) / stride)) +
+                                      static_cast<int64_t>((begin - piece.buffer_offset) % stride);
+                file_pwrite_all(fd.fd, file_offset, buffer.data() + begin, end - begin, segy_path);
+                local.bytes_written += end - begin;
+                local.write_calls++;
+            }
+        }
+        local.traces += entries.size();
+        report_progress(progress, "Patching headers", static_cast<int64_t>(next), static_cast<int64_t>(n));
+    }
+
+    local.seconds = seconds_since(start);
+    if (stats) *stats = local;
+    return !cancelled;
+}
+
+int64_t undo_header_patch(const std::string& segy_path, const std::string& journal_path) {
+    SegyReader reader(segy_path);
+    FileHandle journal(file_open_read(journal_path));
+    if (journal.fd < 0) {
+        throw std::runtime_error("Cannot open undo journal: " + journal_path);
+    }
+    JournalHeader header;
+    file_pread_all(journal.fd, 0, reinterpret_cast<char*>(&header), sizeof(header), journal_path);
+    if (std::memcmp(header.magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) != 0 || header.byte_order != BYTE_ORDER_MARK) {
+        throw std::runtime_error("Corrupted undo journal: " + journal_path);
+    }
+    if (header.trace_bsize != reader.trace_bsize()) {
+        throw std::runtime_error("Undo journal " + journal_path + " does not match trace size of " + segy_path);
+    }
+
+    FileHandle fd(file_open_rw(segy_path));
+    if (fd.fd < 0) {
+        throw std::runtime_error("Cannot open SEG-Y file for writing: " + segy_path);
+    }
+
+    // Журнал читается блоками записей; неполная запись в конце отбрасывается
+    std::vector<char> chunk(4096 * JOURNAL_RECORD_SIZE);
+    int64_t offset = JOURNAL_HEADER_SIZE;
+    int64_t restored = 0;
+    for (;;) {
+        size_t filled = 0;
+        while (filled < chunk.size()) {
+            int64_t got = file_pread(journal.fd, offset + static_cast<int64_t>(filled), chunk.data() + filled, chunk.size() - filled);
+            if (got < 0 && errno == EINTR) continue;
+            if (got < 0) throw std::runtime_error("Failed to read undo journal: " + journal_path);
+            if (got == 0) break;
+            filled += static_cast<size_t>(got);
+        }
+        size_t records = filled / JOURNAL_RECORD_SIZE;
+        for (size_t r = 0; r < records; ++r) {
+            const char* record = chunk.data() + r * JOURNAL_RECORD_SIZE;
+            int64_t trace;
+            std::memcpy(&trace, record, sizeof(trace));
+            if (trace < 0 || trace >= reader.num_traces()) {
+                throw std::runtime_error("Corrupted undo journal: trace " + std::to_string(trace) + " is out of range");
+            }
+            file_pwrite_all(fd.fd, reader.trace_offset(static_cast<int>(trace)), record + sizeof(trace), TRACE_HEADER_SIZE, segy_path);
+            restored++;
+        }
+        offset += static_cast<int64_t>(records * JOURNAL_RECORD_SIZE);
+        if (filled < chunk.size()) break;
+    }
+    if (!file_sync(fd.fd)) {
+        throw std::runtime_error("Failed to sync " + segy_path);
+    }
+    return restored;
+}
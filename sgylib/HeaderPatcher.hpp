@@ -0,0 +1,66 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include "SegyUtil.hpp"
+
+/**
+ * @brief Новые значения полей заголовков: поле fields[k] трассы traces[i] получает values[k][i].
+ * Поля задаются смещениями (см. resolve_trace_fields), поэтому подходят и нестандартные байты.
+ */
+struct HeaderPatch {
+    std::vector<int> traces;                  // индексы трасс файла, без повторов
+    std::vector<FieldInfo> fields;
+    std::vector<std::vector<int32_t>> values; // values[k].size() == traces.size()
+};
+
+struct HeaderPatchOptions {
+    // Журнал отката: исходные заголовки изменяемых трасс пишутся в него (с fsync) до их
+    // перезаписи в файле. Пустая строка - без журнала.
+    std::string journal_path;
+    // Трассы, между которыми не больше read_max_gap ненужных, читаются одним блоком;
+    // если такие блоки состояли бы в основном из отсчетов, читаются только заголовки
+    int read_max_gap = 16;
+    // Соседние заголовки, между которыми не больше write_max_gap байт, пишутся одним pwrite
+    // вместе с промежутком (он перезаписывается прочитанными же байтами). Промежуток между
+    // заголовками соседних трасс - это их отсчеты, поэтому при значении по умолчанию (0)
+    // каждый заголовок пишется отдельным pwrite; объединение имеет смысл только для коротких
+    // трасс, когда перезапись отсчетов дешевле лишних вызовов.
+    size_t write_max_gap = 0;
+};
+
+struct HeaderPatchStats {
+    int64_t traces = 0;        // измененные заголовки
+    int64_t bytes_read = 0;
+    int64_t bytes_written = 0; // в SEG-Y, без журнала
+    int64_t write_calls = 0;
+    double seconds = 0.0;
+};
+
+/**
+ * @brief Изменяет поля заголовков трасс SEG-Y на месте, не переписывая файл.
+ *
+ * Заголовки читаются сериями подряд идущих трасс, а если трассы длинные и серии состояли бы
+ * в основном из отсчетов - только сами 240-байтовые заголовки. Новые заголовки пакета
+ * вычисляются параллельно (OpenMP), затем пакет записывается вызовами pwrite по возрастанию
+ * смещения - по одному на заголовок, если write_max_gap не позволяет захватить отсчеты между ними.
+ * При отмене или ошибке уже записанные пакеты остаются в файле - их откатывает журнал.
+ * @return false, если операция отменена флагом cancel.
+ * @throws std::invalid_argument при некорректном патче; std::runtime_error при ошибке ввода-вывода.
+ */
+bool apply_header_patch(const std::string& segy_path, const HeaderPatch& patch,
+                        const HeaderPatchOptions& options = HeaderPatchOptions(),
+                        HeaderPatchStats* stats = nullptr,
+                        const ProgressCallback& progress = ProgressCallback(),
+                        const std::atomic<bool>* cancel = nullptr);
+
+/**
+ * @brief Восстанавливает заголовки из журнала отката apply_header_patch.
+ * Недописанная последняя запись журнала (прерванный патч) пропускается: ее заголовок
+ * в файле еще не менялся.
+ * @return Число восстановленных заголовков.
+ * @throws std::runtime_error, если журнал поврежден или относится к другому файлу.
+ */
+int64_t undo_header_patch(const std::string& segy_path, const std::string& journal_path);
@@ -0,0 +1,121 @@
+#include "IbmConvert.hpp"
+#include "SegyUtil.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SGY_X86_DISPATCH 1
+#include <immintrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define SGY_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+inline void encode_scalar(const float* src, size_t n, uint8_t* dst) {
+    for (size_t i = 0; i < n; ++i) {
+        put_u32_be(dst + i * 4, ieee_to_ibm(src[i]));
+    }
+}
+
+#ifdef SGY_X86_DISPATCH
+// Возвращает false, если в группе есть денормализованные числа, NaN или Inf
+__attribute__((target("avx2")))
+inline bool encode8(const float* src, uint8_t* dst) {
+    const __m256i u = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+    const __m256i abs = _mm256_and_si256(u, _mm256_set1_epi32(0x7FFFFFFF));
+    const __m256i e = _mm256_srli_epi32(abs, 23);
+    const __m256i zero = _mm256_cmpeq_epi32(abs, _mm256_setzero_si256());
+    const __m256i special = _mm256_or_si256(_mm256_andnot_si256(zero, _mm256_cmpeq_epi32(e, _mm256_setzero_si256())),
+                                            _mm256_cmpeq_epi32(e, _mm256_set1_epi32(255)));
+    if (!_mm256_testz_si256(special, special)) return false;
+
+    const __m256i m = _mm256_or_si256(_mm256_and_si256(u, _mm256_set1_epi32(0x007FFFFF)), _mm256_set1_epi32(0x00800000));
+    const __m256i ibm_exp = _mm256_add_epi32(_mm256_srli_epi32(_mm256_add_epi32(e, _mm256_set1_epi32(129)), 2), _mm256_set1_epi32(1));
+    const __m256i shift = _mm256_sub_epi32(_mm256_slli_epi32(ibm_exp, 2), _mm256_add_epi32(e, _mm256_set1_epi32(130)));
+    // bias = ((2^shift - 1) >> 1) + младший бит результата (если shift > 0)
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i half = _mm256_srli_epi32(_mm256_sub_epi32(_mm256_sllv_epi32(one, shift), one), 1);
+    const __m256i odd = _mm256_and_si256(_mm256_and_si256(_mm256_srlv_epi32(m, shift), one),
+                                         _mm256_cmpgt_epi32(shift, _mm256_setzero_si256()));
+    const __m256i fraction = _mm256_srlv_epi32(_mm256_add_epi32(m, _mm256_add_epi32(half, odd)), shift);
+
+    __m256i ibm = _mm256_or_si256(_mm256_and_si256(u, _mm256_set1_epi32(static_cast<int>(0x80000000u))),
+                                  _mm256_or_si256(_mm256_slli_epi32(ibm_exp, 24), fraction));
+    ibm = _mm256_andnot_si256(zero, ibm);
+    const __m256i swap = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                          3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), _mm256_shuffle_epi8(ibm, swap));
+    return true;
+}
+
+// Кодирует группы по 8 отсчетов; возвращает число обработанных отсчетов
+__attribute__((target("avx2")))
+size_t encode_avx2(const float* src, size_t n, uint8_t* dst) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        if (!encode8(src + i, dst + i * 4)) encode_scalar(src + i, 8, dst + i * 4);
+    }
+    return i;
+}
+
+bool cpu_has_avx2() {
+    static const bool has = __builtin_cpu_supports("avx2");
+    return has;
+}
+#endif
+
+#ifdef SGY_HAVE_SSE2
+// Сдвиг вправо на shift (0..3) с округлением: в SSE2 нет сдвигов на разное число бит по каналам,
+// поэтому считаются все четыре варианта и выбирается нужный
+inline __m128i round_shift(__m128i m, __m128i shift) {
+    const __m128i one = _mm_set1_epi32(1);
+    __m128i result = _mm_and_si128(_mm_cmpeq_epi32(shift, _mm_setzero_si128()), m);
+    for (int s = 1; s <= 3; ++s) {
+        const __m128i count = _mm_cvtsi32_si128(s);
+        __m128i bias = _mm_add_epi32(_mm_set1_epi32(((1 << s) - 1) >> 1), _mm_and_si128(_mm_srl_epi32(m, count), one));
+        __m128i shifted = _mm_srl_epi32(_mm_add_epi32(m, bias), count);
+        result = _mm_or_si128(result, _mm_and_si128(_mm_cmpeq_epi32(shift, _mm_set1_epi32(s)), shifted));
+    }
+    return result;
+}
+
+inline bool encode4(const float* src, uint8_t* dst) {
+    const __m128i u = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+    const __m128i abs = _mm_and_si128(u, _mm_set1_epi32(0x7FFFFFFF));
+    const __m128i e = _mm_srli_epi32(abs, 23);
+    const __m128i zero = _mm_cmpeq_epi32(abs, _mm_setzero_si128());
+    const __m128i special = _mm_or_si128(_mm_andnot_si128(zero, _mm_cmpeq_epi32(e, _mm_setzero_si128())),
+                                         _mm_cmpeq_epi32(e, _mm_set1_epi32(255)));
+    if (_mm_movemask_epi8(special)) return false;
+
+    const __m128i m = _mm_or_si128(_mm_and_si128(u, _mm_set1_epi32(0x007FFFFF)), _mm_set1_epi32(0x00800000));
+    const __m128i ibm_exp = _mm_add_epi32(_mm_srli_epi32(_mm_add_epi32(e, _mm_set1_epi32(129)), 2), _mm_set1_epi32(1));
+    const __m128i shift = _mm_sub_epi32(_mm_slli_epi32(ibm_exp, 2), _mm_add_epi32(e, _mm_set1_epi32(130)));
+    __m128i ibm = _mm_or_si128(_mm_and_si128(u, _mm_set1_epi32(static_cast<int>(0x80000000u))),
+                               _mm_or_si128(_mm_slli_epi32(ibm_exp, 24), round_shift(m, shift)));
+    ibm = _mm_andnot_si128(zero, ibm);
+    // Перестановка байтов в big-endian: сначала половины слова, затем байты в половинах
+    ibm = _mm_shufflehi_epi16(_mm_shufflelo_epi16(ibm, 0xB1), 0xB1);
+    ibm = _mm_or_si128(_mm_slli_epi16(ibm, 8), _mm_srli_epi16(ibm, 8));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), ibm);
+    return true;
+}
+#endif
+
+} // namespace
+
+void ieee_to_ibm_be(const float* src, size_t n, uint8_t* dst) {
+    size_t i = 0;
+#ifdef SGY_X86_DISPATCH
+    // AVX2 выбирается во время выполнения, как в extract_header_fields
+    if (cpu_has_avx2()) i = encode_avx2(src, n, dst);
+#endif
+#ifdef SGY_HAVE_SSE2
+    for (; i + 4 <= n; i += 4) {
+        if (!encode4(src + i, dst + i * 4)) encode_scalar(src + i, 4, dst + i * 4);
+    }
+#endif
+    encode_scalar(src + i, n - i, dst + i * 4);
+}
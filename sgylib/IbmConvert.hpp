@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Пакетное кодирование отсчетов в IBM float для записи SEG-Y.
+ *
+ * Результат совпадает с ieee_to_ibm побитно (округление к ближайшему, NaN/Inf -
+ * максимум по модулю). Используются AVX2 (по 8 отсчетов, при сборке с -mavx2)
+ * или SSE2 (по 4 отсчета); группы с денормализованными числами, NaN и Inf
+ * дорабатываются скалярно.
+ */
+
+// Кодирует n отсчетов в IBM float big-endian: dst размером n * 4 байт
+void ieee_to_ibm_be(const float* src, size_t n, uint8_t* dst);
@@ -0,0 +1,233 @@
+#include "PostingList.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define SGY_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+const uint8_t TAG_RUNS = 0x01;
+const uint8_t TAG_PACKED = 0x02;
+const size_t BLOCK_SIZE = 128;
+
+inline uint32_t zigzag(int64_t v) {
+    return static_cast<uint32_t>((v << 1) ^ (v >> 63));
+}
+
+inline int32_t unzigzag(uint32_t z) {
+    return static_cast<int32_t>((z >> 1) ^ (0u - (z & 1u)));
+}
+
+void put_varint(std::vector<char>& out, uint32_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<char>((v & 0x7F) | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+// Разбор входного буфера с проверкой границ
+struct Cursor {
+    const uint8_t* p;
+    const uint8_t* end;
+
+    uint32_t varint() {
+        uint32_t v = 0;
+        for (int shift = 0; shift < 35; shift += 7) {
+            if (p >= end) throw std::runtime_error("Corrupted posting list: truncated varint");
+            uint8_t b = *p++;
+            v |= static_cast<uint32_t>(b & 0x7F) << shift;
+            if (!(b & 0x80)) return v;
+        }
+        throw std::runtime_error("Corrupted posting list: varint too long");
+    }
+
+    const uint8_t* take(size_t n) {
+        if (static_cast<size_t>(end - p) < n) throw std::runtime_error("Corrupted posting list: truncated block");
+        const uint8_t* r = p;
+        p += n;
+        return r;
+    }
+};
+
+inline int bit_width(uint32_t v) {
+    int w = 0;
+    while (v) { ++w; v >>= 1; }
+    return w;
+}
+
+// --- Серии арифметических прогрессий ---
+
+std::vector<char> encode_runs(const std::vector<int>& indices) {
+    std::vector<char> out;
+    out.push_back(static_cast<char>(TAG_RUNS));
+    put_varint(out, static_cast<uint32_t>(indices.size()));
+
+    int64_t prev = 0;
+    size_t i = 0;
+    while (i < indices.size()) {
+        int64_t start = indices[i];
+        int64_t step = (i + 1 < indices.size()) ? static_cast<int64_t>(indices[i + 1]) - start : 0;
+        size_t len = 1;
+        while (i + len < indices.size() && static_cast<int64_t>(indices[i + len]) - indices[i + len - 1] == step) {
+            ++len;
+        }
+        if (len == 1) step = 0;
+        put_varint(out, zigzag(start - prev));
+        put_varint(out, zigzag(step));
+        put_varint(out, static_cast<uint32_t>(len - 1));
+        prev = start + step * static_cast<int64_t>(len - 1);
+        i += len;
+    }
+    return out;
+}
+
+void decode_runs(Cursor& c, size_t n, int* out) {
+    int64_t prev = 0;
+    size_t pos = 0;
+    while (pos < n) {
+        int64_t start = prev + unzigzag(c.varint());
+        int32_t step = unzigzag(c.varint());
+        size_t len = static_cast<size_t>(c.varint()) + 1;
+        if (len > n - pos) throw std::runtime_error("Corrupted posting list: run overflow");
+        int32_t v = static_cast<int32_t>(start);
+        for (size_t k = 0; k < len; ++k) {
+            out[pos + k] = v + static_cast<int32_t>(k) * step;
+        }
+        prev = start + static_cast<int64_t>(step) * static_cast<int64_t>(len - 1);
+        pos += len;
+    }
+}
+
+// --- Упакованные разности ---
+
+std::vector<char> encode_packed(const std::vector<int>& indices) {
+    std::vector<char> out;
+    out.push_back(static_cast<char>(TAG_PACKED));
+    put_varint(out, static_cast<uint32_t>(indices.size()));
+    if (indices.empty()) return out;
+
+    uint32_t deltas[BLOCK_SIZE];
+    int64_t prev = 0;
+    for (size_t base = 0; base < indices.size(); base += BLOCK_SIZE) {
+        size_t count = std::min(BLOCK_SIZE, indices.size() - base);
+        uint32_t max_value = 0;
+        for (size_t k = 0; k < count; ++k) {
+            deltas[k] = zigzag(static_cast<int64_t>(indices[base + k]) - prev);
+            prev = indices[base + k];
+            max_value |= deltas[k];
+        }
+        int width = bit_width(max_value);
+        out.push_back(static_cast<char>(width));
+
+        uint64_t acc = 0;
+        int acc_bits = 0;
+        for (size_t k = 0; k < count; ++k) {
+            acc |= static_cast<uint64_t>(deltas[k]) << acc_bits;
+            acc_bits += width;
+            while (acc_bits >= 8) {
+                out.push_back(static_cast<char>(acc & 0xFF));
+                acc >>= 8;
+                acc_bits -= 8;
+            }
+        }
+        if (acc_bits > 0) out.push_back(static_cast<char>(acc & 0xFF));
+    }
+    return out;
+}
+
+void unpack_block(const uint8_t* src, int width, size_t count, uint32_t* dst) {
+    if (width == 0) {
+        std::fill(dst, dst + count, 0u);
+        return;
+    }
+    const uint64_t mask = (width == 32) ? 0xFFFFFFFFull : ((1ull << width) - 1);
+    uint64_t acc = 0;
+    int acc_bits = 0;
+    for (size_t k = 0; k < count; ++k) {
+        while (acc_bits < width) {
+            acc |= static_cast<uint64_t>(*src++) << acc_bits;
+            acc_bits += 8;
+        }
+        dst[k] = static_cast<uint32_t>(acc & mask);
+        acc >>= width;
+        acc_bits -= width;
+    }
+}
+
+// zigzag-декодирование и префиксная сумма; возвращает последнее значение
+int32_t prefix_sum(const uint32_t* deltas, size_t count, int32_t prev, int* out) {
+    size_t k = 0;
+#ifdef SGY_HAVE_SSE2
+    __m128i carry = _mm_set1_epi32(prev);
+    const __m128i one = _mm_set1_epi32(1);
+    for (; k + 4 <= count; k += 4) {
+        __m128i z = _mm_loadu_si128(reinterpret_cast<const __m128i*>(deltas + k));
+        __m128i d = _mm_xor_si128(_mm_srli_epi32(z, 1), _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(z, one)));
+        d = _mm_add_epi32(d, _mm_slli_si128(d, 4));
+        d = _mm_add_epi32(d, _mm_slli_si128(d, 8));
+        d = _mm_add_epi32(d, carry);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + k), d);
+        carry = _mm_shuffle_epi32(d, 0xFF);
+    }
+    prev = _mm_cvtsi128_si32(carry);
+#endif
+    for (; k < count; ++k) {
+        prev += unzigzag(deltas[k]);
+        out[k] = prev;
+    }
+    return prev;
+}
+
+void decode_packed(Cursor& c, size_t n, int* out) {
+    uint32_t deltas[BLOCK_SIZE];
+    int32_t prev = 0;
+    for (size_t base = 0; base < n; base += BLOCK_SIZE) {
+        size_t count = std::min(BLOCK_SIZE, n - base);
+        int width = *c.take(1);
+        if (width > 32) throw std::runtime_error("Corrupted posting list: bad bit width");
+        const uint8_t* src = c.take((count * width + 7) / 8);
+        unpack_block(src, width, count, deltas);
+        prev = prefix_sum(deltas, count, prev, out + base);
+    }
+}
+
+} // namespace
+
+std::vector<char> encode_posting_list(const std::vector<int>& indices) {
+    std::vector<char> runs = encode_runs(indices);
+    // Для регулярных списков серии на порядки компактнее - упакованный вариант не нужен
+    if (runs.size() <= 16) return runs;
+    std::vector<char> packed = encode_packed(indices);
+    return packed.size() < runs.size() ? packed : runs;
+}
+
+size_t posting_list_length(const char* data, size_t size) {
+    Cursor c = { reinterpret_cast<const uint8_t*>(data), reinterpret_cast<const uint8_t*>(data) + size };
+    c.take(1);
+    return c.varint();
+}
+
+void decode_posting_list(const char* data, size_t size, std::vector<int>& out) {
+    Cursor c = { reinterpret_cast<const uint8_t*>(data), reinterpret_cast<const uint8_t*>(data) + size };
+    uint8_t tag = *c.take(1);
+    size_t n = c.varint();
+    size_t old_size = out.size();
+    out.resize(old_size + n);
+    try {
+        if (tag == TAG_RUNS) {
+            decode_runs(c, n, out.data() + old_size);
+        } else if (tag == TAG_PACKED) {
+            decode_packed(c, n, out.data() + old_size);
+        } else {
+            throw std::runtime_error("Corrupted posting list: unknown encoding");
+        }
+    } catch (...) {
+        out.resize(old_size);
+        throw;
+    }
+}
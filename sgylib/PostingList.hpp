@@ -0,0 +1,28 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Сжатые списки индексов трасс (posting lists) для хранения в TraceMap.
+ *
+ * Поддерживаются два представления, кодировщик выбирает более компактное:
+ * - серии арифметических прогрессий (start, step, length) в varint - для регулярной
+ *   геометрии, где индексы сборки идут с постоянным шагом;
+ * - разности соседних индексов (zigzag), упакованные блоками по 128 значений
+ *   с минимальной разрядностью на блок - для нерегулярных списков.
+ * Декодирование разностей использует SSE2 (zigzag и префиксные суммы по 4 значения).
+ */
+
+// Кодирует список индексов в компактный BLOB
+std::vector<char> encode_posting_list(const std::vector<int>& indices);
+
+/**
+ * @brief Декодирует BLOB, дописывая индексы в конец out.
+ * @throws std::runtime_error для поврежденных данных.
+ */
+void decode_posting_list(const char* data, size_t size, std::vector<int>& out);
+
+// Количество индексов в BLOB без полного декодирования
+size_t posting_list_length(const char* data, size_t size);
@@ -0,0 +1,262 @@
+#include "RawExport.hpp"
+#include "SegyReader.hpp"
+#include "BinFieldMap.hpp"
+#include "FileIo.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#endif
+
+namespace {
+
+const int64_t CHUNK_BYTES = 256ll << 20;   // между проверками отмены и отчетами о прогрессе
+const int64_t CALL_BYTES = 1ll << 30;      // не больше за один системный вызов
+const size_t BUFFER_BYTES = 8u << 20;      // буфер запасного пути чтения/записи
+
+#ifdef __linux__
+// Ошибки, после которых тот же диапазон можно скопировать следующим способом:
+// вызов не поддерживается ядром или для этой пары файлов/файловых систем
+bool can_fall_back(int error) {
+    return error == ENOSYS || error == EXDEV || error == EINVAL || error == EOPNOTSUPP || error == EBADF;
+}
+#endif
+
+/**
+ * Выходной файл: заголовки, копирование диапазонов исходных файлов в конец и
+ * финальное обновление бинарного заголовка. Недописанный файл удаляется деструктором.
+ */
+class RawCopier {
+public:
+    RawCopier(const std::string& path, int64_t total_bytes, RawCopyMethod first_method,
+              const ProgressCallback& progress, const std::atomic<bool>* cancel)
+        : path_(path), total_(total_bytes), progress_(progress), cancel_(cancel) {
+        out_ = file_create(path);
+        if (out_ < 0) {
+            throw std::runtime_error("Cannot create " + path + ": " + std::strerror(errno));
+        }
+#ifdef __linux__
+#ifdef SYS_copy_file_range
+        method_ = RawCopyMethod::CopyFileRange;
+#else
+        method_ = RawCopyMethod::SendFile;
+#endif
+#else
+        method_ = RawCopyMethod::ReadWrite;
+#endif
+        // Способы упорядочены от быстрого к запасному: более быстрые, чем first_method, не пробуются
+        if (first_method > method_) method_ = first_method;
+    }
+
+    ~RawCopier() {
+        if (out_ >= 0) file_close(out_);
+        if (!committed_) std::remove(path_.c_str());
+    }
+
+    RawCopier(const RawCopier&) = delete;
+    RawCopier& operator=(const RawCopier&) = delete;
+
+    void write_headers(const std::vector<char>& text_header, const std::vector<uint8_t>& bin_header) {
+        file_write_all(out_, text_header.data(), text_header.size(), path_);
+        file_write_all(out_, reinterpret_cast<const char*>(bin_header.data()), bin_header.size(), path_);
+    }
+
+    // Дописывает len байт файла in с позиции offset; false - отмена
+    bool copy(int in, int64_t offset, int64_t len) {
+        while (len > 0) {
+            if (cancel_ && cancel_->load()) return false;
+            int64_t chunk = std::min(len, CHUNK_BYTES);
+            int64_t end = offset + chunk;
+            while (offset < end) {
+                int64_t n = transfer(in, offset, end - offset);
+                offset += n;
+                bytes_ += n;
+            }
+            len -= chunk;
+            if (bytes_ - reported_ >= CHUNK_BYTES) {
+                reported_ = bytes_;
+                report_progress(progress_, "Copying traces", bytes_, total_);
+            }
+        }
+        return true;
+    }
+
+    // Записывает число трасс в бинарный заголовок и закрывает файл
+    void finish(std::vector<uint8_t> bin_header, int64_t traces) {
+        report_progress(progress_, "Copying traces", bytes_, total_);
+        // Поле 16-битное: при большем числе трасс записывается максимум
+        set_i16_be(bin_header.data(), BinFieldOffsets.at("DataTracesPerEnsemble").offset,
+                   static_cast<int16_t>(std::min<int64_t>(traces, 32767)));
+        if (!file_seek(out_, 3200)) {
+            throw std::runtime_error("Failed to update binary header of " + path_);
+        }
+        file_write_all(out_, reinterpret_cast<const char*>(bin_header.data()), bin_header.size(), path_);
+        int fd = out_;
+        out_ = -1;
+        if (file_close(fd) != 0) {
+            throw std::runtime_error("Failed to write " + path_ + ": " + std::strerror(errno));
+        }
+        committed_ = true;
+    }
+
+    RawCopyMethod method() const { return method_; }
+    int64_t bytes() const { return bytes_; }
+
+private:
+    // Копирует часть диапазона; при неподдерживаемом способе переходит к следующему
+    int64_t transfer(int in, int64_t offset, int64_t len) {
+        len = std::min(len, CALL_BYTES);
+#ifdef __linux__
+#ifdef SYS_copy_file_range
+        if (method_ == RawCopyMethod::CopyFileRange) {
+            loff_t in_offset = offset;
+            ssize_t n = ::syscall(SYS_copy_file_range, in, &in_offset, out_, nullptr, static_cast<size_t>(len), 0u);
+            if (n > 0) return n;
+            if (n == 0) throw_truncated(offset);
+            if (errno == EINTR) return 0;
+            if (!can_fall_back(errno)) throw_copy_error();
+            method_ = RawCopyMethod::SendFile;
+        }
+#endif
+        if (method_ == RawCopyMethod::SendFile) {
+            off_t in_offset = static_cast<off_t>(offset);
+            ssize_t n = ::sendfile(out_, in, &in_offset, static_cast<size_t>(len));
+            if (n > 0) return n;
+            if (n == 0) throw_truncated(offset);
+            if (errno == EINTR) return 0;
+            if (!can_fall_back(errno)) throw_copy_error();
+            method_ = RawCopyMethod::ReadWrite;
+        }
+#endif
+        if (buffer_.empty()) buffer_.resize(BUFFER_BYTES);
+        size_t want = static_cast<size_t>(std::min<int64_t>(len, static_cast<int64_t>(buffer_.size())));
+        int64_t n = file_pread(in, offset, buffer_.data(), want);
+        if (n < 0 && errno == EINTR) return 0;
+        if (n < 0) throw_copy_error();
+        if (n == 0) throw_truncated(offset);
+        file_write_all(out_, buffer_.data(), static_cast<size_t>(n), path_);
+        return n;
+    }
+
+    void throw_truncated(int64_t offset) const {
+        throw std::runtime_error("Unexpected end of source file at byte " + std::to_string(offset) + " while writing " + path_);
+    }
+
+    void throw_copy_error() const {
+        throw std::runtime_error("Failed to copy traces to " + path_ + ": " + std::strerror(errno));
+    }
+
+    std::string path_;
+    int out_ = -1;
+    bool committed_ = false;
+    RawCopyMethod method_ = RawCopyMethod::ReadWrite;
+    int64_t bytes_ = 0;
+    int64_t reported_ = 0;
+    int64_t total_;
+    std::vector<char> buffer_;
+    const ProgressCallback& progress_;
+    const std::atomic<bool>* cancel_;
+};
+
+int open_source(const std::string& path) {
+    int fd = file_open_read(path);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open SEG-Y file: " + path);
+    }
+    return fd;
+}
+
+void fill_stats(RawExportStats* stats, const RawCopier& copier, int64_t traces,
+                std::chrono::steady_clock::time_point start) {
+    if (!stats) return;
+    stats->traces = traces;
+    stats->bytes = copier.bytes();
+    stats->seconds = seconds_since(start);
+    stats->method = copier.method();
+}
+
+} // namespace
+
+const char* raw_copy_method_name(RawCopyMethod method) {
+    switch (method) {
+    case RawCopyMethod::CopyFileRange: return "copy_file_range";
+    case RawCopyMethod::SendFile: return "sendfile";
+    case RawCopyMethod::ReadWrite: return "read/write";
+    }
+    return "";
+}
+
+bool export_raw_traces(const SegyReader& reader, const std::vector<int>& traces, const std::string& path,
+                       RawExportStats* stats, const ProgressCallback& progress, const std::atomic<bool>* cancel,
+                       RawCopyMethod first_method) {
+    for (int index : traces) {
+        if (index < 0 || index >= reader.num_traces()) {
+            throw std::out_of_range("Trace index out of range: " + std::to_string(index));
+        }
+    }
+    auto start = std::chrono::steady_clock::now();
+    const int64_t bsize = reader.trace_bsize();
+
+    FileHandle in(open_source(reader.filename()));
+    RawCopier copier(path, static_cast<int64_t>(traces.size()) * bsize, first_method, progress, cancel);
+    copier.write_headers(reader.text_header(), reader.bin_header());
+
+    // Серии подряд идущих индексов копируются одним диапазоном
+    for (size_t i = 0; i < traces.size();) {
+        size_t j = i + 1;
+        while (j < traces.size() && traces[j] == traces[j - 1] + 1) ++j;
+        if (!copier.copy(in.fd, reader.trace_offset(traces[i]), static_cast<int64_t>(j - i) * bsize)) {
+            return false;
+        }
+        i = j;
+    }
+
+    copier.finish(reader.bin_header(), static_cast<int64_t>(traces.size()));
+    fill_stats(stats, copier, static_cast<int64_t>(traces.size()), start);
+    return true;
+}
+
+bool concat_segy_files(const std::vector<std::string>& inputs, const std::string& path,
+                       RawExportStats* stats, const ProgressCallback& progress, const std::atomic<bool>* cancel,
+                       RawCopyMethod first_method) {
+    if (inputs.empty()) {
+        throw std::invalid_argument("No input files to concatenate.");
+    }
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::unique_ptr<SegyReader>> readers;
+    int64_t total_traces = 0;
+    for (const std::string& input : inputs) {
+        readers.emplace_back(new SegyReader(input));
+        const SegyReader& first = *readers.front();
+        const SegyReader& reader = *readers.back();
+        if (reader.num_samples() != first.num_samples() || reader.sample_format() != first.sample_format() ||
+            reader.sample_interval() != first.sample_interval()) {
+            throw std::invalid_argument("Incompatible trace layout in " + input + ": samples, format and interval must match " + inputs.front());
+        }
+        total_traces += reader.num_traces();
+    }
+
+    const SegyReader& first = *readers.front();
+    RawCopier copier(path, total_traces * first.trace_bsize(), first_method, progress, cancel);
+    copier.write_headers(first.text_header(), first.bin_header());
+    for (const auto& reader : readers) {
+        // Копируются только целые трассы: недописанный хвост файла отбрасывается
+        FileHandle in(open_source(reader->filename()));
+        int64_t bytes = static_cast<int64_t>(reader->num_traces()) * reader->trace_bsize();
+        if (!copier.copy(in.fd, reader->data_offset(), bytes)) {
+            return false;
+        }
+    }
+
+    copier.finish(first.bin_header(), total_traces);
+    fill_stats(stats, copier, total_traces, start);
+    return true;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include "SegyUtil.hpp"
+
+class SegyReader;
+
+// Способ копирования байтов трасс, от самого быстрого к запасному
+enum class RawCopyMethod { CopyFileRange, SendFile, ReadWrite };
+
+const char* raw_copy_method_name(RawCopyMethod method);
+
+struct RawExportStats {
+    int64_t traces = 0;
+    int64_t bytes = 0;      // байты трасс (без заголовков файла)
+    double seconds = 0.0;
+    RawCopyMethod method = RawCopyMethod::CopyFileRange; // фактически использованный способ
+
+    double mb_per_second() const { return seconds > 0.0 ? bytes / 1048576.0 / seconds : 0.0; }
+};
+
+/**
+ * @brief Копирует трассы в новый SEG-Y без декодирования отсчетов.
+ *
+ * Записи трасс (заголовок + отсчеты) переносятся байт в байт: серии подряд идущих
+ * индексов копируются одним вызовом copy_file_range, при его недоступности (другая
+ * файловая система, старое ядро) - sendfile, иначе - чтением/записью через буфер.
+ * Текстовый и бинарный заголовки берутся из исходного файла, в бинарном заголовке
+ * обновляется число трасс (DataTracesPerEnsemble, как в SegyWriter).
+ * @param traces Индексы трасс в порядке записи; повторы допустимы.
+ * @param stats Необязательная статистика копирования.
+ * @param first_method Самый быстрый из допустимых способов копирования (ReadWrite - только через буфер).
+ * @return false, если копирование отменено флагом cancel (недописанный файл удаляется).
+ * @throws std::runtime_error при ошибке чтения/записи; недописанный файл удаляется.
+ */
+bool export_raw_traces(const SegyReader& reader, const std::vector<int>& traces, const std::string& path,
+                       RawExportStats* stats = nullptr,
+                       const ProgressCallback& progress = ProgressCallback(),
+                       const std::atomic<bool>* cancel = nullptr,
+                       RawCopyMethod first_method = RawCopyMethod::CopyFileRange);
+
+/**
+ * @brief Склеивает SEG-Y файлы с одинаковыми длиной трассы и форматом отсчетов.
+ * Заголовки файла берутся из первого входного файла; трассы копируются как в export_raw_traces.
+ * @throws std::invalid_argument при пустом списке или несовместимых файлах.
+ */
+bool concat_segy_files(const std::vector<std::string>& inputs, const std::string& path,
+                       RawExportStats* stats = nullptr,
+                       const ProgressCallback& progress = ProgressCallback(),
+                       const std::atomic<bool>* cancel = nullptr,
+                       RawCopyMethod first_method = RawCopyMethod::CopyFileRange);
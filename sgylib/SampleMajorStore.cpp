@@ -0,0 +1,272 @@
+#include "SampleMajorStore.hpp"
+#include "SegyReader.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char STORE_MAGIC[8] = { 'S', 'G', 'Y', 'S', 'M', 'A', 'J', '1' };
+const uint32_t BYTE_ORDER_MARK = 0x01020304u; // копия не переносится между платформами с разным порядком байт
+const size_t HEADER_SIZE = 32;
+const int TILE = 64;                           // плитка транспонирования 64x64 помещается в L1
+const size_t BLOCK_BYTES = 32u << 20;          // исходных данных на блок трасс
+
+struct StoreHeader {
+    char magic[8];
+    uint32_t encoding;
+    uint32_t byte_order;
+    int64_t num_traces;
+    int64_t num_samples;
+};
+static_assert(sizeof(StoreHeader) == HEADER_SIZE, "StoreHeader must be packed into 32 bytes");
+
+inline int16_t quantize(float value, float inv_scale) {
+    if (!std::isfinite(value)) return 0;
+    float q = std::round(value * inv_scale);
+    return static_cast<int16_t>(std::max(-32767.0f, std::min(32767.0f, q)));
+}
+
+} // namespace
+
+bool SampleMajorStore::build(const SegyReader& reader, const std::string& path, SampleEncoding encoding,
+                             const ProgressCallback& progress, const std::atomic<bool>* cancel) {
+    const int n_traces = reader.num_traces();
+    const int ns = reader.num_samples();
+    const size_t esize = encoding == SampleEncoding::Int16 ? sizeof(int16_t) : sizeof(float);
+    const size_t scales_bytes = encoding == SampleEncoding::Int16 ? static_cast<size_t>(n_traces) * sizeof(float) : 0;
+    const std::streamoff data_offset = static_cast<std::streamoff>(HEADER_SIZE + scales_bytes);
+    const int bsize = reader.trace_bsize();
+    const int block_traces = std::max(TILE, static_cast<int>(BLOCK_BYTES / bsize) / TILE * TILE);
+
+    const std::string tmp_path = path + ".tmp";
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("Cannot create sample-major store: " + tmp_path);
+    }
+    StoreHeader header;
+    std::memcpy(header.magic, STORE_MAGIC, sizeof(STORE_MAGIC));
+    header.encoding = static_cast<uint32_t>(encoding);
+    header.byte_order = BYTE_ORDER_MARK;
+    header.num_traces = n_traces;
+    header.num_samples = ns;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    // Файл резервируется целиком: строки каждого блока пишутся в разные его места
+    out.seekp(data_offset + static_cast<std::streamoff>(ns) * n_traces * esize - 1);
+    out.put(0);
+
+    std::vector<char> raw(static_cast<size_t>(block_traces) * bsize);
+    std::vector<float> decoded(static_cast<size_t>(block_traces) * ns);
+    std::vector<char> transposed(static_cast<size_t>(block_traces) * ns * esize);
+    std::vector<float> scales(encoding == SampleEncoding::Int16 ? n_traces : 0);
+
+    for (int first = 0; first < n_traces; first += block_traces) {
+        if (cancel && cancel->load()) {
+            out.close();
+            std::remove(tmp_path.c_str());
+            return false;
+        }
+        const int count = std::min(block_traces, n_traces - first);
+        reader.read_raw_block(first, static_cast<size_t>(count) * bsize, raw.data());
+
+        // Декодирование отсчетов в float и масштабы трасс
+        #pragma omp parallel for schedule(static)
+        for (int t = 0; t < count; ++t) {
+            const uint8_t* src = reinterpret_cast<const uint8_t*>(raw.data()) + static_cast<size_t>(t) * bsize;
+            float* dst = decoded.data() + static_cast<size_t>(t) * ns;
+            reader.decode_trace_samples(src, dst);
+            float max_abs = 0.0f;
+            for (int i = 0; i < ns; ++i) {
+                if (std::isfinite(dst[i])) max_abs = std::max(max_abs, std::fabs(dst[i]));
+            }
+            if (!scales.empty()) scales[first + t] = max_abs > 0.0f ? max_abs / 32767.0f : 1.0f;
+        }
+
+        // Транспонирование плитками: чтение и запись плитки остаются в кэше
+        const int trace_tiles = (count + TILE - 1) / TILE;
+        const int sample_tiles = (ns + TILE - 1) / TILE;
+        #pragma omp parallel for schedule(static)
+        for (int tile = 0; tile < trace_tiles * sample_tiles; ++tile) {
+            const int t0 = (tile / sample_tiles) * TILE;
+            const int s0 = (tile % sample_tiles) * TILE;
+            const int t1 = std::min(count, t0 + TILE);
+            const int s1 = std::min(ns, s0 + TILE);
+            if (encoding == SampleEncoding::Int16) {
+                int16_t* dst = reinterpret_cast<int16_t*>(transposed.data());
+                for (int s = s0; s < s1; ++s) {
+                    for (int t = t0; t < t1; ++t) {
+                        dst[static_cast<size_t>(s) * count + t] =
+                            quantize(decoded[static_cast<size_t>(t) * ns + s], 1.0f / scales[first + t]);
+                    }
+                }
+            } else {
+                float* dst = reinterpret_cast<float*>(transposed.data());
+                for (int s = s0; s < s1; ++s) {
+                    for (int t = t0; t < t1; ++t) {
+                        dst[static_cast<size_t>(s) * count + t] = decoded[static_cast<size_t>(t) * ns + s];
+                    }
+                }
+            }
+        }
+
+        for (int s = 0; s < ns; ++s) {
+            out.seekp(data_offset + (static_cast<std::streamoff>(s) * n_traces + first) * static_cast<std::streamoff>(esize));
+            out.write(transposed.data() + static_cast<size_t>(s) * count * esize, static_cast<std::streamsize>(count * esize));
+        }
+        if (!out) {
+            out.close();
+            std::remove(tmp_path.c_str());
+            throw std::runtime_error("Failed to write sample-major store: " + tmp_path);
+        }
+        report_progress(progress, "Transposing samples", first + count, n_traces);
+    }
+
+    if (!scales.empty()) {
+        out.seekp(static_cast<std::streamoff>(HEADER_SIZE));
+        out.write(reinterpret_cast<const char*>(scales.data()), static_cast<std::streamsize>(scales_bytes));
+    }
+    out.close();
+    if (!out) {
+        std::remove(tmp_path.c_str());
+        throw std::runtime_error("Failed to write sample-major store: " + tmp_path);
+    }
+    std::remove(path.c_str());
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::remove(tmp_path.c_str());
+        throw std::runtime_error("Cannot write sample-major store: " + path);
+    }
+    return true;
+}
+
+SampleMajorStore::SampleMajorStore(const std::string& path) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Cannot open sample-major store: " + path);
+    }
+    LARGE_INTEGER size;
+    GetFileSizeEx(file, &size);
+    map_size_ = static_cast<size_t>(size.QuadPart);
+    HANDLE mapping = map_size_ ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+    map_ = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    file_handle_ = file;
+    mapping_handle_ = mapping;
+    if (!map_) {
+        unmap();
+        throw std::runtime_error("Cannot map sample-major store: " + path);
+    }
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open sample-major store: " + path);
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        throw std::runtime_error("Cannot open sample-major store: " + path);
+    }
+    map_size_ = static_cast<size_t>(st.st_size);
+    map_ = ::mmap(nullptr, map_size_, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd); // отображение остается действительным после закрытия дескриптора
+    if (map_ == MAP_FAILED) {
+        map_ = nullptr;
+        throw std::runtime_error("Cannot map sample-major store: " + path);
+    }
+#endif
+
+    StoreHeader header;
+    if (map_size_ < sizeof(header)) {
+        unmap();
+        throw std::runtime_error("Corrupted sample-major store: " + path);
+    }
+    std::memcpy(&header, map_, sizeof(header));
+    size_t esize = header.encoding == static_cast<uint32_t>(SampleEncoding::Int16) ? sizeof(int16_t) : sizeof(float);
+    size_t scales_bytes = esize == sizeof(int16_t) ? static_cast<size_t>(header.num_traces) * sizeof(float) : 0;
+    bool valid = std::memcmp(header.magic, STORE_MAGIC, sizeof(STORE_MAGIC)) == 0 &&
+                 header.byte_order == BYTE_ORDER_MARK && header.encoding <= 1 &&
+                 header.num_traces > 0 && header.num_traces <= std::numeric_limits<int>::max() &&
+                 header.num_samples > 0 && header.num_samples <= std::numeric_limits<int>::max() &&
+                 map_size_ == HEADER_SIZE + scales_bytes + static_cast<size_t>(header.num_traces * header.num_samples) * esize;
+    if (!valid) {
+        unmap();
+        throw std::runtime_error("Corrupted sample-major store: " + path);
+    }
+
+    num_traces_ = static_cast<int>(header.num_traces);
+    num_samples_ = static_cast<int>(header.num_samples);
+    encoding_ = static_cast<SampleEncoding>(header.encoding);
+    element_size_ = esize;
+    const char* base = static_cast<const char*>(map_);
+    scales_ = scales_bytes ? reinterpret_cast<const float*>(base + HEADER_SIZE) : nullptr;
+    data_ = base + HEADER_SIZE + scales_bytes;
+}
+
+SampleMajorStore::~SampleMajorStore() {
+    unmap();
+}
+
+void SampleMajorStore::unmap() {
+#ifdef _WIN32
+    if (map_) UnmapViewOfFile(map_);
+    if (mapping_handle_) CloseHandle(static_cast<HANDLE>(mapping_handle_));
+    if (file_handle_) CloseHandle(static_cast<HANDLE>(file_handle_));
+    mapping_handle_ = file_handle_ = nullptr;
+#else
+    if (map_) ::munmap(map_, map_size_);
+#endif
+    map_ = nullptr;
+}
+
+const char* SampleMajorStore::row_data(int sample) const {
+    if (sample < 0 || sample >= num_samples_) {
+        throw std::out_of_range("Sample index out of range: " + std::to_string(sample));
+    }
+    return data_ + static_cast<size_t>(sample) * num_traces_ * element_size_;
+}
+
+float SampleMajorStore::value(const char* row, int trace) const {
+    if (encoding_ == SampleEncoding::Int16) {
+        int16_t q;
+        std::memcpy(&q, row + static_cast<size_t>(trace) * sizeof(int16_t), sizeof(q));
+        return q * scales_[trace];
+    }
+    float v;
+    std::memcpy(&v, row + static_cast<size_t>(trace) * sizeof(float), sizeof(v));
+    return v;
+}
+
+void SampleMajorStore::read_row(int sample, int first_trace, int count, float* out) const {
+    if (first_trace < 0 || count < 0 || count > num_traces_ - first_trace) {
+        throw std::out_of_range("Trace range out of range: " + std::to_string(first_trace) + "+" + std::to_string(count));
+    }
+    const char* row = row_data(sample);
+    if (encoding_ == SampleEncoding::Float32) {
+        std::memcpy(out, row + static_cast<size_t>(first_trace) * sizeof(float), static_cast<size_t>(count) * sizeof(float));
+        return;
+    }
+    for (int t = 0; t < count; ++t) out[t] = value(row, first_trace + t);
+}
+
+void SampleMajorStore::gather_row(int sample, const std::vector<int>& traces, float* out) const {
+    const char* row = row_data(sample);
+    for (size_t i = 0; i < traces.size(); ++i) {
+        int trace = traces[i];
+        if (trace >= num_traces_) {
+            throw std::out_of_range("Trace index out of range: " + std::to_string(trace));
+        }
+        out[i] = trace < 0 ? std::numeric_limits<float>::quiet_NaN() : value(row, trace);
+    }
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include "SegyUtil.hpp"
+
+class SegyReader;
+
+// Представление отсчетов в транспонированной копии
+enum class SampleEncoding : uint32_t {
+    Float32 = 0, // float32 little-endian
+    Int16 = 1    // int16 с масштабом на трассу: значение = q * scale[trace]
+};
+
+/**
+ * @class SampleMajorStore
+ * @brief Транспонированная копия данных SEG-Y: отсчеты хранятся строками по времени.
+ *
+ * Строка отсчета s содержит значения всех трасс подряд, поэтому временной срез
+ * и неглубокое окно по времени читают только показываемые байты, а не трассы целиком.
+ * Файл отображается в память (mmap), чтение не требует блокировок.
+ *
+ * Формат: заголовок 32 байта (магия SGYSMAJ1, кодировка, число трасс и отсчетов),
+ * для Int16 - масштабы трасс (float32), затем num_samples строк по num_traces значений.
+ */
+class SampleMajorStore {
+public:
+    /**
+     * @brief Строит копию по файлу SEG-Y: блоки трасс читаются одним чтением,
+     * декодируются и транспонируются параллельно плитками 64x64 (по кэшу), после чего
+     * каждая строка блока дописывается на свое место. Файл пишется во временный
+     * и переименовывается только после успешного завершения.
+     * @param cancel Флаг отмены (проверяется между блоками), может быть nullptr.
+     * @return false, если построение отменено.
+     * @throws std::runtime_error при ошибке чтения или записи.
+     */
+    static bool build(const SegyReader& reader, const std::string& path, SampleEncoding encoding,
+                      const ProgressCallback& progress = ProgressCallback(),
+                      const std::atomic<bool>* cancel = nullptr);
+
+    /**
+     * @brief Открывает построенную копию и отображает ее в память.
+     * @throws std::runtime_error, если файл отсутствует или поврежден.
+     */
+    explicit SampleMajorStore(const std::string& path);
+    ~SampleMajorStore();
+
+    SampleMajorStore(const SampleMajorStore&) = delete;
+    SampleMajorStore& operator=(const SampleMajorStore&) = delete;
+
+    int num_traces() const { return num_traces_; }
+    int num_samples() const { return num_samples_; }
+    SampleEncoding encoding() const { return encoding_; }
+
+    // Отсчет sample трасс [first_trace, first_trace + count)
+    void read_row(int sample, int first_trace, int count, float* out) const;
+
+    // Отсчет sample выбранных трасс; для отрицательных индексов - NaN
+    void gather_row(int sample, const std::vector<int>& traces, float* out) const;
+
+private:
+    float value(const char* row, int trace) const;
+    const char* row_data(int sample) const;
+    void unmap();
+
+    int num_traces_ = 0;
+    int num_samples_ = 0;
+    SampleEncoding encoding_ = SampleEncoding::Float32;
+    size_t element_size_ = 4;
+    const float* scales_ = nullptr;
+    const char* data_ = nullptr;
+
+    // Отображение файла в память
+    void* map_ = nullptr;
+    size_t map_size_ = 0;
+#ifdef _WIN32
+    void* file_handle_ = nullptr;
+    void* mapping_handle_ = nullptr;
+#endif
+};
@@ -0,0 +1,241 @@
+#include "SegyCache.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+namespace {
+
+const char* FINGERPRINT_FILE = "fingerprint";
+const char* MANIFEST_FILE = "manifest";
+const char* STATS_FILE = "amplitude_stats.bin";
+// Версия 2: границы гистограммы хранятся отдельно от min/max
+const char STATS_MAGIC[8] = { 'S', 'G', 'Y', 'S', 'T', 'A', 'T', '2' };
+
+const size_t SAMPLE_BLOCK = 4096;
+const int SAMPLE_BLOCKS = 16;
+const size_t HEAD_BYTES = 3200 + 400 + 240; // текстовый, бинарный заголовки и первая трасса
+
+// FNV-1a 64
+uint64_t fnv1a(uint64_t hash, const char* data, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<uint8_t>(data[i]);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+template <typename T>
+void write_pod(std::ostream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool read_pod(std::istream& in, T& value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+// Запись во временный файл с последующим переименованием, чтобы не оставить полузаписанный кэш
+void replace_file(const std::string& tmp_path, const std::string& path) {
+    std::remove(path.c_str());
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::remove(tmp_path.c_str());
+        throw std::runtime_error("Cannot write cache file: " + path);
+    }
+}
+
+} // namespace
+
+// --- SegyFingerprint ---
+
+std::string SegyFingerprint::to_string() const {
+    std::ostringstream ss;
+    ss << file_size << ' ' << mtime << ' ' << std::hex << content_hash;
+    return ss.str();
+}
+
+bool SegyFingerprint::parse(const std::string& text, SegyFingerprint& out) {
+    std::istringstream ss(text);
+    SegyFingerprint fp;
+    if (!(ss >> fp.file_size >> fp.mtime >> std::hex >> fp.content_hash)) return false;
+    out = fp;
+    return true;
+}
+
+SegyFingerprint compute_fingerprint(const std::string& segy_path) {
+    struct stat st;
+    if (stat(segy_path.c_str(), &st) != 0) {
+        throw std::runtime_error("Cannot stat file: " + segy_path);
+    }
+    std::ifstream file(segy_path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Cannot open file: " + segy_path);
+    }
+
+    SegyFingerprint fp;
+    fp.file_size = static_cast<uint64_t>(st.st_size);
+    fp.mtime = static_cast<int64_t>(st.st_mtime);
+
+    // Смещения выборочных блоков: начало, равномерная сетка и хвост
+    std::vector<std::pair<uint64_t, size_t>> blocks;
+    blocks.push_back(std::make_pair(uint64_t(0), HEAD_BYTES));
+    if (fp.file_size > HEAD_BYTES + SAMPLE_BLOCK) {
+        uint64_t span = fp.file_size - SAMPLE_BLOCK;
+        for (int i = 1; i <= SAMPLE_BLOCKS; ++i) {
+            blocks.push_back(std::make_pair(span * i / SAMPLE_BLOCKS, SAMPLE_BLOCK));
+        }
+    }
+
+    uint64_t hash = 0xcbf29ce484222325ull;
+    std::vector<char> buf(std::max(HEAD_BYTES, SAMPLE_BLOCK));
+    for (const auto& block : blocks) {
+        file.clear();
+        file.seekg(static_cast<std::streamoff>(block.first), std::ios::beg);
+        file.read(buf.data(), static_cast<std::streamsize>(block.second));
+        hash = fnv1a(hash, buf.data(), static_cast<size_t>(file.gcount()));
+    }
+    fp.content_hash = hash;
+    return fp;
+}
+
+// --- SegyCache ---
+
+SegyCache::SegyCache(const std::string& cache_dir, const std::string& segy_path)
+    : dir_(cache_dir), fingerprint_(compute_fingerprint(segy_path))
+{
+    std::ifstream in(path(FINGERPRINT_FILE));
+    std::string line;
+    SegyFingerprint stored;
+    was_valid_ = in && std::getline(in, line) && SegyFingerprint::parse(line, stored) && stored == fingerprint_;
+    in.close();
+    if (!was_valid_) {
+        invalidate();
+    }
+}
+
+void SegyCache::invalidate() {
+    std::vector<std::string> entries = read_manifest();
+    for (const auto& name : entries) {
+        std::remove(path(name).c_str());
+        // Служебные файлы SQLite в режиме WAL
+        std::remove(path(name + "-wal").c_str());
+        std::remove(path(name + "-shm").c_str());
+    }
+    std::remove(path(STATS_FILE).c_str());
+    std::remove(path(MANIFEST_FILE).c_str());
+    write_text_file(FINGERPRINT_FILE, fingerprint_.to_string() + "\n");
+}
+
+std::vector<std::string> SegyCache::read_manifest() const {
+    std::vector<std::string> entries;
+    std::ifstream in(path(MANIFEST_FILE));
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty()) entries.push_back(line);
+    }
+    return entries;
+}
+
+void SegyCache::register_entry(const std::string& name) {
+    std::vector<std::string> entries = read_manifest();
+    if (std::find(entries.begin(), entries.end(), name) != entries.end()) return;
+    std::ofstream out(path(MANIFEST_FILE), std::ios::app);
+    out << name << "\n";
+    if (!out) {
+        throw std::runtime_error("Cannot update cache manifest in " + dir_);
+    }
+}
+
+void SegyCache::write_text_file(const std::string& name, const std::string& content) const {
+    std::string tmp = path(name + ".tmp");
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        out << content;
+        if (!out) {
+            throw std::runtime_error("Cannot write cache file: " + tmp);
+        }
+    }
+    replace_file(tmp, path(name));
+}
+
+std::string SegyCache::trace_map_path(const std::vector<std::string>& keys) {
+    std::string name = "trace_map";
+    for (const auto& key : keys) name += "_" + key;
+    name += ".db";
+    register_entry(name);
+    return path(name);
+}
+
+std::string SegyCache::ordering_path(const std::vector<std::string>& keys) {
+    std::string name = "ordering";
+    for (const auto& key : keys) name += "_" + key;
+    name += ".bin";
+    register_entry(name);
+    return path(name);
+}
+
+std::string SegyCache::sample_major_path() {
+    register_entry("sample_major.bin");
+    return path("sample_major.bin");
+}
+
+std::string SegyCache::brick_store_path() {
+    register_entry("bricks.bin");
+    return path("bricks.bin");
+}
+
+bool SegyCache::load_stats(AmplitudeStats& stats) const {
+    std::ifstream in(path(STATS_FILE), std::ios::binary);
+    if (!in) return false;
+
+    char magic[sizeof(STATS_MAGIC)];
+    uint64_t stored_hash = 0;
+    uint32_t n_bins = 0, n_percentiles = 0;
+    AmplitudeStats s;
+    if (!in.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), STATS_MAGIC)) return false;
+    if (!read_pod(in, stored_hash) || stored_hash != fingerprint_.content_hash) return false;
+    if (!read_pod(in, s.min_amplitude) || !read_pod(in, s.max_amplitude) || !read_pod(in, s.mean) ||
+        !read_pod(in, s.rms) || !read_pod(in, s.sample_count) || !read_pod(in, s.traces_analyzed) ||
+        !read_pod(in, s.hist_min) || !read_pod(in, s.hist_max) || !read_pod(in, n_bins) || !read_pod(in, n_percentiles)) {
+        return false;
+    }
+    if (n_bins > (1u << 20) || n_percentiles != AmplitudeStats::PERCENTILE_STEPS) return false;
+    s.histogram.resize(n_bins);
+    s.percentiles.resize(n_percentiles);
+    if (!in.read(reinterpret_cast<char*>(s.histogram.data()), n_bins * sizeof(uint64_t)) ||
+        !in.read(reinterpret_cast<char*>(s.percentiles.data()), n_percentiles * sizeof(float))) {
+        return false;
+    }
+    stats = s;
+    return true;
+}
+
+void SegyCache::save_stats(const AmplitudeStats& stats) {
+    std::string tmp = path(std::string(STATS_FILE) + ".tmp");
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        out.write(STATS_MAGIC, sizeof(STATS_MAGIC));
+        write_pod(out, fingerprint_.content_hash);
+        write_pod(out, stats.min_amplitude);
+        write_pod(out, stats.max_amplitude);
+        write_pod(out, stats.mean);
+        write_pod(out, stats.rms);
+        write_pod(out, stats.sample_count);
+        write_pod(out, stats.traces_analyzed);
+        write_pod(out, stats.hist_min);
+        write_pod(out, stats.hist_max);
+        write_pod(out, static_cast<uint32_t>(stats.histogram.size()));
+        write_pod(out, static_cast<uint32_t>(stats.percentiles.size()));
+        out.write(reinterpret_cast<const char*>(stats.histogram.data()), stats.histogram.size() * sizeof(uint64_t));
+        out.write(reinterpret_cast<const char*>(stats.percentiles.data()), stats.percentiles.size() * sizeof(float));
+        if (!out) {
+            out.close();
+            std::remove(tmp.c_str());
+            throw std::runtime_error("Cannot write cache file: " + tmp);
+        }
+    }
+    replace_file(tmp, path(STATS_FILE));
+}
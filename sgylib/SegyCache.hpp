@@ -0,0 +1,82 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "AmplitudeStats.hpp"
+
+/**
+ * @brief Быстрый отпечаток SEG-Y файла: размер, время модификации и хэш выборочных блоков.
+ *
+ * Хэшируются заголовки файла и первой трассы, 16 равномерно расположенных блоков
+ * по 4 КБ и хвост файла - несколько десятков КБ чтения независимо от размера файла.
+ */
+struct SegyFingerprint {
+    uint64_t file_size = 0;
+    int64_t mtime = 0;
+    uint64_t content_hash = 0;
+
+    std::string to_string() const;
+    static bool parse(const std::string& text, SegyFingerprint& out);
+
+    bool operator==(const SegyFingerprint& other) const {
+        return file_size == other.file_size && mtime == other.mtime && content_hash == other.content_hash;
+    }
+    bool operator!=(const SegyFingerprint& other) const { return !(*this == other); }
+};
+
+/**
+ * @brief Вычисляет отпечаток файла.
+ * @throws std::runtime_error, если файл недоступен.
+ */
+SegyFingerprint compute_fingerprint(const std::string& segy_path);
+
+/**
+ * @class SegyCache
+ * @brief Каталог кэша одного SEG-Y файла: статистика амплитуд и индексы заголовков (TraceMap).
+ *
+ * Каталог создается вызывающей стороной (например, в QStandardPaths::CacheLocation).
+ * При открытии отпечаток файла сравнивается с сохраненным; если файл изменился,
+ * все ранее записанные артефакты удаляются и кэш начинается заново.
+ */
+class SegyCache {
+public:
+    SegyCache(const std::string& cache_dir, const std::string& segy_path);
+
+    // true, если отпечаток совпал и артефакты прошлого открытия можно использовать
+    bool was_valid() const { return was_valid_; }
+    const SegyFingerprint& fingerprint() const { return fingerprint_; }
+    const std::string& directory() const { return dir_; }
+
+    // Загружает статистику; false, если ее нет или файл поврежден
+    bool load_stats(AmplitudeStats& stats) const;
+    void save_stats(const AmplitudeStats& stats);
+
+    /**
+     * @brief Путь к базе TraceMap для заданного набора ключей.
+     * Файл регистрируется в кэше и удаляется при смене отпечатка.
+     */
+    std::string trace_map_path(const std::vector<std::string>& keys);
+
+    // Путь к сохраненной перестановке TraceOrdering для набора ключей
+    std::string ordering_path(const std::vector<std::string>& keys);
+
+    // Путь к транспонированной копии данных (SampleMajorStore)
+    std::string sample_major_path();
+
+    // Путь к блочному хранилищу 3D-куба (BrickStore)
+    std::string brick_store_path();
+
+    // Удаляет все артефакты и записывает текущий отпечаток
+    void invalidate();
+
+private:
+    std::string path(const std::string& name) const { return dir_ + "/" + name; }
+    void register_entry(const std::string& name);
+    std::vector<std::string> read_manifest() const;
+    void write_text_file(const std::string& name, const std::string& content) const;
+
+    std::string dir_;
+    SegyFingerprint fingerprint_;
+    bool was_valid_ = false;
+};
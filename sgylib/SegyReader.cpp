@@ -1,7 +1,18 @@
 #include "SegyReader.hpp"
 #include "SegyUtil.hpp"
 #include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <cstring>
+#include <limits>
+
+namespace {
+
+int64_t nanoseconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
 
 SegyReader::SegyReader(const std::string& filename) : filename_(filename) {
     // Проверяем, что файл существует
@@ -46,14 +57,29 @@ SegyReader::SegyReader(const std::string& filename) : filename_(filename) {
         throw;
     }
 
+    // Формат отсчетов; 0 встречается в старых файлах и означает IBM float
+    sample_format_ = get_bin_header_value_i16("DataSampleFormat");
+    if (sample_format_ == 0) sample_format_ = SEGY_FORMAT_IBM32;
+    bytes_per_sample_ = sample_format_bytes(sample_format_);
+    if (bytes_per_sample_ == 0) {
+        throw std::runtime_error("Unsupported data sample format: " + std::to_string(sample_format_));
+    }
+
     // Вычисляем размер одной трассы и общее количество трасс
-    trace_bsize_ = TRACE_HEADER_SIZE + num_samples_ * 4; // 4 байта на сэмпл (IBM float)
+    trace_bsize_ = TRACE_HEADER_SIZE + num_samples_ * bytes_per_sample_;
     
     num_traces_ = (file_size - data_offset()) / trace_bsize_;
 
     if (num_traces_ <= 0) {
         throw std::runtime_error("Invalid number of traces: " + std::to_string(num_traces_));
     }
+
+    // Буфер отключается до открытия, иначе каждое чтение окна подтягивает целый блок
+    window_file_.rdbuf()->pubsetbuf(nullptr, 0);
+    window_file_.open(filename, std::ios::binary | std::ios::in);
+    if (!window_file_.is_open()) {
+        throw std::runtime_error("Cannot open SEG-Y file: " + filename);
+    }
 }
 
 SegyReader::~SegyReader() {
@@ -62,28 +88,72 @@ SegyReader::~SegyReader() {
     }
 }
 
+int SegyReader::refresh() {
+    std::streamoff file_size;
+    {
+        std::lock_guard<std::mutex> lock(io_mutex_);
+        // После чтения до конца файла поток в состоянии eof - сбрасываем его
+        file_.clear();
+        file_.seekg(0, std::ios::end);
+        file_size = file_.tellg();
+    }
+    if (file_size < 0) {
+        throw std::runtime_error("Cannot determine size of SEG-Y file: " + filename_);
+    }
+    int complete_traces = static_cast<int>((file_size - data_offset()) / trace_bsize_);
+    if (complete_traces <= num_traces_) {
+        return 0;
+    }
+    int added = complete_traces - num_traces_;
+    num_traces_ = complete_traces;
+    return added;
+}
+
 std::vector<float> SegyReader::get_trace(int index) const {
     if (index < 0 || index >= num_traces_) {
         throw std::out_of_range("Trace index out of range: " + std::to_string(index));
     }
 
     std::vector<float> trace_data(num_samples_);
-    std::streamoff offset = trace_data_offset(index);
-    
-    // Читаем данные трассы
-    std::vector<uint8_t> buf(num_samples_ * 4);
-    file_.seekg(offset, std::ios::beg);
-    file_.read(reinterpret_cast<char*>(buf.data()), buf.size());
 
-    // Конвертируем IBM float в IEEE float
-    for (int i = 0; i < num_samples_; ++i) {
-        uint32_t ibm = read_u32_be(&buf[i * 4]);
-        trace_data[i] = ibm_to_float(ibm);
+    // Читаем трассу целиком: для целочисленных форматов множитель берется из заголовка
+    std::vector<uint8_t> buf(trace_bsize_);
+    auto start = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lock(io_mutex_);
+        file_.seekg(trace_offset(index), std::ios::beg);
+        file_.read(reinterpret_cast<char*>(buf.data()), buf.size());
     }
-    
+    count_read(trace_bsize_, nanoseconds_since(start));
+
+    start = std::chrono::steady_clock::now();
+    decode_trace_samples(buf.data(), trace_data.data());
+    count_decode(1, nanoseconds_since(start));
     return trace_data;
 }
 
+std::vector<std::vector<float>> SegyReader::get_traces(int first_trace, int count) const {
+    if (count <= 0) return {};
+    if (first_trace < 0 || count > num_traces_ - first_trace) {
+        throw std::out_of_range("Trace range out of range: " + std::to_string(first_trace) + "+" + std::to_string(count));
+    }
+
+    // Один вызов чтения на весь диапазон вместо seek/read на каждую трассу
+    std::vector<char> block(static_cast<size_t>(count) * trace_bsize_);
+    auto start = std::chrono::steady_clock::now();
+    read_raw_block(first_trace, block.size(), block.data());
+    count_read(static_cast<int64_t>(block.size()), nanoseconds_since(start));
+
+    std::vector<std::vector<float>> traces(count, std::vector<float>(num_samples_));
+    start = std::chrono::steady_clock::now();
+    for (int t = 0; t < count; ++t) {
+        decode_trace_samples(reinterpret_cast<const uint8_t*>(block.data()) + static_cast<size_t>(t) * trace_bsize_,
+                             traces[t].data());
+    }
+    count_decode(count, nanoseconds_since(start));
+    return traces;
+}
+
 std::vector<uint8_t> SegyReader::get_trace_header(int index) const {
     if (index < 0 || index >= num_traces_) {
         throw std::out_of_range("Trace index out of range: " + std::to_string(index));
@@ -92,12 +162,147 @@ std::vector<uint8_t> SegyReader::get_trace_header(int index) const {
     std::vector<uint8_t> header(TRACE_HEADER_SIZE);
     std::streamoff offset = trace_offset(index);
     
+    std::lock_guard<std::mutex> lock(io_mutex_);
     file_.seekg(offset, std::ios::beg);
     file_.read(reinterpret_cast<char*>(header.data()), TRACE_HEADER_SIZE);
     
     return header;
 }
 
+void SegyReader::read_raw_block(int first_trace, size_t bytes, char* dst) const {
+    if (first_trace < 0 || first_trace >= num_traces_) {
+        throw std::out_of_range("Trace index out of range: " + std::to_string(first_trace));
+    }
+    size_t available = static_cast<size_t>(num_traces_ - first_trace) * trace_bsize_;
+    if (bytes > available) {
+        throw std::out_of_range("Raw block exceeds the last trace: " + std::to_string(bytes) + " bytes");
+    }
+
+    std::lock_guard<std::mutex> lock(io_mutex_);
+    file_.clear();
+    file_.seekg(trace_offset(first_trace), std::ios::beg);
+    file_.read(dst, static_cast<std::streamsize>(bytes));
+    if (static_cast<size_t>(file_.gcount()) != bytes) {
+        file_.clear();
+        throw std::runtime_error("Failed to read raw block at trace " + std::to_string(first_trace));
+    }
+}
+
+void SegyReader::read_sample_window(const std::vector<int>& traces, int first_sample, int n_samples, float* out) const {
+    if (first_sample < 0 || n_samples <= 0 || n_samples > num_samples_ - first_sample) {
+        throw std::out_of_range("Sample window out of range: " + std::to_string(first_sample) + "+" + std::to_string(n_samples));
+    }
+    for (int index : traces) {
+        if (index >= num_traces_) {
+            throw std::out_of_range("Trace index out of range: " + std::to_string(index));
+        }
+    }
+
+    const size_t window_bytes = static_cast<size_t>(n_samples) * bytes_per_sample_;
+    const bool weighted = sample_format_is_integer(sample_format_);
+    std::vector<uint8_t> buf(window_bytes);
+    std::vector<uint8_t> header(TRACE_HEADER_SIZE);
+    int64_t read_ns = 0;
+    int64_t decode_ns = 0;
+    int64_t bytes = 0;
+    int64_t decoded = 0;
+    std::lock_guard<std::mutex> lock(io_mutex_);
+    for (size_t t = 0; t < traces.size(); ++t) {
+        float* dst = out + t * n_samples;
+        if (traces[t] < 0) {
+            std::fill(dst, dst + n_samples, std::numeric_limits<float>::quiet_NaN());
+            continue;
+        }
+        // Множитель целочисленных отсчетов - в заголовке трассы: отдельное короткое чтение
+        float scale = 1.0f;
+        auto start = std::chrono::steady_clock::now();
+        if (weighted) {
+            window_file_.clear();
+            window_file_.seekg(trace_offset(traces[t]), std::ios::beg);
+            window_file_.read(reinterpret_cast<char*>(header.data()), TRACE_HEADER_SIZE);
+            if (window_file_.gcount() != TRACE_HEADER_SIZE) {
+                throw std::runtime_error("Failed to read header of trace " + std::to_string(traces[t]));
+            }
+            scale = trace_scale(header.data());
+            bytes += TRACE_HEADER_SIZE;
+        }
+        window_file_.clear();
+        window_file_.seekg(trace_data_offset(traces[t]) + static_cast<std::streamoff>(first_sample) * bytes_per_sample_, std::ios::beg);
+        window_file_.read(reinterpret_cast<char*>(buf.data()), static_cast<std::streamsize>(window_bytes));
+        if (static_cast<size_t>(window_file_.gcount()) != window_bytes) {
+            throw std::runtime_error("Failed to read samples of trace " + std::to_string(traces[t]));
+        }
+        bytes += static_cast<int64_t>(window_bytes);
+        auto decode_start = std::chrono::steady_clock::now();
+        read_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(decode_start - start).count();
+        decode_samples(buf.data(), n_samples, dst, scale);
+        decode_ns += nanoseconds_since(decode_start);
+        decoded++;
+    }
+    count_read(bytes, read_ns);
+    count_decode(decoded, decode_ns);
+}
+
+SegyReaderStats SegyReader::stats() const {
+    SegyReaderStats stats;
+    stats.traces_decoded = traces_decoded_.load();
+    stats.bytes_read = bytes_read_.load();
+    stats.read_seconds = read_ns_.load() * 1e-9;
+    stats.decode_seconds = decode_ns_.load() * 1e-9;
+    return stats;
+}
+
+void SegyReader::reset_stats() {
+    traces_decoded_ = 0;
+    bytes_read_ = 0;
+    read_ns_ = 0;
+    decode_ns_ = 0;
+}
+
+void SegyReader::count_read(int64_t bytes, int64_t nanoseconds) const {
+    bytes_read_ += bytes;
+    read_ns_ += nanoseconds;
+}
+
+void SegyReader::count_decode(int64_t traces, int64_t nanoseconds) const {
+    traces_decoded_ += traces;
+    decode_ns_ += nanoseconds;
+}
+
+float SegyReader::trace_scale(const uint8_t* trace_header) const {
+    if (!sample_format_is_integer(sample_format_)) return 1.0f;
+    // Значение отсчета = число * 2^-N
+    int weighting = read_i16_be(trace_header + 168);
+    return weighting == 0 ? 1.0f : std::ldexp(1.0f, -weighting);
+}
+
+void SegyReader::decode_trace_samples(const uint8_t* trace_record, float* dst) const {
+    decode_samples(trace_record + TRACE_HEADER_SIZE, num_samples_, dst, trace_scale(trace_record));
+}
+
+void SegyReader::decode_samples(const uint8_t* src, int n, float* dst, float scale) const {
+    switch (sample_format_) {
+    case SEGY_FORMAT_IBM32:
+        for (int i = 0; i < n; ++i) dst[i] = ibm_to_float(read_u32_be(src + i * 4));
+        break;
+    case SEGY_FORMAT_IEEE32:
+        for (int i = 0; i < n; ++i) {
+            uint32_t u = read_u32_be(src + i * 4);
+            std::memcpy(dst + i, &u, sizeof(u));
+        }
+        break;
+    case SEGY_FORMAT_INT32:
+        for (int i = 0; i < n; ++i) dst[i] = static_cast<float>(read_i32_be(src + i * 4)) * scale;
+        break;
+    case SEGY_FORMAT_INT16:
+        for (int i = 0; i < n; ++i) dst[i] = static_cast<float>(read_i16_be(src + i * 2)) * scale;
+        break;
+    case SEGY_FORMAT_INT8:
+        for (int i = 0; i < n; ++i) dst[i] = static_cast<float>(static_cast<int8_t>(src[i])) * scale;
+        break;
+    }
+}
+
 int32_t SegyReader::get_header_value_i32(int trace_index, const std::string& key) const {
     auto header = get_trace_header(trace_index);
     return get_header_value_i32(header, key);
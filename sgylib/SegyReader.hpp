@@ -5,6 +5,18 @@
 #include <cstdint>
 #include <fstream>
 #include <stdexcept>
+#include <mutex>
+#include <atomic>
+#include "SegyUtil.hpp"
+
+// Счетчики чтения трасс с отсчетами (времена в секундах): get_trace, get_traces,
+// read_sample_window. Заголовки и сырые блоки без декодирования не учитываются.
+struct SegyReaderStats {
+    int64_t traces_decoded = 0;
+    int64_t bytes_read = 0;
+    double read_seconds = 0.0;   // seek/read под блокировкой файла
+    double decode_seconds = 0.0; // перевод отсчетов в float
+};
 
 class SegyReader {
 public:
@@ -23,10 +35,58 @@ public:
     std::vector<float> get_trace(int index) const;
     std::vector<uint8_t> get_trace_header(int index) const;
 
+    // Читает count подряд идущих трасс одним блоком
+    std::vector<std::vector<float>> get_traces(int first_trace, int count) const;
+
+    /**
+     * @brief Читает сырые байты подряд идущих трасс (заголовки + данные) одним вызовом.
+     * @param first_trace Индекс первой трассы блока.
+     * @param bytes Размер блока в байтах (не должен выходить за последнюю трассу).
+     * @param dst Буфер назначения размером не менее bytes.
+     */
+    void read_raw_block(int first_trace, size_t bytes, char* dst) const;
+
+    /**
+     * @brief Читает окно отсчетов [first_sample, first_sample + n_samples) выбранных трасс.
+     * С диска читаются только байты окна каждой трассы (небуферизованным потоком),
+     * поэтому временной срез стоит одного короткого чтения на трассу, а не всего файла.
+     * @param traces Индексы трасс; для отрицательных индексов окно заполняется NaN.
+     * @param out Буфер размером traces.size() * n_samples, окна трасс идут подряд.
+     */
+    void read_sample_window(const std::vector<int>& traces, int first_sample, int n_samples, float* out) const;
+
+    /**
+     * @brief Перечитывает размер файла, который продолжает дописываться (режим слежения).
+     * Учитываются только полностью записанные трассы; число трасс не уменьшается.
+     * Вызывается из потока-владельца, пока другие потоки не читают файл.
+     * @return Количество новых трасс.
+     */
+    int refresh();
+
+    /**
+     * @brief Декодирует отсчеты одной трассы из сырой записи (заголовок + отсчеты) в float.
+     * Поддерживаются форматы 1 (IBM), 2 (int32), 3 (int16), 5 (IEEE) и 8 (int8);
+     * целочисленные значения умножаются на 2^-N, где N - TraceWeightingFactor (байты 169-170).
+     */
+    void decode_trace_samples(const uint8_t* trace_record, float* dst) const;
+
+    // Декодирует n отсчетов формата файла начиная с src, умножая на scale
+    void decode_samples(const uint8_t* src, int n, float* dst, float scale = 1.0f) const;
+
+    // Множитель целочисленных отсчетов трассы по ее заголовку (1 для форматов с плавающей точкой)
+    float trace_scale(const uint8_t* trace_header) const;
+
     // --- ГЕТТЕРЫ И ВСПОМОГАТЕЛЬНЫЕ МЕТОДЫ ---
+    const std::string& filename() const { return filename_; }
     int num_traces() const { return num_traces_; }
     int num_samples() const { return num_samples_; }
     float sample_interval() const { return sample_interval_; }
+    int trace_bsize() const { return trace_bsize_; }
+    int sample_format() const { return sample_format_; }
+    int bytes_per_sample() const { return bytes_per_sample_; }
+    // Смещения в файле: начало трасс и запись трассы index (заголовок + отсчеты)
+    std::streamoff data_offset() const { return TEXT_HEADER_SIZE + BINARY_HEADER_SIZE; }
+    std::streamoff trace_offset(int index) const { return data_offset() + static_cast<std::streamoff>(index) * trace_bsize_; }
 
     int32_t get_header_value_i32(int trace_index, const std::string& key) const;
     int32_t get_header_value_i32(const std::vector<uint8_t>& trace_header, const std::string& key) const;
@@ -38,6 +98,10 @@ public:
     const std::vector<char>& text_header() const { return text_header_; }
     const std::vector<uint8_t>& bin_header() const { return bin_header_; }
 
+    // Накопленные счетчики чтения; потокобезопасны
+    SegyReaderStats stats() const;
+    void reset_stats();
+
 private:
     // Константы SEG-Y формата
     static const int TEXT_HEADER_SIZE = 3200;
@@ -51,16 +115,26 @@ private:
     int16_t read_i16_be(const uint8_t* data) const;
     
     // Вычисление смещений в файле
-    std::streamoff data_offset() const { return TEXT_HEADER_SIZE + BINARY_HEADER_SIZE; }
-    std::streamoff trace_offset(int index) const { return data_offset() + static_cast<std::streamoff>(index) * trace_bsize_; }
     std::streamoff trace_data_offset(int index) const { return trace_offset(index) + TRACE_HEADER_SIZE; }
 
+    void count_read(int64_t bytes, int64_t nanoseconds) const;
+    void count_decode(int64_t traces, int64_t nanoseconds) const;
+
     std::string filename_;
     mutable std::fstream file_;
+    mutable std::ifstream window_file_; // без буфера: читает ровно запрошенные байты
+    mutable std::mutex io_mutex_; // seekg/read должны выполняться атомарно при доступе из нескольких потоков
     std::vector<char> text_header_;
     std::vector<uint8_t> bin_header_;
     int num_traces_ = 0;
+    int sample_format_ = SEGY_FORMAT_IBM32;
+    int bytes_per_sample_ = 4;
     int num_samples_ = 0;
     float sample_interval_ = 0.0f;
     int trace_bsize_ = 0;
+
+    mutable std::atomic<int64_t> traces_decoded_{0};
+    mutable std::atomic<int64_t> bytes_read_{0};
+    mutable std::atomic<int64_t> read_ns_{0};
+    mutable std::atomic<int64_t> decode_ns_{0};
 };
@@ -1,5 +0,0 @@
-#include "SegyUtil.hpp"
-
-void print_progress_bar(const std::string& message, int current, int total) {
-    // Отладочный вывод убран
-} 
\ No newline at end of file
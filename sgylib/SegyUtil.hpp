@@ -1,7 +1,10 @@
 #pragma once
 #include <cstdint>
+#include <chrono>
 #include <cmath>
 #include <cstring>
+#include <functional>
+#include <string>
 
 struct FieldInfo {
     int offset; // 1-based offset
@@ -23,7 +26,7 @@ inline int32_t get_i32_be(const uint8_t* buf, int offset1based) {
 
 #define IEEEMAX 0x7FFFFFFF
 #define IEMAXIB 0x611FFFFF
-#define IEMINIB 0x21200000
+#define IEMINIB 0x21400000 // 2^-126: меньшие значения (денормализованные во float) обнуляются
 
 inline float ibm_to_float(uint32_t ibm) {
     static const int it[8] = { 0x21800000, 0x21400000, 0x21000000, 0x21000000,
@@ -47,16 +50,66 @@ inline float ibm_to_float(uint32_t ibm) {
     return result;
 }
 
+/**
+ * @brief IEEE float -> IBM float без циклов нормализации.
+ *
+ * Показатель IBM (по основанию 16) и сдвиг мантиссы (0..3 бита) вычисляются из
+ * двоичного показателя; отбрасываемые биты округляются к ближайшему (при равенстве -
+ * к четному). Округление не переполняет мантиссу: при ненулевом сдвиге ее старший
+ * бит ниже 23-го. Все конечные float, включая денормализованные, представимы точно
+ * или с ошибкой не более половины младшего разряда IBM; ibm_to_float -> ieee_to_ibm
+ * возвращает исходное нормализованное IBM-значение. +-Inf и NaN кодируются
+ * максимальным по модулю значением (ibm_to_float декодирует его в NaN), -0 - нулем.
+ */
 inline uint32_t ieee_to_ibm(float val) {
-    if (val == 0.0f) return 0;
-    uint32_t sign = (val < 0) ? 0x80000000 : 0;
-    if (val < 0) val = -val;
-    int exponent = 64;
-    while (val < 1.0f) { val *= 16.0f; --exponent; }
-    while (val >= 1.0f) { val /= 16.0f; ++exponent; }
-    uint32_t fraction = static_cast<uint32_t>(val * 0x01000000) & 0x00FFFFFF;
-    return sign | (exponent << 24) | fraction;
-} 
+    uint32_t u;
+    std::memcpy(&u, &val, sizeof(u));
+    uint32_t sign = u & 0x80000000u;
+    int e = static_cast<int>((u >> 23) & 0xFF);
+    uint32_t m = u & 0x007FFFFFu;
+    if (e == 255) return sign | 0x7FFFFFFFu;
+    if (e == 0) {
+        if (m == 0) return 0;
+        // Денормализованное число: нормализуем мантиссу, показатель уходит ниже 1
+        while (!(m & 0x00800000u)) { m <<= 1; --e; }
+        ++e;
+        m &= 0x007FFFFFu;
+    }
+    m |= 0x00800000u;
+    // Значение M * 2^(e-150); IBM: F * 16^(E-64-6). Смещение 129 = 256 - 127 держит e + 129 > 0
+    int ibm_exp = ((e + 129) >> 2) + 1;
+    int shift = 4 * ibm_exp - e - 130; // 0..3
+    uint32_t bias = shift ? (((1u << shift) - 1) >> 1) + ((m >> shift) & 1u) : 0u;
+    uint32_t fraction = (m + bias) >> shift;
+    return sign | (static_cast<uint32_t>(ibm_exp) << 24) | fraction;
+}
+
+// Коды форматов отсчетов (DataSampleFormat, байты 3225-3226)
+const int SEGY_FORMAT_IBM32 = 1;
+const int SEGY_FORMAT_INT32 = 2;
+const int SEGY_FORMAT_INT16 = 3;
+const int SEGY_FORMAT_IEEE32 = 5;
+const int SEGY_FORMAT_INT8 = 8;
+
+// Размер отсчета формата в байтах; 0 - формат не поддерживается
+inline int sample_format_bytes(int format) {
+    switch (format) {
+    case SEGY_FORMAT_IBM32:
+    case SEGY_FORMAT_INT32:
+    case SEGY_FORMAT_IEEE32:
+        return 4;
+    case SEGY_FORMAT_INT16:
+        return 2;
+    case SEGY_FORMAT_INT8:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+inline bool sample_format_is_integer(int format) {
+    return format == SEGY_FORMAT_INT32 || format == SEGY_FORMAT_INT16 || format == SEGY_FORMAT_INT8;
+}
 
 inline void set_i16_be(uint8_t* buf, int offset1based, int16_t value) {
     int offset = offset1based - 1;
@@ -86,5 +139,14 @@ inline void put_u32_be(uint8_t* buf, uint32_t value) {
     buf[3] = static_cast<uint8_t>(value & 0xFF);
 }
 
-// Функция для отображения прогресса (отладочный вывод убран)
-void print_progress_bar(const std::string& message, int current, int total);
\ No newline at end of file
+// Обратный вызов прогресса длительных операций: этап, выполнено, всего
+typedef std::function<void(const std::string& stage, int64_t current, int64_t total)> ProgressCallback;
+
+inline void report_progress(const ProgressCallback& progress, const std::string& stage, int64_t current, int64_t total) {
+    if (progress) progress(stage, current, total);
+}
+
+// Секунды, прошедшие с момента start (для статистики и замеров)
+inline double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
\ No newline at end of file
@@ -1,32 +1,99 @@
 #include "SegyWriter.hpp"
 #include "SegyUtil.hpp"
 #include "BinFieldMap.hpp" // Для доступа к смещениям в бинарном заголовке
+#include "TraceFieldMap.hpp"
+#include "IbmConvert.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
 #include <stdexcept>
 #include <vector>
 
+namespace {
+
+// IEEE float big-endian: только перестановка байтов
+void encode_ieee(const std::vector<float>& samples, uint8_t* dst) {
+    for (size_t i = 0; i < samples.size(); ++i) {
+        uint32_t bits;
+        std::memcpy(&bits, &samples[i], sizeof(bits));
+        put_u32_be(dst + i * 4, bits);
+    }
+}
+
+// int16 с масштабом трассы: x = v * 2^-N. N выбирается так, чтобы максимум модуля
+// занимал старший разряд int16. Возвращает N для TraceWeightingFactor.
+int16_t encode_int16(const std::vector<float>& samples, uint8_t* dst) {
+    float max_abs = 0.0f;
+    for (float v : samples) {
+        if (std::isfinite(v)) max_abs = std::max(max_abs, std::fabs(v));
+    }
+    int weighting = 0;
+    if (max_abs > 0.0f) {
+        int exponent;
+        std::frexp(max_abs, &exponent); // max_abs = m * 2^exponent, m в [0.5, 1)
+        weighting = std::min(120, std::max(-120, 15 - exponent));
+    }
+    for (size_t i = 0; i < samples.size(); ++i) {
+        float v = samples[i];
+        long q = std::isfinite(v) ? std::lround(std::ldexp(v, weighting)) : 0;
+        q = std::min(32767L, std::max(-32767L, q));
+        uint16_t u = static_cast<uint16_t>(static_cast<int16_t>(q));
+        dst[i * 2] = static_cast<uint8_t>(u >> 8);
+        dst[i * 2 + 1] = static_cast<uint8_t>(u);
+    }
+    return static_cast<int16_t>(weighting);
+}
+
+} // namespace
+
 // --- Приватный метод для инициализации ---
 void SegyWriter::init() {
     this->num_traces_ = 0;
-    this->trace_bsize_ = 240 + this->num_samples_ * 4;
-    
+    if (options_.sample_format != SEGY_FORMAT_IBM32 && options_.sample_format != SEGY_FORMAT_IEEE32 &&
+        options_.sample_format != SEGY_FORMAT_INT16) {
+        throw std::invalid_argument("Unsupported output sample format: " + std::to_string(options_.sample_format));
+    }
+    this->trace_bsize_ = 240 + this->num_samples_ * sample_format_bytes(options_.sample_format);
+    if (options_.async && options_.buffers < 2) {
+        throw std::invalid_argument("Asynchronous SegyWriter needs at least two buffers.");
+    }
+
+    // Заголовок может быть взят из файла другого формата
+    set_i16_be(bin_header_.data(), BinFieldOffsets.at("DataSampleFormat").offset,
+               static_cast<int16_t>(options_.sample_format));
+
     file_.open(filename_, std::ios::binary | std::ios::out | std::ios::trunc);
     if (!file_) {
         throw std::runtime_error("Failed to open file for writing: " + filename_);
     }
-    
+
     // Записываем начальные заголовки
     file_.write(text_header_.data(), text_header_.size());
     file_.write(reinterpret_cast<const char*>(bin_header_.data()), bin_header_.size());
+
+    // Буферы выделяются сразу: во время записи память не перераспределяется
+    const size_t capacity = std::max(options_.buffer_bytes, static_cast<size_t>(trace_bsize_));
+    buffers_.resize(std::max(1, options_.buffers));
+    for (size_t i = 0; i < buffers_.size(); ++i) {
+        buffers_[i].data.reserve(capacity);
+        if (options_.sparse) buffers_[i].zero_samples.reserve(capacity / trace_bsize_);
+        free_buffers_.push_back(static_cast<int>(i));
+    }
+    if (options_.async) {
+        io_thread_ = std::thread(&SegyWriter::io_loop, this);
+    }
 }
 
 // --- Конструкторы ---
 
-SegyWriter::SegyWriter(const std::string& filename, const SegyReader& reader)
+SegyWriter::SegyWriter(const std::string& filename, const SegyReader& reader, const SegyWriterOptions& options)
     : filename_(filename),
       text_header_(reader.text_header()),
       bin_header_(reader.bin_header()),
       num_samples_(reader.num_samples()),
-      sample_interval_(reader.sample_interval())
+      sample_interval_(reader.sample_interval()),
+      options_(options)
 {
     init();
 }
@@ -35,12 +102,14 @@ SegyWriter::SegyWriter(const std::string& filename,
                        const std::vector<char>& text_header,
                        const std::vector<uint8_t>& bin_header,
                        int num_samples,
-                       float sample_interval)
+                       float sample_interval,
+                       const SegyWriterOptions& options)
     : filename_(filename),
       text_header_(text_header),
       bin_header_(bin_header),
       num_samples_(num_samples),
-      sample_interval_(sample_interval)
+      sample_interval_(sample_interval),
+      options_(options)
 {
     if (text_header.size() != 3200) throw std::invalid_argument("Text header must be 3200 bytes.");
     if (bin_header.size() != 400) throw std::invalid_argument("Binary header must be 400 bytes.");
@@ -50,7 +119,12 @@ SegyWriter::SegyWriter(const std::string& filename,
 // --- Деструктор и финализация ---
 
 SegyWriter::~SegyWriter() {
-    finalize_file();
+    try {
+        close();
+    } catch (...) {
+        // Деструктор не бросает исключений: ошибку можно получить только из close()
+    }
+    stop_io_thread();
 }
 
 void SegyWriter::finalize_file() {
@@ -58,20 +132,205 @@ void SegyWriter::finalize_file() {
         return;
     }
 
+    // Дыра в конце файла: размер задается последним записанным байтом
+    if (hole_bytes_ > 0) {
+        file_.seekp(hole_bytes_ - 1, std::ios::cur);
+        file_.put('\0');
+        hole_bytes_ = 0;
+    }
+
     // Обновляем количество трасс в бинарном заголовке.
     // Стандарт SEG-Y Rev 1 (поле "Number of data traces per ensemble")
     auto it = BinFieldOffsets.find("DataTracesPerEnsemble");
     if (it != BinFieldOffsets.end()) {
         set_i16_be(bin_header_.data(), it->second.offset, static_cast<int16_t>(num_traces_));
-        
+
         // Перезаписываем обновленный бинарный заголовок в файле
         file_.seekp(3200, std::ios::beg);
         file_.write(reinterpret_cast<const char*>(bin_header_.data()), bin_header_.size());
     }
-    
+
     file_.close();
 }
 
+void SegyWriter::flush() {
+    if (closed_) {
+        throw_if_failed();
+        return;
+    }
+    drain();
+}
+
+void SegyWriter::drain() {
+    submit_current();
+    if (options_.async) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        buffer_free_.wait(lock, [this] { return full_buffers_.empty() && !writing_; });
+    }
+    file_.flush();
+    if (!file_) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (error_.empty()) error_ = "Failed to flush " + filename_;
+    }
+    throw_if_failed();
+}
+
+void SegyWriter::close() {
+    if (closed_) {
+        throw_if_failed();
+        return;
+    }
+    closed_ = true;
+    try {
+        drain();
+    } catch (...) {
+        stop_io_thread();
+        file_.close();
+        throw;
+    }
+    stop_io_thread();
+    finalize_file();
+    if (file_.fail()) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (error_.empty()) error_ = "Failed to update binary header of " + filename_;
+    }
+    throw_if_failed();
+}
+
+SegyWriterStats SegyWriter::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+// --- Буферы и фоновая запись ---
+
+char* SegyWriter::reserve_trace() {
+    if (current_ >= 0) {
+        std::vector<char>& data = buffers_[current_].data;
+        if (data.size() + trace_bsize_ > data.capacity() && !data.empty()) {
+            submit_current();
+        }
+    }
+    if (current_ < 0) {
+        auto start = std::chrono::steady_clock::now();
+        std::unique_lock<std::mutex> lock(mutex_);
+        buffer_free_.wait(lock, [this] { return !free_buffers_.empty(); });
+        current_ = free_buffers_.front();
+        free_buffers_.pop_front();
+        stats_.wait_seconds += seconds_since(start);
+    }
+    Buffer& buffer = buffers_[current_];
+    size_t offset = buffer.data.size();
+    buffer.data.resize(offset + trace_bsize_);
+    buffer.traces++;
+    return buffer.data.data() + offset;
+}
+
+void SegyWriter::submit_current() {
+    if (current_ < 0) return;
+    int index = current_;
+    current_ = -1;
+    if (!options_.async) {
+        write_buffer(buffers_[index]);
+        std::lock_guard<std::mutex> lock(mutex_);
+        free_buffers_.push_back(index);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        full_buffers_.push_back(index);
+    }
+    buffer_full_.notify_one();
+}
+
+void SegyWriter::write_buffer(Buffer& buffer) {
+    auto start = std::chrono::steady_clock::now();
+    bool ok;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ok = error_.empty();
+    }
+    // После первой ошибки данные не пишутся: файл все равно поврежден
+    if (ok) {
+        if (options_.sparse) {
+            write_sparse(buffer);
+        } else {
+            file_.write(buffer.data.data(), buffer.data.size());
+        }
+        ok = static_cast<bool>(file_);
+    }
+    double elapsed = seconds_since(start);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (ok) {
+        stats_.traces_written += buffer.traces;
+        stats_.bytes_written += buffer.data.size();
+    } else if (error_.empty()) {
+        error_ = "Failed to write traces to " + filename_;
+    }
+    stats_.write_seconds += elapsed;
+    buffer.data.clear();
+    buffer.traces = 0;
+    buffer.zero_samples.clear();
+}
+
+void SegyWriter::write_sparse(const Buffer& buffer) {
+    // Подряд идущие записанные байты (включая заголовки нулевых трасс) пишутся одним вызовом
+    const size_t sample_bytes = static_cast<size_t>(trace_bsize_) - 240;
+    size_t span = 0;
+    for (int t = 0; t < buffer.traces; ++t) {
+        if (!buffer.zero_samples[t]) continue;
+        size_t record = static_cast<size_t>(t) * trace_bsize_;
+        write_span(buffer.data.data() + span, record + 240 - span);
+        hole_bytes_ += sample_bytes;
+        span = record + trace_bsize_;
+    }
+    write_span(buffer.data.data() + span, buffer.data.size() - span);
+}
+
+void SegyWriter::write_span(const char* data, size_t size) {
+    if (size == 0) return;
+    if (hole_bytes_ > 0) {
+        file_.seekp(hole_bytes_, std::ios::cur);
+        hole_bytes_ = 0;
+    }
+    file_.write(data, size);
+}
+
+void SegyWriter::io_loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        buffer_full_.wait(lock, [this] { return stop_ || !full_buffers_.empty(); });
+        if (full_buffers_.empty()) return; // stop_ и очередь пуста
+        int index = full_buffers_.front();
+        full_buffers_.pop_front();
+        writing_ = true;
+        lock.unlock();
+        write_buffer(buffers_[index]);
+        lock.lock();
+        writing_ = false;
+        free_buffers_.push_back(index);
+        buffer_free_.notify_all();
+    }
+}
+
+void SegyWriter::stop_io_thread() {
+    if (!io_thread_.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    buffer_full_.notify_one();
+    io_thread_.join();
+}
+
+void SegyWriter::throw_if_failed() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!error_.empty()) {
+        throw std::runtime_error(error_);
+    }
+}
+
 // --- Методы для записи ---
 
 void SegyWriter::write_trace(const std::vector<uint8_t>& header, const std::vector<float>& samples) {
@@ -81,18 +340,38 @@ void SegyWriter::write_trace(const std::vector<uint8_t>& header, const std::vect
     if (samples.size() != static_cast<size_t>(num_samples_)) {
         throw std::invalid_argument("Trace samples size mismatch.");
     }
+    if (closed_) {
+        throw std::logic_error("SegyWriter::write_trace after close");
+    }
+    throw_if_failed();
 
-    // Записываем заголовок
-    file_.write(reinterpret_cast<const char*>(header.data()), 240);
-    
-    // Конвертируем и записываем отсчеты, используя утилиты
-    std::vector<uint8_t> sample_bytes(samples.size() * 4);
-    for (size_t i = 0; i < samples.size(); ++i) {
-        uint32_t ibm = ieee_to_ibm(samples[i]);
-        // ИСПОЛЬЗУЕМ НОВУЮ УТИЛИТУ
-        put_u32_be(&sample_bytes[i * 4], ibm);
+    // Заголовок и отсчеты кодируются сразу в буфер записи
+    char* dst = reserve_trace();
+    auto start = std::chrono::steady_clock::now();
+    std::memcpy(dst, header.data(), 240);
+    uint8_t* record = reinterpret_cast<uint8_t*>(dst);
+    switch (options_.sample_format) {
+    case SEGY_FORMAT_IEEE32:
+        encode_ieee(samples, record + 240);
+        break;
+    case SEGY_FORMAT_INT16:
+        // Масштаб пишется в копию заголовка в буфере, исходный заголовок не меняется
+        set_i16_be(record, TraceFieldOffsets.at("TraceWeightingFactor").offset, encode_int16(samples, record + 240));
+        break;
+    default:
+        ieee_to_ibm_be(samples.data(), samples.size(), record + 240);
+        break;
+    }
+    if (options_.sparse) {
+        const uint8_t* encoded = record + 240;
+        const uint8_t* end = record + trace_bsize_;
+        buffers_[current_].zero_samples.push_back(std::find_if(encoded, end, [](uint8_t b) { return b != 0; }) == end);
+    }
+    double elapsed = seconds_since(start);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.encode_seconds += elapsed;
     }
-    file_.write(reinterpret_cast<const char*>(sample_bytes.data()), sample_bytes.size());
 
     num_traces_++;
 }
@@ -105,36 +384,16 @@ void SegyWriter::write_gather(const std::vector<std::vector<uint8_t>>& headers,
     if (headers.empty()) {
         return; // Нечего записывать
     }
-
-    // ОПТИМИЗАЦИЯ: Создаем один большой буфер для всего сейсмосбора.
-    std::vector<uint8_t> gather_buffer;
-    gather_buffer.reserve(headers.size() * trace_bsize_);
-
+    // Сбор проверяется целиком до записи, чтобы в файл не попала его часть
     for (size_t i = 0; i < headers.size(); ++i) {
-        const auto& header = headers[i];
-        const auto& trace_samples = traces[i];
-        
-        if (header.size() != 240 || trace_samples.size() != static_cast<size_t>(num_samples_)) {
+        if (headers[i].size() != 240 || traces[i].size() != static_cast<size_t>(num_samples_)) {
             throw std::invalid_argument("Invalid header or samples size in gather at index " + std::to_string(i));
         }
-
-        // Добавляем заголовок в буфер
-        gather_buffer.insert(gather_buffer.end(), header.begin(), header.end());
-        
-        // Конвертируем и добавляем отсчеты в буфер
-        size_t current_size = gather_buffer.size();
-        gather_buffer.resize(current_size + trace_samples.size() * 4);
-        for (size_t j = 0; j < trace_samples.size(); ++j) {
-            uint32_t ibm = ieee_to_ibm(trace_samples[j]);
-            // ИСПОЛЬЗУЕМ НОВУЮ УТИЛИТУ
-            put_u32_be(&gather_buffer[current_size + j * 4], ibm);
-        }
     }
 
-    // Записываем весь буфер за один системный вызов
-    file_.write(reinterpret_cast<const char*>(gather_buffer.data()), gather_buffer.size());
-    
-    num_traces_ += headers.size();
+    for (size_t i = 0; i < headers.size(); ++i) {
+        write_trace(headers[i], traces[i]);
+    }
 }
 
 // УДАЛЕНО: write_gather_block и write_trace_internal.
@@ -143,4 +402,4 @@ void SegyWriter::write_gather(const std::vector<std::vector<uint8_t>>& headers,
 void SegyWriter::write_gather_block(const std::vector<std::vector<uint8_t>>& headers, const std::vector<std::vector<float>>& traces) {
     // Этот метод теперь является просто псевдонимом для write_gather.
     write_gather(headers, traces);
-}
\ No newline at end of file
+}
@@ -4,20 +4,66 @@
 #include <vector>
 #include <cstdint>
 #include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
 #include "SegyReader.hpp"
+#include "SegyUtil.hpp"
+
+/**
+ * @brief Режим записи SegyWriter.
+ *
+ * Трассы кодируются в буферы фиксированного размера из заранее выделенного пула.
+ * В асинхронном режиме заполненный буфер передается фоновому потоку, который пишет
+ * его в файл, пока вызывающий поток заполняет следующий; если свободных буферов
+ * нет, производитель ждет (очередь ограничена числом буферов).
+ * В синхронном режиме буфер пишется на вызывающем потоке.
+ *
+ * sample_format - формат отсчетов в файле (DataSampleFormat бинарного заголовка
+ * выставляется по нему): SEGY_FORMAT_IBM32, SEGY_FORMAT_IEEE32 (отсчеты пишутся без
+ * преобразования) или SEGY_FORMAT_INT16 (вдвое меньший файл; каждая трасса масштабируется
+ * к полному диапазону int16, показатель пишется в TraceWeightingFactor ее заголовка).
+ *
+ * sparse - отсчеты трасс, закодированные одними нулевыми байтами, не пишутся: запись
+ * пропускает их смещением позиции, и файловая система оставляет на их месте дыру
+ * (разреженный файл). Содержимое файла то же, но место экономится только целыми блоками
+ * файловой системы: заметно - лишь для трасс много длиннее блока (4 КБ).
+ */
+struct SegyWriterOptions {
+    bool async = false;
+    size_t buffer_bytes = 8 << 20;
+    int buffers = 3; // не меньше 2 в асинхронном режиме
+    int sample_format = SEGY_FORMAT_IBM32;
+    bool sparse = false;
+};
+
+// Счетчики записи (времена в секундах)
+struct SegyWriterStats {
+    int64_t traces_written = 0; // трасс, дошедших до файла
+    int64_t bytes_written = 0;
+    double encode_seconds = 0.0; // кодирование отсчетов на вызывающем потоке
+    double write_seconds = 0.0;  // вызовы write
+    double wait_seconds = 0.0;   // ожидание производителем свободного буфера
+
+    double write_mb_per_second() const { return write_seconds > 0.0 ? bytes_written / 1048576.0 / write_seconds : 0.0; }
+};
 
 class SegyWriter {
 public:
     // Конструктор, создающий Writer на основе существующего Reader.
-    explicit SegyWriter(const std::string& filename, const SegyReader& reader);
-    
+    explicit SegyWriter(const std::string& filename, const SegyReader& reader,
+                        const SegyWriterOptions& options = SegyWriterOptions());
+
     // Конструктор, создающий Writer с явно заданными параметрами.
     SegyWriter(const std::string& filename,
                const std::vector<char>& text_header,
                const std::vector<uint8_t>& bin_header,
                int num_samples,
-               float sample_interval);
-    
+               float sample_interval,
+               const SegyWriterOptions& options = SegyWriterOptions());
+
+    // Закрывает файл; ошибки записи здесь теряются - для их получения нужен close().
     ~SegyWriter();
 
     // Запрещаем копирование, т.к. класс управляет файлом.
@@ -29,13 +75,28 @@ public:
 
     // Записывает целый сейсмосбор (несколько заголовков и трасс).
     void write_gather(const std::vector<std::vector<uint8_t>>& headers, const std::vector<std::vector<float>>& traces);
-    
+
     // Псевдоним для обратной совместимости, если нужен.
     void write_gather_block(const std::vector<std::vector<uint8_t>>& headers, const std::vector<std::vector<float>>& traces);
 
-    // Текущее количество записанных трасс.
+    /**
+     * @brief Дожидается записи всех переданных трасс в файл.
+     * @throws std::runtime_error, если запись (в том числе фоновая) завершилась ошибкой.
+     */
+    void flush();
+
+    /**
+     * @brief Дописывает трассы, обновляет бинарный заголовок и закрывает файл.
+     * Повторный вызов ничего не делает.
+     * @throws std::runtime_error при ошибке записи.
+     */
+    void close();
+
+    // Текущее количество записанных трасс (переданных writer-у).
     int num_traces() const { return num_traces_; }
 
+    SegyWriterStats stats() const;
+
 private:
     std::string filename_;
     std::ofstream file_;
@@ -46,15 +107,48 @@ private:
     float sample_interval_ = 0.0f;
     int trace_bsize_ = 0;
 
+    // Пул буферов и очередь заполненных буферов для фонового потока
+    struct Buffer {
+        std::vector<char> data;
+        int traces = 0;
+        std::vector<char> zero_samples; // флаги трасс из нулевых отсчетов (режим sparse)
+    };
+    SegyWriterOptions options_;
+    std::vector<Buffer> buffers_;
+    std::deque<int> free_buffers_;
+    std::deque<int> full_buffers_;
+    int current_ = -1;        // заполняемый буфер
+    bool writing_ = false;    // фоновый поток пишет буфер
+    bool stop_ = false;
+    bool closed_ = false;     // флаг вместо file_.is_open(): файл в это время может писать фоновый поток
+    std::string error_;       // первая ошибка записи
+    std::thread io_thread_;
+    mutable std::mutex mutex_;
+    std::condition_variable buffer_free_;
+    std::condition_variable buffer_full_;
+    SegyWriterStats stats_;
+    int64_t hole_bytes_ = 0;  // пропущенные нулевые байты перед следующей записью (режим sparse)
+
     // --- ИСПРАВЛЕНИЕ: ДОБАВЛЕНЫ ОБЪЯВЛЕНИЯ ПРИВАТНЫХ МЕТОДОВ ---
-    
+
     /**
      * @brief Инициализирует и открывает файл, записывает начальные заголовки.
      */
     void init();
-    
+
     /**
      * @brief Обновляет бинарный заголовок и корректно закрывает файл.
      */
     void finalize_file();
-};
\ No newline at end of file
+
+    // Место под трассу в текущем буфере; при нехватке места буфер отправляется на запись
+    char* reserve_trace();
+    void submit_current();
+    void drain(); // отправляет текущий буфер и ждет записи всех буферов
+    void write_buffer(Buffer& buffer);
+    void write_sparse(const Buffer& buffer);
+    void write_span(const char* data, size_t size);
+    void io_loop();
+    void stop_io_thread();
+    void throw_if_failed();
+};
@@ -0,0 +1,211 @@
+#include "SurveyGeometry.hpp"
+#include "HeaderExtractor.hpp"
+#include "SegyReader.hpp"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+int64_t gcd64(int64_t a, int64_t b) {
+    if (a < 0) a = -a;
+    if (b < 0) b = -b;
+    while (b) {
+        int64_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+// Диапазон и шаг одной колонки: шаг - НОД отклонений от минимума
+void column_range(const std::vector<int32_t>& column, int32_t& min_value, int32_t& max_value, int64_t& step) {
+    const long long n = static_cast<long long>(column.size());
+    int32_t lo = std::numeric_limits<int32_t>::max();
+    int32_t hi = std::numeric_limits<int32_t>::min();
+    #pragma omp parallel
+    {
+        int32_t local_lo = std::numeric_limits<int32_t>::max();
+        int32_t local_hi = std::numeric_limits<int32_t>::min();
+        #pragma omp for schedule(static) nowait
+        for (long long i = 0; i < n; ++i) {
+            local_lo = std::min(local_lo, column[i]);
+            local_hi = std::max(local_hi, column[i]);
+        }
+        #pragma omp critical
+        {
+            lo = std::min(lo, local_lo);
+            hi = std::max(hi, local_hi);
+        }
+    }
+
+    int64_t g = 0;
+    #pragma omp parallel
+    {
+        int64_t local_g = 0;
+        #pragma omp for schedule(static) nowait
+        for (long long i = 0; i < n; ++i) {
+            // Как только НОД стал 1, дальше он не изменится
+            if (local_g != 1) local_g = gcd64(local_g, static_cast<int64_t>(column[i]) - lo);
+        }
+        #pragma omp critical
+        g = gcd64(g, local_g);
+    }
+    min_value = lo;
+    max_value = hi;
+    step = g == 0 ? 1 : g;
+}
+
+} // namespace
+
+SurveyGeometry SurveyGeometry::from_columns(const std::vector<int32_t>& inlines, const std::vector<int32_t>& crosslines) {
+    SurveyGeometry geometry;
+    if (inlines.size() != crosslines.size()) {
+        throw std::invalid_argument("Inline and crossline columns differ in length.");
+    }
+    geometry.n_traces_ = static_cast<int>(inlines.size());
+    if (inlines.empty()) {
+        geometry.reason_ = "no traces";
+        return geometry;
+    }
+
+    int32_t il_lo, il_hi, xl_lo, xl_hi;
+    int64_t il_step, xl_step;
+    column_range(inlines, il_lo, il_hi, il_step);
+    column_range(crosslines, xl_lo, xl_hi, xl_step);
+    const int64_t n_il = (static_cast<int64_t>(il_hi) - il_lo) / il_step + 1;
+    const int64_t n_xl = (static_cast<int64_t>(xl_hi) - xl_lo) / xl_step + 1;
+    const long long n_traces = static_cast<long long>(inlines.size());
+
+    geometry.il_min_ = il_lo;
+    geometry.il_step_ = static_cast<int>(il_step);
+    geometry.xl_min_ = xl_lo;
+    geometry.xl_step_ = static_cast<int>(xl_step);
+    if (n_il < 2 || n_xl < 2) {
+        geometry.reason_ = "inline or crossline numbers are constant (2D line or missing header values)";
+        return geometry;
+    }
+    // Сетка не должна быть заметно больше числа трасс
+    if (n_il * n_xl > 2 * n_traces) {
+        geometry.reason_ = "grid " + std::to_string(n_il) + "x" + std::to_string(n_xl) + " is mostly empty";
+        return geometry;
+    }
+    geometry.n_il_ = static_cast<int>(n_il);
+    geometry.n_xl_ = static_cast<int>(n_xl);
+    geometry.cells_.assign(static_cast<size_t>(n_il * n_xl), -1);
+
+    // Каждая трасса пишет свой индекс в ячейку; повторное попадание отмечается счетчиком
+    long long duplicates = 0;
+    int* cells = geometry.cells_.data();
+    #pragma omp parallel for schedule(static) reduction(+:duplicates)
+    for (long long i = 0; i < n_traces; ++i) {
+        size_t cell = static_cast<size_t>((static_cast<int64_t>(inlines[i]) - il_lo) / il_step * n_xl +
+                                          (static_cast<int64_t>(crosslines[i]) - xl_lo) / xl_step);
+        int previous;
+        #pragma omp atomic capture
+        { previous = cells[cell]; cells[cell] = static_cast<int>(i); }
+        if (previous != -1) ++duplicates;
+    }
+    if (duplicates > 0) {
+        geometry.reason_ = std::to_string(duplicates) + " traces share a cell (pre-stack data?)";
+        geometry.n_il_ = geometry.n_xl_ = 0;
+        geometry.cells_.clear();
+        return geometry;
+    }
+    geometry.regular_ = true;
+    return geometry;
+}
+
+SurveyGeometry SurveyGeometry::detect(const SegyReader& reader, const GeometryFields& fields, const ProgressCallback& progress) {
+    std::vector<FieldInfo> infos;
+    infos.push_back(fields.inline_field);
+    infos.push_back(fields.crossline_field);
+    std::vector<std::vector<int32_t>> columns = read_header_columns(reader, infos, progress);
+    return from_columns(columns[0], columns[1]);
+}
+
+bool SurveyGeometry::append_traces(const SegyReader& reader, const GeometryFields& fields) {
+    if (!regular_) return false;
+    const int added = reader.num_traces() - n_traces_;
+    if (added <= 0) return true;
+
+    std::vector<FieldInfo> infos;
+    infos.push_back(fields.inline_field);
+    infos.push_back(fields.crossline_field);
+    std::vector<std::vector<int32_t>> columns = read_header_columns(reader, infos, n_traces_, added);
+    const std::vector<int32_t>& inlines = columns[0];
+    const std::vector<int32_t>& crosslines = columns[1];
+
+    // Новые номера должны лечь на прежние шаги; границы сетки могут расшириться
+    int64_t il_lo = il_min_, il_hi = inline_max();
+    int64_t xl_lo = xl_min_, xl_hi = crossline_max();
+    for (int t = 0; t < added; ++t) {
+        if ((static_cast<int64_t>(inlines[t]) - il_min_) % il_step_ != 0 ||
+            (static_cast<int64_t>(crosslines[t]) - xl_min_) % xl_step_ != 0) {
+            return false;
+        }
+        il_lo = std::min<int64_t>(il_lo, inlines[t]);
+        il_hi = std::max<int64_t>(il_hi, inlines[t]);
+        xl_lo = std::min<int64_t>(xl_lo, crosslines[t]);
+        xl_hi = std::max<int64_t>(xl_hi, crosslines[t]);
+    }
+    const int64_t n_il = (il_hi - il_lo) / il_step_ + 1;
+    const int64_t n_xl = (xl_hi - xl_lo) / xl_step_ + 1;
+    if (n_il * n_xl > 2 * (static_cast<int64_t>(n_traces_) + added)) return false;
+
+    // Прежние ячейки переносятся со сдвигом, заголовки старых трасс не перечитываются
+    std::vector<int> cells;
+    const bool grown = n_il != n_il_ || n_xl != n_xl_;
+    if (grown) {
+        const int64_t di = (il_min_ - il_lo) / il_step_;
+        const int64_t dj = (xl_min_ - xl_lo) / xl_step_;
+        cells.assign(static_cast<size_t>(n_il * n_xl), -1);
+        for (int64_t i = 0; i < n_il_; ++i) {
+            std::copy(cells_.begin() + i * n_xl_, cells_.begin() + (i + 1) * n_xl_,
+                      cells.begin() + (i + di) * n_xl + dj);
+        }
+    } else {
+        cells = cells_;
+    }
+    for (int t = 0; t < added; ++t) {
+        size_t cell = static_cast<size_t>((inlines[t] - il_lo) / il_step_ * n_xl + (crosslines[t] - xl_lo) / xl_step_);
+        // Повторное попадание в ячейку - данные до суммирования: геометрию нужно определить заново
+        if (cells[cell] != -1) return false;
+        cells[cell] = n_traces_ + t;
+    }
+
+    cells_.swap(cells);
+    il_min_ = static_cast<int>(il_lo);
+    xl_min_ = static_cast<int>(xl_lo);
+    n_il_ = static_cast<int>(n_il);
+    n_xl_ = static_cast<int>(n_xl);
+    n_traces_ += added;
+    return true;
+}
+
+int SurveyGeometry::trace_index(int inline_no, int crossline_no) const {
+    if (!regular_) return -1;
+    int64_t i = static_cast<int64_t>(inline_no) - il_min_;
+    int64_t j = static_cast<int64_t>(crossline_no) - xl_min_;
+    if (i < 0 || j < 0 || i % il_step_ != 0 || j % xl_step_ != 0) return -1;
+    i /= il_step_;
+    j /= xl_step_;
+    if (i >= n_il_ || j >= n_xl_) return -1;
+    return cells_[static_cast<size_t>(i * n_xl_ + j)];
+}
+
+std::vector<int> SurveyGeometry::inline_traces(int inline_no) const {
+    std::vector<int> traces;
+    if (!regular_) return traces;
+    traces.reserve(n_xl_);
+    for (int j = 0; j < n_xl_; ++j) traces.push_back(trace_index(inline_no, xl_min_ + j * xl_step_));
+    return traces;
+}
+
+std::vector<int> SurveyGeometry::crossline_traces(int crossline_no) const {
+    std::vector<int> traces;
+    if (!regular_) return traces;
+    traces.reserve(n_il_);
+    for (int i = 0; i < n_il_; ++i) traces.push_back(trace_index(il_min_ + i * il_step_, crossline_no));
+    return traces;
+}
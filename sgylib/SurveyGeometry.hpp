@@ -0,0 +1,81 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "SegyUtil.hpp"
+
+class SegyReader;
+
+/**
+ * @brief Байты заголовка трассы, из которых берутся номера инлайна/кросслайна.
+ * По умолчанию - поля SEG-Y rev1 (189 и 193), для нестандартных файлов задаются явно.
+ */
+struct GeometryFields {
+    FieldInfo inline_field = { 189, 4 };
+    FieldInfo crossline_field = { 193, 4 };
+};
+
+/**
+ * @class SurveyGeometry
+ * @brief Регулярная сетка 3D-куба после суммирования: (инлайн, кросслайн) -> трасса.
+ *
+ * Строится по колонкам номеров инлайнов/кросслайнов: диапазоны и шаги находятся
+ * параллельными редукциями (min/max и НОД разностей), затем каждая трасса
+ * записывается в свою ячейку. Если в ячейку попадает больше одной трассы
+ * (данные до суммирования) или сетка заполнена меньше чем наполовину,
+ * геометрия считается нерегулярной.
+ */
+class SurveyGeometry {
+public:
+    SurveyGeometry() {}
+
+    static SurveyGeometry from_columns(const std::vector<int32_t>& inlines, const std::vector<int32_t>& crosslines);
+
+    /**
+     * @brief Читает заголовки файла и определяет геометрию.
+     */
+    static SurveyGeometry detect(const SegyReader& reader, const GeometryFields& fields = GeometryFields(),
+                                 const ProgressCallback& progress = ProgressCallback());
+
+    /**
+     * @brief Заносит в сетку трассы [trace_count(), reader.num_traces()), дописанные после построения.
+     * Читаются только их заголовки; при выходе за границы сетка расширяется переносом ячеек.
+     * Если новая трасса не попадает на прежний шаг или в свободную ячейку, геометрия
+     * не меняется и возвращается false: ее нужно определить заново.
+     */
+    bool append_traces(const SegyReader& reader, const GeometryFields& fields = GeometryFields());
+
+    bool regular() const { return regular_; }
+    // Причина, по которой геометрия не признана регулярной
+    const std::string& reason() const { return reason_; }
+
+    int inline_min() const { return il_min_; }
+    int inline_max() const { return il_min_ + (n_il_ - 1) * il_step_; }
+    int inline_step() const { return il_step_; }
+    int crossline_min() const { return xl_min_; }
+    int crossline_max() const { return xl_min_ + (n_xl_ - 1) * xl_step_; }
+    int crossline_step() const { return xl_step_; }
+    int inline_count() const { return n_il_; }
+    int crossline_count() const { return n_xl_; }
+    // Число трасс, по которым построена сетка
+    int trace_count() const { return n_traces_; }
+
+    // Индекс трассы в ячейке или -1, если ячейка пуста или вне сетки
+    int trace_index(int inline_no, int crossline_no) const;
+
+    // Трассы инлайна по возрастанию кросслайна (-1 для пустых ячеек)
+    std::vector<int> inline_traces(int inline_no) const;
+    // Трассы кросслайна по возрастанию инлайна (-1 для пустых ячеек)
+    std::vector<int> crossline_traces(int crossline_no) const;
+    // Сетка целиком: cells()[i * crossline_count() + j]
+    const std::vector<int>& cells() const { return cells_; }
+
+private:
+    bool regular_ = false;
+    std::string reason_;
+    int il_min_ = 0, il_step_ = 1, n_il_ = 0;
+    int xl_min_ = 0, xl_step_ = 1, n_xl_ = 0;
+    int n_traces_ = 0;
+    std::vector<int> cells_;
+};
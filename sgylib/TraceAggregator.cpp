@@ -0,0 +1,259 @@
+#include "TraceAggregator.hpp"
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace {
+
+const int RADIX_BITS = 8;
+const int RADIX_BUCKETS = 1 << RADIX_BITS;
+// Минимальное число записей на поток при сортировке
+const size_t MIN_RECORDS_PER_THREAD = 1 << 16;
+
+int max_threads() {
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+// Инверсия знакового бита дает беззнаковый порядок, совпадающий со знаковым
+inline uint32_t radix_digit(int32_t value, int shift) {
+    return ((static_cast<uint32_t>(value) ^ 0x80000000u) >> shift) & (RADIX_BUCKETS - 1);
+}
+
+// Лексикографическое сравнение записей по ключам и значению сортировки
+inline int compare_records(const int32_t* a, const int32_t* b, int n_words) {
+    for (int i = 0; i < n_words; ++i) {
+        if (a[i] != b[i]) return a[i] < b[i] ? -1 : 1;
+    }
+    return 0;
+}
+
+} // namespace
+
+// Последовательное чтение отсортированной серии с диска блоками
+struct TraceAggregator::RunReader {
+    std::ifstream file;
+    std::vector<int32_t> block;
+    size_t words;
+    size_t block_records;
+    size_t count = 0;
+    size_t pos = 0;
+
+    RunReader(const std::string& path, int record_words, size_t records_per_block)
+        : file(path, std::ios::binary), words(record_words), block_records(records_per_block) {
+        if (!file) {
+            throw std::runtime_error("Cannot open aggregation run: " + path);
+        }
+        block.resize(block_records * words);
+        refill();
+    }
+
+    void refill() {
+        file.read(reinterpret_cast<char*>(block.data()), block.size() * sizeof(int32_t));
+        count = static_cast<size_t>(file.gcount()) / (words * sizeof(int32_t));
+        pos = 0;
+    }
+
+    const int32_t* current() const { return pos < count ? block.data() + pos * words : nullptr; }
+
+    void advance() {
+        if (++pos >= count && count == block_records) refill();
+    }
+};
+
+TraceAggregator::TraceAggregator(int n_keys, size_t memory_limit_bytes, const std::string& spill_prefix)
+    : n_keys_(n_keys), spill_prefix_(spill_prefix)
+{
+    if (n_keys < 1) {
+        throw std::invalid_argument("TraceAggregator needs at least one key.");
+    }
+    // Буфер записей и буфер сортировки одинакового размера
+    size_t record_bytes = static_cast<size_t>(record_words()) * sizeof(int32_t);
+    max_records_ = std::max<size_t>(MIN_RECORDS_PER_THREAD, memory_limit_bytes / (2 * record_bytes));
+}
+
+TraceAggregator::~TraceAggregator() {
+    runs_.clear();
+    for (const auto& path : run_paths_) {
+        std::remove(path.c_str());
+    }
+}
+
+int32_t* TraceAggregator::append(size_t count) {
+    if (finished_) {
+        throw std::logic_error("TraceAggregator::append after finish");
+    }
+    if (buffered_records_ > 0 && buffered_records_ + count > max_records_) {
+        spill();
+    }
+    const size_t words = record_words();
+    buffer_.resize((buffered_records_ + count) * words);
+    int32_t* dst = buffer_.data() + buffered_records_ * words;
+    buffered_records_ += count;
+    total_records_ += count;
+    return dst;
+}
+
+void TraceAggregator::spill() {
+    const size_t words = record_words();
+    scratch_.resize(buffered_records_ * words);
+    radix_sort(buffer_.data(), scratch_.data(), buffered_records_, record_words(), n_keys_);
+
+    std::string path = spill_prefix_ + ".run" + std::to_string(run_paths_.size());
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(buffer_.data()), buffered_records_ * words * sizeof(int32_t));
+    if (!out) {
+        std::remove(path.c_str());
+        throw std::runtime_error("Failed to write aggregation run: " + path);
+    }
+    run_paths_.push_back(path);
+    buffered_records_ = 0;
+    buffer_.clear();
+}
+
+void TraceAggregator::finish() {
+    if (finished_) return;
+    finished_ = true;
+    const size_t words = record_words();
+
+    if (run_paths_.empty()) {
+        scratch_.resize(buffered_records_ * words);
+        radix_sort(buffer_.data(), scratch_.data(), buffered_records_, record_words(), n_keys_);
+        std::vector<int32_t>().swap(scratch_);
+        read_pos_ = 0;
+        return;
+    }
+
+    if (buffered_records_ > 0) {
+        spill();
+    }
+    std::vector<int32_t>().swap(buffer_);
+    std::vector<int32_t>().swap(scratch_);
+
+    // Память под блоки чтения делится между сериями
+    size_t block_records = std::max<size_t>(4096, std::min<size_t>(1 << 20, 2 * max_records_ / run_paths_.size()));
+    for (const auto& path : run_paths_) {
+        runs_.push_back(std::unique_ptr<RunReader>(new RunReader(path, record_words(), block_records)));
+    }
+    for (size_t r = 0; r < runs_.size(); ++r) {
+        if (runs_[r]->current()) heap_.push_back(static_cast<int>(r));
+    }
+    std::make_heap(heap_.begin(), heap_.end(), [this](int a, int b) {
+        int c = compare_records(runs_[a]->current(), runs_[b]->current(), n_keys_ + 1);
+        return c != 0 ? c > 0 : a > b; // min-куча; при равенстве раньше идет более ранняя серия
+    });
+}
+
+const int32_t* TraceAggregator::peek_record() {
+    if (runs_.empty()) {
+        return read_pos_ < buffered_records_ ? buffer_.data() + read_pos_ * record_words() : nullptr;
+    }
+    return heap_.empty() ? nullptr : runs_[heap_.front()]->current();
+}
+
+void TraceAggregator::advance_record() {
+    if (runs_.empty()) {
+        ++read_pos_;
+        return;
+    }
+    auto greater = [this](int a, int b) {
+        int c = compare_records(runs_[a]->current(), runs_[b]->current(), n_keys_ + 1);
+        return c != 0 ? c > 0 : a > b;
+    };
+    std::pop_heap(heap_.begin(), heap_.end(), greater);
+    int run = heap_.back();
+    runs_[run]->advance();
+    if (runs_[run]->current()) {
+        std::push_heap(heap_.begin(), heap_.end(), greater);
+    } else {
+        heap_.pop_back();
+    }
+}
+
+bool TraceAggregator::next_group(std::vector<int32_t>& key, std::vector<int>& indices) {
+    if (!finished_) {
+        throw std::logic_error("TraceAggregator::next_group before finish");
+    }
+    const int32_t* rec = peek_record();
+    if (!rec) return false;
+
+    key.assign(rec, rec + n_keys_);
+    indices.clear();
+    while ((rec = peek_record()) != nullptr && std::equal(key.begin(), key.end(), rec)) {
+        indices.push_back(rec[n_keys_ + 1]);
+        advance_record();
+    }
+    return true;
+}
+
+void TraceAggregator::radix_sort(int32_t* records, int32_t* scratch, size_t count, int words, int n_keys) {
+    if (count < 2) return;
+
+    const int n_threads = static_cast<int>(std::max<size_t>(1, std::min<size_t>(max_threads(), count / MIN_RECORDS_PER_THREAD)));
+    const size_t per_thread = (count + n_threads - 1) / n_threads;
+    std::vector<size_t> hist(static_cast<size_t>(n_threads) * RADIX_BUCKETS);
+
+    int32_t* src = records;
+    int32_t* dst = scratch;
+    // LSD: от младшего значимого слова (значение сортировки) к первому ключу.
+    // Каждый проход стабилен, поэтому исходный порядок (по индексу трассы) сохраняется при равенстве.
+    for (int word = n_keys; word >= 0; --word) {
+        for (int shift = 0; shift < 32; shift += RADIX_BITS) {
+            #pragma omp parallel for schedule(static) num_threads(n_threads)
+            for (int t = 0; t < n_threads; ++t) {
+                size_t* h = hist.data() + static_cast<size_t>(t) * RADIX_BUCKETS;
+                std::fill(h, h + RADIX_BUCKETS, 0);
+                size_t begin = std::min(count, t * per_thread);
+                size_t end = std::min(count, begin + per_thread);
+                for (size_t i = begin; i < end; ++i) {
+                    ++h[radix_digit(src[i * words + word], shift)];
+                }
+            }
+
+            // Если все записи попали в одну корзину, проход ничего не меняет
+            bool trivial = false;
+            for (int b = 0; b < RADIX_BUCKETS && !trivial; ++b) {
+                size_t total = 0;
+                for (int t = 0; t < n_threads; ++t) total += hist[t * RADIX_BUCKETS + b];
+                trivial = (total == count);
+            }
+            if (trivial) continue;
+
+            // Смещения: корзины по порядку, внутри корзины - потоки по порядку (стабильность)
+            size_t offset = 0;
+            for (int b = 0; b < RADIX_BUCKETS; ++b) {
+                for (int t = 0; t < n_threads; ++t) {
+                    size_t c = hist[t * RADIX_BUCKETS + b];
+                    hist[t * RADIX_BUCKETS + b] = offset;
+                    offset += c;
+                }
+            }
+
+            #pragma omp parallel for schedule(static) num_threads(n_threads)
+            for (int t = 0; t < n_threads; ++t) {
+                size_t* h = hist.data() + static_cast<size_t>(t) * RADIX_BUCKETS;
+                size_t begin = std::min(count, t * per_thread);
+                size_t end = std::min(count, begin + per_thread);
+                for (size_t i = begin; i < end; ++i) {
+                    const int32_t* rec = src + i * words;
+                    size_t pos = h[radix_digit(rec[word], shift)]++;
+                    std::memcpy(dst + pos * words, rec, words * sizeof(int32_t));
+                }
+            }
+            std::swap(src, dst);
+        }
+    }
+
+    if (src != records) {
+        std::memcpy(records, src, count * words * sizeof(int32_t));
+    }
+}
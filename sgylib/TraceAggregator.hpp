@@ -0,0 +1,91 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+
+/**
+ * @class TraceAggregator
+ * @brief Группирует трассы по кортежу ключей без хеш-таблиц и аллокаций на трассу.
+ *
+ * Каждая запись - плоский кортеж из n_keys + 2 слов int32:
+ * [ключ 0, ..., ключ n_keys-1, значение сортировки, индекс трассы].
+ * Записи пишутся потоками напрямую в общий плоский буфер (каждый поток - в свой участок)
+ * и упорядочиваются параллельной LSD-радикс-сортировкой. Если буфер превышает лимит памяти,
+ * он сортируется и сбрасывается на диск как отсортированная серия (run); в конце серии
+ * сливаются k-way слиянием. Память ограничена лимитом независимо от числа трасс.
+ *
+ * Группы выдаются по возрастанию кортежа ключей; внутри группы трассы упорядочены
+ * по значению сортировки, при равенстве - по индексу трассы.
+ */
+class TraceAggregator {
+public:
+    /**
+     * @param n_keys Количество ключевых полей в записи.
+     * @param memory_limit_bytes Лимит памяти на буфер записей и буфер сортировки.
+     * @param spill_prefix Префикс путей временных файлов серий.
+     */
+    TraceAggregator(int n_keys, size_t memory_limit_bytes, const std::string& spill_prefix);
+    ~TraceAggregator();
+
+    TraceAggregator(const TraceAggregator&) = delete;
+    TraceAggregator& operator=(const TraceAggregator&) = delete;
+
+    int record_words() const { return n_keys_ + 2; }
+
+    /**
+     * @brief Резервирует место под count записей и возвращает указатель на первую из них.
+     * Указатель действителен до следующего вызова append/finish.
+     */
+    int32_t* append(size_t count);
+
+    /**
+     * @brief Завершает прием записей и готовит выдачу групп.
+     */
+    void finish();
+
+    /**
+     * @brief Выдает следующую группу.
+     * @param key Значения ключей группы (n_keys).
+     * @param indices Индексы трасс группы в порядке сортировки.
+     * @return false, если групп больше нет.
+     */
+    bool next_group(std::vector<int32_t>& key, std::vector<int>& indices);
+
+    size_t record_count() const { return total_records_; }
+    size_t spilled_runs() const { return run_paths_.size(); }
+
+    /**
+     * @brief Параллельная стабильная LSD-радикс-сортировка записей по словам [0, n_keys].
+     * @param records Записи (count * words слов), результат остается в них.
+     * @param scratch Буфер того же размера.
+     */
+    static void radix_sort(int32_t* records, int32_t* scratch, size_t count, int words, int n_keys);
+
+private:
+    struct RunReader;
+
+    void spill();
+    const int32_t* peek_record();
+    void advance_record();
+
+    int n_keys_;
+    size_t max_records_;
+    std::string spill_prefix_;
+
+    std::vector<int32_t> buffer_;
+    std::vector<int32_t> scratch_;
+    size_t buffered_records_ = 0;
+    size_t total_records_ = 0;
+    bool finished_ = false;
+
+    // Выдача из памяти (без сбросов на диск)
+    size_t read_pos_ = 0;
+
+    // Выдача слиянием серий
+    std::vector<std::string> run_paths_;
+    std::vector<std::unique_ptr<RunReader>> runs_;
+    std::vector<int> heap_;
+};
@@ -0,0 +1,240 @@
+#include "TraceBitmap.hpp"
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+const size_t DENSE_WORDS = 1024;          // 65536 бит
+const size_t ARRAY_MAX_CARDINALITY = 4096; // порог перехода к битовой карте
+
+inline int popcount64(uint64_t v) {
+#if defined(__GNUC__)
+    return __builtin_popcountll(v);
+#else
+    v = v - ((v >> 1) & 0x5555555555555555ull);
+    v = (v & 0x3333333333333333ull) + ((v >> 2) & 0x3333333333333333ull);
+    v = (v + (v >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+    return static_cast<int>((v * 0x0101010101010101ull) >> 56);
+#endif
+}
+
+inline int trailing_zeros64(uint64_t v) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(v);
+#else
+    int n = 0;
+    while (!(v & 1u)) { v >>= 1; ++n; }
+    return n;
+#endif
+}
+
+inline bool test_bit(const std::vector<uint64_t>& bits, uint16_t v) {
+    return (bits[v >> 6] >> (v & 63)) & 1u;
+}
+
+} // namespace
+
+// --- Container ---
+
+size_t TraceBitmap::Container::cardinality() const {
+    if (!dense) return values.size();
+    size_t n = 0;
+    for (uint64_t w : bits) n += popcount64(w);
+    return n;
+}
+
+void TraceBitmap::Container::to_dense() {
+    if (dense) return;
+    bits.assign(DENSE_WORDS, 0);
+    for (uint16_t v : values) bits[v >> 6] |= uint64_t(1) << (v & 63);
+    std::vector<uint16_t>().swap(values);
+    dense = true;
+}
+
+void TraceBitmap::Container::normalize() {
+    size_t n = cardinality();
+    if (!dense && n > ARRAY_MAX_CARDINALITY) {
+        to_dense();
+    } else if (dense && n <= ARRAY_MAX_CARDINALITY) {
+        values.clear();
+        values.reserve(n);
+        for (size_t w = 0; w < DENSE_WORDS; ++w) {
+            uint64_t word = bits[w];
+            while (word) {
+                values.push_back(static_cast<uint16_t>(w * 64 + trailing_zeros64(word)));
+                word &= word - 1;
+            }
+        }
+        std::vector<uint64_t>().swap(bits);
+        dense = false;
+    }
+}
+
+TraceBitmap::Container TraceBitmap::intersect(const Container& a, const Container& b) {
+    Container r;
+    r.key = a.key;
+    if (a.dense && b.dense) {
+        r.dense = true;
+        r.bits.resize(DENSE_WORDS);
+        for (size_t w = 0; w < DENSE_WORDS; ++w) r.bits[w] = a.bits[w] & b.bits[w];
+    } else if (a.dense || b.dense) {
+        const Container& arr = a.dense ? b : a;
+        const Container& bmp = a.dense ? a : b;
+        for (uint16_t v : arr.values) {
+            if (test_bit(bmp.bits, v)) r.values.push_back(v);
+        }
+    } else {
+        std::set_intersection(a.values.begin(), a.values.end(), b.values.begin(), b.values.end(),
+                              std::back_inserter(r.values));
+    }
+    r.normalize();
+    return r;
+}
+
+TraceBitmap::Container TraceBitmap::unite(const Container& a, const Container& b) {
+    Container r;
+    r.key = a.key;
+    if (!a.dense && !b.dense && a.values.size() + b.values.size() <= ARRAY_MAX_CARDINALITY) {
+        std::set_union(a.values.begin(), a.values.end(), b.values.begin(), b.values.end(),
+                       std::back_inserter(r.values));
+        return r;
+    }
+    r = a;
+    r.to_dense();
+    if (b.dense) {
+        for (size_t w = 0; w < DENSE_WORDS; ++w) r.bits[w] |= b.bits[w];
+    } else {
+        for (uint16_t v : b.values) r.bits[v >> 6] |= uint64_t(1) << (v & 63);
+    }
+    r.normalize();
+    return r;
+}
+
+// --- TraceBitmap ---
+
+TraceBitmap TraceBitmap::from_indices(const std::vector<int>& indices) {
+    TraceBitmap result;
+    result.add(indices);
+    return result;
+}
+
+TraceBitmap TraceBitmap::from_bitset(const std::vector<uint64_t>& words) {
+    TraceBitmap result;
+    for (size_t first = 0; first < words.size(); first += DENSE_WORDS) {
+        size_t count = std::min(DENSE_WORDS, words.size() - first);
+        bool any = false;
+        for (size_t w = 0; w < count && !any; ++w) any = words[first + w] != 0;
+        if (!any) continue;
+
+        Container c;
+        c.key = static_cast<uint16_t>(first / DENSE_WORDS);
+        c.dense = true;
+        c.bits.assign(DENSE_WORDS, 0);
+        std::copy(words.begin() + first, words.begin() + first + count, c.bits.begin());
+        c.normalize();
+        result.containers_.push_back(std::move(c));
+    }
+    return result;
+}
+
+void TraceBitmap::add(const std::vector<int>& indices) {
+    std::vector<int> sorted;
+    sorted.reserve(indices.size());
+    for (int v : indices) {
+        if (v >= 0) sorted.push_back(v);
+    }
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+    TraceBitmap other;
+    size_t i = 0;
+    while (i < sorted.size()) {
+        Container c;
+        c.key = static_cast<uint16_t>(static_cast<uint32_t>(sorted[i]) >> 16);
+        while (i < sorted.size() && (static_cast<uint32_t>(sorted[i]) >> 16) == c.key) {
+            c.values.push_back(static_cast<uint16_t>(sorted[i] & 0xFFFF));
+            ++i;
+        }
+        c.normalize();
+        other.containers_.push_back(std::move(c));
+    }
+    if (containers_.empty()) {
+        containers_.swap(other.containers_);
+    } else {
+        *this |= other;
+    }
+}
+
+bool TraceBitmap::contains(int index) const {
+    if (index < 0) return false;
+    uint16_t key = static_cast<uint16_t>(static_cast<uint32_t>(index) >> 16);
+    uint16_t low = static_cast<uint16_t>(index & 0xFFFF);
+    auto it = std::lower_bound(containers_.begin(), containers_.end(), key,
+                               [](const Container& c, uint16_t k) { return c.key < k; });
+    if (it == containers_.end() || it->key != key) return false;
+    return it->dense ? test_bit(it->bits, low) : std::binary_search(it->values.begin(), it->values.end(), low);
+}
+
+size_t TraceBitmap::cardinality() const {
+    size_t n = 0;
+    for (const auto& c : containers_) n += c.cardinality();
+    return n;
+}
+
+std::vector<int> TraceBitmap::to_vector() const {
+    std::vector<int> out;
+    out.reserve(cardinality());
+    for (const auto& c : containers_) {
+        int base = static_cast<int>(c.key) << 16;
+        if (!c.dense) {
+            for (uint16_t v : c.values) out.push_back(base | v);
+            continue;
+        }
+        for (size_t w = 0; w < DENSE_WORDS; ++w) {
+            uint64_t word = c.bits[w];
+            while (word) {
+                out.push_back(base | static_cast<int>(w * 64 + trailing_zeros64(word)));
+                word &= word - 1;
+            }
+        }
+    }
+    return out;
+}
+
+TraceBitmap& TraceBitmap::operator&=(const TraceBitmap& other) {
+    std::vector<Container> result;
+    size_t i = 0, j = 0;
+    while (i < containers_.size() && j < other.containers_.size()) {
+        if (containers_[i].key < other.containers_[j].key) {
+            ++i;
+        } else if (containers_[i].key > other.containers_[j].key) {
+            ++j;
+        } else {
+            Container c = intersect(containers_[i], other.containers_[j]);
+            if (c.cardinality() > 0) result.push_back(std::move(c));
+            ++i;
+            ++j;
+        }
+    }
+    containers_.swap(result);
+    return *this;
+}
+
+TraceBitmap& TraceBitmap::operator|=(const TraceBitmap& other) {
+    std::vector<Container> result;
+    result.reserve(containers_.size() + other.containers_.size());
+    size_t i = 0, j = 0;
+    while (i < containers_.size() || j < other.containers_.size()) {
+        if (j == other.containers_.size() || (i < containers_.size() && containers_[i].key < other.containers_[j].key)) {
+            result.push_back(std::move(containers_[i++]));
+        } else if (i == containers_.size() || other.containers_[j].key < containers_[i].key) {
+            result.push_back(other.containers_[j++]);
+        } else {
+            result.push_back(unite(containers_[i], other.containers_[j]));
+            ++i;
+            ++j;
+        }
+    }
+    containers_.swap(result);
+    return *this;
+}
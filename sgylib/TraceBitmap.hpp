@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @class TraceBitmap
+ * @brief Сжатое множество индексов трасс в духе roaring bitmap.
+ *
+ * Пространство индексов делится на блоки по 65536 значений (старшие 16 бит).
+ * Разреженный блок хранится отсортированным массивом младших 16 бит,
+ * плотный (более 4096 элементов) - битовой картой из 1024 слов.
+ * Пересечение и объединение выполняются поблочно в памяти: для плотных блоков -
+ * пословными AND/OR, для разреженных - слиянием массивов.
+ */
+class TraceBitmap {
+public:
+    TraceBitmap() {}
+
+    // Строит множество из индексов в произвольном порядке (отрицательные игнорируются)
+    static TraceBitmap from_indices(const std::vector<int>& indices);
+
+    // Строит множество из плоской битовой карты (бит i слова i/64 - индекс i)
+    static TraceBitmap from_bitset(const std::vector<uint64_t>& words);
+
+    // Добавляет индексы в произвольном порядке
+    void add(const std::vector<int>& indices);
+
+    bool contains(int index) const;
+    size_t cardinality() const;
+    bool empty() const { return containers_.empty(); }
+
+    // Индексы по возрастанию
+    std::vector<int> to_vector() const;
+
+    TraceBitmap& operator&=(const TraceBitmap& other);
+    TraceBitmap& operator|=(const TraceBitmap& other);
+    friend TraceBitmap operator&(TraceBitmap a, const TraceBitmap& b) { return a &= b; }
+    friend TraceBitmap operator|(TraceBitmap a, const TraceBitmap& b) { return a |= b; }
+
+    bool operator==(const TraceBitmap& other) const { return to_vector() == other.to_vector(); }
+
+private:
+    struct Container {
+        uint16_t key = 0;
+        bool dense = false;
+        std::vector<uint16_t> values; // разреженный блок
+        std::vector<uint64_t> bits;   // плотный блок (1024 слова)
+
+        size_t cardinality() const;
+        void to_dense();
+        void normalize(); // выбирает представление по числу элементов
+    };
+
+    static Container intersect(const Container& a, const Container& b);
+    static Container unite(const Container& a, const Container& b);
+
+    std::vector<Container> containers_; // отсортированы по key
+};
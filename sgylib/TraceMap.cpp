@@ -5,27 +5,72 @@
 #include <stdexcept>
 #include <algorithm>
 #include <sstream>
-#include <unordered_map>
 #include <cstring>
-#include <iostream>
-#include "SegyUtil.hpp"
+#include <future>
+#include <iterator>
+#include <map>
+#include "HeaderExtractor.hpp"
+#include "TraceAggregator.hpp"
+#include "PostingList.hpp"
 
-// Заголовки для параллелизации и работы с БД
-#include <omp.h>
+// Заголовки для работы с БД
 #include <sqlite3.h>
 
+template <typename Key>
+static void add_to_summary(std::map<Key, KeySummary>& summary, const Key& value, size_t count, int first_trace, int last_trace) {
+    auto it = summary.find(value);
+    if (it == summary.end()) {
+        KeySummary s = { 0, static_cast<int64_t>(count), first_trace, last_trace };
+        summary.insert(std::make_pair(value, s));
+        return;
+    }
+    it->second.trace_count += count;
+    it->second.first_trace = std::min(it->second.first_trace, first_trace);
+    it->second.last_trace = std::max(it->second.last_trace, last_trace);
+}
 
-// Хеш-функция для std::vector<int>, нужна для временной карты в памяти
-struct VectorHash {
-    std::size_t operator()(const std::vector<int>& v) const {
-        std::size_t seed = v.size();
-        for (int i : v) {
-            seed ^= std::hash<int>{}(i) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
-        }
-        return seed;
+namespace {
+
+// Транзакция записи карты и ее подготовленные выражения. При раскрутке стека выражения
+// финализируются, а незавершенная транзакция откатывается - соединение остается пригодным.
+class WriteTransaction {
+public:
+    explicit WriteTransaction(sqlite3* db) : db_(db) {}
+    ~WriteTransaction() {
+        finalize();
+        if (open_) sqlite3_exec(db_, "ROLLBACK;", nullptr, nullptr, nullptr);
     }
+    WriteTransaction(const WriteTransaction&) = delete;
+    WriteTransaction& operator=(const WriteTransaction&) = delete;
+
+    int begin() {
+        int rc = sqlite3_exec(db_, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+        open_ = rc == SQLITE_OK;
+        return rc;
+    }
+    int commit() {
+        finalize();
+        int rc = sqlite3_exec(db_, "COMMIT;", nullptr, nullptr, nullptr);
+        if (rc == SQLITE_OK) open_ = false;
+        return rc;
+    }
+    void finalize() {
+        sqlite3_finalize(insert);
+        sqlite3_finalize(lookup);
+        insert = nullptr;
+        lookup = nullptr;
+    }
+
+    sqlite3_stmt* insert = nullptr;
+    sqlite3_stmt* lookup = nullptr;
+
+private:
+    sqlite3* db_;
+    bool open_ = false;
 };
 
+} // namespace
+
 TraceMap::TraceMap(const std::string& db_path, const std::vector<std::string>& keys)
     : db_path_(db_path), keys_(keys) 
 {
@@ -39,10 +84,20 @@ TraceMap::TraceMap(const std::string& db_path, const std::vector<std::string>& k
         keys_.pop_back(); 
     }
     open_db();
+    bool existed = table_exists("trace_map");
     create_table();
+    if (!existed) {
+        set_storage_version(STORAGE_VERSION_SUMMARIES);
+    }
+    int version = storage_version();
+    compressed_indices_ = version >= STORAGE_VERSION_COMPRESSED;
+    has_summaries_ = version >= STORAGE_VERSION_SUMMARIES;
 }
 
 TraceMap::~TraceMap() {
+    for (sqlite3_stmt* stmt : range_stmts_) {
+        sqlite3_finalize(stmt);
+    }
     if (db_) {
         sqlite3_close(db_);
     }
@@ -72,90 +127,168 @@ void TraceMap::create_table() {
     sql << "));";
 
     check_db_error(sqlite3_exec(db_, sql.str().c_str(), nullptr, nullptr, nullptr), "Table creation");
+
+    // Сводки по значениям ключей и парам ключей - заполняются в build_map
+    check_db_error(sqlite3_exec(db_,
+        "CREATE TABLE IF NOT EXISTS key_summary ("
+        "key_name TEXT NOT NULL, value INTEGER NOT NULL, trace_count INTEGER NOT NULL, "
+        "first_trace INTEGER NOT NULL, last_trace INTEGER NOT NULL, "
+        "PRIMARY KEY (key_name, value)) WITHOUT ROWID;", nullptr, nullptr, nullptr), "Key summary creation");
+    check_db_error(sqlite3_exec(db_,
+        "CREATE TABLE IF NOT EXISTS pair_summary ("
+        "key1 TEXT NOT NULL, key2 TEXT NOT NULL, value1 INTEGER NOT NULL, value2 INTEGER NOT NULL, "
+        "trace_count INTEGER NOT NULL, first_trace INTEGER NOT NULL, last_trace INTEGER NOT NULL, "
+        "PRIMARY KEY (key1, key2, value1, value2)) WITHOUT ROWID;", nullptr, nullptr, nullptr), "Pair summary creation");
+    // Параметры построения карты (поле сортировки сборок), нужные при дописывании
+    check_db_error(sqlite3_exec(db_,
+        "CREATE TABLE IF NOT EXISTS map_meta (name TEXT PRIMARY KEY, value TEXT NOT NULL);",
+        nullptr, nullptr, nullptr), "Meta table creation");
+
+    // Первый ключ - префикс первичного ключа; для диапазонных запросов по остальным нужны отдельные индексы
+    for (size_t i = 1; i < keys_.size(); ++i) {
+        std::string index_sql = "CREATE INDEX IF NOT EXISTS \"trace_map_" + keys_[i] + "\" ON trace_map (\"" + keys_[i] + "\");";
+        check_db_error(sqlite3_exec(db_, index_sql.c_str(), nullptr, nullptr, nullptr), "Index creation");
+    }
 }
 
-void TraceMap::build_map(const SegyReader& reader, const std::string& sorting_key) {
-    int n_traces = reader.num_traces();
-    size_t n_keys = keys_.size();
+void TraceMap::build_map(const SegyReader& reader, const std::string& sorting_key, const ProgressCallback& progress) {
+    const int n_traces = reader.num_traces();
+    // Поле сортировки извлекается вместе с ключами - повторное чтение заголовков не нужно
+    const std::string sort_key = sorting_key.empty() ? keys_.front() : sorting_key;
+
+    // --- Агрегация: плоские записи (ключи, значение сортировки, индекс) + радикс-сортировка ---
+    TraceAggregator aggregator(static_cast<int>(keys_.size()), aggregation_memory_limit_, db_path_ + ".spill");
+    scan_headers(reader, 0, n_traces, sort_key, aggregator, progress);
+
+    // 3. Сортировка (по ключам, затем по sort_key и индексу трассы) и, при сбросах на диск, слияние серий
+    aggregator.finish();
+    write_groups(aggregator, reader, sort_key, false, n_traces, progress);
+}
+
+int TraceMap::append_traces(const SegyReader& reader, const ProgressCallback& progress) {
+    const int first_trace = indexed_trace_count();
+    if (first_trace < 0) {
+        throw std::logic_error("TraceMap::append_traces requires a map built with summaries; call build_map first.");
+    }
+    const int n_new = reader.num_traces() - first_trace;
+    if (n_new <= 0) return 0;
+
+    // Карты, построенные до появления map_meta, сортировались по первому ключу
+    std::string sort_key = read_meta("sort_key");
+    if (sort_key.empty()) sort_key = keys_.front();
+
+    TraceAggregator aggregator(static_cast<int>(keys_.size()), aggregation_memory_limit_, db_path_ + ".spill");
+    scan_headers(reader, first_trace, n_new, sort_key, aggregator, progress);
+    aggregator.finish();
+    write_groups(aggregator, reader, sort_key, true, n_new, progress);
+    return n_new;
+}
+
+int TraceMap::indexed_trace_count() const {
+    if (!has_summaries_) return -1;
+    sqlite3_stmt* stmt;
+    check_db_error(sqlite3_prepare_v2(db_, "SELECT MAX(last_trace) FROM key_summary WHERE key_name = ?;", -1, &stmt, nullptr),
+                   "Prepare indexed count");
+    sqlite3_bind_text(stmt, 1, keys_.front().c_str(), -1, SQLITE_TRANSIENT);
+    int count = 0;
+    if (sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_type(stmt, 0) != SQLITE_NULL) {
+        count = sqlite3_column_int(stmt, 0) + 1;
+    }
+    sqlite3_finalize(stmt);
+    return count;
+}
+
+void TraceMap::scan_headers(const SegyReader& reader, int first_trace, int n_traces, const std::string& sort_key,
+                            TraceAggregator& aggregator, const ProgressCallback& progress) const {
+    std::vector<std::string> scan_fields = keys_;
+    scan_fields.push_back(sort_key);
+    const std::vector<FieldInfo> scan_field_infos = resolve_trace_fields(scan_fields);
+    const size_t n_fields = scan_fields.size();
+    if (n_traces <= 0) return;
     
     // Определяем размер одного полного блока трассы (заголовок + данные)
-    const int trace_size = 240 + reader.num_samples() * 4;
+    const size_t trace_size = reader.trace_bsize();
     
     // Устанавливаем большой размер буфера для чтения (например, 256 МБ)
     const size_t CHUNK_SIZE_BYTES = 256 * 1024 * 1024;
     // Сколько полных трасс помещается в наш буфер
-    const int traces_per_chunk = CHUNK_SIZE_BYTES / trace_size;
+    const int traces_per_chunk = std::min<int>(std::max(n_traces, 1), std::max<size_t>(1, CHUNK_SIZE_BYTES / trace_size));
+    // Размер блока заголовков, который извлекается одним вызовом extract_header_fields
+    const int EXTRACT_BLOCK = 4096;
     
-    // Временный буфер для чтения больших кусков файла
-    std::vector<char> buffer(traces_per_chunk * trace_size);
+    // Двойная буферизация: пока OpenMP обрабатывает блок N, в соседний буфер читается блок N+1
+    std::vector<char> buffers[2];
+    buffers[0].resize(traces_per_chunk * trace_size);
+    buffers[1].resize(traces_per_chunk * trace_size);
+
+    auto start_read = [&reader, trace_size](int first, int count, std::vector<char>& buffer) {
+        char* dst = buffer.data();
+        return std::async(std::launch::async, [&reader, first, count, trace_size, dst]() {
+            reader.read_raw_block(first, static_cast<size_t>(count) * trace_size, dst);
+        });
+    };
 
-    // --- Основная карта для агрегации результатов ---
-    using InMemoryMap = std::unordered_map<std::vector<int>, std::vector<int>, VectorHash>;
-    InMemoryMap final_map;
+    const int words = aggregator.record_words();
 
     int traces_processed = 0;
+    int current = 0;
+    std::future<void> pending = start_read(first_trace, std::min(traces_per_chunk, n_traces), buffers[current]);
     while (traces_processed < n_traces) {
-        // Определяем, сколько трасс читать на этой итерации
+        // Определяем, сколько трасс в текущем блоке
         int traces_to_read = std::min(traces_per_chunk, n_traces - traces_processed);
-        size_t bytes_to_read = traces_to_read * trace_size;
         
-        // 1. Читаем большой непрерывный блок с диска за один вызов
-        reader.read_raw_block(traces_processed, bytes_to_read, buffer.data());
+        // 1. Дожидаемся чтения текущего блока и сразу запускаем чтение следующего
+        pending.get();
+        int next_first = traces_processed + traces_to_read;
+        if (next_first < n_traces) {
+            int next_count = std::min(traces_per_chunk, n_traces - next_first);
+            pending = start_read(first_trace + next_first, next_count, buffers[1 - current]);
+        }
+        const uint8_t* buffer = reinterpret_cast<const uint8_t*>(buffers[current].data());
 
-        // 2. Параллельно обрабатываем заголовки из этого блока УЖЕ В ПАМЯТИ
-        std::vector<InMemoryMap> local_maps;
+        // 2. Параллельно разбираем заголовки блока УЖЕ В ПАМЯТИ: каждый поток извлекает поля
+        //    своих подблоков в локальные колонки и пишет записи в свой участок общего буфера
+        int32_t* records = aggregator.append(traces_to_read);
+        const int n_blocks = (traces_to_read + EXTRACT_BLOCK - 1) / EXTRACT_BLOCK;
         #pragma omp parallel
         {
-            int thread_id = omp_get_thread_num();
-            #pragma omp single
-            {
-                local_maps.resize(omp_get_num_threads());
-            }
+            std::vector<std::vector<int32_t>> columns(n_fields, std::vector<int32_t>(EXTRACT_BLOCK));
+            std::vector<int32_t*> out(n_fields);
+            for (size_t j = 0; j < n_fields; ++j) out[j] = columns[j].data();
+
+            #pragma omp for schedule(static)
+            for (int b = 0; b < n_blocks; ++b) {
+                int first = b * EXTRACT_BLOCK;
+                int count = std::min(EXTRACT_BLOCK, traces_to_read - first);
+                extract_header_fields(buffer + first * trace_size, count, trace_size, scan_field_infos, out.data());
 
-            #pragma omp for schedule(dynamic)
-            for (int i = 0; i < traces_to_read; ++i) {
-                // Получаем указатель на заголовок внутри нашего буфера в памяти
-                const char* header_ptr = buffer.data() + i * trace_size;
-                
-                std::vector<int> key_vals(n_keys);
-                for (size_t j = 0; j < n_keys; ++j) {
-                    key_vals[j] = get_trace_field_value(reinterpret_cast<const uint8_t*>(header_ptr), keys_[j]);
+                for (int i = 0; i < count; ++i) {
+                    int32_t* rec = records + static_cast<size_t>(first + i) * words;
+                    for (size_t j = 0; j < n_fields; ++j) {
+                        rec[j] = columns[j][i]; // ключи и значение сортировки
+                    }
+                    rec[n_fields] = first_trace + traces_processed + first + i;
                 }
-                
-                int global_trace_index = traces_processed + i;
-                local_maps[thread_id][key_vals].push_back(global_trace_index);
             }
         } // Конец параллельной секции
 
-        // 3. Сливаем результаты из локальных карт в общую
-        for (const auto& local_map : local_maps) {
-            for (const auto& pair : local_map) {
-                final_map[pair.first].insert(final_map[pair.first].end(), pair.second.begin(), pair.second.end());
-            }
-        }
-
         traces_processed += traces_to_read;
-        print_progress_bar("1/2 Reading & Processing", traces_processed, n_traces);
-    }
-    
-    // --- Шаг 4: Сортировка индексов внутри gather по sorting_key (если задан) ---
-    std::string sort_key = sorting_key.empty() ? keys_.front() : sorting_key;
-    for (auto& [key_vec, indices_vec] : final_map) {
-        // Для каждого индекса читаем заголовок и получаем значение сортировочного поля
-        std::vector<std::pair<int, int>> sort_pairs;
-        for (int idx : indices_vec) {
-            auto header = reader.get_trace_header(idx);
-            int val = get_trace_field_value(header.data(), sort_key);
-            sort_pairs.emplace_back(val, idx);
-        }
-        std::sort(sort_pairs.begin(), sort_pairs.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
-        // Перезаписываем indices_vec в отсортированном порядке
-        for (size_t i = 0; i < indices_vec.size(); ++i) {
-            indices_vec[i] = sort_pairs[i].second;
-        }
+        current = 1 - current;
+        report_progress(progress, "Reading & processing headers", traces_processed, n_traces);
     }
-    // --- Шаг 4: Запись объединенной карты в SQLite (без изменений) ---
-    sqlite3_stmt* stmt;
+}
+
+void TraceMap::write_groups(TraceAggregator& aggregator, const SegyReader& reader, const std::string& sort_key,
+                            bool append, int64_t n_traces, const ProgressCallback& progress) {
+    const size_t n_keys = keys_.size();
+    // Если поле сортировки - один из ключей, внутри сборки оно постоянно и порядок задается индексом трассы:
+    // новые индексы (они больше старых) просто дописываются в конец списка
+    const bool sort_within_gather = std::find(keys_.begin(), keys_.end(), sort_key) == keys_.end();
+    auto sort_value = [&reader, &sort_key](int trace) {
+        std::vector<uint8_t> header = reader.get_trace_header(trace);
+        return get_trace_field_value(header.data(), sort_key);
+    };
+    // --- 4. Запись групп в SQLite по мере их выдачи агрегатором ---
     std::stringstream sql;
     sql << "INSERT OR REPLACE INTO trace_map (";
     for(const auto& key : keys_) sql << "\"" << key << "\", ";
@@ -163,37 +296,177 @@ void TraceMap::build_map(const SegyReader& reader, const std::string& sorting_ke
     for(size_t i = 0; i < keys_.size(); ++i) sql << "?, ";
     sql << "?);";
 
-    check_db_error(sqlite3_exec(db_, "DELETE FROM trace_map;", nullptr, nullptr, nullptr), "Clear table");
-    
-    check_db_error(sqlite3_exec(db_, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr), "Begin transaction");
-    check_db_error(sqlite3_prepare_v2(db_, sql.str().c_str(), -1, &stmt, nullptr), "Prepare insert");
+    // При дописывании существующий список сборки читается, и новые индексы вливаются в него по полю сортировки
+    std::stringstream lookup_sql;
+    lookup_sql << "SELECT indices FROM trace_map WHERE ";
+    for (size_t i = 0; i < n_keys; ++i) {
+        lookup_sql << (i ? " AND " : "") << "\"" << keys_[i] << "\" = ?";
+    }
+    lookup_sql << ";";
+
+    WriteTransaction transaction(db_);
+    check_db_error(transaction.begin(), "Begin transaction");
+    if (!append) {
+        check_db_error(sqlite3_exec(db_, "DELETE FROM trace_map;", nullptr, nullptr, nullptr), "Clear table");
+        check_db_error(sqlite3_exec(db_, "DELETE FROM key_summary; DELETE FROM pair_summary;", nullptr, nullptr, nullptr), "Clear summaries");
+        // Карта перезаписывается целиком, поэтому старые несжатые BLOB-ы не остаются
+        set_storage_version(STORAGE_VERSION_SUMMARIES);
+        write_meta("sort_key", sort_key);
+    }
+    if (append) {
+        check_db_error(sqlite3_prepare_v2(db_, lookup_sql.str().c_str(), -1, &transaction.lookup, nullptr), "Prepare gather lookup");
+    }
+    check_db_error(sqlite3_prepare_v2(db_, sql.str().c_str(), -1, &transaction.insert, nullptr), "Prepare insert");
+    sqlite3_stmt* stmt = transaction.insert;
+    sqlite3_stmt* lookup = transaction.lookup;
+
+    std::vector<int32_t> key_vec;
+    std::vector<int> indices;
+    int64_t written_traces = 0;
+    int written_gathers = 0;
+    // Сводки накапливаются по мере выдачи групп: по каждому ключу и по каждой паре ключей (i < j)
+    std::vector<std::map<int, KeySummary>> key_summaries(n_keys);
+    std::vector<std::map<std::pair<int, int>, KeySummary>> pair_summaries(n_keys * (n_keys - 1) / 2);
+    while (aggregator.next_group(key_vec, indices)) {
+        const size_t group_size = indices.size();
+        int first_trace = *std::min_element(indices.begin(), indices.end());
+        int last_trace = *std::max_element(indices.begin(), indices.end());
+        size_t pair_idx = 0;
+        for (size_t i = 0; i < n_keys; ++i) {
+            add_to_summary(key_summaries[i], key_vec[i], indices.size(), first_trace, last_trace);
+            for (size_t j = i + 1; j < n_keys; ++j) {
+                add_to_summary(pair_summaries[pair_idx++], std::make_pair(key_vec[i], key_vec[j]),
+                               indices.size(), first_trace, last_trace);
+            }
+        }
+
+        if (lookup) {
+            for (size_t i = 0; i < n_keys; ++i) {
+                sqlite3_bind_int(lookup, i + 1, key_vec[i]);
+            }
+            if (sqlite3_step(lookup) == SQLITE_ROW) {
+                std::vector<int> merged;
+                deserialize_indices(static_cast<const char*>(sqlite3_column_blob(lookup, 0)), sqlite3_column_bytes(lookup, 0), merged);
+                if (!sort_within_gather || merged.empty() || sort_value(merged.back()) <= sort_value(indices.front())) {
+                    merged.insert(merged.end(), indices.begin(), indices.end());
+                } else {
+                    // Обе части упорядочены по (значение сортировки, индекс трассы) - сливаем их в том же порядке.
+                    // Заголовки старых трасс перечитываются только для сборок, куда новые трассы попадают не в конец
+                    std::vector<std::pair<int32_t, int>> old_part, new_part, both;
+                    old_part.reserve(merged.size());
+                    for (int trace : merged) old_part.emplace_back(sort_value(trace), trace);
+                    new_part.reserve(indices.size());
+                    for (int trace : indices) new_part.emplace_back(sort_value(trace), trace);
+                    both.reserve(old_part.size() + new_part.size());
+                    std::merge(old_part.begin(), old_part.end(), new_part.begin(), new_part.end(), std::back_inserter(both));
+                    merged.clear();
+                    for (const auto& entry : both) merged.push_back(entry.second);
+                }
+                indices.swap(merged);
+            }
+            sqlite3_reset(lookup);
+        }
 
-    int written_keys = 0;
-    int total_keys = final_map.size();
-    for (const auto& [key_vec, indices_vec] : final_map) {
         for (size_t i = 0; i < key_vec.size(); ++i) {
             sqlite3_bind_int(stmt, i + 1, key_vec[i]);
         }
-        auto blob = serialize_indices(indices_vec);
+        auto blob = serialize_indices(indices);
         sqlite3_bind_blob(stmt, keys_.size() + 1, blob.data(), blob.size(), SQLITE_TRANSIENT);
         
-        if (sqlite3_step(stmt) != SQLITE_DONE) {/* обработка ошибки */}
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            throw std::runtime_error("SQLite error in Insert gather: " + std::string(sqlite3_errmsg(db_)));
+        }
         sqlite3_reset(stmt);
         
-        if (++written_keys % 1000 == 0 || written_keys == total_keys) {
-            print_progress_bar("2/2 Writing to database", written_keys, total_keys);
+        written_traces += group_size;
+        if (++written_gathers % 1000 == 0 || written_traces == n_traces) {
+            report_progress(progress, "Writing to database", written_traces, n_traces);
         }
     }
     
-    sqlite3_finalize(stmt);
-    check_db_error(sqlite3_exec(db_, "COMMIT;", nullptr, nullptr, nullptr), "Commit transaction");
+    transaction.finalize();
+
+    write_summaries(key_summaries, pair_summaries, append);
+    check_db_error(transaction.commit(), "Commit transaction");
+    if (!append) compressed_indices_ = true;
+    has_summaries_ = true;
 }
 
-std::vector<int> TraceMap::find_trace_indices(const std::vector<std::optional<int>>& key_values) const {
+void TraceMap::write_summaries(const std::vector<std::map<int, KeySummary>>& key_summaries,
+                               const std::vector<std::map<std::pair<int, int>, KeySummary>>& pair_summaries, bool merge) {
+    // При слиянии существующая строка обновляется, новая - вставляется
+    const char* merge_sql[2] = {
+        "UPDATE key_summary SET trace_count = trace_count + ?3, first_trace = MIN(first_trace, ?4), "
+        "last_trace = MAX(last_trace, ?5) WHERE key_name = ?1 AND value = ?2;",
+        "UPDATE pair_summary SET trace_count = trace_count + ?5, first_trace = MIN(first_trace, ?6), "
+        "last_trace = MAX(last_trace, ?7) WHERE key1 = ?1 AND key2 = ?2 AND value1 = ?3 AND value2 = ?4;"
+    };
+    const char* insert_sql[2] = {
+        "INSERT INTO key_summary (key_name, value, trace_count, first_trace, last_trace) VALUES (?1, ?2, ?3, ?4, ?5);",
+        "INSERT INTO pair_summary (key1, key2, value1, value2, trace_count, first_trace, last_trace) "
+        "VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7);"
+    };
+    sqlite3_stmt* update_stmt[2] = { nullptr, nullptr };
+    sqlite3_stmt* insert_stmt[2] = { nullptr, nullptr };
+    auto finalize_all = [&]() {
+        for (int t = 0; t < 2; ++t) {
+            sqlite3_finalize(update_stmt[t]);
+            sqlite3_finalize(insert_stmt[t]);
+        }
+    };
+    for (int t = 0; t < 2; ++t) {
+        int rc = sqlite3_prepare_v2(db_, insert_sql[t], -1, &insert_stmt[t], nullptr);
+        if (rc == SQLITE_OK && merge) rc = sqlite3_prepare_v2(db_, merge_sql[t], -1, &update_stmt[t], nullptr);
+        if (rc != SQLITE_OK) {
+            finalize_all();
+            check_db_error(rc, "Prepare summary statements");
+        }
+    }
+
+    // Параметры 1..n_names - имена ключей, далее значения и сводка
+    auto write_row = [&](int table, const std::string* names, const int* values, const KeySummary& s) {
+        const int n_names = table + 1;
+        for (int pass = merge ? 0 : 1; pass < 2; ++pass) {
+            sqlite3_stmt* stmt = pass == 0 ? update_stmt[table] : insert_stmt[table];
+            int p = 1;
+            for (int k = 0; k < n_names; ++k) sqlite3_bind_text(stmt, p++, names[k].c_str(), -1, SQLITE_TRANSIENT);
+            for (int k = 0; k < n_names; ++k) sqlite3_bind_int(stmt, p++, values[k]);
+            sqlite3_bind_int64(stmt, p++, s.trace_count);
+            sqlite3_bind_int(stmt, p++, s.first_trace);
+            sqlite3_bind_int(stmt, p++, s.last_trace);
+            int rc = sqlite3_step(stmt);
+            sqlite3_reset(stmt);
+            if (rc != SQLITE_DONE) {
+                finalize_all();
+                check_db_error(rc, "Write summary");
+            }
+            if (pass == 0 && sqlite3_changes(db_) > 0) break;
+        }
+    };
+
+    for (size_t i = 0; i < key_summaries.size(); ++i) {
+        for (const auto& entry : key_summaries[i]) {
+            write_row(0, &keys_[i], &entry.first, entry.second);
+        }
+    }
+    size_t pair_idx = 0;
+    for (size_t i = 0; i < keys_.size(); ++i) {
+        for (size_t j = i + 1; j < keys_.size(); ++j, ++pair_idx) {
+            const std::string names[2] = { keys_[i], keys_[j] };
+            for (const auto& entry : pair_summaries[pair_idx]) {
+                const int values[2] = { entry.first.first, entry.first.second };
+                write_row(1, names, values, entry.second);
+            }
+        }
+    }
+    finalize_all();
+}
+
+std::vector<int> TraceMap::find_trace_indices(const std::vector<Optional<int>>& key_values) const {
     std::vector<int> result_indices;
     
     // Определяем, был ли запрошен конкретный номер в последовательности
-    std::optional<int> seq_num;
+    Optional<int> seq_num;
     if (has_seq_number_ && key_values.size() == keys_.size() + 1) {
         seq_num = key_values.back();
     }
@@ -213,7 +486,7 @@ std::vector<int> TraceMap::find_trace_indices(const std::vector<std::optional<in
     }
     
     if (first_clause) { // Если не задано ни одного фильтра, возвращаем всё (или ничего)
-        return {}; // или можно выбрать другое поведение
+        return std::vector<int>(); // или можно выбрать другое поведение
     }
 
     sqlite3_stmt* stmt;
@@ -227,8 +500,7 @@ std::vector<int> TraceMap::find_trace_indices(const std::vector<std::optional<in
     while (sqlite3_step(stmt) == SQLITE_ROW) {
         const char* blob = static_cast<const char*>(sqlite3_column_blob(stmt, 0));
         int blob_size = sqlite3_column_bytes(stmt, 0);
-        auto indices = deserialize_indices(blob, blob_size);
-        combined_indices.insert(combined_indices.end(), indices.begin(), indices.end());
+        deserialize_indices(blob, blob_size, combined_indices);
     }
     sqlite3_finalize(stmt);
 
@@ -236,47 +508,192 @@ std::vector<int> TraceMap::find_trace_indices(const std::vector<std::optional<in
     if (seq_num.has_value() && !combined_indices.empty()) {
         int idx = *seq_num;
         if (idx >= 0 && idx < (int)combined_indices.size()) {
-            return { combined_indices[idx] };
+            return std::vector<int>(1, combined_indices[idx]);
         } else {
-            return {}; // Индекс за пределами диапазона
+            return std::vector<int>(); // Индекс за пределами диапазона
         }
     }
 
     return combined_indices;
 }
 
-std::vector<int> TraceMap::get_unique_values(const std::string& key) const {
+TraceBitmap TraceMap::select_key_range(int key_idx, int min_value, int max_value) const {
+    if (range_stmts_.empty()) {
+        range_stmts_.assign(keys_.size(), nullptr);
+    }
+    sqlite3_stmt*& stmt = range_stmts_[key_idx];
+    if (!stmt) {
+        std::string sql = "SELECT indices FROM trace_map WHERE \"" + keys_[key_idx] + "\" BETWEEN ? AND ?;";
+        check_db_error(sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr), "Prepare range select");
+    }
+    sqlite3_reset(stmt);
+    sqlite3_bind_int(stmt, 1, min_value);
+    sqlite3_bind_int(stmt, 2, max_value);
+
+    // Индексы всех подходящих сборок собираются в плоскую битовую карту - без сортировки
+    std::vector<uint64_t> bits;
+    std::vector<int> indices;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const char* blob = static_cast<const char*>(sqlite3_column_blob(stmt, 0));
+        int blob_size = sqlite3_column_bytes(stmt, 0);
+        indices.clear();
+        deserialize_indices(blob, blob_size, indices);
+        for (int idx : indices) {
+            if (idx < 0) continue;
+            size_t word = static_cast<size_t>(idx) >> 6;
+            if (word >= bits.size()) bits.resize(std::max(word + 1, bits.size() * 2), 0);
+            bits[word] |= uint64_t(1) << (idx & 63);
+        }
+    }
+    sqlite3_reset(stmt);
+    return TraceBitmap::from_bitset(bits);
+}
+
+TraceBitmap TraceMap::select(const std::vector<KeyRange>& predicates) const {
+    return select_batch(std::vector<std::vector<KeyRange>>(1, predicates)).front();
+}
+
+std::vector<TraceBitmap> TraceMap::select_batch(const std::vector<std::vector<KeyRange>>& queries) const {
+    // Уникальные предикаты всех запросов: (индекс ключа, min, max)
+    typedef std::pair<int, std::pair<int, int>> PredicateId;
+    std::vector<PredicateId> unique_predicates;
+    std::vector<std::vector<size_t>> query_predicates(queries.size());
+    for (size_t q = 0; q < queries.size(); ++q) {
+        std::vector<KeyRange> predicates = queries[q];
+        if (predicates.empty()) {
+            predicates.push_back(KeyRange{keys_.front(), std::numeric_limits<int>::min(), std::numeric_limits<int>::max()});
+        }
+        for (const auto& p : predicates) {
+            PredicateId id(find_key_index(p.key), std::make_pair(p.min, p.max));
+            auto it = std::find(unique_predicates.begin(), unique_predicates.end(), id);
+            query_predicates[q].push_back(it - unique_predicates.begin());
+            if (it == unique_predicates.end()) unique_predicates.push_back(id);
+        }
+    }
+
+    // Предикаты читаются из SQLite последовательно (одно соединение)
+    std::vector<TraceBitmap> predicate_maps(unique_predicates.size());
+    for (size_t i = 0; i < unique_predicates.size(); ++i) {
+        const PredicateId& id = unique_predicates[i];
+        if (id.second.first <= id.second.second) {
+            predicate_maps[i] = select_key_range(id.first, id.second.first, id.second.second);
+        }
+    }
+
+    // Пересечения - в памяти, параллельно по запросам
+    std::vector<TraceBitmap> results(queries.size());
+    const int n_queries = static_cast<int>(queries.size());
+    #pragma omp parallel for schedule(dynamic)
+    for (int q = 0; q < n_queries; ++q) {
+        const std::vector<size_t>& ids = query_predicates[q];
+        // Начинаем с самой маленькой карты - промежуточные результаты минимальны
+        std::vector<size_t> order(ids);
+        std::sort(order.begin(), order.end(), [&predicate_maps](size_t a, size_t b) {
+            return predicate_maps[a].cardinality() < predicate_maps[b].cardinality();
+        });
+        TraceBitmap result = predicate_maps[order.front()];
+        for (size_t k = 1; k < order.size() && !result.empty(); ++k) {
+            result &= predicate_maps[order[k]];
+        }
+        results[q] = result;
+    }
+    return results;
+}
+
+std::vector<int> TraceMap::select_indices(const std::vector<KeyRange>& predicates) const {
+    return select(predicates).to_vector();
+}
+
+std::vector<KeySummary> TraceMap::get_key_summary(const std::string& key) const {
     int key_idx = find_key_index(key);
-    
+    std::vector<KeySummary> summary;
+
+    sqlite3_stmt* stmt;
+    if (has_summaries_) {
+        // Поиск по первичному ключу (key_name, value): читаются только строки этого ключа
+        check_db_error(sqlite3_prepare_v2(db_,
+            "SELECT value, trace_count, first_trace, last_trace FROM key_summary WHERE key_name = ? ORDER BY value;",
+            -1, &stmt, nullptr), "Prepare key summary select");
+        sqlite3_bind_text(stmt, 1, keys_[key_idx].c_str(), -1, SQLITE_TRANSIENT);
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            KeySummary s = { sqlite3_column_int(stmt, 0), sqlite3_column_int64(stmt, 1),
+                             sqlite3_column_int(stmt, 2), sqlite3_column_int(stmt, 3) };
+            summary.push_back(s);
+        }
+        sqlite3_finalize(stmt);
+        return summary;
+    }
+
+    // Карта построена до появления сводок: только значения, без статистики
     std::stringstream sql;
     sql << "SELECT DISTINCT \"" << keys_[key_idx] << "\" FROM trace_map ORDER BY \"" << keys_[key_idx] << "\";";
-    
-    sqlite3_stmt* stmt;
     check_db_error(sqlite3_prepare_v2(db_, sql.str().c_str(), -1, &stmt, nullptr), "Prepare unique select");
-    
-    std::vector<int> unique_values;
     while (sqlite3_step(stmt) == SQLITE_ROW) {
-        unique_values.push_back(sqlite3_column_int(stmt, 0));
+        KeySummary s = { sqlite3_column_int(stmt, 0), 0, -1, -1 };
+        summary.push_back(s);
     }
-    
     sqlite3_finalize(stmt);
-    return unique_values;
+    return summary;
 }
 
-std::vector<std::pair<int, int>> TraceMap::get_unique_pairs(const std::string& key1, const std::string& key2) const {
+std::vector<PairSummary> TraceMap::get_pair_summary(const std::string& key1, const std::string& key2) const {
     int idx1 = find_key_index(key1);
     int idx2 = find_key_index(key2);
+    std::vector<PairSummary> summary;
+
+    sqlite3_stmt* stmt;
+    if (has_summaries_ && idx1 != idx2) {
+        // Сводка хранится для пары в порядке ключей карты
+        bool swapped = idx1 > idx2;
+        check_db_error(sqlite3_prepare_v2(db_,
+            "SELECT value1, value2, trace_count, first_trace, last_trace FROM pair_summary "
+            "WHERE key1 = ? AND key2 = ? ORDER BY value1, value2;", -1, &stmt, nullptr), "Prepare pair summary select");
+        sqlite3_bind_text(stmt, 1, keys_[swapped ? idx2 : idx1].c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 2, keys_[swapped ? idx1 : idx2].c_str(), -1, SQLITE_TRANSIENT);
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            int v1 = sqlite3_column_int(stmt, 0);
+            int v2 = sqlite3_column_int(stmt, 1);
+            PairSummary s = { swapped ? v2 : v1, swapped ? v1 : v2, sqlite3_column_int64(stmt, 2),
+                              sqlite3_column_int(stmt, 3), sqlite3_column_int(stmt, 4) };
+            summary.push_back(s);
+        }
+        sqlite3_finalize(stmt);
+        if (swapped) {
+            std::sort(summary.begin(), summary.end(), [](const PairSummary& a, const PairSummary& b) {
+                return a.value1 != b.value1 ? a.value1 < b.value1 : a.value2 < b.value2;
+            });
+        }
+        return summary;
+    }
+
     std::stringstream sql;
     sql << "SELECT DISTINCT \"" << keys_[idx1] << "\", \"" << keys_[idx2] << "\" FROM trace_map ORDER BY \"" << keys_[idx1] << "\", \"" << keys_[idx2] << "\";";
-    sqlite3_stmt* stmt;
     check_db_error(sqlite3_prepare_v2(db_, sql.str().c_str(), -1, &stmt, nullptr), "Prepare unique pairs select");
-    std::vector<std::pair<int, int>> unique_pairs;
     while (sqlite3_step(stmt) == SQLITE_ROW) {
-        int v1 = sqlite3_column_int(stmt, 0);
-        int v2 = sqlite3_column_int(stmt, 1);
-        unique_pairs.emplace_back(v1, v2);
+        PairSummary s = { sqlite3_column_int(stmt, 0), sqlite3_column_int(stmt, 1), 0, -1, -1 };
+        summary.push_back(s);
     }
     sqlite3_finalize(stmt);
+    return summary;
+}
+
+std::vector<int> TraceMap::get_unique_values(const std::string& key) const {
+    std::vector<KeySummary> summary = get_key_summary(key);
+    std::vector<int> unique_values;
+    unique_values.reserve(summary.size());
+    for (const auto& s : summary) {
+        unique_values.push_back(s.value);
+    }
+    return unique_values;
+}
+
+std::vector<std::pair<int, int>> TraceMap::get_unique_pairs(const std::string& key1, const std::string& key2) const {
+    std::vector<PairSummary> summary = get_pair_summary(key1, key2);
+    std::vector<std::pair<int, int>> unique_pairs;
+    unique_pairs.reserve(summary.size());
+    for (const auto& s : summary) {
+        unique_pairs.emplace_back(s.value1, s.value2);
+    }
     return unique_pairs;
 }
 
@@ -300,14 +717,63 @@ int TraceMap::find_key_index(const std::string& key) const {
     return std::distance(keys_.begin(), it);
 }
 
+bool TraceMap::table_exists(const char* name) const {
+    sqlite3_stmt* stmt;
+    check_db_error(sqlite3_prepare_v2(db_, "SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = ?;", -1, &stmt, nullptr),
+                   "Prepare table lookup");
+    sqlite3_bind_text(stmt, 1, name, -1, SQLITE_TRANSIENT);
+    bool exists = sqlite3_step(stmt) == SQLITE_ROW;
+    sqlite3_finalize(stmt);
+    return exists;
+}
+
+int TraceMap::storage_version() const {
+    sqlite3_stmt* stmt;
+    check_db_error(sqlite3_prepare_v2(db_, "PRAGMA user_version;", -1, &stmt, nullptr), "Prepare user_version");
+    int version = (sqlite3_step(stmt) == SQLITE_ROW) ? sqlite3_column_int(stmt, 0) : 0;
+    sqlite3_finalize(stmt);
+    return version;
+}
+
+void TraceMap::set_storage_version(int version) {
+    std::string sql = "PRAGMA user_version = " + std::to_string(version) + ";";
+    check_db_error(sqlite3_exec(db_, sql.c_str(), nullptr, nullptr, nullptr), "Set user_version");
+}
+
+std::string TraceMap::read_meta(const char* name) const {
+    sqlite3_stmt* stmt;
+    check_db_error(sqlite3_prepare_v2(db_, "SELECT value FROM map_meta WHERE name = ?;", -1, &stmt, nullptr), "Prepare meta lookup");
+    sqlite3_bind_text(stmt, 1, name, -1, SQLITE_TRANSIENT);
+    std::string value;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        value = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+    }
+    sqlite3_finalize(stmt);
+    return value;
+}
+
+void TraceMap::write_meta(const char* name, const std::string& value) {
+    sqlite3_stmt* stmt;
+    check_db_error(sqlite3_prepare_v2(db_, "INSERT OR REPLACE INTO map_meta (name, value) VALUES (?, ?);", -1, &stmt, nullptr),
+                   "Prepare meta write");
+    sqlite3_bind_text(stmt, 1, name, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 2, value.c_str(), -1, SQLITE_TRANSIENT);
+    int rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    check_db_error(rc == SQLITE_DONE ? SQLITE_OK : rc, "Write meta");
+}
+
 std::vector<char> TraceMap::serialize_indices(const std::vector<int>& indices) {
-    std::vector<char> blob(indices.size() * sizeof(int));
-    memcpy(blob.data(), indices.data(), blob.size());
-    return blob;
+    return encode_posting_list(indices);
 }
 
-std::vector<int> TraceMap::deserialize_indices(const char* data, int size) {
-    std::vector<int> indices(size / sizeof(int));
-    memcpy(indices.data(), data, size);
-    return indices;
-}
\ No newline at end of file
+void TraceMap::deserialize_indices(const char* data, int size, std::vector<int>& out) const {
+    if (compressed_indices_) {
+        decode_posting_list(data, size, out);
+        return;
+    }
+    // Карты, построенные до сжатия: массив int в порядке байтов машины
+    size_t old_size = out.size();
+    out.resize(old_size + size / sizeof(int));
+    memcpy(out.data() + old_size, data, (size / sizeof(int)) * sizeof(int));
+}
@@ -3,19 +3,70 @@
 #include <string>
 #include <vector>
 #include "Optional.hpp"
+#include "SegyUtil.hpp"
+#include "TraceBitmap.hpp"
 #include <memory>
+#include <cstddef>
+#include <limits>
+#include <map>
 
 // Прямое объявление, чтобы не включать заголовок sqlite3 в hpp-файл
 struct sqlite3;
+struct sqlite3_stmt;
 class SegyReader;
+class TraceAggregator;
+
+/**
+ * @brief Предикат диапазона по ключу карты: min <= значение <= max (границы включаются).
+ */
+struct KeyRange {
+    std::string key;
+    int min;
+    int max;
+
+    static KeyRange equal(const std::string& key, int value) { return KeyRange{key, value, value}; }
+    static KeyRange between(const std::string& key, int lo, int hi) { return KeyRange{key, lo, hi}; }
+    // Для value == INT_MIN диапазон пуст (min > max)
+    static KeyRange less_than(const std::string& key, int value) {
+        if (value == std::numeric_limits<int>::min()) return KeyRange{key, 0, -1};
+        return KeyRange{key, std::numeric_limits<int>::min(), value - 1};
+    }
+    static KeyRange at_least(const std::string& key, int value) {
+        return KeyRange{key, value, std::numeric_limits<int>::max()};
+    }
+};
+
+/**
+ * @brief Сводка по одному значению ключа: число трасс, минимальный и максимальный индекс трассы.
+ */
+struct KeySummary {
+    int value;
+    int64_t trace_count;
+    int first_trace;
+    int last_trace;
+};
+
+/**
+ * @brief Сводка по паре значений двух ключей.
+ */
+struct PairSummary {
+    int value1;
+    int value2;
+    int64_t trace_count;
+    int first_trace;
+    int last_trace;
+};
 
 /**
  * @class TraceMap
  * @brief Создает и управляет картой трасс из SEG-Y файла, используя SQLite для хранения на диске.
  * 
  * Этот класс решает две основные проблемы при работе с большими SEG-Y файлами:
- * 1. Медленное создание карты: используется OpenMP для параллельного сканирования заголовков.
+ * 1. Медленное создание карты: файл читается большими блоками с двойной буферизацией,
+ *    заголовки блока разбираются параллельно (OpenMP) пакетным извлечением полей,
+ *    группировка выполняется радикс-сортировкой плоских записей (TraceAggregator).
  * 2. Высокое потребление ОЗУ: карта хранится в базе данных SQLite на диске, а не в памяти.
+ *    Индексы трасс каждой сборки хранятся сжатыми списками (серии прогрессий или упакованные разности).
  */
 class TraceMap {
 public:
@@ -34,9 +85,31 @@ public:
     /**
      * @brief Сканирует SEG-Y файл и строит карту трасс в базе данных SQLite.
      * Если карта в БД уже существует, она будет полностью перезаписана.
+     * Файл читается ровно один раз последовательно: значение поля сортировки
+     * извлекается вместе с ключами, сортировка сборок выполняется в памяти.
      * @param reader Экземпляр SegyReader для доступа к файлу.
+     * @param sorting_key Поле для сортировки трасс внутри сборки (по умолчанию - первый ключ).
+     * @param progress Необязательный обратный вызов прогресса.
      */
-    void build_map(const SegyReader& reader, const std::string& sorting_key = "");
+    void build_map(const SegyReader& reader, const std::string& sorting_key = "",
+                   const ProgressCallback& progress = ProgressCallback());
+
+    /**
+     * @brief Дописывает в карту трассы, появившиеся в файле после последнего построения.
+     *
+     * Читаются только заголовки трасс [indexed_trace_count(), reader.num_traces()):
+     * новые индексы вливаются в списки существующих сборок, сводки обновляются.
+     * Порядок внутри сборки - по полю сортировки, сохраненному build_map в таблице map_meta
+     * (для карт без этой записи - по первому ключу).
+     * @return Число добавленных трасс.
+     * @throws std::logic_error, если карта построена без сводок (нужен build_map).
+     */
+    int append_traces(const SegyReader& reader, const ProgressCallback& progress = ProgressCallback());
+
+    /**
+     * @brief Число трасс, покрытых картой (индекс последней трассы + 1); -1 для карт без сводок.
+     */
+    int indexed_trace_count() const;
 
     /**
      * @brief Находит индексы трасс, соответствующих заданным значениям ключей.
@@ -46,6 +119,39 @@ public:
      */
     std::vector<int> find_trace_indices(const std::vector<Optional<int>>& key_values) const;
 
+    /**
+     * @brief Выбирает трассы, удовлетворяющие всем предикатам (логическое И).
+     *
+     * Каждый предикат вычисляется одним диапазонным запросом по индексу ключа и превращается
+     * в сжатую битовую карту; пересечение предикатов выполняется в памяти.
+     * Например, "FieldRecord in [a,b] AND offset < 2000":
+     * select({KeyRange::between("FieldRecord", a, b), KeyRange::less_than("offset", 2000)}).
+     * Пустой список предикатов выбирает все трассы карты.
+     */
+    TraceBitmap select(const std::vector<KeyRange>& predicates) const;
+
+    /**
+     * @brief Пакетный вариант select: одинаковые предикаты разных запросов вычисляются один раз.
+     */
+    std::vector<TraceBitmap> select_batch(const std::vector<std::vector<KeyRange>>& queries) const;
+
+    /**
+     * @brief То же, что select, но возвращает индексы трасс по возрастанию.
+     */
+    std::vector<int> select_indices(const std::vector<KeyRange>& predicates) const;
+
+    /**
+     * @brief Сводка по значениям ключа (value, count, first/last trace), отсортированная по значению.
+     * Читается из таблицы key_summary, материализованной в build_map, без сканирования карты.
+     * Для карт, построенных до появления сводок, заполняются только значения.
+     */
+    std::vector<KeySummary> get_key_summary(const std::string& key) const;
+
+    /**
+     * @brief Сводка по парам значений двух ключей, отсортированная по (key1, key2).
+     */
+    std::vector<PairSummary> get_pair_summary(const std::string& key1, const std::string& key2) const;
+
     /**
      * @brief Получает все уникальные значения для указанного ключа из карты.
      * @param key Имя ключа (должно быть одним из ключей, переданных в конструктор).
@@ -61,6 +167,11 @@ public:
      */
     std::vector<std::pair<int, int>> get_unique_pairs(const std::string& key1, const std::string& key2) const;
 
+    /**
+     * @brief Лимит памяти агрегации в build_map; при превышении отсортированные серии сбрасываются на диск.
+     */
+    void set_aggregation_memory_limit(size_t bytes) { aggregation_memory_limit_ = bytes; }
+
     const std::string& db_path() const { return db_path_; }
     const std::vector<std::string>& keys() const { return keys_; }
 
@@ -70,12 +181,35 @@ private:
     void check_db_error(int error_code, const char* context) const;
     int find_key_index(const std::string& key) const;
 
-    // Хелперы для сериализации/десериализации вектора индексов в/из BLOB
+    bool table_exists(const char* name) const;
+    TraceBitmap select_key_range(int key_idx, int min_value, int max_value) const;
+    void scan_headers(const SegyReader& reader, int first_trace, int n_traces, const std::string& sort_key,
+                      TraceAggregator& aggregator, const ProgressCallback& progress) const;
+    void write_groups(TraceAggregator& aggregator, const SegyReader& reader, const std::string& sort_key,
+                      bool append, int64_t n_traces, const ProgressCallback& progress);
+    void write_summaries(const std::vector<std::map<int, KeySummary>>& key_summaries,
+                         const std::vector<std::map<std::pair<int, int>, KeySummary>>& pair_summaries, bool merge);
+    int storage_version() const;
+    void set_storage_version(int version);
+    std::string read_meta(const char* name) const;
+    void write_meta(const char* name, const std::string& value);
+
+    // Хелперы для сериализации/десериализации вектора индексов в/из BLOB (см. PostingList.hpp).
+    // Десериализация дописывает индексы в конец out.
     static std::vector<char> serialize_indices(const std::vector<int>& indices);
-    static std::vector<int> deserialize_indices(const char* data, int size);
+    void deserialize_indices(const char* data, int size, std::vector<int>& out) const;
+
+    // PRAGMA user_version: 0 - индексы хранятся несжатым массивом int, 1 - сжатые списки,
+    // 2 - дополнительно материализованы сводки key_summary/pair_summary
+    static const int STORAGE_VERSION_COMPRESSED = 1;
+    static const int STORAGE_VERSION_SUMMARIES = 2;
 
     std::string db_path_;
     std::vector<std::string> keys_;
     sqlite3* db_ = nullptr;
     bool has_seq_number_ = false; // Флаг для специальной обработки 'sequence_number'
+    size_t aggregation_memory_limit_ = size_t(1) << 30;
+    bool compressed_indices_ = true;
+    bool has_summaries_ = true;
+    mutable std::vector<sqlite3_stmt*> range_stmts_; // подготовленные диапазонные запросы по каждому ключу
 };
\ No newline at end of file
@@ -0,0 +1,162 @@
+#include "TraceOrdering.hpp"
+#include "TraceAggregator.hpp"
+#include "HeaderExtractor.hpp"
+#include "SegyReader.hpp"
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+// Версия 2: после перестановки хранятся значения ключей в логическом порядке
+const char ORDERING_MAGIC[8] = { 'S', 'G', 'Y', 'O', 'R', 'D', 'R', '2' };
+
+} // namespace
+
+TraceOrdering TraceOrdering::identity(int n_traces) {
+    TraceOrdering ordering;
+    ordering.permutation_.resize(std::max(0, n_traces));
+    for (int i = 0; i < n_traces; ++i) ordering.permutation_[i] = i;
+    return ordering;
+}
+
+TraceOrdering TraceOrdering::from_columns(const std::vector<std::string>& keys,
+                                          const std::vector<std::vector<int32_t>>& columns) {
+    if (keys.empty() || keys.size() != columns.size()) {
+        throw std::invalid_argument("TraceOrdering needs one column per key.");
+    }
+    const size_t n_traces = columns[0].size();
+    const int n_keys = static_cast<int>(keys.size());
+    for (const auto& column : columns) {
+        if (column.size() != n_traces) throw std::invalid_argument("TraceOrdering columns differ in length.");
+    }
+
+    // Плоские записи [ключ 0, ..., ключ K-1, индекс трассы] и та же радикс-сортировка, что в TraceAggregator
+    const int words = n_keys + 1;
+    std::vector<int32_t> records(n_traces * words);
+    std::vector<int32_t> scratch(records.size());
+    #pragma omp parallel for schedule(static)
+    for (long long i = 0; i < static_cast<long long>(n_traces); ++i) {
+        int32_t* rec = records.data() + i * words;
+        for (int k = 0; k < n_keys; ++k) rec[k] = columns[k][i];
+        rec[n_keys] = static_cast<int32_t>(i);
+    }
+    TraceAggregator::radix_sort(records.data(), scratch.data(), n_traces, words, n_keys - 1);
+
+    TraceOrdering ordering;
+    ordering.keys_ = keys;
+    ordering.permutation_.resize(n_traces);
+    ordering.sorted_keys_.resize(n_traces * n_keys);
+    #pragma omp parallel for schedule(static)
+    for (long long i = 0; i < static_cast<long long>(n_traces); ++i) {
+        const int32_t* rec = records.data() + i * words;
+        std::copy(rec, rec + n_keys, ordering.sorted_keys_.begin() + i * n_keys);
+        ordering.permutation_[i] = rec[n_keys];
+    }
+    return ordering;
+}
+
+TraceOrdering TraceOrdering::from_header_keys(const SegyReader& reader, const std::vector<std::string>& keys,
+                                              const ProgressCallback& progress) {
+    HeaderColumns columns = read_header_columns(reader, keys, progress);
+    return from_columns(keys, columns.columns);
+}
+
+void TraceOrdering::append_traces(const SegyReader& reader) {
+    const int first = size();
+    const int added = reader.num_traces() - first;
+    if (added <= 0) return;
+    if (keys_.empty()) {
+        // Исходный порядок файла
+        for (int i = first; i < reader.num_traces(); ++i) permutation_.push_back(i);
+        return;
+    }
+
+    // Новые трассы сортируются отдельно; их индексы - относительно first
+    TraceOrdering tail = from_columns(keys_, read_header_columns(reader, resolve_trace_fields(keys_), first, added));
+    const size_t n_keys = keys_.size();
+    std::vector<int> permutation;
+    std::vector<int32_t> sorted_keys;
+    permutation.reserve(permutation_.size() + added);
+    sorted_keys.reserve(sorted_keys_.size() + tail.sorted_keys_.size());
+    size_t a = 0, b = 0;
+    const size_t n_old = permutation_.size(), n_new = tail.permutation_.size();
+    while (a < n_old || b < n_new) {
+        // При равных ключах первой идет старая трасса: ее физический индекс меньше
+        bool take_new = a == n_old ||
+            (b < n_new && std::lexicographical_compare(tail.sorted_keys_.begin() + b * n_keys, tail.sorted_keys_.begin() + (b + 1) * n_keys,
+                                                       sorted_keys_.begin() + a * n_keys, sorted_keys_.begin() + (a + 1) * n_keys));
+        if (take_new) {
+            permutation.push_back(first + tail.permutation_[b]);
+            sorted_keys.insert(sorted_keys.end(), tail.sorted_keys_.begin() + b * n_keys, tail.sorted_keys_.begin() + (b + 1) * n_keys);
+            ++b;
+        } else {
+            permutation.push_back(permutation_[a]);
+            sorted_keys.insert(sorted_keys.end(), sorted_keys_.begin() + a * n_keys, sorted_keys_.begin() + (a + 1) * n_keys);
+            ++a;
+        }
+    }
+    permutation_.swap(permutation);
+    sorted_keys_.swap(sorted_keys);
+}
+
+std::vector<int> TraceOrdering::physical_range(int first, int count) const {
+    first = std::max(0, first);
+    int end = std::min(size(), first + std::max(0, count));
+    if (first >= end) return {};
+    return std::vector<int>(permutation_.begin() + first, permutation_.begin() + end);
+}
+
+void TraceOrdering::save(const std::string& path) const {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    uint32_t n_keys = static_cast<uint32_t>(keys_.size());
+    uint32_t n_traces = static_cast<uint32_t>(permutation_.size());
+    out.write(ORDERING_MAGIC, sizeof(ORDERING_MAGIC));
+    out.write(reinterpret_cast<const char*>(&n_keys), sizeof(n_keys));
+    for (const auto& key : keys_) out << key << '\n';
+    out.write(reinterpret_cast<const char*>(&n_traces), sizeof(n_traces));
+    out.write(reinterpret_cast<const char*>(permutation_.data()), permutation_.size() * sizeof(int));
+    out.write(reinterpret_cast<const char*>(sorted_keys_.data()), sorted_keys_.size() * sizeof(int32_t));
+    if (!out) {
+        throw std::runtime_error("Cannot write trace ordering: " + path);
+    }
+}
+
+bool TraceOrdering::load(const std::string& path, int expected_traces) {
+    std::ifstream in(path, std::ios::binary);
+    char magic[sizeof(ORDERING_MAGIC)];
+    uint32_t n_keys = 0, n_traces = 0;
+    if (!in.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), ORDERING_MAGIC)) return false;
+    if (!in.read(reinterpret_cast<char*>(&n_keys), sizeof(n_keys)) || n_keys > 64) return false;
+    std::vector<std::string> keys(n_keys);
+    for (auto& key : keys) {
+        if (!std::getline(in, key)) return false;
+    }
+    if (!in.read(reinterpret_cast<char*>(&n_traces), sizeof(n_traces)) ||
+        static_cast<int>(n_traces) != expected_traces) {
+        return false;
+    }
+    std::vector<int> permutation(n_traces);
+    if (!in.read(reinterpret_cast<char*>(permutation.data()), permutation.size() * sizeof(int))) return false;
+    std::vector<int32_t> sorted_keys(static_cast<size_t>(n_traces) * n_keys);
+    if (!in.read(reinterpret_cast<char*>(sorted_keys.data()), sorted_keys.size() * sizeof(int32_t))) return false;
+    keys_.swap(keys);
+    permutation_.swap(permutation);
+    sorted_keys_.swap(sorted_keys);
+    return true;
+}
+
+std::vector<TraceReadRun> coalesce_trace_reads(std::vector<int> physical, int max_gap) {
+    std::sort(physical.begin(), physical.end());
+    physical.erase(std::unique(physical.begin(), physical.end()), physical.end());
+
+    std::vector<TraceReadRun> runs;
+    for (int trace : physical) {
+        if (!runs.empty() && trace - (runs.back().first_trace + runs.back().count) <= max_gap) {
+            runs.back().count = trace - runs.back().first_trace + 1;
+        } else {
+            runs.push_back(TraceReadRun{ trace, 1 });
+        }
+    }
+    return runs;
+}
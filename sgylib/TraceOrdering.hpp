@@ -0,0 +1,83 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "SegyUtil.hpp"
+
+class SegyReader;
+
+/**
+ * @brief Непрерывный диапазон физических трасс для одного чтения.
+ */
+struct TraceReadRun {
+    int first_trace;
+    int count;
+};
+
+/**
+ * @class TraceOrdering
+ * @brief Виртуальный порядок трасс: перестановка "логический индекс -> физическая трасса".
+ *
+ * Позволяет смотреть файл, отсортированный по произвольным полям заголовка
+ * (например, CDP, затем offset), без записи пересортированной копии.
+ * Перестановка строится по колонкам заголовков параллельной стабильной
+ * радикс-сортировкой: при равных ключах сохраняется исходный порядок трасс.
+ * Значения ключей хранятся в логическом порядке (4 байта на ключ и трассу), чтобы
+ * дописанные в файл трассы встраивались слиянием, без повторного чтения всех заголовков.
+ */
+class TraceOrdering {
+public:
+    TraceOrdering() {}
+
+    // Исходный порядок файла
+    static TraceOrdering identity(int n_traces);
+
+    /**
+     * @brief Порядок по колонкам ключей (columns[k][i] - значение k-го ключа трассы i).
+     */
+    static TraceOrdering from_columns(const std::vector<std::string>& keys,
+                                      const std::vector<std::vector<int32_t>>& columns);
+
+    /**
+     * @brief Читает заголовки файла и строит порядок по ключам.
+     * @throws std::invalid_argument для неизвестного поля.
+     */
+    static TraceOrdering from_header_keys(const SegyReader& reader, const std::vector<std::string>& keys,
+                                          const ProgressCallback& progress = ProgressCallback());
+
+    /**
+     * @brief Встраивает трассы [size(), reader.num_traces()), дописанные в файл после построения.
+     * Читаются только их заголовки; отсортированные новые трассы сливаются с текущим порядком
+     * (при равных ключах - после старых), результат совпадает с полным построением.
+     */
+    void append_traces(const SegyReader& reader);
+
+    int size() const { return static_cast<int>(permutation_.size()); }
+    int physical(int logical) const { return permutation_[logical]; }
+    const std::vector<int>& permutation() const { return permutation_; }
+    const std::vector<std::string>& keys() const { return keys_; }
+
+    // Физические индексы логического диапазона [first, first + count)
+    std::vector<int> physical_range(int first, int count) const;
+
+    // Сохранение в двоичный файл (для кэша) и загрузка; load возвращает false при несовпадении
+    void save(const std::string& path) const;
+    bool load(const std::string& path, int expected_traces);
+
+private:
+    std::vector<std::string> keys_;
+    std::vector<int> permutation_;
+    std::vector<int32_t> sorted_keys_; // ключи трассы permutation_[i] - в [i * K, (i + 1) * K)
+};
+
+// Сколько ненужных трасс можно прочитать, чтобы объединить два чтения в одно
+const int READ_GAP_TRACES = 16;
+
+/**
+ * @brief Объединяет физические трассы в отсортированные непрерывные серии чтения.
+ *
+ * Индексы сортируются и дедуплицируются; соседние трассы, между которыми не более
+ * max_gap ненужных, попадают в одну серию - лишние байты дешевле отдельного системного вызова.
+ */
+std::vector<TraceReadRun> coalesce_trace_reads(std::vector<int> physical, int max_gap);
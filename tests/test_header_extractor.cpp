@@ -0,0 +1,140 @@
+// Проверки HeaderExtractor: пакетное извлечение полей (AVX2, если доступен) совпадает со
+// скалярным путем и прямым чтением байтов, в том числе для полей у краев заголовка.
+// Запускается через ctest.
+
+#include "HeaderExtractor.hpp"
+#include "SegyUtil.hpp"
+#include "TraceFieldMap.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+int failures = 0;
+
+#define CHECK(condition)                                                                    \
+    do {                                                                                    \
+        if (!(condition)) {                                                                 \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            ++failures;                                                                     \
+        }                                                                                   \
+    } while (0)
+
+// Блок из n_traces записей по stride байт, заполненный псевдослучайными байтами
+std::vector<uint8_t> random_block(int n_traces, size_t stride) {
+    std::vector<uint8_t> block(n_traces * stride);
+    uint32_t state = 12345u;
+    for (uint8_t& b : block) {
+        state = state * 1664525u + 1013904223u;
+        b = static_cast<uint8_t>(state >> 24);
+    }
+    return block;
+}
+
+int32_t read_field(const uint8_t* header, const FieldInfo& field) {
+    return field.size == 2 ? static_cast<int32_t>(get_i16_be(header, field.offset)) : get_i32_be(header, field.offset);
+}
+
+void check_extract(int n_traces, size_t stride, const std::vector<FieldInfo>& fields) {
+    const std::vector<uint8_t> block = random_block(n_traces, stride);
+    std::vector<std::vector<int32_t>> simd(fields.size(), std::vector<int32_t>(n_traces, -1));
+    std::vector<std::vector<int32_t>> scalar(fields.size(), std::vector<int32_t>(n_traces, -1));
+    std::vector<int32_t*> simd_out, scalar_out;
+    for (size_t k = 0; k < fields.size(); ++k) {
+        simd_out.push_back(simd[k].data());
+        scalar_out.push_back(scalar[k].data());
+    }
+    extract_header_fields(block.data(), n_traces, stride, fields, simd_out.data());
+    extract_header_fields_scalar(block.data(), n_traces, stride, fields, scalar_out.data());
+
+    int mismatches = 0;
+    for (size_t k = 0; k < fields.size(); ++k) {
+        for (int t = 0; t < n_traces; ++t) {
+            int32_t want = read_field(block.data() + t * stride, fields[k]);
+            if (simd[k][t] != want || scalar[k][t] != want) ++mismatches;
+        }
+    }
+    CHECK(mismatches == 0);
+}
+
+// Поля у обоих краев заголовка (байты 1-2, 1-4, 237-240, 239-240), невыровненные
+// и подряд идущие 2-байтовые поля
+std::vector<FieldInfo> edge_fields() {
+    std::vector<FieldInfo> fields;
+    const int offsets_2[] = { 1, 2, 3, 29, 31, 71, 115, 117, 237, 239 };
+    const int offsets_4[] = { 1, 2, 5, 9, 21, 181, 189, 233, 237 };
+    for (int offset : offsets_2) {
+        FieldInfo field;
+        field.offset = offset;
+        field.size = 2;
+        fields.push_back(field);
+    }
+    for (int offset : offsets_4) {
+        FieldInfo field;
+        field.offset = offset;
+        field.size = 4;
+        fields.push_back(field);
+    }
+    return fields;
+}
+
+void test_simd_matches_scalar() {
+    std::printf("header extractor: %s\n", header_extractor_uses_simd() ? "AVX2" : "scalar");
+    const std::vector<FieldInfo> fields = edge_fields();
+    // Блок одних заголовков и трассы с отсчетами; число трасс не кратно ширине вектора
+    const size_t strides[] = { 240, 240 + 4 * 25, 240 + 2 * 7 + 1 };
+    const int counts[] = { 1, 7, 8, 9, 1000, 1003 };
+    for (size_t stride : strides) {
+        for (int n : counts) {
+            check_extract(n, stride, fields);
+            check_extract(n, stride, std::vector<FieldInfo>(1, fields.front()));
+        }
+    }
+}
+
+void test_columns_by_name() {
+    const int n_traces = 37;
+    const std::vector<uint8_t> block = random_block(n_traces, 240);
+    const std::vector<std::string> names = { "FieldRecord", "offset", "TRACE_SAMPLE_COUNT", "CDP_X" };
+    HeaderColumns columns = extract_header_columns(block.data(), n_traces, 240, names);
+    const std::vector<FieldInfo> fields = resolve_trace_fields(names);
+    CHECK(fields.size() == names.size());
+    for (size_t k = 0; k < names.size(); ++k) {
+        CHECK(fields[k].offset == TraceFieldOffsets.at(names[k]).offset);
+        const std::vector<int32_t>& column = columns.column(names[k]);
+        CHECK(column.size() == static_cast<size_t>(n_traces));
+        for (int t = 0; t < n_traces && t < static_cast<int>(column.size()); ++t) {
+            CHECK(column[t] == get_trace_field_value(block.data() + t * 240, names[k]));
+        }
+    }
+
+    bool thrown = false;
+    try {
+        resolve_trace_fields({ "NoSuchField" });
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
+
+} // namespace
+
+int main() {
+    try {
+        test_simd_matches_scalar();
+        test_columns_by_name();
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "test_header_extractor: %s\n", e.what());
+        ++failures;
+    }
+    if (failures) {
+        std::fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    std::printf("test_header_extractor: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,151 @@
+// Проверки HeaderPatcher на синтетическом файле: патч меняет только заданные поля заголовков,
+// отсчеты остаются нетронутыми, undo_header_patch по журналу возвращает файл байт в байт.
+// Запускается через ctest; файлы пишутся в текущий каталог.
+
+#include "HeaderPatcher.hpp"
+#include "HeaderExtractor.hpp"
+#include "SegyReader.hpp"
+#include "SegyWriter.hpp"
+#include "SegyUtil.hpp"
+#include "BinFieldMap.hpp"
+#include "TraceFieldMap.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+
+const int N_TRACES = 100;
+const int N_SAMPLES = 20;
+const int TRACE_HEADER_SIZE = 240;
+int failures = 0;
+
+#define CHECK(condition)                                                                    \
+    do {                                                                                    \
+        if (!(condition)) {                                                                 \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            ++failures;                                                                     \
+        }                                                                                   \
+    } while (0)
+
+void write_test_file(const std::string& path) {
+    std::vector<uint8_t> bin_header(400, 0);
+    set_i16_be(bin_header.data(), BinFieldOffsets.at("SampleInterval").offset, 2000);
+    set_i16_be(bin_header.data(), BinFieldOffsets.at("SamplesPerTrace").offset, N_SAMPLES);
+    SegyWriter writer(path, std::vector<char>(3200, ' '), bin_header, N_SAMPLES, 2.0f);
+    std::vector<uint8_t> header(TRACE_HEADER_SIZE);
+    std::vector<float> samples(N_SAMPLES);
+    for (int t = 0; t < N_TRACES; ++t) {
+        std::fill(header.begin(), header.end(), 0);
+        set_i32_be(header.data(), TraceFieldOffsets.at("FieldRecord").offset, 1 + t / 10);
+        set_i32_be(header.data(), TraceFieldOffsets.at("CDP").offset, 1000 + t);
+        set_i16_be(header.data(), TraceFieldOffsets.at("ElevationScalar").offset, 1);
+        set_i16_be(header.data(), TraceFieldOffsets.at("TRACE_SAMPLE_COUNT").offset, N_SAMPLES);
+        for (int s = 0; s < N_SAMPLES; ++s) samples[s] = static_cast<float>(t * N_SAMPLES + s);
+        writer.write_trace(header, samples);
+    }
+    writer.close();
+}
+
+std::vector<char> read_file(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::vector<char>((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+void write_file(const std::string& path, const std::vector<char>& data) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(data.data(), data.size());
+}
+
+// Каждая третья трасса и серия подряд идущих 40..59: CDP = -t, ElevationScalar = -10
+HeaderPatch make_patch() {
+    HeaderPatch patch;
+    for (int t = 0; t < N_TRACES; ++t) {
+        if (t % 3 == 0 || (t >= 40 && t < 60)) patch.traces.push_back(t);
+    }
+    patch.fields = resolve_trace_fields({ "CDP", "ElevationScalar" });
+    patch.values.resize(2);
+    for (int t : patch.traces) {
+        patch.values[0].push_back(-t);
+        patch.values[1].push_back(-10);
+    }
+    return patch;
+}
+
+// Возвращает число вызовов pwrite
+int64_t check_patch(const std::string& path, const std::vector<char>& original, const HeaderPatchOptions& options) {
+    const HeaderPatch patch = make_patch();
+    write_file(path, original);
+    std::remove(options.journal_path.c_str());
+
+    HeaderPatchStats stats;
+    CHECK(apply_header_patch(path, patch, options, &stats));
+    CHECK(stats.traces == static_cast<int64_t>(patch.traces.size()));
+
+    // Отличаться могут только байты патчируемых полей патчированных трасс
+    const std::vector<char> patched = read_file(path);
+    CHECK(patched.size() == original.size());
+    if (patched.size() != original.size()) return stats.write_calls;
+    std::vector<char> expected = original;
+    {
+        SegyReader reader(path);
+        for (size_t i = 0; i < patch.traces.size(); ++i) {
+            uint8_t* header = reinterpret_cast<uint8_t*>(expected.data() + reader.trace_offset(patch.traces[i]));
+            set_i32_be(header, patch.fields[0].offset, patch.values[0][i]);
+            set_i16_be(header, patch.fields[1].offset, static_cast<int16_t>(patch.values[1][i]));
+        }
+        CHECK(patched == expected);
+
+        std::vector<uint8_t> header = reader.get_trace_header(42);
+        CHECK(get_trace_field_value(header.data(), "CDP") == -42);
+        CHECK(get_trace_field_value(header.data(), "ElevationScalar") == -10);
+        header = reader.get_trace_header(43);
+        CHECK(get_trace_field_value(header.data(), "FieldRecord") == 5);
+        header = reader.get_trace_header(1);
+        CHECK(get_trace_field_value(header.data(), "CDP") == 1001);
+    }
+
+    CHECK(undo_header_patch(path, options.journal_path) == static_cast<int64_t>(patch.traces.size()));
+    CHECK(read_file(path) == original);
+    std::remove(options.journal_path.c_str());
+    return stats.write_calls;
+}
+
+} // namespace
+
+int main() {
+    const std::string source = "test_header_patcher_source.sgy";
+    const std::string path = "test_header_patcher.sgy";
+    try {
+        write_test_file(source);
+        const std::vector<char> original = read_file(source);
+
+        HeaderPatchOptions options;
+        options.journal_path = "test_header_patcher.undo";
+        // По умолчанию: серии читаются целиком, каждый заголовок пишется отдельно
+        const int64_t n_patched = static_cast<int64_t>(make_patch().traces.size());
+        CHECK(check_patch(path, original, options) == n_patched);
+        // Без захвата ненужных трасс между изменяемыми при чтении
+        options.read_max_gap = 0;
+        check_patch(path, original, options);
+        // Запись соседних заголовков одним pwrite вместе с отсчетами между ними
+        options.read_max_gap = 16;
+        options.write_max_gap = static_cast<size_t>(4 * N_SAMPLES);
+        CHECK(check_patch(path, original, options) < n_patched);
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "test_header_patcher: %s\n", e.what());
+        ++failures;
+    }
+    std::remove(source.c_str());
+    std::remove(path.c_str());
+    if (failures) {
+        std::fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    std::printf("test_header_patcher: all checks passed\n");
+    return 0;
+}
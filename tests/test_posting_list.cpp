@@ -0,0 +1,158 @@
+// Проверки PostingList: кодирование и декодирование списков индексов трасс обоими
+// представлениями (серии прогрессий и упакованные разности), граничные случаи и
+// обнаружение поврежденных данных. Запускается через ctest.
+
+#include "PostingList.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+const char TAG_RUNS = 0x01;
+const char TAG_PACKED = 0x02;
+int failures = 0;
+
+#define CHECK(condition)                                                                    \
+    do {                                                                                    \
+        if (!(condition)) {                                                                 \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            ++failures;                                                                     \
+        }                                                                                   \
+    } while (0)
+
+// Кодирует, декодирует в непустой вектор (декодирование дописывает) и сравнивает;
+// возвращает BLOB для проверки выбранного представления
+std::vector<char> round_trip(const std::vector<int>& indices) {
+    std::vector<char> blob = encode_posting_list(indices);
+    CHECK(!blob.empty());
+    CHECK(posting_list_length(blob.data(), blob.size()) == indices.size());
+
+    std::vector<int> decoded = { -7, -8 };
+    decode_posting_list(blob.data(), blob.size(), decoded);
+    CHECK(decoded.size() == indices.size() + 2);
+    CHECK(decoded.size() >= 2 && decoded[0] == -7 && decoded[1] == -8);
+    CHECK(std::vector<int>(decoded.begin() + std::min<size_t>(2, decoded.size()), decoded.end()) == indices);
+    return blob;
+}
+
+std::vector<int> progression(int start, int step, int count) {
+    std::vector<int> v;
+    for (int k = 0; k < count; ++k) v.push_back(start + k * step);
+    return v;
+}
+
+std::vector<int> random_indices(size_t count, uint32_t max_value, uint32_t seed) {
+    std::vector<int> v;
+    uint32_t state = seed;
+    for (size_t k = 0; k < count; ++k) {
+        state = state * 1664525u + 1013904223u;
+        v.push_back(static_cast<int>(state % (max_value + 1ull)));
+    }
+    return v;
+}
+
+void test_edge_cases() {
+    round_trip(std::vector<int>());
+    round_trip({ 0 });
+    round_trip({ 123456789 });
+    round_trip({ std::numeric_limits<int>::max() });
+    round_trip({ 5, 5, 5, 5 }); // шаг 0
+    round_trip({ 0, std::numeric_limits<int>::max(), 0, std::numeric_limits<int>::max() });
+}
+
+void test_arithmetic_runs() {
+    // Регулярная геометрия: одна прогрессия кодируется несколькими байтами
+    std::vector<char> blob = round_trip(progression(0, 1, 100000));
+    CHECK(blob[0] == TAG_RUNS && blob.size() <= 16);
+    blob = round_trip(progression(17, 250, 4000));
+    CHECK(blob[0] == TAG_RUNS && blob.size() <= 16);
+    // Сборка, отсортированная по убыванию индекса (например, по offset)
+    blob = round_trip(progression(49, -1, 10));
+    CHECK(blob[0] == TAG_RUNS);
+
+    // Несколько серий с разными шагами и одиночные значения между ними
+    std::vector<int> runs;
+    for (int line = 0; line < 50; ++line) {
+        std::vector<int> part = progression(line * 10000, 3 + line % 4, 40);
+        runs.insert(runs.end(), part.begin(), part.end());
+        runs.push_back(line * 10000 + 7777);
+    }
+    round_trip(runs);
+}
+
+void test_packed_deltas() {
+    // Длины вокруг размера блока упакованных разностей (128)
+    const size_t lengths[] = { 3, 127, 128, 129, 256, 1000 };
+    for (size_t n : lengths) {
+        round_trip(random_indices(n, 1000, static_cast<uint32_t>(n)));
+    }
+    // Нерегулярный список выбирает упакованные разности
+    std::vector<char> blob = round_trip(random_indices(1000, 100, 1));
+    CHECK(blob[0] == TAG_PACKED);
+
+    // Большие разности обоих знаков - разрядность 32
+    blob = round_trip(random_indices(300, static_cast<uint32_t>(std::numeric_limits<int>::max()), 7));
+    CHECK(blob[0] == TAG_PACKED);
+
+    // Возрастающий список с небольшими нерегулярными шагами
+    std::vector<int> increasing;
+    uint32_t state = 99;
+    int value = 0;
+    for (int k = 0; k < 5000; ++k) {
+        state = state * 1664525u + 1013904223u;
+        value += 1 + static_cast<int>(state >> 28);
+        increasing.push_back(value);
+    }
+    blob = round_trip(increasing);
+    CHECK(blob[0] == TAG_PACKED && blob.size() < increasing.size() * 2);
+}
+
+bool decode_throws(const std::vector<char>& blob) {
+    std::vector<int> out = { 1, 2, 3 };
+    try {
+        decode_posting_list(blob.data(), blob.size(), out);
+    } catch (const std::runtime_error&) {
+        // При ошибке out не меняется
+        return out == std::vector<int>({ 1, 2, 3 });
+    }
+    return false;
+}
+
+void test_corrupted() {
+    std::vector<char> runs = encode_posting_list(progression(0, 2, 1000));
+    std::vector<char> packed = encode_posting_list(random_indices(500, 1000000, 3));
+    CHECK(packed[0] == TAG_PACKED);
+
+    CHECK(decode_throws(std::vector<char>(runs.begin(), runs.end() - 1)));
+    CHECK(decode_throws(std::vector<char>(packed.begin(), packed.begin() + packed.size() / 2)));
+    std::vector<char> bad_tag = runs;
+    bad_tag[0] = 0x7F;
+    CHECK(decode_throws(bad_tag));
+    CHECK(decode_throws(std::vector<char>(1, TAG_RUNS)));
+}
+
+} // namespace
+
+int main() {
+    try {
+        test_edge_cases();
+        test_arithmetic_runs();
+        test_packed_deltas();
+        test_corrupted();
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "test_posting_list: %s\n", e.what());
+        ++failures;
+    }
+    if (failures) {
+        std::fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    std::printf("test_posting_list: all checks passed\n");
+    return 0;
+}
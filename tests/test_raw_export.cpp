@@ -0,0 +1,185 @@
+// Проверки RawExport: export_raw_traces и concat_segy_files переносят записи трасс байт в байт
+// как системными вызовами копирования, так и запасным чтением/записью через буфер.
+// Запускается через ctest; файлы пишутся в текущий каталог.
+
+#include "RawExport.hpp"
+#include "SegyReader.hpp"
+#include "SegyWriter.hpp"
+#include "SegyUtil.hpp"
+#include "BinFieldMap.hpp"
+#include "TraceFieldMap.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+const int N_SAMPLES = 25;
+const int FILE_HEADER_SIZE = 3600;
+int failures = 0;
+
+#define CHECK(condition)                                                                    \
+    do {                                                                                    \
+        if (!(condition)) {                                                                 \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            ++failures;                                                                     \
+        }                                                                                   \
+    } while (0)
+
+// Трассы файла различаются заголовками и отсчетами; first - номер первой трассы
+void write_test_file(const std::string& path, int first, int n_traces, int n_samples = N_SAMPLES) {
+    std::vector<uint8_t> bin_header(400, 0);
+    set_i16_be(bin_header.data(), BinFieldOffsets.at("SampleInterval").offset, 2000);
+    set_i16_be(bin_header.data(), BinFieldOffsets.at("SamplesPerTrace").offset, n_samples);
+    SegyWriterOptions options;
+    options.sample_format = SEGY_FORMAT_IEEE32;
+    SegyWriter writer(path, std::vector<char>(3200, 'C'), bin_header, n_samples, 2.0f, options);
+    std::vector<uint8_t> header(240, 0);
+    std::vector<float> samples(n_samples);
+    for (int t = first; t < first + n_traces; ++t) {
+        set_i32_be(header.data(), TraceFieldOffsets.at("TRACE_SEQUENCE_FILE").offset, t);
+        for (int s = 0; s < n_samples; ++s) samples[s] = t + 0.01f * s;
+        writer.write_trace(header, samples);
+    }
+    writer.close();
+}
+
+std::vector<char> read_file(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::vector<char>((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+void append_bytes(const std::string& path, size_t n) {
+    std::ofstream out(path, std::ios::binary | std::ios::app);
+    out.write(std::vector<char>(n, 'x').data(), n);
+}
+
+// Запись трассы index файла data (заголовок + отсчеты)
+std::vector<char> trace_record(const std::vector<char>& data, size_t bsize, size_t index) {
+    auto begin = data.begin() + FILE_HEADER_SIZE + index * bsize;
+    return std::vector<char>(begin, begin + bsize);
+}
+
+// Заголовки файла out взяты из source, в бинарном заголовке - число трасс
+void check_file_headers(const std::vector<char>& out, const std::vector<char>& source, int traces) {
+    CHECK(out.size() >= static_cast<size_t>(FILE_HEADER_SIZE));
+    if (out.size() < static_cast<size_t>(FILE_HEADER_SIZE)) return;
+    const int count_offset = BinFieldOffsets.at("DataTracesPerEnsemble").offset;
+    std::vector<char> want(source.begin(), source.begin() + FILE_HEADER_SIZE);
+    set_i16_be(reinterpret_cast<uint8_t*>(want.data() + 3200), count_offset, static_cast<int16_t>(traces));
+    CHECK(std::equal(want.begin(), want.end(), out.begin()));
+}
+
+void test_export(const std::string& source_path, RawCopyMethod method) {
+    const std::string path = "test_raw_export_out.sgy";
+    SegyReader reader(source_path);
+    const std::vector<char> source = read_file(source_path);
+    const size_t bsize = reader.trace_bsize();
+
+    // Серии подряд идущих трасс, обратный порядок и повторы
+    const std::vector<int> traces = { 5, 6, 7, 20, 3, 3, 59, 58, 0, 1, 2 };
+    RawExportStats stats;
+    CHECK(export_raw_traces(reader, traces, path, &stats, ProgressCallback(), nullptr, method));
+    CHECK(stats.traces == static_cast<int64_t>(traces.size()));
+    CHECK(stats.bytes == static_cast<int64_t>(traces.size() * bsize));
+    if (method == RawCopyMethod::ReadWrite) CHECK(stats.method == RawCopyMethod::ReadWrite);
+
+    const std::vector<char> out = read_file(path);
+    CHECK(out.size() == FILE_HEADER_SIZE + traces.size() * bsize);
+    if (out.size() == FILE_HEADER_SIZE + traces.size() * bsize) {
+        check_file_headers(out, source, static_cast<int>(traces.size()));
+        for (size_t i = 0; i < traces.size(); ++i) {
+            CHECK(trace_record(out, bsize, i) == trace_record(source, bsize, traces[i]));
+        }
+    }
+    std::remove(path.c_str());
+
+    bool thrown = false;
+    try {
+        export_raw_traces(reader, { 0, reader.num_traces() }, path, nullptr, ProgressCallback(), nullptr, method);
+    } catch (const std::out_of_range&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+    CHECK(!std::ifstream(path).good());
+}
+
+void test_concat(const std::vector<std::string>& inputs, RawCopyMethod method) {
+    const std::string path = "test_raw_export_concat.sgy";
+    std::vector<std::vector<char>> sources;
+    std::vector<int> counts;
+    size_t bsize = 0;
+    int total = 0;
+    for (const std::string& input : inputs) {
+        SegyReader reader(input);
+        sources.push_back(read_file(input));
+        counts.push_back(reader.num_traces());
+        bsize = reader.trace_bsize();
+        total += reader.num_traces();
+    }
+
+    RawExportStats stats;
+    CHECK(concat_segy_files(inputs, path, &stats, ProgressCallback(), nullptr, method));
+    CHECK(stats.traces == total);
+    if (method == RawCopyMethod::ReadWrite) CHECK(stats.method == RawCopyMethod::ReadWrite);
+
+    // Недописанный хвост входного файла отбрасывается
+    const std::vector<char> out = read_file(path);
+    CHECK(out.size() == FILE_HEADER_SIZE + total * bsize);
+    if (out.size() == FILE_HEADER_SIZE + total * bsize) {
+        check_file_headers(out, sources.front(), total);
+        size_t out_index = 0;
+        for (size_t f = 0; f < sources.size(); ++f) {
+            for (int t = 0; t < counts[f]; ++t, ++out_index) {
+                CHECK(trace_record(out, bsize, out_index) == trace_record(sources[f], bsize, t));
+            }
+        }
+    }
+    std::remove(path.c_str());
+}
+
+} // namespace
+
+int main() {
+    const std::string first = "test_raw_export_a.sgy";
+    const std::string second = "test_raw_export_b.sgy";
+    const std::string other = "test_raw_export_other.sgy";
+    try {
+        write_test_file(first, 0, 60);
+        write_test_file(second, 1000, 17);
+        append_bytes(second, 100); // недописанная трасса в конце
+        write_test_file(other, 0, 5, N_SAMPLES + 1);
+
+        const RawCopyMethod methods[2] = { RawCopyMethod::CopyFileRange, RawCopyMethod::ReadWrite };
+        for (RawCopyMethod method : methods) {
+            test_export(first, method);
+            test_concat({ first, second }, method);
+            test_concat({ second, first, second }, method);
+        }
+
+        bool thrown = false;
+        try {
+            concat_segy_files({ first, other }, "test_raw_export_concat.sgy");
+        } catch (const std::invalid_argument&) {
+            thrown = true;
+        }
+        CHECK(thrown);
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "test_raw_export: %s\n", e.what());
+        ++failures;
+    }
+    std::remove(first.c_str());
+    std::remove(second.c_str());
+    std::remove(other.c_str());
+    if (failures) {
+        std::fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    std::printf("test_raw_export: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,170 @@
+// Проверки SegyWriter: запись во всех поддерживаемых форматах отсчетов и чтение обратно
+// через SegyReader; синхронный, асинхронный и разреженный режимы должны давать один и тот
+// же файл байт в байт. Запускается через ctest; файлы пишутся в текущий каталог.
+
+#include "SegyWriter.hpp"
+#include "SegyReader.hpp"
+#include "SegyUtil.hpp"
+#include "BinFieldMap.hpp"
+#include "TraceFieldMap.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+
+const int N_TRACES = 300;
+const int N_SAMPLES = 37; // нечетное число - проверяются хвосты векторных преобразований
+const int TRACE_HEADER_SIZE = 240;
+int failures = 0;
+
+#define CHECK(condition)                                                                    \
+    do {                                                                                    \
+        if (!(condition)) {                                                                 \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            ++failures;                                                                     \
+        }                                                                                   \
+    } while (0)
+
+// Каждая пятая трасса (и последняя) - нули, чтобы в разреженном режиме в файле были дыры,
+// в том числе в конце; амплитуды остальных трасс различаются на порядки
+bool zero_trace(int t) { return t % 5 == 0 || t == N_TRACES - 1; }
+
+std::vector<float> trace_samples(int t) {
+    std::vector<float> samples(N_SAMPLES, 0.0f);
+    if (zero_trace(t)) return samples;
+    const float amplitude = std::pow(10.0f, static_cast<float>(t % 7 - 3));
+    for (int s = 0; s < N_SAMPLES; ++s) {
+        samples[s] = amplitude * std::sin(0.3f * s + 0.1f * t) * (s % 4 == 1 ? -1.0f : 1.0f);
+    }
+    return samples;
+}
+
+std::vector<uint8_t> trace_header(int t) {
+    std::vector<uint8_t> header(TRACE_HEADER_SIZE, 0);
+    set_i32_be(header.data(), TraceFieldOffsets.at("TRACE_SEQUENCE_LINE").offset, t + 1);
+    set_i32_be(header.data(), TraceFieldOffsets.at("CDP").offset, 500 + t);
+    set_i16_be(header.data(), TraceFieldOffsets.at("TRACE_SAMPLE_COUNT").offset, N_SAMPLES);
+    return header;
+}
+
+void write_file(const std::string& path, const SegyWriterOptions& options) {
+    std::vector<uint8_t> bin_header(400, 0);
+    set_i16_be(bin_header.data(), BinFieldOffsets.at("SampleInterval").offset, 4000);
+    set_i16_be(bin_header.data(), BinFieldOffsets.at("SamplesPerTrace").offset, N_SAMPLES);
+    SegyWriter writer(path, std::vector<char>(3200, ' '), bin_header, N_SAMPLES, 4.0f, options);
+    // Трассы пишутся и по одной, и сборками
+    for (int t = 0; t < N_TRACES / 2; ++t) {
+        writer.write_trace(trace_header(t), trace_samples(t));
+    }
+    std::vector<std::vector<uint8_t>> headers;
+    std::vector<std::vector<float>> traces;
+    for (int t = N_TRACES / 2; t < N_TRACES; ++t) {
+        headers.push_back(trace_header(t));
+        traces.push_back(trace_samples(t));
+        if (headers.size() == 10) {
+            writer.write_gather(headers, traces);
+            headers.clear();
+            traces.clear();
+        }
+    }
+    writer.write_gather(headers, traces);
+    writer.close();
+    CHECK(writer.num_traces() == N_TRACES);
+    CHECK(writer.stats().traces_written == N_TRACES);
+}
+
+std::vector<char> read_file(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::vector<char>((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+// Допустимая погрешность отсчета v трассы с максимальной амплитудой max_abs
+double tolerance(int format, float v, float max_abs) {
+    switch (format) {
+    case SEGY_FORMAT_IEEE32:
+        return 0.0;
+    case SEGY_FORMAT_INT16:
+        return std::ldexp(max_abs, -14); // шаг квантования после масштабирования к int16
+    default:
+        return std::ldexp(std::fabs(v), -20); // мантисса IBM - не меньше 21 значащего бита
+    }
+}
+
+void check_read_back(const std::string& path, int format) {
+    SegyReader reader(path);
+    CHECK(reader.num_traces() == N_TRACES);
+    CHECK(reader.num_samples() == N_SAMPLES);
+    CHECK(reader.sample_format() == format);
+    CHECK(reader.sample_interval() == 4.0f);
+    CHECK(reader.trace_bsize() == TRACE_HEADER_SIZE + N_SAMPLES * sample_format_bytes(format));
+
+    const int weighting_offset = TraceFieldOffsets.at("TraceWeightingFactor").offset;
+    int bad_samples = 0;
+    for (int t = 0; t < N_TRACES; ++t) {
+        // Заголовок сохраняется, кроме TraceWeightingFactor, который для int16 задает масштаб
+        std::vector<uint8_t> header = reader.get_trace_header(t);
+        std::vector<uint8_t> want = trace_header(t);
+        if (format == SEGY_FORMAT_INT16) {
+            set_i16_be(header.data(), weighting_offset, 0);
+        }
+        CHECK(header == want);
+
+        std::vector<float> samples = reader.get_trace(t);
+        std::vector<float> source = trace_samples(t);
+        CHECK(samples.size() == source.size());
+        if (samples.size() != source.size()) continue;
+        float max_abs = 0.0f;
+        for (float v : source) max_abs = std::max(max_abs, std::fabs(v));
+        for (int s = 0; s < N_SAMPLES; ++s) {
+            if (std::fabs(samples[s] - source[s]) > tolerance(format, source[s], max_abs)) ++bad_samples;
+        }
+    }
+    CHECK(bad_samples == 0);
+}
+
+void test_format(int format) {
+    const std::string reference = "test_segy_writer_reference.sgy";
+    const std::string path = "test_segy_writer.sgy";
+    SegyWriterOptions options;
+    options.sample_format = format;
+    write_file(reference, options);
+    check_read_back(reference, format);
+    const std::vector<char> expected = read_file(reference);
+
+    // Маленькие буферы - трассы переходят через границы буферов, в асинхронном режиме
+    // производитель ждет освобождения буфера
+    options.buffer_bytes = 4096;
+    for (int mode = 1; mode < 4; ++mode) {
+        options.async = (mode & 1) != 0;
+        options.sparse = (mode & 2) != 0;
+        write_file(path, options);
+        CHECK(read_file(path) == expected);
+        std::remove(path.c_str());
+    }
+    std::remove(reference.c_str());
+}
+
+} // namespace
+
+int main() {
+    try {
+        test_format(SEGY_FORMAT_IBM32);
+        test_format(SEGY_FORMAT_IEEE32);
+        test_format(SEGY_FORMAT_INT16);
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "test_segy_writer: %s\n", e.what());
+        ++failures;
+    }
+    if (failures) {
+        std::fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    std::printf("test_segy_writer: all checks passed\n");
+    return 0;
+}
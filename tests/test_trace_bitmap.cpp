@@ -0,0 +1,150 @@
+// Проверки TraceBitmap: пересечение, объединение и мощность для всех сочетаний
+// разреженных и плотных блоков сравниваются с операциями над отсортированными векторами.
+// Запускается через ctest.
+
+#include "TraceBitmap.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+
+const int BLOCK = 65536;
+int failures = 0;
+
+#define CHECK(condition)                                                                    \
+    do {                                                                                    \
+        if (!(condition)) {                                                                 \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            ++failures;                                                                     \
+        }                                                                                   \
+    } while (0)
+
+// Индексы блока block: dense - больше 4096 значений (битовая карта), иначе - массив
+std::vector<int> block_values(int block, bool dense, uint32_t seed) {
+    std::vector<int> values;
+    uint32_t state = seed;
+    const int count = dense ? 20000 : 300;
+    for (int k = 0; k < count; ++k) {
+        state = state * 1664525u + 1013904223u;
+        values.push_back(block * BLOCK + static_cast<int>(state >> 16));
+    }
+    return values;
+}
+
+std::vector<int> sorted_unique(std::vector<int> v) {
+    std::sort(v.begin(), v.end());
+    v.erase(std::unique(v.begin(), v.end()), v.end());
+    return v;
+}
+
+// Множество из блоков 0..n_blocks-1; kinds[b]: 0 - блока нет, 1 - разреженный, 2 - плотный
+std::vector<int> make_set(const std::vector<int>& kinds, uint32_t seed) {
+    std::vector<int> values;
+    for (size_t b = 0; b < kinds.size(); ++b) {
+        if (kinds[b] == 0) continue;
+        std::vector<int> part = block_values(static_cast<int>(b), kinds[b] == 2, seed + static_cast<uint32_t>(b));
+        values.insert(values.end(), part.begin(), part.end());
+    }
+    return values;
+}
+
+void check_equals(const TraceBitmap& bitmap, const std::vector<int>& want) {
+    CHECK(bitmap.to_vector() == want);
+    CHECK(bitmap.cardinality() == want.size());
+    CHECK(bitmap.empty() == want.empty());
+}
+
+void check_ops(const std::vector<int>& a_values, const std::vector<int>& b_values) {
+    const std::vector<int> a_sorted = sorted_unique(a_values);
+    const std::vector<int> b_sorted = sorted_unique(b_values);
+    std::vector<int> both, either;
+    std::set_intersection(a_sorted.begin(), a_sorted.end(), b_sorted.begin(), b_sorted.end(), std::back_inserter(both));
+    std::set_union(a_sorted.begin(), a_sorted.end(), b_sorted.begin(), b_sorted.end(), std::back_inserter(either));
+
+    const TraceBitmap a = TraceBitmap::from_indices(a_values);
+    const TraceBitmap b = TraceBitmap::from_indices(b_values);
+    check_equals(a, a_sorted);
+    check_equals(b, b_sorted);
+    check_equals(a & b, both);
+    check_equals(b & a, both);
+    check_equals(a | b, either);
+    check_equals(b | a, either);
+
+    // Операции на месте и повторное применение
+    TraceBitmap c = a;
+    c &= b;
+    c |= a;
+    check_equals(c, a_sorted);
+}
+
+void test_container_kinds() {
+    // Все сочетания видов блоков: отсутствует, разреженный, плотный
+    for (int ka = 0; ka < 3; ++ka) {
+        for (int kb = 0; kb < 3; ++kb) {
+            check_ops(make_set({ ka, kb, 2, 1 }, 10), make_set({ kb, ka, 1, 2 }, 20));
+            check_ops(make_set({ ka }, 30), make_set({ kb }, 30)); // одинаковые значения при одинаковом виде
+        }
+    }
+
+    // Пересечение двух плотных блоков с малым перекрытием становится разреженным и наоборот
+    std::vector<int> evens, odds_and_some;
+    for (int i = 0; i < BLOCK; i += 2) evens.push_back(i);
+    for (int i = 1; i < BLOCK; i += 2) odds_and_some.push_back(i);
+    for (int i = 0; i < 100 * 2; i += 2) odds_and_some.push_back(i);
+    check_ops(evens, odds_and_some);
+    // Объединение разреженных блоков, превышающее порог
+    check_ops(block_values(0, false, 1), block_values(0, false, 2));
+    std::vector<int> halves_a, halves_b;
+    for (int i = 0; i < 3000; ++i) {
+        halves_a.push_back(i);
+        halves_b.push_back(3000 + i);
+    }
+    check_ops(halves_a, halves_b);
+}
+
+void test_construction() {
+    // Отрицательные индексы игнорируются, порядок и повторы не важны
+    TraceBitmap bitmap = TraceBitmap::from_indices({ 5, -1, 3, 5, 70000, 3 });
+    check_equals(bitmap, { 3, 5, 70000 });
+    CHECK(bitmap.contains(70000) && bitmap.contains(3) && !bitmap.contains(4) && !bitmap.contains(-1));
+    bitmap.add({ 4, 200000, 70000 });
+    check_equals(bitmap, { 3, 4, 5, 70000, 200000 });
+
+    check_equals(TraceBitmap(), std::vector<int>());
+    check_equals(TraceBitmap() & bitmap, std::vector<int>());
+    check_equals(TraceBitmap() | bitmap, bitmap.to_vector());
+
+    // Плоская битовая карта: бит i слова i/64
+    std::vector<uint64_t> words(3000, 0);
+    std::vector<int> want;
+    for (int i = 0; i < 3000 * 64; i += 7) {
+        words[i / 64] |= uint64_t(1) << (i % 64);
+        want.push_back(i);
+    }
+    TraceBitmap from_bits = TraceBitmap::from_bitset(words);
+    check_equals(from_bits, want);
+    CHECK(from_bits == TraceBitmap::from_indices(want));
+}
+
+} // namespace
+
+int main() {
+    try {
+        test_construction();
+        test_container_kinds();
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "test_trace_bitmap: %s\n", e.what());
+        ++failures;
+    }
+    if (failures) {
+        std::fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    std::printf("test_trace_bitmap: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,220 @@
+// Проверки TraceMap на синтетическом файле: build_map, find_trace_indices, select, порядок
+// трасс внутри сборки, дописывание растущего файла и откат прерванной записи. Запускается через ctest; файлы пишутся
+// в текущий каталог.
+
+#include "TraceMap.hpp"
+#include "SegyReader.hpp"
+#include "SegyWriter.hpp"
+#include "SegyUtil.hpp"
+#include "BinFieldMap.hpp"
+#include "TraceFieldMap.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+const int N_TRACES = 200;
+const int TRACES_PER_RECORD = 10;
+int failures = 0;
+
+#define CHECK(condition)                                                                    \
+    do {                                                                                    \
+        if (!(condition)) {                                                                 \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            ++failures;                                                                     \
+        }                                                                                   \
+    } while (0)
+
+// Сборка FieldRecord = 1 + t/10; offset внутри сборки убывает (1000..100), CDP = t%7
+int field_record(int t) { return 1 + t / TRACES_PER_RECORD; }
+int offset(int t) { return 100 * (TRACES_PER_RECORD - t % TRACES_PER_RECORD); }
+
+void write_test_file(const std::string& path) {
+    std::vector<uint8_t> bin_header(400, 0);
+    set_i16_be(bin_header.data(), BinFieldOffsets.at("SampleInterval").offset, 2000);
+    set_i16_be(bin_header.data(), BinFieldOffsets.at("SamplesPerTrace").offset, 50);
+    SegyWriter writer(path, std::vector<char>(3200, ' '), bin_header, 50, 2.0f);
+    std::vector<uint8_t> header(240);
+    std::vector<float> samples(50);
+    for (int t = 0; t < N_TRACES; ++t) {
+        std::fill(header.begin(), header.end(), 0);
+        set_i32_be(header.data(), TraceFieldOffsets.at("FieldRecord").offset, field_record(t));
+        set_i32_be(header.data(), TraceFieldOffsets.at("offset").offset, offset(t));
+        set_i32_be(header.data(), TraceFieldOffsets.at("CDP").offset, t % 7);
+        set_i16_be(header.data(), TraceFieldOffsets.at("TRACE_SAMPLE_COUNT").offset, 50);
+        std::fill(samples.begin(), samples.end(), static_cast<float>(t));
+        writer.write_trace(header, samples);
+    }
+    writer.close();
+}
+
+// Все трассы, для которых pred истинен, по возрастанию
+template <typename Pred>
+std::vector<int> expected(Pred pred) {
+    std::vector<int> traces;
+    for (int t = 0; t < N_TRACES; ++t) {
+        if (pred(t)) traces.push_back(t);
+    }
+    return traces;
+}
+
+void test_build_and_sort_order(const SegyReader& reader) {
+    const std::string db = "test_trace_map_records.db";
+    std::remove(db.c_str());
+    {
+        TraceMap map(db, { "FieldRecord" });
+        map.build_map(reader, "offset");
+        CHECK(map.indexed_trace_count() == N_TRACES);
+
+        std::vector<int> records = map.get_unique_values("FieldRecord");
+        CHECK(records.size() == static_cast<size_t>(N_TRACES / TRACES_PER_RECORD));
+        CHECK(!records.empty() && records.front() == 1 && records.back() == N_TRACES / TRACES_PER_RECORD);
+
+        // Внутри сборки трассы упорядочены по возрастанию offset, т.е. в обратном порядке файла
+        std::vector<int> gather = map.find_trace_indices({ Optional<int>(5) });
+        std::vector<int> want = { 49, 48, 47, 46, 45, 44, 43, 42, 41, 40 };
+        CHECK(gather == want);
+        CHECK(map.find_trace_indices({ Optional<int>(1000) }).empty());
+
+        std::vector<KeySummary> summary = map.get_key_summary("FieldRecord");
+        CHECK(summary.size() == records.size());
+        CHECK(!summary.empty() && summary[0].trace_count == TRACES_PER_RECORD && summary[0].first_trace == 0 &&
+              summary[0].last_trace == TRACES_PER_RECORD - 1);
+    }
+    std::remove(db.c_str());
+}
+
+void test_select(const SegyReader& reader) {
+    const std::string db = "test_trace_map_select.db";
+    std::remove(db.c_str());
+    {
+        TraceMap map(db, { "FieldRecord", "offset", "CDP" });
+        map.build_map(reader);
+
+        // FieldRecord in [3,4] AND offset < 300
+        std::vector<int> got = map.select_indices({ KeyRange::between("FieldRecord", 3, 4), KeyRange::less_than("offset", 300) });
+        CHECK(got == expected([](int t) { return field_record(t) >= 3 && field_record(t) <= 4 && offset(t) < 300; }));
+
+        got = map.select_indices({ KeyRange::at_least("offset", 900), KeyRange::equal("CDP", 3) });
+        CHECK(got == expected([](int t) { return offset(t) >= 900 && t % 7 == 3; }));
+
+        CHECK(map.select({}).cardinality() == static_cast<size_t>(N_TRACES));
+        CHECK(map.select({ KeyRange::between("FieldRecord", 100, 200) }).empty());
+        CHECK(map.select({ KeyRange::less_than("offset", std::numeric_limits<int>::min()) }).empty());
+
+        std::vector<TraceBitmap> batch = map.select_batch({ { KeyRange::equal("CDP", 0) }, { KeyRange::equal("CDP", 0), KeyRange::equal("FieldRecord", 1) } });
+        CHECK(batch.size() == 2);
+        CHECK(batch.size() == 2 && batch[0].to_vector() == expected([](int t) { return t % 7 == 0; }));
+        CHECK(batch.size() == 2 && batch[1].to_vector() == expected([](int t) { return t % 7 == 0 && field_record(t) == 1; }));
+
+        // Незаданные ключи не фильтруют
+        std::vector<int> by_offset = map.find_trace_indices({ nullopt<int>(), Optional<int>(500) });
+        std::sort(by_offset.begin(), by_offset.end());
+        CHECK(by_offset == expected([](int t) { return offset(t) == 500; }));
+    }
+    std::remove(db.c_str());
+}
+
+// Копирует в dst первые bytes байт src (bytes < 0 - весь файл), дописывая к уже имеющимся в dst
+void copy_bytes(const std::string& src, const std::string& dst, std::streamoff from, std::streamoff bytes) {
+    std::ifstream in(src, std::ios::binary);
+    std::vector<char> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::streamoff end = bytes < 0 ? static_cast<std::streamoff>(data.size()) : from + bytes;
+    std::ofstream out(dst, std::ios::binary | (from == 0 ? std::ios::trunc : std::ios::app));
+    out.write(data.data() + from, end - from);
+}
+
+void test_append_keeps_sort_order(const std::string& full_path, const SegyReader& full_reader) {
+    const std::string path = "test_trace_map_growing.sgy";
+    const std::string db = "test_trace_map_append.db";
+    const std::string full_db = "test_trace_map_append_full.db";
+    std::remove(db.c_str());
+    std::remove(full_db.c_str());
+    // Файл обрывается посреди сборки 11 (трассы 100..104 из 100..109)
+    const int first_part = 105;
+    copy_bytes(full_path, path, 0, full_reader.trace_offset(first_part));
+    {
+        SegyReader reader(path);
+        CHECK(reader.num_traces() == first_part);
+        TraceMap map(db, { "FieldRecord" });
+        map.build_map(reader, "offset");
+
+        copy_bytes(full_path, path, full_reader.trace_offset(first_part), -1);
+        CHECK(reader.refresh() == N_TRACES - first_part);
+        CHECK(map.append_traces(reader) == N_TRACES - first_part);
+        CHECK(map.indexed_trace_count() == N_TRACES);
+
+        // Новые трассы с меньшим offset встают перед старыми - как при построении по всему файлу
+        std::vector<int> want = { 109, 108, 107, 106, 105, 104, 103, 102, 101, 100 };
+        CHECK(map.find_trace_indices({ Optional<int>(11) }) == want);
+
+        TraceMap full_map(full_db, { "FieldRecord" });
+        full_map.build_map(full_reader, "offset");
+        for (int record = 1; record <= N_TRACES / TRACES_PER_RECORD; ++record) {
+            CHECK(map.find_trace_indices({ Optional<int>(record) }) == full_map.find_trace_indices({ Optional<int>(record) }));
+        }
+        std::vector<KeySummary> summary = map.get_key_summary("FieldRecord");
+        CHECK(summary.size() == static_cast<size_t>(N_TRACES / TRACES_PER_RECORD));
+        CHECK(summary.size() > 10 && summary[10].trace_count == TRACES_PER_RECORD && summary[10].first_trace == 100 &&
+              summary[10].last_trace == 109);
+    }
+    std::remove(db.c_str());
+    std::remove(full_db.c_str());
+    std::remove(path.c_str());
+}
+
+void test_failed_build_rolls_back(const SegyReader& reader) {
+    const std::string db = "test_trace_map_rollback.db";
+    std::remove(db.c_str());
+    {
+        TraceMap map(db, { "FieldRecord" });
+        map.build_map(reader);
+
+        // Исключение посреди записи групп не должно оставлять открытую транзакцию
+        bool thrown = false;
+        try {
+            map.build_map(reader, "", [](const std::string& stage, int64_t, int64_t) {
+                if (stage == "Writing to database") throw std::runtime_error("interrupted");
+            });
+        } catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        CHECK(thrown);
+        CHECK(map.find_trace_indices({ Optional<int>(2) }).size() == static_cast<size_t>(TRACES_PER_RECORD));
+
+        map.build_map(reader);
+        CHECK(map.indexed_trace_count() == N_TRACES);
+    }
+    std::remove(db.c_str());
+}
+
+} // namespace
+
+int main() {
+    const std::string path = "test_trace_map.sgy";
+    try {
+        write_test_file(path);
+        SegyReader reader(path);
+        test_build_and_sort_order(reader);
+        test_select(reader);
+        test_append_keeps_sort_order(path, reader);
+        test_failed_build_rolls_back(reader);
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "test_trace_map: %s\n", e.what());
+        ++failures;
+    }
+    std::remove(path.c_str());
+    if (failures) {
+        std::fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    std::printf("test_trace_map: all checks passed\n");
+    return 0;
+}
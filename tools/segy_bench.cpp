@@ -0,0 +1,371 @@
+// segy_bench - микро- и макротесты производительности горячих путей sgylib (и кадра SegyViewer,
+// если собран с Qt). Результаты - JSON для сравнения между версиями на своих данных.
+//
+//   segy_bench [FILE] [--out results.json] [--repeat N] [--filter SUBSTR] [--work DIR]
+//
+// Без FILE тесты идут на детерминированном синтетическом кубе, который пишется в DIR.
+// Чтения файла измеряются на прогретом кэше ОС: первая итерация каждого теста не учитывается.
+
+#include "SegyReader.hpp"
+#include "SegyWriter.hpp"
+#include "SegyUtil.hpp"
+#include "BinFieldMap.hpp"
+#include "TraceFieldMap.hpp"
+#include "IbmConvert.hpp"
+#include "HeaderExtractor.hpp"
+#include "AmplitudeStats.hpp"
+#include "TraceMap.hpp"
+#include "SegyDataManager.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <functional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#ifdef SEGY_BENCH_VIEWER
+#include "SegyViewer.hpp"
+#include <QApplication>
+#include <QPixmap>
+#endif
+
+namespace {
+
+// Время итераций теста и число обработанных элементов за итерацию
+struct BenchResult {
+    std::string name;
+    std::string items_unit;
+    double items = 0.0;
+    std::vector<double> seconds;
+};
+
+struct BenchConfig {
+    int repeat = 10;
+    std::string filter;
+};
+
+double percentile(std::vector<double> values, double p) {
+    std::sort(values.begin(), values.end());
+    size_t index = static_cast<size_t>(p / 100.0 * (values.size() - 1) + 0.5);
+    return values[std::min(index, values.size() - 1)];
+}
+
+/**
+ * Тест: одна прогревочная итерация, затем repeat измеряемых. Тесты, имя которых
+ * не содержит фильтр, пропускаются.
+ */
+class BenchRunner {
+public:
+    explicit BenchRunner(const BenchConfig& config) : config_(config) {}
+
+    void run(const std::string& name, const std::string& items_unit, double items, const std::function<void()>& body) {
+        if (!config_.filter.empty() && name.find(config_.filter) == std::string::npos) return;
+        std::fprintf(stderr, "%-28s", name.c_str());
+        body();
+        BenchResult result;
+        result.name = name;
+        result.items_unit = items_unit;
+        result.items = items;
+        for (int i = 0; i < config_.repeat; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            body();
+            result.seconds.push_back(seconds_since(start));
+        }
+        double median = percentile(result.seconds, 50.0);
+        std::fprintf(stderr, " median %10.3f ms  %12.1f %s/s\n", median * 1e3, items / median, items_unit.c_str());
+        results_.push_back(result);
+    }
+
+    const std::vector<BenchResult>& results() const { return results_; }
+
+private:
+    BenchConfig config_;
+    std::vector<BenchResult> results_;
+};
+
+// Защита от удаления вычислений оптимизатором
+volatile float sink = 0.0f;
+
+// --- Синтетический куб ---
+
+/**
+ * Регулярный 3D-куб в IBM float: инлайн/кросслайн в байтах 189/193, CDP в байтах 21,
+ * наклонные отражения плюс шум из фиксированного зерна - файл одинаков при каждом запуске.
+ */
+void write_synthetic(const std::string& path, int n_il, int n_xl, int n_samples) {
+    std::vector<char> text_header(3200, ' ');
+    std::vector<uint8_t> bin_header(400, 0);
+    set_i16_be(bin_header.data(), BinFieldOffsets.at("SampleInterval").offset, 2000);
+    set_i16_be(bin_header.data(), BinFieldOffsets.at("SamplesPerTrace").offset, static_cast<int16_t>(n_samples));
+    SegyWriterOptions options;
+    options.async = true;
+    SegyWriter writer(path, text_header, bin_header, n_samples, 2.0f, options);
+
+    std::mt19937 rng(12345);
+    std::normal_distribution<float> noise(0.0f, 0.05f);
+    std::vector<uint8_t> header(240, 0);
+    std::vector<float> samples(n_samples);
+    for (int il = 0; il < n_il; ++il) {
+        for (int xl = 0; xl < n_xl; ++xl) {
+            std::fill(header.begin(), header.end(), 0);
+            set_i32_be(header.data(), TraceFieldOffsets.at("CDP").offset, il * n_xl + xl + 1);
+            set_i32_be(header.data(), 189, il + 100);
+            set_i32_be(header.data(), 193, xl + 1000);
+            set_i16_be(header.data(), TraceFieldOffsets.at("TRACE_SAMPLE_COUNT").offset, static_cast<int16_t>(n_samples));
+            for (int s = 0; s < n_samples; ++s) {
+                float t = static_cast<float>(s) + 0.3f * il - 0.2f * xl;
+                samples[s] = std::sin(t * 0.07f) * std::exp(-s * 0.001f) + noise(rng);
+            }
+            writer.write_trace(header, samples);
+        }
+    }
+    writer.close();
+}
+
+// --- Тесты ---
+
+void bench_codecs(BenchRunner& runner) {
+    const size_t n = size_t(4) << 20;
+    std::mt19937 rng(7);
+    std::normal_distribution<float> values(0.0f, 1000.0f);
+    std::vector<float> floats(n);
+    for (float& v : floats) v = values(rng);
+    std::vector<uint8_t> encoded(n * 4);
+    ieee_to_ibm_be(floats.data(), n, encoded.data());
+    std::vector<float> decoded(n);
+
+    runner.run("codec/ibm_to_float", "samples", static_cast<double>(n), [&] {
+        for (size_t i = 0; i < n; ++i) decoded[i] = ibm_to_float(get_u32_be(&encoded[i * 4]));
+        sink = decoded[n / 2];
+    });
+    runner.run("codec/ieee_to_ibm_be", "samples", static_cast<double>(n), [&] {
+        ieee_to_ibm_be(floats.data(), n, encoded.data());
+        sink = encoded[n];
+    });
+}
+
+void bench_reads(BenchRunner& runner, const SegyReader& reader) {
+    const int n = std::min(reader.num_traces(), 4096);
+    const double bytes = static_cast<double>(n) * reader.trace_bsize();
+
+    runner.run("read/get_trace", "traces", n, [&] {
+        for (int t = 0; t < n; ++t) sink = reader.get_trace(t)[0];
+    });
+    runner.run("read/get_traces_bulk", "traces", n, [&] {
+        for (int first = 0; first < n; first += 256) {
+            sink = reader.get_traces(first, std::min(256, n - first))[0][0];
+        }
+    });
+    std::vector<char> raw(static_cast<size_t>(bytes));
+    runner.run("read/raw_block", "bytes", bytes, [&] {
+        reader.read_raw_block(0, raw.size(), raw.data());
+        sink = raw[raw.size() / 2];
+    });
+}
+
+void bench_headers(BenchRunner& runner, const SegyReader& reader) {
+    // 12 полей из заголовков блока трасс (шаг - размер трассы): по полю через карту имен
+    // против разбора всех полей блока за один проход
+    const std::vector<std::string> names = {
+        "TRACE_SEQUENCE_LINE", "TRACE_SEQUENCE_FILE", "FieldRecord", "TraceNumber", "CDP", "CDP_TRACE",
+        "offset", "TRACE_SAMPLE_COUNT", "CDP_X", "CDP_Y", "INLINE_3D", "CROSSLINE_3D"
+    };
+    const std::vector<FieldInfo> fields = resolve_trace_fields(names);
+    const int n = std::min(reader.num_traces(), 20000);
+    const size_t stride = static_cast<size_t>(reader.trace_bsize());
+    std::vector<char> raw(static_cast<size_t>(n) * stride);
+    reader.read_raw_block(0, raw.size(), raw.data());
+    const uint8_t* block = reinterpret_cast<const uint8_t*>(raw.data());
+    std::vector<std::vector<int32_t>> columns(fields.size(), std::vector<int32_t>(n));
+    std::vector<int32_t*> out;
+    for (auto& column : columns) out.push_back(column.data());
+    const double values = static_cast<double>(n) * fields.size();
+
+    runner.run("headers/get_trace_field_value", "values", values, [&] {
+        for (int t = 0; t < n; ++t) {
+            for (size_t k = 0; k < names.size(); ++k) columns[k][t] = get_trace_field_value(block + t * stride, names[k]);
+        }
+        sink = static_cast<float>(columns[4][n / 2]);
+    });
+    runner.run("headers/extract_scalar", "values", values, [&] {
+        extract_header_fields_scalar(block, n, stride, fields, out.data());
+        sink = static_cast<float>(columns[4][n / 2]);
+    });
+    runner.run("headers/extract_bulk", "values", values, [&] {
+        extract_header_fields(block, n, stride, fields, out.data());
+        sink = static_cast<float>(columns[4][n / 2]);
+    });
+}
+
+void bench_manager(BenchRunner& runner, const std::string& file) {
+    // Страница в 100 трасс при кэше в 1000: промах - каждый раз новая страница,
+    // попадание - одна и та же
+    const int page = 100;
+    SegyDataManager manager(1000);
+    if (!manager.loadFile(file)) throw std::runtime_error("SegyDataManager failed to load " + file);
+    const int pages = std::max(1, manager.fileTraceCount() / page);
+    int next_page = 0;
+    runner.run("manager/page_miss", "pages", 1, [&] {
+        sink = manager.getTracesRange((next_page++ % pages) * page, page)[0][0];
+        if (next_page % pages == 0) manager.clearCache();
+    });
+    manager.getTracesRange(0, page);
+    runner.run("manager/page_hit", "pages", 1, [&] {
+        sink = manager.getTracesRange(0, page)[0][0];
+    });
+}
+
+void bench_stats(BenchRunner& runner, const SegyReader& reader) {
+    // Тот же расчет (сортировка первых 1000 трасс), что и перцентили шкалы во вьювере
+    const int n = std::min(reader.num_traces(), 1000);
+    runner.run("stats/percentiles_1000", "samples", static_cast<double>(n) * reader.num_samples(), [&] {
+        sink = compute_amplitude_stats(reader, n).percentiles[500];
+    });
+}
+
+void bench_trace_map(BenchRunner& runner, const SegyReader& reader, const std::string& work_dir) {
+    const std::string db = work_dir + "/segy_bench_map.db";
+    runner.run("index/build_map_cdp", "traces", reader.num_traces(), [&] {
+        std::remove(db.c_str());
+        TraceMap map(db, { "CDP" });
+        map.build_map(reader);
+    });
+    std::remove(db.c_str());
+}
+
+#ifdef SEGY_BENCH_VIEWER
+void bench_viewer(BenchRunner& runner, const std::string& file) {
+    SegyDataManager manager(2000);
+    manager.loadFile(file);
+    manager.computeGlobalStats();
+    SegyViewer viewer;
+    viewer.resize(1600, 1000);
+    viewer.setDataManager(&manager);
+    viewer.setTracesPerPage(500);
+
+    // Чередование двух страниц из кэша менеджера: кадр без чтения файла
+    int frame = 0;
+    runner.run("viewer/frame_cached", "frames", 1, [&] {
+        viewer.setStartTrace((frame++ % 2) * 500);
+        sink = static_cast<float>(viewer.grab().width());
+    });
+    // Прокрутка на полстраницы: половина колонок читается из файла
+    const int max_start = std::max(1, manager.fileTraceCount() - 500);
+    int start = 0;
+    runner.run("viewer/frame_scroll", "frames", 1, [&] {
+        start = (start + 250) % max_start;
+        viewer.setStartTrace(start);
+        sink = static_cast<float>(viewer.grab().width());
+    });
+}
+#endif
+
+// --- JSON ---
+
+std::string json_string(const std::string& text) {
+    std::string out = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') out += '\\';
+        if (static_cast<unsigned char>(c) < 0x20) continue;
+        out += c;
+    }
+    return out + "\"";
+}
+
+void write_json(FILE* out, const std::vector<BenchResult>& results, const SegyReader& reader, bool synthetic, int repeat) {
+    char timestamp[32];
+    std::time_t now = std::time(nullptr);
+    std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+    int threads = 1;
+#ifdef _OPENMP
+    threads = omp_get_max_threads();
+#endif
+
+    std::fprintf(out, "{\n  \"schema\": \"segy_bench/1\",\n  \"timestamp\": \"%s\",\n", timestamp);
+#ifdef __VERSION__
+    std::fprintf(out, "  \"compiler\": %s,\n", json_string(__VERSION__).c_str());
+#endif
+    std::fprintf(out, "  \"threads\": %d,\n  \"repeat\": %d,\n", threads, repeat);
+    std::fprintf(out, "  \"dataset\": {\"file\": %s, \"synthetic\": %s, \"traces\": %d, \"samples\": %d, \"format\": %d, \"trace_bytes\": %d},\n",
+                 json_string(reader.filename()).c_str(), synthetic ? "true" : "false", reader.num_traces(),
+                 reader.num_samples(), reader.sample_format(), reader.trace_bsize());
+    std::fprintf(out, "  \"results\": [\n");
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        double sum = 0.0;
+        for (double s : r.seconds) sum += s;
+        double median = percentile(r.seconds, 50.0);
+        std::fprintf(out,
+                     "    {\"name\": %s, \"iterations\": %zu, \"min_s\": %.9g, \"median_s\": %.9g, \"p95_s\": %.9g, "
+                     "\"max_s\": %.9g, \"mean_s\": %.9g, \"items\": %.9g, \"items_unit\": %s, \"items_per_s\": %.9g}%s\n",
+                     json_string(r.name).c_str(), r.seconds.size(), percentile(r.seconds, 0.0), median,
+                     percentile(r.seconds, 95.0), percentile(r.seconds, 100.0), sum / r.seconds.size(), r.items,
+                     json_string(r.items_unit).c_str(), r.items / median, i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(out, "  ]\n}\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+#ifdef SEGY_BENCH_VIEWER
+    if (std::getenv("QT_QPA_PLATFORM") == nullptr) qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication app(argc, argv);
+#endif
+    BenchConfig config;
+    std::string file, out_path, work_dir;
+    const char* tmp = std::getenv("TMPDIR");
+    work_dir = tmp ? tmp : "/tmp";
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--out" && has_value) out_path = argv[++i];
+        else if (arg == "--repeat" && has_value) config.repeat = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--filter" && has_value) config.filter = argv[++i];
+        else if (arg == "--work" && has_value) work_dir = argv[++i];
+        else if (arg.compare(0, 2, "--") != 0 && file.empty()) file = arg;
+        else {
+            std::fprintf(stderr, "usage: segy_bench [FILE] [--out results.json] [--repeat N] [--filter SUBSTR] [--work DIR]\n");
+            return 2;
+        }
+    }
+
+    try {
+        bool synthetic = file.empty();
+        if (synthetic) {
+            file = work_dir + "/segy_bench_synthetic.sgy";
+            std::fprintf(stderr, "writing synthetic cube %s\n", file.c_str());
+            write_synthetic(file, 100, 200, 1000);
+        }
+        SegyReader reader(file);
+        BenchRunner runner(config);
+        bench_codecs(runner);
+        bench_reads(runner, reader);
+        bench_headers(runner, reader);
+        bench_manager(runner, file);
+        bench_stats(runner, reader);
+        bench_trace_map(runner, reader, work_dir);
+#ifdef SEGY_BENCH_VIEWER
+        bench_viewer(runner, file);
+#endif
+
+        FILE* out = out_path.empty() ? stdout : std::fopen(out_path.c_str(), "w");
+        if (!out) throw std::runtime_error("Cannot write " + out_path);
+        write_json(out, runner.results(), reader, synthetic, config.repeat);
+        if (out != stdout) std::fclose(out);
+        if (synthetic) std::remove(file.c_str());
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "segy_bench: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,368 @@
+// segy_replay - воспроизведение сценария навигации в SegyViewer с замером каждого кадра.
+//
+//   segy_replay FILE [--script FILE] [--width W] [--height H] [--traces-per-page N]
+//                    [--cache N] [--out replay.json] [--frames frames.csv]
+//
+// Виджет рисуется без окна (QT_QPA_PLATFORM=offscreen выставляется, если не задан),
+// поэтому сценарий запускается и в CI без дисплея. Каждая команда сценария - один кадр:
+// состояние просмотрщика меняется тем же публичным API, что и из интерфейса, затем кадр
+// рисуется через QWidget::grab(). Время кадра раскладывается по этапам SegyViewer
+// (fetch, decode, raster, blit), итог - p50/p95/p99 по этапам и по типам команд.
+//
+// Сценарий - текстовый файл, по команде в строке (# - комментарий):
+//   scroll N            сдвиг на N трасс (отрицательный - назад)
+//   page N              сдвиг на N страниц
+//   goto N              переход к трассе N
+//   zoom F              увеличение в F раз к центру видимой области
+//   unzoom              сброс зума
+//   gain F              шаг колеса усиления: gain *= F
+//   color NAME|next     цветовая схема (next - следующая из ColorSchemes)
+//   time N              сдвиг первого показываемого отсчета на N
+//   window MS           длина показываемого окна по времени (0 - вся трасса)
+//   repeat K <команда>  команда K раз подряд
+// Без --script воспроизводится встроенный сценарий типичного просмотра.
+
+#include "SegyViewer.hpp"
+#include "SegyDataManager.hpp"
+#include "ColorSchemes.hpp"
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QPixmap>
+#include <QStringList>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+const char* const DEFAULT_SCRIPT[] = {
+    "# прокрутка колесом и постранично",
+    "repeat 40 scroll 50",
+    "repeat 10 page 1",
+    "repeat 10 page -1",
+    "# зум к центру и обратно",
+    "repeat 3 zoom 2",
+    "repeat 10 scroll 20",
+    "unzoom",
+    "# колесо усиления",
+    "repeat 10 gain 1.1",
+    "repeat 10 gain 0.9",
+    "# перебор цветовых схем",
+    "repeat 11 color next",
+    "# окно по времени",
+    "window 1000",
+    "repeat 10 time 50",
+    "window 0",
+};
+
+struct Command {
+    std::string name;
+    std::string arg;
+    int line;
+};
+
+struct Frame {
+    std::string command;
+    double wallMs; // изменение состояния + кадр целиком
+    FrameTiming timing;
+};
+
+double percentile(std::vector<double> values, double p) {
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    size_t index = static_cast<size_t>(p / 100.0 * (values.size() - 1) + 0.5);
+    return values[std::min(index, values.size() - 1)];
+}
+
+std::vector<Command> parse_script(std::istream& in) {
+    static const char* const known[] = { "scroll", "page", "goto", "zoom", "unzoom", "gain", "color", "time", "window" };
+    std::vector<Command> commands;
+    std::string text;
+    int line = 0;
+    while (std::getline(in, text)) {
+        ++line;
+        size_t hash = text.find('#');
+        if (hash != std::string::npos) text.erase(hash);
+        std::istringstream words(text);
+        std::string name;
+        if (!(words >> name)) continue;
+        int repeat = 1;
+        if (name == "repeat") {
+            if (!(words >> repeat >> name) || repeat < 1) {
+                throw std::invalid_argument("line " + std::to_string(line) + ": expected 'repeat K <command>'");
+            }
+        }
+        if (std::find(std::begin(known), std::end(known), name) == std::end(known)) {
+            throw std::invalid_argument("line " + std::to_string(line) + ": unknown command '" + name + "'");
+        }
+        Command command;
+        command.name = name;
+        command.line = line;
+        words >> command.arg;
+        if (command.arg.empty() && name != "unzoom") {
+            throw std::invalid_argument("line " + std::to_string(line) + ": command '" + name + "' needs an argument");
+        }
+        commands.insert(commands.end(), repeat, command);
+    }
+    return commands;
+}
+
+/**
+ * Исполнитель команд: меняет состояние просмотрщика так же, как соответствующие
+ * действия пользователя в MainWindow.
+ */
+class Player {
+public:
+    Player(SegyViewer& viewer, SegyDataManager& manager) : viewer_(viewer), manager_(manager) {
+        schemes_ = ColorSchemes::getAvailableSchemes();
+    }
+
+    void apply(const Command& command) {
+        const std::string& arg = command.arg;
+        if (command.name == "scroll") {
+            viewer_.setStartTrace(viewer_.startTrace() + std::stoi(arg));
+        } else if (command.name == "page") {
+            viewer_.setStartTrace(viewer_.startTrace() + std::stoi(arg) * viewer_.getTracesPerPage());
+        } else if (command.name == "goto") {
+            viewer_.setStartTrace(std::stoi(arg));
+        } else if (command.name == "zoom") {
+            zoom(std::stod(arg));
+        } else if (command.name == "unzoom") {
+            viewer_.resetZoom();
+        } else if (command.name == "gain") {
+            gain_ *= static_cast<float>(std::stod(arg));
+            viewer_.setGain(gain_);
+        } else if (command.name == "color") {
+            if (arg == "next") {
+                scheme_ = (scheme_ + 1) % std::max(1, schemes_.size());
+                viewer_.setColorScheme(schemes_.value(scheme_));
+            } else {
+                viewer_.setColorScheme(QString::fromStdString(arg));
+            }
+        } else if (command.name == "time") {
+            int last = std::max(0, manager_.pageSampleCount() - 1);
+            viewer_.setStartSample(std::min(last, std::max(0, viewer_.getStartSample() + std::stoi(arg))));
+        } else if (command.name == "window") {
+            viewer_.setSamplesPerPage(std::stoi(arg));
+        }
+    }
+
+private:
+    // Окно в factor раз меньше текущего с тем же центром; время - в мс, как samplesPerPage
+    void zoom(double factor) {
+        if (factor <= 1.0) throw std::invalid_argument("zoom factor must be greater than 1");
+        const float dt = std::max(1e-6f, manager_.pageAxes().verticalStep);
+        const int traces = viewer_.getTracesPerPage();
+        const int newTraces = std::max(10, static_cast<int>(traces / factor));
+        const int firstTrace = viewer_.startTrace() + (traces - newTraces) / 2;
+
+        const int totalSamples = manager_.pageSampleCount() - viewer_.getStartSample();
+        const int spanMs = viewer_.getSamplesPerPage() > 0 ? viewer_.getSamplesPerPage() : static_cast<int>(totalSamples * dt);
+        const int newSpanMs = std::max(static_cast<int>(100 * dt), static_cast<int>(spanMs / factor));
+        const int firstSample = viewer_.getStartSample() + static_cast<int>((spanMs - newSpanMs) / 2 / dt);
+        viewer_.zoomToRegion(firstTrace, firstTrace + newTraces, firstSample, firstSample + newSpanMs);
+    }
+
+    SegyViewer& viewer_;
+    SegyDataManager& manager_;
+    QStringList schemes_;
+    int scheme_ = 0;
+    float gain_ = 1.0f;
+};
+
+// --- Отчет ---
+
+struct StageColumn {
+    const char* name;
+    std::vector<double> values;
+};
+
+std::vector<StageColumn> stage_columns(const std::vector<Frame>& frames) {
+    std::vector<StageColumn> columns = { { "frame", {} }, { "fetch", {} }, { "decode", {} }, { "raster", {} }, { "blit", {} } };
+    for (const Frame& f : frames) {
+        columns[0].values.push_back(f.wallMs);
+        columns[1].values.push_back(f.timing.fetchMs);
+        columns[2].values.push_back(f.timing.decodeMs);
+        columns[3].values.push_back(f.timing.rasterMs);
+        columns[4].values.push_back(f.timing.blitMs);
+    }
+    return columns;
+}
+
+std::map<std::string, std::vector<double>> frames_by_command(const std::vector<Frame>& frames) {
+    std::map<std::string, std::vector<double>> groups;
+    for (const Frame& f : frames) groups[f.command].push_back(f.wallMs);
+    return groups;
+}
+
+void print_report(const std::vector<Frame>& frames) {
+    std::printf("%-10s %10s %10s %10s %10s   (ms)\n", "stage", "p50", "p95", "p99", "max");
+    for (const StageColumn& c : stage_columns(frames)) {
+        std::printf("%-10s %10.3f %10.3f %10.3f %10.3f\n", c.name, percentile(c.values, 50.0), percentile(c.values, 95.0),
+                    percentile(c.values, 99.0), percentile(c.values, 100.0));
+    }
+    std::printf("\n%-10s %6s %10s %10s %10s   (frame, ms)\n", "command", "frames", "p50", "p95", "p99");
+    for (const auto& group : frames_by_command(frames)) {
+        std::printf("%-10s %6zu %10.3f %10.3f %10.3f\n", group.first.c_str(), group.second.size(), percentile(group.second, 50.0),
+                    percentile(group.second, 95.0), percentile(group.second, 99.0));
+    }
+}
+
+std::string json_string(const std::string& text) {
+    std::string out = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') out += '\\';
+        if (static_cast<unsigned char>(c) < 0x20) continue;
+        out += c;
+    }
+    return out + "\"";
+}
+
+void write_json(FILE* out, const std::vector<Frame>& frames, const std::string& file, const std::string& script,
+                const SegyViewer& viewer) {
+    char timestamp[32];
+    std::time_t now = std::time(nullptr);
+    std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+    std::fprintf(out, "{\n  \"schema\": \"segy_replay/1\",\n  \"timestamp\": \"%s\",\n", timestamp);
+    std::fprintf(out, "  \"file\": %s,\n  \"script\": %s,\n", json_string(file).c_str(), json_string(script).c_str());
+    std::fprintf(out, "  \"viewport\": {\"width\": %d, \"height\": %d},\n  \"frames\": %zu,\n", viewer.width(), viewer.height(),
+                 frames.size());
+    std::fprintf(out, "  \"stages_ms\": {");
+    std::vector<StageColumn> columns = stage_columns(frames);
+    for (size_t i = 0; i < columns.size(); ++i) {
+        const std::vector<double>& v = columns[i].values;
+        std::fprintf(out, "%s\n    %s: {\"p50\": %.6g, \"p95\": %.6g, \"p99\": %.6g, \"max\": %.6g}", i ? "," : "",
+                     json_string(columns[i].name).c_str(), percentile(v, 50.0), percentile(v, 95.0), percentile(v, 99.0),
+                     percentile(v, 100.0));
+    }
+    std::fprintf(out, "\n  },\n  \"commands_ms\": {");
+    bool first = true;
+    for (const auto& group : frames_by_command(frames)) {
+        const std::vector<double>& v = group.second;
+        std::fprintf(out, "%s\n    %s: {\"frames\": %zu, \"p50\": %.6g, \"p95\": %.6g, \"p99\": %.6g}", first ? "" : ",",
+                     json_string(group.first).c_str(), v.size(), percentile(v, 50.0), percentile(v, 95.0), percentile(v, 99.0));
+        first = false;
+    }
+    std::fprintf(out, "\n  }\n}\n");
+}
+
+void write_frames_csv(FILE* out, const std::vector<Frame>& frames) {
+    std::fprintf(out, "frame,command,wall_ms,fetch_ms,decode_ms,raster_ms,blit_ms\n");
+    for (size_t i = 0; i < frames.size(); ++i) {
+        const Frame& f = frames[i];
+        std::fprintf(out, "%zu,%s,%.4f,%.4f,%.4f,%.4f,%.4f\n", i, f.command.c_str(), f.wallMs, f.timing.fetchMs, f.timing.decodeMs,
+                     f.timing.rasterMs, f.timing.blitMs);
+    }
+}
+
+FILE* open_output(const std::string& path) {
+    FILE* out = std::fopen(path.c_str(), "w");
+    if (!out) throw std::runtime_error("Cannot write " + path);
+    return out;
+}
+
+void print_usage() {
+    std::fprintf(stderr,
+                 "usage: segy_replay FILE [--script FILE] [--width W] [--height H] [--traces-per-page N]\n"
+                 "                        [--cache N] [--out replay.json] [--frames frames.csv]\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (std::getenv("QT_QPA_PLATFORM") == nullptr) qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication app(argc, argv);
+
+    std::string file, script_path, out_path, frames_path;
+    int width = 1600, height = 1000, traces_per_page = 1000, cache = 1000;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg.compare(0, 2, "--") != 0) {
+                if (!file.empty()) throw std::invalid_argument("Unexpected argument: " + arg);
+                file = arg;
+                continue;
+            }
+            if (i + 1 >= argc) throw std::invalid_argument("Missing value for " + arg);
+            std::string value = argv[++i];
+            if (arg == "--script") script_path = value;
+            else if (arg == "--width") width = std::stoi(value);
+            else if (arg == "--height") height = std::stoi(value);
+            else if (arg == "--traces-per-page") traces_per_page = std::stoi(value);
+            else if (arg == "--cache") cache = std::stoi(value);
+            else if (arg == "--out") out_path = value;
+            else if (arg == "--frames") frames_path = value;
+            else throw std::invalid_argument("Unknown option: " + arg);
+        }
+        if (file.empty()) throw std::invalid_argument("SEG-Y file is required");
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "segy_replay: %s\n", e.what());
+        print_usage();
+        return 2;
+    }
+
+    try {
+        std::vector<Command> commands;
+        if (script_path.empty()) {
+            std::stringstream script;
+            for (const char* line : DEFAULT_SCRIPT) script << line << '\n';
+            commands = parse_script(script);
+        } else {
+            std::ifstream script(script_path);
+            if (!script) throw std::runtime_error("Cannot open script: " + script_path);
+            commands = parse_script(script);
+        }
+
+        SegyDataManager manager(cache);
+        if (!manager.loadFile(file)) throw std::runtime_error("Cannot load " + file);
+        manager.computeGlobalStats();
+        SegyViewer viewer;
+        viewer.resize(width, height);
+        viewer.setDataManager(&manager);
+        viewer.setTracesPerPage(traces_per_page);
+        Player player(viewer, manager);
+
+        // Первый кадр - открытие файла с холодным кэшем трасс
+        std::vector<Frame> frames;
+        QElapsedTimer timer;
+        timer.start();
+        viewer.grab();
+        frames.push_back(Frame{ "open", timer.nsecsElapsed() * 1e-6, viewer.lastFrameTiming() });
+        for (const Command& command : commands) {
+            timer.restart();
+            try {
+                player.apply(command);
+            } catch (const std::exception& e) {
+                throw std::runtime_error("script line " + std::to_string(command.line) + ": " + e.what());
+            }
+            viewer.grab();
+            frames.push_back(Frame{ command.name, timer.nsecsElapsed() * 1e-6, viewer.lastFrameTiming() });
+        }
+
+        std::printf("file:   %s\nframes: %zu (%dx%d, %d traces per page)\n\n", file.c_str(), frames.size(), width, height,
+                    traces_per_page);
+        print_report(frames);
+        if (!out_path.empty()) {
+            FILE* out = open_output(out_path);
+            write_json(out, frames, file, script_path.empty() ? "default" : script_path, viewer);
+            std::fclose(out);
+        }
+        if (!frames_path.empty()) {
+            FILE* out = open_output(frames_path);
+            write_frames_csv(out, frames);
+            std::fclose(out);
+        }
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "segy_replay: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,311 @@
+// segy_synth - генератор синтетических SEG-Y для нагрузочных тестов без производственных данных.
+//
+//   segy_synth OUT [--geometry 3d|2d] [--inlines N --crosslines M | --cdps N] [--offsets K]
+//                  [--samples NS] [--interval MS] [--format ibm|ieee|int16]
+//                  [--events N] [--noise LEVEL] [--frequency HZ] [--seed S]
+//                  [--size BYTES[K|M|G|T]] [--sparse] [--sync] [--quiet]
+//
+// Трасса определяется только своим номером и параметрами, поэтому файл одинаков при любом
+// числе потоков. Трассы генерируются блоками параллельно (OpenMP) и пишутся SegyWriter
+// (по умолчанию асинхронно). --size подбирает число инлайнов (3D) или CDP (2D) под размер
+// файла; --sparse пишет нулевые отсчеты дырами файла (экономит место при трассах длиннее
+// блока файловой системы, например --samples 8000: 2 ГБ файла занимают ~280 МБ диска).
+
+#include "SegyWriter.hpp"
+#include "SegyUtil.hpp"
+#include "BinFieldMap.hpp"
+#include "TraceFieldMap.hpp"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+const size_t BLOCK_BYTES = size_t(16) << 20; // трасс на блок параллельной генерации
+const double PI = 3.14159265358979323846;
+
+struct SynthParams {
+    bool three_d = true;
+    int inlines = 100;
+    int crosslines = 100;
+    int cdps = 1000;
+    int offsets = 1;
+    double offset_min = 100.0;  // м
+    double offset_step = 50.0;
+    int samples = 1000;
+    double interval_ms = 2.0;
+    int format = SEGY_FORMAT_IBM32;
+    int events = 10;
+    double noise = 0.1;         // относительно амплитуды отражений
+    double frequency = 25.0;    // Гц, импульс Рикера
+    uint64_t seed = 1;
+    int64_t size_bytes = 0;
+    bool sparse = false;
+    bool async = true;
+    bool quiet = false;
+
+    int gathers() const { return three_d ? inlines * crosslines : cdps; }
+    int64_t traces() const { return static_cast<int64_t>(gathers()) * offsets; }
+};
+
+// Отражающая граница: время на первой трассе, наклоны по инлайну/кросслайну, скорость для годографа
+struct Event {
+    double t0_ms;
+    double dip_il_ms;
+    double dip_xl_ms;
+    double amplitude;
+    double velocity; // м/с
+};
+
+// splitmix64: независимые детерминированные последовательности для каждой трассы
+struct Random {
+    uint64_t state;
+    explicit Random(uint64_t seed) : state(seed) {}
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+    double uniform() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+    double gaussian() {
+        double u1 = std::max(uniform(), 1e-300);
+        return std::sqrt(-2.0 * std::log(u1)) * std::cos(2.0 * PI * uniform());
+    }
+};
+
+std::vector<Event> make_events(const SynthParams& p) {
+    Random rng(p.seed * 0x100000001B3ull + 17);
+    const double length_ms = p.samples * p.interval_ms;
+    std::vector<Event> events(p.events);
+    for (Event& e : events) {
+        e.t0_ms = (0.05 + 0.9 * rng.uniform()) * length_ms;
+        e.dip_il_ms = (rng.uniform() - 0.5) * 0.8;
+        e.dip_xl_ms = (rng.uniform() - 0.5) * 0.8;
+        e.amplitude = (rng.uniform() < 0.5 ? -1.0 : 1.0) * (0.3 + 0.7 * rng.uniform());
+        e.velocity = 1500.0 + 2500.0 * e.t0_ms / length_ms + 300.0 * rng.uniform();
+    }
+    std::sort(events.begin(), events.end(), [](const Event& a, const Event& b) { return a.t0_ms < b.t0_ms; });
+    return events;
+}
+
+void make_header(const SynthParams& p, int64_t trace, std::vector<uint8_t>& header) {
+    std::fill(header.begin(), header.end(), 0);
+    const int gather = static_cast<int>(trace / p.offsets);
+    const int channel = static_cast<int>(trace % p.offsets);
+    const int il = p.three_d ? gather / p.crosslines : gather;
+    const int xl = p.three_d ? gather % p.crosslines : 0;
+    auto set32 = [&](const char* name, int32_t value) { set_i32_be(header.data(), TraceFieldOffsets.at(name).offset, value); };
+    auto set16 = [&](const char* name, int16_t value) { set_i16_be(header.data(), TraceFieldOffsets.at(name).offset, value); };
+    set32("TRACE_SEQUENCE_LINE", static_cast<int32_t>(trace + 1));
+    set32("TRACE_SEQUENCE_FILE", static_cast<int32_t>(trace + 1));
+    set32("FieldRecord", gather + 1);
+    set32("TraceNumber", channel + 1);
+    set32("CDP", gather + 1);
+    set32("CDP_TRACE", channel + 1);
+    set32("offset", static_cast<int32_t>(p.offset_min + channel * p.offset_step));
+    set16("TraceIdentificationCode", 1);
+    set16("TRACE_SAMPLE_COUNT", static_cast<int16_t>(p.samples));
+    set16("TRACE_SAMPLE_INTERVAL", static_cast<int16_t>(std::lround(p.interval_ms * 1000.0)));
+    set32("CDP_X", 500000 + il * 25);
+    set32("CDP_Y", 6000000 + xl * 25);
+    if (p.three_d) {
+        set32("INLINE_3D", 1000 + il);
+        set32("CROSSLINE_3D", 2000 + xl);
+    }
+}
+
+void make_samples(const SynthParams& p, const std::vector<Event>& events, int64_t trace, std::vector<float>& samples) {
+    std::fill(samples.begin(), samples.end(), 0.0f);
+    if (p.sparse) return;
+    const int gather = static_cast<int>(trace / p.offsets);
+    const int channel = static_cast<int>(trace % p.offsets);
+    const int il = p.three_d ? gather / p.crosslines : gather;
+    const int xl = p.three_d ? gather % p.crosslines : 0;
+    const double offset = p.offset_min + channel * p.offset_step;
+
+    // Импульс Рикера добавляется только в окне +-1.5 периода вокруг времени отражения
+    const double half_width_ms = 1500.0 / p.frequency;
+    const double pf2 = PI * PI * p.frequency * p.frequency * 1e-6; // на мс^2
+    for (const Event& e : events) {
+        double t0 = e.t0_ms + e.dip_il_ms * il + e.dip_xl_ms * xl;
+        double moveout = offset / e.velocity * 1000.0;
+        double t = std::sqrt(t0 * t0 + moveout * moveout);
+        int first = std::max(0, static_cast<int>(std::ceil((t - half_width_ms) / p.interval_ms)));
+        int last = std::min(p.samples - 1, static_cast<int>(std::floor((t + half_width_ms) / p.interval_ms)));
+        for (int s = first; s <= last; ++s) {
+            double tau2 = (s * p.interval_ms - t) * (s * p.interval_ms - t);
+            samples[s] += static_cast<float>(e.amplitude * (1.0 - 2.0 * pf2 * tau2) * std::exp(-pf2 * tau2));
+        }
+    }
+    if (p.noise > 0.0) {
+        Random rng(p.seed ^ (static_cast<uint64_t>(trace) * 0xD6E8FEB86659FD93ull));
+        for (float& v : samples) v += static_cast<float>(p.noise * rng.gaussian());
+    }
+}
+
+std::vector<char> make_text_header(const SynthParams& p) {
+    std::vector<char> text(3200, ' ');
+    char lines[5][81];
+    std::snprintf(lines[0], sizeof(lines[0]), "C 1 SYNTHETIC SEG-Y GENERATED BY SEGY_SYNTH");
+    std::snprintf(lines[1], sizeof(lines[1]), "C 2 GEOMETRY %s  GATHERS %d  TRACES PER GATHER %d", p.three_d ? "3D" : "2D", p.gathers(), p.offsets);
+    std::snprintf(lines[2], sizeof(lines[2]), "C 3 SAMPLES %d  INTERVAL %g MS  FORMAT %d", p.samples, p.interval_ms, p.format);
+    std::snprintf(lines[3], sizeof(lines[3]), "C 4 EVENTS %d  NOISE %g  RICKER %g HZ  SEED %llu", p.sparse ? 0 : p.events, p.sparse ? 0.0 : p.noise,
+                  p.frequency, static_cast<unsigned long long>(p.seed));
+    std::snprintf(lines[4], sizeof(lines[4]), "C 5 INLINE BYTES 189  CROSSLINE BYTES 193  CDP X/Y BYTES 181/185");
+    for (int i = 0; i < 5; ++i) std::memcpy(text.data() + i * 80, lines[i], std::strlen(lines[i]));
+    return text;
+}
+
+int64_t parse_size(const std::string& text) {
+    size_t pos = 0;
+    double value = std::stod(text, &pos);
+    std::string suffix = text.substr(pos);
+    double scale = 1.0;
+    if (suffix == "K" || suffix == "k") scale = 1024.0;
+    else if (suffix == "M" || suffix == "m") scale = 1024.0 * 1024.0;
+    else if (suffix == "G" || suffix == "g") scale = 1024.0 * 1024.0 * 1024.0;
+    else if (suffix == "T" || suffix == "t") scale = 1024.0 * 1024.0 * 1024.0 * 1024.0;
+    else if (!suffix.empty()) throw std::invalid_argument("Bad size: " + text);
+    return static_cast<int64_t>(value * scale);
+}
+
+int parse_format(const std::string& name) {
+    if (name == "ibm") return SEGY_FORMAT_IBM32;
+    if (name == "ieee") return SEGY_FORMAT_IEEE32;
+    if (name == "int16") return SEGY_FORMAT_INT16;
+    throw std::invalid_argument("Unknown sample format: " + name + " (expected ibm, ieee or int16)");
+}
+
+SynthParams parse_params(int argc, char** argv, std::string& out) {
+    SynthParams p;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--sparse") { p.sparse = true; continue; }
+        if (arg == "--sync") { p.async = false; continue; }
+        if (arg == "--quiet") { p.quiet = true; continue; }
+        if (arg.compare(0, 2, "--") != 0) {
+            if (!out.empty()) throw std::invalid_argument("Unexpected argument: " + arg);
+            out = arg;
+            continue;
+        }
+        if (i + 1 >= argc) throw std::invalid_argument("Missing value for " + arg);
+        std::string value = argv[++i];
+        if (arg == "--geometry") {
+            if (value != "2d" && value != "3d") throw std::invalid_argument("Geometry must be 2d or 3d");
+            p.three_d = value == "3d";
+        }
+        else if (arg == "--inlines") p.inlines = std::stoi(value);
+        else if (arg == "--crosslines") p.crosslines = std::stoi(value);
+        else if (arg == "--cdps") p.cdps = std::stoi(value);
+        else if (arg == "--offsets") p.offsets = std::stoi(value);
+        else if (arg == "--offset-min") p.offset_min = std::stod(value);
+        else if (arg == "--offset-step") p.offset_step = std::stod(value);
+        else if (arg == "--samples") p.samples = std::stoi(value);
+        else if (arg == "--interval") p.interval_ms = std::stod(value);
+        else if (arg == "--format") p.format = parse_format(value);
+        else if (arg == "--events") p.events = std::stoi(value);
+        else if (arg == "--noise") p.noise = std::stod(value);
+        else if (arg == "--frequency") p.frequency = std::stod(value);
+        else if (arg == "--seed") p.seed = std::stoull(value);
+        else if (arg == "--size") p.size_bytes = parse_size(value);
+        else throw std::invalid_argument("Unknown option: " + arg);
+    }
+    if (out.empty()) throw std::invalid_argument("Output file is required");
+    if (p.samples <= 0 || p.samples > 32767) throw std::invalid_argument("Samples must be in 1..32767");
+    if (p.interval_ms <= 0.0 || p.interval_ms * 1000.0 > 32767.0) throw std::invalid_argument("Interval must be in (0, 32.767] ms");
+    if (p.offsets <= 0 || p.inlines <= 0 || p.crosslines <= 0 || p.cdps <= 0 || p.events < 0 || p.frequency <= 0.0) {
+        throw std::invalid_argument("Counts must be positive");
+    }
+
+    // Размер файла задает число инлайнов (3D) или CDP (2D)
+    if (p.size_bytes > 0) {
+        const int64_t trace_bytes = 240 + static_cast<int64_t>(p.samples) * sample_format_bytes(p.format);
+        const int64_t traces = std::max<int64_t>(1, (p.size_bytes - 3600) / trace_bytes);
+        const int64_t per_line = static_cast<int64_t>(p.offsets) * (p.three_d ? p.crosslines : 1);
+        const int64_t lines = std::max<int64_t>(1, (traces + per_line - 1) / per_line);
+        if (lines > INT_MAX) throw std::invalid_argument("Size is too large for this geometry");
+        (p.three_d ? p.inlines : p.cdps) = static_cast<int>(lines);
+    }
+    if (static_cast<int64_t>(p.gathers()) * p.offsets > INT_MAX ||
+        (p.three_d && static_cast<int64_t>(p.inlines) * p.crosslines > INT_MAX)) {
+        throw std::invalid_argument("Too many traces for SEG-Y indexing (max 2^31-1)");
+    }
+    return p;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    try {
+        std::string out;
+        SynthParams p = parse_params(argc, argv, out);
+        const std::vector<Event> events = make_events(p);
+        const int64_t n_traces = p.traces();
+
+        std::vector<uint8_t> bin_header(400, 0);
+        auto set_bin = [&](const char* name, int16_t value) { set_i16_be(bin_header.data(), BinFieldOffsets.at(name).offset, value); };
+        set_bin("SampleInterval", static_cast<int16_t>(std::lround(p.interval_ms * 1000.0)));
+        set_bin("SamplesPerTrace", static_cast<int16_t>(p.samples));
+        set_bin("EnsembleFold", static_cast<int16_t>(std::min(p.offsets, 32767)));
+        set_bin("SortingCode", 2); // сборки ОГТ
+        set_bin("MeasurementSystem", 1);
+
+        SegyWriterOptions options;
+        options.async = p.async;
+        options.sample_format = p.format;
+        options.sparse = p.sparse;
+        SegyWriter writer(out, make_text_header(p), bin_header, p.samples, static_cast<float>(p.interval_ms), options);
+
+        const int64_t trace_bytes = 240 + static_cast<int64_t>(p.samples) * sample_format_bytes(p.format);
+        const int block = static_cast<int>(std::max<int64_t>(1, static_cast<int64_t>(BLOCK_BYTES) / trace_bytes));
+        std::vector<std::vector<uint8_t>> headers(block, std::vector<uint8_t>(240));
+        std::vector<std::vector<float>> traces(block, std::vector<float>(p.samples));
+        auto start = std::chrono::steady_clock::now();
+        int last_percent = -1;
+        for (int64_t first = 0; first < n_traces; first += block) {
+            const int count = static_cast<int>(std::min<int64_t>(block, n_traces - first));
+            headers.resize(count);
+            traces.resize(count);
+            #pragma omp parallel for schedule(static)
+            for (int t = 0; t < count; ++t) {
+                make_header(p, first + t, headers[t]);
+                make_samples(p, events, first + t, traces[t]);
+            }
+            writer.write_gather(headers, traces);
+
+            int percent = static_cast<int>((first + count) * 100 / n_traces);
+            if (!p.quiet && percent != last_percent) {
+                std::fprintf(stderr, "\rGenerating: %3d%%", percent);
+                std::fflush(stderr);
+                last_percent = percent;
+            }
+        }
+        writer.close();
+        if (!p.quiet) std::fprintf(stderr, "\n");
+
+        const double seconds = seconds_since(start);
+        const double file_mb = (3600.0 + static_cast<double>(n_traces) * trace_bytes) / 1048576.0;
+        std::printf("file:            %s\n", out.c_str());
+        if (p.three_d) {
+            std::printf("geometry:        3D %d inlines x %d crosslines, %d traces per gather\n", p.inlines, p.crosslines, p.offsets);
+        } else {
+            std::printf("geometry:        2D %d CDPs, %d traces per gather\n", p.cdps, p.offsets);
+        }
+        std::printf("traces:          %lld x %d samples (format %d)\n", static_cast<long long>(n_traces), p.samples, p.format);
+        std::printf("size:            %.1f MB%s\n", file_mb, p.sparse ? " (sparse)" : "");
+        std::printf("time:            %.3f s (%.1f MB/s)\n", seconds, seconds > 0.0 ? file_mb / seconds : 0.0);
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "segy_synth: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,356 @@
+// segytool - консольный доступ к движкам sgylib без Qt (пакетные задания на вычислительных узлах).
+//
+//   segytool info FILE [--geometry]
+//   segytool stats FILE [--traces N | --all]
+//   segytool index FILE --keys K1[,K2...] [--sort KEY] [--db PATH]
+//   segytool extract FILE OUT [--traces SPEC] [--where KEY=LO:HI]...
+//   segytool convert FILE OUT --format ibm|ieee|int16 [--sync]
+
+#include "SegyReader.hpp"
+#include "SegyWriter.hpp"
+#include "SegyUtil.hpp"
+#include "AmplitudeStats.hpp"
+#include "HeaderExtractor.hpp"
+#include "SurveyGeometry.hpp"
+#include "TraceMap.hpp"
+#include "RawExport.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+const size_t CONVERT_BLOCK_BYTES = size_t(32) << 20;
+
+bool quiet = false;
+
+// Разобранная командная строка: позиционные аргументы и опции --name [value]
+struct Args {
+    std::vector<std::string> positional;
+    std::multimap<std::string, std::string> options;
+
+    bool has(const std::string& name) const { return options.count(name) > 0; }
+    std::string get(const std::string& name, const std::string& fallback = "") const {
+        auto it = options.find(name);
+        return it == options.end() ? fallback : it->second;
+    }
+    std::vector<std::string> all(const std::string& name) const {
+        std::vector<std::string> values;
+        auto range = options.equal_range(name);
+        for (auto it = range.first; it != range.second; ++it) values.push_back(it->second);
+        return values;
+    }
+};
+
+// Опции без значения
+bool is_flag(const std::string& name) {
+    return name == "--geometry" || name == "--all" || name == "--sync" || name == "--quiet";
+}
+
+Args parse_args(int argc, char** argv, int first) {
+    Args args;
+    for (int i = first; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 2, "--") != 0) {
+            args.positional.push_back(arg);
+        } else if (is_flag(arg)) {
+            args.options.insert(std::make_pair(arg, std::string()));
+        } else {
+            if (i + 1 >= argc) throw std::invalid_argument("Missing value for " + arg);
+            args.options.insert(std::make_pair(arg, std::string(argv[++i])));
+        }
+    }
+    quiet = args.has("--quiet");
+    return args;
+}
+
+std::vector<std::string> split(const std::string& text, char separator) {
+    std::vector<std::string> parts;
+    std::stringstream stream(text);
+    std::string part;
+    while (std::getline(stream, part, separator)) {
+        if (!part.empty()) parts.push_back(part);
+    }
+    return parts;
+}
+
+int parse_int(const std::string& text) {
+    size_t pos = 0;
+    int value = std::stoi(text, &pos);
+    if (pos != text.size()) throw std::invalid_argument("Not an integer: " + text);
+    return value;
+}
+
+// Прогресс в stderr одной обновляемой строкой
+ProgressCallback progress_printer() {
+    if (quiet) return ProgressCallback();
+    return [](const std::string& stage, int64_t current, int64_t total) {
+        int percent = total > 0 ? static_cast<int>(current * 100 / total) : 0;
+        std::fprintf(stderr, "\r%s: %3d%%", stage.c_str(), percent);
+        if (current >= total) std::fprintf(stderr, "\n");
+        std::fflush(stderr);
+    };
+}
+
+const char* format_name(int format) {
+    switch (format) {
+    case SEGY_FORMAT_IBM32: return "4-byte IBM float";
+    case SEGY_FORMAT_INT32: return "4-byte integer";
+    case SEGY_FORMAT_INT16: return "2-byte integer";
+    case SEGY_FORMAT_IEEE32: return "4-byte IEEE float";
+    case SEGY_FORMAT_INT8: return "1-byte integer";
+    }
+    return "unknown";
+}
+
+void require_positional(const Args& args, size_t count, const char* usage) {
+    if (args.positional.size() != count) {
+        throw std::invalid_argument(std::string("usage: segytool ") + usage);
+    }
+}
+
+// --- Подкоманды ---
+
+int cmd_info(const Args& args) {
+    require_positional(args, 1, "info FILE [--geometry]");
+    SegyReader reader(args.positional[0]);
+    std::printf("file:            %s\n", reader.filename().c_str());
+    std::printf("traces:          %d\n", reader.num_traces());
+    std::printf("samples:         %d\n", reader.num_samples());
+    std::printf("sample interval: %g ms\n", reader.sample_interval());
+    std::printf("sample format:   %d (%s)\n", reader.sample_format(), format_name(reader.sample_format()));
+    std::printf("trace size:      %d bytes\n", reader.trace_bsize());
+    std::printf("data size:       %.1f MB\n", static_cast<double>(reader.num_traces()) * reader.trace_bsize() / 1048576.0);
+
+    if (args.has("--geometry")) {
+        auto start = std::chrono::steady_clock::now();
+        SurveyGeometry geometry = SurveyGeometry::detect(reader, GeometryFields(), progress_printer());
+        if (geometry.regular()) {
+            std::printf("inlines:         %d-%d step %d (%d)\n", geometry.inline_min(), geometry.inline_max(),
+                        geometry.inline_step(), geometry.inline_count());
+            std::printf("crosslines:      %d-%d step %d (%d)\n", geometry.crossline_min(), geometry.crossline_max(),
+                        geometry.crossline_step(), geometry.crossline_count());
+        } else {
+            std::printf("geometry:        irregular (%s)\n", geometry.reason().c_str());
+        }
+        std::printf("geometry time:   %.3f s\n", seconds_since(start));
+    }
+    return 0;
+}
+
+int cmd_stats(const Args& args) {
+    require_positional(args, 1, "stats FILE [--traces N | --all]");
+    SegyReader reader(args.positional[0]);
+    auto start = std::chrono::steady_clock::now();
+    // Перцентили считаются по выборке первых трасс, остальные трассы (--all)
+    // дополняют min/max, среднее, RMS и гистограмму без хранения значений
+    int sample_traces = args.has("--traces") ? parse_int(args.get("--traces")) : 1000;
+    AmplitudeStats stats = compute_amplitude_stats(reader, sample_traces);
+    if (args.has("--all") && stats.valid() && stats.traces_analyzed < reader.num_traces()) {
+        accumulate_amplitude_stats(stats, reader, stats.traces_analyzed, reader.num_traces() - stats.traces_analyzed);
+    }
+    if (!stats.valid()) {
+        std::printf("no finite samples\n");
+        return 1;
+    }
+    std::printf("traces analyzed: %d\n", stats.traces_analyzed);
+    std::printf("samples:         %lld\n", static_cast<long long>(stats.sample_count));
+    std::printf("min:             %g\n", stats.min_amplitude);
+    std::printf("max:             %g\n", stats.max_amplitude);
+    std::printf("mean:            %g\n", stats.mean);
+    std::printf("rms:             %g\n", stats.rms);
+    const int steps[] = { 1, 10, 50, 500, 950, 990, 999 }; // в десятых долях процента
+    for (int step : steps) {
+        std::printf("p%-5g           %g\n", step / 10.0, stats.percentiles[step]);
+    }
+    std::printf("time:            %.3f s\n", seconds_since(start));
+    return 0;
+}
+
+int cmd_index(const Args& args) {
+    require_positional(args, 1, "index FILE --keys K1[,K2...] [--sort KEY] [--db PATH]");
+    std::vector<std::string> keys = split(args.get("--keys"), ',');
+    if (keys.empty()) throw std::invalid_argument("index needs --keys");
+    const std::string& file = args.positional[0];
+    std::string db = args.get("--db");
+    if (db.empty()) {
+        db = file + ".";
+        for (size_t i = 0; i < keys.size(); ++i) db += (i ? "_" : "") + keys[i];
+        db += ".db";
+    }
+
+    SegyReader reader(file);
+    auto start = std::chrono::steady_clock::now();
+    TraceMap map(db, keys);
+    map.build_map(reader, args.get("--sort"), progress_printer());
+    std::printf("index:           %s\n", db.c_str());
+    std::printf("traces:          %d\n", reader.num_traces());
+    std::printf("%-16s %zu values\n", (keys[0] + ":").c_str(), map.get_unique_values(keys[0]).size());
+    std::printf("time:            %.3f s\n", seconds_since(start));
+    return 0;
+}
+
+// "0-99,200,300-310": диапазоны включительно
+std::vector<int> parse_trace_spec(const std::string& spec, int num_traces) {
+    std::vector<int> traces;
+    for (const std::string& part : split(spec, ',')) {
+        size_t dash = part.find('-', 1);
+        int first = parse_int(part.substr(0, dash));
+        int last = dash == std::string::npos ? first : parse_int(part.substr(dash + 1));
+        if (first < 0 || last < first || last >= num_traces) {
+            throw std::invalid_argument("Trace range out of file: " + part);
+        }
+        for (int t = first; t <= last; ++t) traces.push_back(t);
+    }
+    return traces;
+}
+
+int cmd_extract(const Args& args) {
+    require_positional(args, 2, "extract FILE OUT [--traces SPEC] [--where KEY=LO:HI]...");
+    SegyReader reader(args.positional[0]);
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<int> traces;
+    if (args.has("--traces")) {
+        traces = parse_trace_spec(args.get("--traces"), reader.num_traces());
+    } else {
+        traces.resize(reader.num_traces());
+        for (int t = 0; t < reader.num_traces(); ++t) traces[t] = t;
+    }
+
+    // Условия по заголовкам проверяются по колонкам, извлеченным параллельно за один проход
+    std::vector<std::string> where = args.all("--where");
+    if (!where.empty()) {
+        std::vector<std::string> names;
+        std::vector<std::pair<int, int>> bounds;
+        for (const std::string& condition : where) {
+            size_t eq = condition.find('=');
+            size_t colon = condition.find(':', eq);
+            if (eq == std::string::npos) throw std::invalid_argument("Expected KEY=LO:HI, got " + condition);
+            names.push_back(condition.substr(0, eq));
+            int lo = parse_int(condition.substr(eq + 1, colon == std::string::npos ? std::string::npos : colon - eq - 1));
+            int hi = colon == std::string::npos ? lo : parse_int(condition.substr(colon + 1));
+            bounds.push_back(std::make_pair(lo, hi));
+        }
+        HeaderColumns columns = read_header_columns(reader, names, progress_printer());
+        std::vector<int> selected;
+        for (int t : traces) {
+            bool match = true;
+            for (size_t k = 0; k < names.size() && match; ++k) {
+                int32_t value = columns.columns[k][t];
+                match = value >= bounds[k].first && value <= bounds[k].second;
+            }
+            if (match) selected.push_back(t);
+        }
+        traces.swap(selected);
+    }
+    if (traces.empty()) throw std::runtime_error("No traces selected");
+
+    RawExportStats stats;
+    export_raw_traces(reader, traces, args.positional[1], &stats, progress_printer());
+    std::printf("traces:          %lld\n", static_cast<long long>(stats.traces));
+    std::printf("copied:          %.1f MB via %s\n", stats.bytes / 1048576.0, raw_copy_method_name(stats.method));
+    std::printf("copy rate:       %.1f MB/s\n", stats.mb_per_second());
+    std::printf("time:            %.3f s\n", seconds_since(start));
+    return 0;
+}
+
+int parse_format(const std::string& name) {
+    if (name == "ibm") return SEGY_FORMAT_IBM32;
+    if (name == "ieee") return SEGY_FORMAT_IEEE32;
+    if (name == "int16") return SEGY_FORMAT_INT16;
+    throw std::invalid_argument("Unknown output format: " + name + " (expected ibm, ieee or int16)");
+}
+
+int cmd_convert(const Args& args) {
+    require_positional(args, 2, "convert FILE OUT --format ibm|ieee|int16 [--sync]");
+    SegyReader reader(args.positional[0]);
+    auto start = std::chrono::steady_clock::now();
+
+    SegyWriterOptions options;
+    options.sample_format = parse_format(args.get("--format", "ieee"));
+    options.async = !args.has("--sync");
+    SegyWriter writer(args.positional[1], reader, options);
+
+    // Блок трасс читается одним вызовом и декодируется параллельно; кодирование
+    // и запись идут в SegyWriter (в асинхронном режиме запись - в фоновом потоке)
+    const size_t bsize = static_cast<size_t>(reader.trace_bsize());
+    const int block_traces = static_cast<int>(std::max<size_t>(1, CONVERT_BLOCK_BYTES / bsize));
+    const int n_traces = reader.num_traces();
+    const ProgressCallback progress = progress_printer();
+    std::vector<char> raw;
+    std::vector<std::vector<uint8_t>> headers;
+    std::vector<std::vector<float>> traces;
+    for (int first = 0; first < n_traces; first += block_traces) {
+        const int count = std::min(block_traces, n_traces - first);
+        raw.resize(static_cast<size_t>(count) * bsize);
+        reader.read_raw_block(first, raw.size(), raw.data());
+        headers.resize(count);
+        traces.resize(count);
+        #pragma omp parallel for schedule(static)
+        for (int t = 0; t < count; ++t) {
+            const uint8_t* record = reinterpret_cast<const uint8_t*>(raw.data()) + static_cast<size_t>(t) * bsize;
+            headers[t].assign(record, record + 240);
+            traces[t].resize(reader.num_samples());
+            reader.decode_trace_samples(record, traces[t].data());
+        }
+        writer.write_gather(headers, traces);
+        report_progress(progress, "Converting", first + count, n_traces);
+    }
+    writer.close();
+
+    SegyWriterStats stats = writer.stats();
+    std::printf("traces:          %lld\n", static_cast<long long>(stats.traces_written));
+    std::printf("format:          %d (%s)\n", options.sample_format, format_name(options.sample_format));
+    std::printf("written:         %.1f MB\n", stats.bytes_written / 1048576.0);
+    std::printf("encode time:     %.3f s\n", stats.encode_seconds);
+    std::printf("write time:      %.3f s\n", stats.write_seconds);
+    std::printf("time:            %.3f s\n", seconds_since(start));
+    return 0;
+}
+
+void print_usage() {
+    std::fprintf(stderr,
+                 "usage: segytool COMMAND [options]\n"
+                 "  info FILE [--geometry]                              file layout (and 3D grid)\n"
+                 "  stats FILE [--traces N | --all]                     amplitude statistics\n"
+                 "  index FILE --keys K1[,K2] [--sort KEY] [--db PATH]  build a header index\n"
+                 "  extract FILE OUT [--traces SPEC] [--where KEY=LO:HI]...\n"
+                 "                                                      copy selected traces\n"
+                 "  convert FILE OUT --format ibm|ieee|int16 [--sync]   re-encode samples\n"
+                 "options: --quiet suppresses progress on stderr\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        print_usage();
+        return 2;
+    }
+    const std::string command = argv[1];
+    try {
+        Args args = parse_args(argc, argv, 2);
+        if (command == "info") return cmd_info(args);
+        if (command == "stats") return cmd_stats(args);
+        if (command == "index") return cmd_index(args);
+        if (command == "extract") return cmd_extract(args);
+        if (command == "convert") return cmd_convert(args);
+        print_usage();
+        return 2;
+    } catch (const std::invalid_argument& e) {
+        std::fprintf(stderr, "segytool %s: %s\n", command.c_str(), e.what());
+        return 2;
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "segytool %s: %s\n", command.c_str(), e.what());
+        return 1;
+    }
+}